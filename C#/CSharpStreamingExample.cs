@@ -305,10 +305,11 @@ namespace LlamaCppIntegration.Streaming
             // Write stream_mode at offset 40961
             Marshal.WriteByte(_sharedMemoryPtr + 40961, streamMode ? (byte)1 : (byte)0);
 
-            // Initialize counters at offsets 40962, 40966, 40970
-            Marshal.WriteInt32(_sharedMemoryPtr + 40962, 0); // update_counter
-            Marshal.WriteByte(_sharedMemoryPtr + 40966, 0);  // generation_complete
-            Marshal.WriteInt32(_sharedMemoryPtr + 40967, 0); // tokens_generated
+            // Initialize counters at offsets 40964, 40968, 40972, 40976
+            Marshal.WriteInt32(_sharedMemoryPtr + 40964, 0); // update_counter
+            Marshal.WriteByte(_sharedMemoryPtr + 40968, 0);  // generation_complete
+            Marshal.WriteInt32(_sharedMemoryPtr + 40972, 0); // tokens_generated
+            Marshal.WriteInt32(_sharedMemoryPtr + 40976, 0); // response_length
         }
 
         private string ReadResponseFromSharedMemory()
@@ -328,9 +329,9 @@ namespace LlamaCppIntegration.Streaming
             string response = ReadResponseFromSharedMemory();
 
             // Read counters
-            int updateCounter = Marshal.ReadInt32(_sharedMemoryPtr + 40962);
-            bool isComplete = Marshal.ReadByte(_sharedMemoryPtr + 40966) != 0;
-            int tokensGenerated = Marshal.ReadInt32(_sharedMemoryPtr + 40967);
+            int updateCounter = Marshal.ReadInt32(_sharedMemoryPtr + 40964);
+            bool isComplete = Marshal.ReadByte(_sharedMemoryPtr + 40968) != 0;
+            int tokensGenerated = Marshal.ReadInt32(_sharedMemoryPtr + 40972);
 
             return (response, updateCounter, isComplete, tokensGenerated);
         }
@@ -1,6 +1,11 @@
 using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
+using System.Text;
 using System.Threading;
+using System.Threading.Channels;
 using System.Threading.Tasks;
 using System.Diagnostics;
 using System.Windows.Forms; // For TextBox - or use System.Windows.Controls for WPF
@@ -28,6 +33,9 @@ namespace LlamaCpp.Service
         [DllImport("libc.so.6", SetLastError = true)]
         public static extern int munmap(IntPtr addr, IntPtr length);
 
+        [DllImport("libc.so.6", SetLastError = true)]
+        public static extern int ftruncate(int fd, long length);
+
         [DllImport("libpthread.so.0", SetLastError = true)]
         public static extern IntPtr sem_open(string name, int oflag);
 
@@ -48,9 +56,63 @@ namespace LlamaCpp.Service
     /// </summary>
     public class StreamTextEventArgs : EventArgs
     {
-        public string Text { get; set; }
-        public int TokensGenerated { get; set; }
-        public bool IsComplete { get; set; }
+        private readonly StringBuilder _text;
+        private readonly int _textLength;
+
+        internal StreamTextEventArgs(StringBuilder text)
+        {
+            _text = text;
+            _textLength = text.Length;
+        }
+
+        /// <summary>
+        /// Text generated since the previous update - append it to the output
+        /// </summary>
+        public string Delta { get; internal set; }
+
+        /// <summary>
+        /// Byte offset of the delta in the UTF-8 response
+        /// </summary>
+        public int Offset { get; internal set; }
+
+        /// <summary>
+        /// Full text generated so far (built on demand, prefer Delta)
+        /// </summary>
+        public string Text => _text.ToString(0, _textLength);
+
+        public int RequestId { get; internal set; }
+        public int TokensGenerated { get; internal set; }
+        public bool IsComplete { get; internal set; }
+    }
+    #endregion
+
+    #region Request Options
+    /// <summary>
+    /// Scheduling class of a request: interactive requests are served first and
+    /// preempt background generations at the next token
+    /// </summary>
+    public enum LLMRequestPriority
+    {
+        Background = 0,
+        Interactive = 1
+    }
+
+    /// <summary>
+    /// Per-request scheduling options
+    /// </summary>
+    public class LLMRequestOptions
+    {
+        public LLMRequestPriority Priority { get; set; } = LLMRequestPriority.Interactive;
+
+        /// <summary>
+        /// Time within which generation must start, otherwise the request fails with a TimeoutException (null = no deadline)
+        /// </summary>
+        public TimeSpan? Deadline { get; set; }
+
+        /// <summary>
+        /// Maximum tokens to generate (0 = until the model stops)
+        /// </summary>
+        public int MaxTokens { get; set; } = 0;
     }
     #endregion
 
@@ -63,6 +125,11 @@ namespace LlamaCpp.Service
         public string ChatbotPath { get; set; } = "./build/chatbot";
         public string DefaultSystemPrompt { get; set; } = "You are my best assistance.";
         public int InitializationDelayMs { get; set; } = 3000;
+
+        /// <summary>
+        /// Number of C++ worker processes serving requests in parallel (--workers), they share the loaded model
+        /// </summary>
+        public int Workers { get; set; } = 1;
     }
     #endregion
 
@@ -74,20 +141,87 @@ namespace LlamaCpp.Service
     {
         #region Constants
         private const string SharedMemoryName = "/llama_cpp_shared_mem";
-        private const string SemReadyName = "/llama_cpp_sem_ready";
-        private const string SemPromptsWrittenName = "/llama_cpp_sem_prompts_written";
-        private const string SemResponseWrittenName = "/llama_cpp_sem_response_written";
-        private const string SemChunkReadyName = "/llama_cpp_sem_chunk_ready";
-        private const int SharedMemorySize = 45000;
+        private const string SemQueueName = "/llama_cpp_sem_queue";
+        private const string SemQueueLockName = "/llama_cpp_sem_queue_lock";
+        private const string SemQueueFreeName = "/llama_cpp_sem_queue_free";
+        private const string SemSlotNamePrefix = "/llama_cpp_sem_slot_";
+        private const string SlotDataNamePrefix = "/llama_cpp_slot_data_";
+        private const string SemTokenizerLockName = "/llama_cpp_sem_tokenizer_lock";
+        private const string SemTokenizerRequestName = "/llama_cpp_sem_tokenizer_request";
+        private const string SemTokenizerResponseName = "/llama_cpp_sem_tokenizer_response";
+        private const string TokenizerDataName = "/llama_cpp_tokenizer_data";
+
+        // Request queue in SharedMemoryData (main.cpp)
+        private const int QueueSlotsOffset = 40992;
+        private const int NextRequestIdOffset = 40996;
+        private const int SlotsOffset = 41000;
+        private const int SlotSize = 72;
+        private const int MaxQueueSlots = 8;
+        private const int TokenizerOffset = SlotsOffset + MaxQueueSlots * SlotSize;
+        private const int TokenizerSize = 40;
+        private const int SharedMemorySize = TokenizerOffset + TokenizerSize;
+
+        // Field offsets of RequestSlot (main.cpp)
+        private const int SlotStateOffset = 0;
+        private const int SlotRequestIdOffset = 4;
+        private const int SlotPriorityOffset = 8;
+        private const int SlotStatusOffset = 12;
+        private const int SlotDeadlineOffset = 16;
+        private const int SlotMaxTokensOffset = 24;
+        private const int SlotStreamModeOffset = 28;
+        private const int SlotGenerationCompleteOffset = 29;
+        private const int SlotUpdateCounterOffset = 32;
+        private const int SlotTokensGeneratedOffset = 36;
+        private const int SlotResponseLengthOffset = 40;
+        private const int SlotReaderWaitingOffset = 44;
+        private const int SlotUpdateAckOffset = 48;
+        private const int SlotRequestSizeOffset = 52;
+        private const int SlotResponseOffsetOffset = 56;
+        private const int SlotDataSizeOffset = 64;
+
+        // Room reserved for the response when a request is written, C++ grows the data segment beyond it
+        private const int InitialResponseReserve = 16 * 1024;
+
+        // Field offsets of TokenizerChannel (main.cpp)
+        private const int TokenizerOpOffset = 0;
+        private const int TokenizerItemsOffset = 4;
+        private const int TokenizerFlagsOffset = 8;
+        private const int TokenizerStatusOffset = 12;
+        private const int TokenizerRequestSizeOffset = 16;
+        private const int TokenizerResponseOffsetOffset = 20;
+        private const int TokenizerResponseSizeOffset = 24;
+        private const int TokenizerDataSizeOffset = 32;
+
+        // TokenizerOp and TokenizerFlags (main.cpp)
+        private const int TokenizerTokenize = 0;
+        private const int TokenizerDetokenize = 1;
+        private const int TokenizerCount = 2;
+        private const int TokenizerCountPrompt = 3;
+        private const int TokenizerAddSpecial = 1;
+        private const int TokenizerParseSpecial = 2;
+
+        // RequestSlotState and RequestStatus (main.cpp)
+        private const int SlotFree = 0;
+        private const int SlotClaimed = 1;
+        private const int SlotQueued = 2;
+        private const int SlotDone = 4;
+        private const int StatusExpired = 1;
+        private const int StatusFailed = 2;
         #endregion
 
         #region Private Fields
         private IntPtr _sharedMemoryPtr = IntPtr.Zero;
         private int _shmFd = -1;
-        private IntPtr _semReady = IntPtr.Zero;
-        private IntPtr _semPromptsWritten = IntPtr.Zero;
-        private IntPtr _semResponseWritten = IntPtr.Zero;
-        private IntPtr _semChunkReady = IntPtr.Zero;
+        private IntPtr _semQueue = IntPtr.Zero;
+        private IntPtr _semQueueLock = IntPtr.Zero;
+        private IntPtr _semQueueFree = IntPtr.Zero;
+        private readonly IntPtr[] _semSlots = new IntPtr[MaxQueueSlots];
+        private readonly DataSegment[] _slotSegments = new DataSegment[MaxQueueSlots];
+        private readonly DataSegment _tokenizerSegment = new DataSegment();
+        private IntPtr _semTokenizerLock = IntPtr.Zero;
+        private IntPtr _semTokenizerRequest = IntPtr.Zero;
+        private IntPtr _semTokenizerResponse = IntPtr.Zero;
+        private int _queueSlots = 0;
         private Process _cppProcess;
         private bool _isInitialized = false;
         private bool _isDisposed = false;
@@ -125,6 +259,7 @@ namespace LlamaCpp.Service
                 var startInfo = new ProcessStartInfo
                 {
                     FileName = _config.ChatbotPath,
+                    Arguments = _config.Workers > 1 ? $"--workers {_config.Workers}" : string.Empty,
                     UseShellExecute = false,
                     RedirectStandardOutput = true,
                     RedirectStandardError = true,
@@ -198,17 +333,45 @@ namespace LlamaCpp.Service
                 throw new Exception($"Failed to map shared memory: {Marshal.GetLastWin32Error()}");
             }
 
+            _queueSlots = Math.Min(Marshal.ReadInt32(_sharedMemoryPtr + QueueSlotsOffset), MaxQueueSlots);
+            if (_queueSlots <= 0)
+            {
+                throw new Exception("The chatbot process does not provide a request queue");
+            }
+
             // Open semaphores
-            _semReady = PosixInterop.sem_open(SemReadyName, 0);
-            _semPromptsWritten = PosixInterop.sem_open(SemPromptsWrittenName, 0);
-            _semResponseWritten = PosixInterop.sem_open(SemResponseWrittenName, 0);
-            _semChunkReady = PosixInterop.sem_open(SemChunkReadyName, 0);
+            _semQueue = PosixInterop.sem_open(SemQueueName, 0);
+            _semQueueLock = PosixInterop.sem_open(SemQueueLockName, 0);
+            _semQueueFree = PosixInterop.sem_open(SemQueueFreeName, 0);
+            bool slotsOpen = true;
+            for (int i = 0; i < _queueSlots; i++)
+            {
+                _semSlots[i] = PosixInterop.sem_open(SemSlotNamePrefix + i, 0);
+                slotsOpen &= _semSlots[i] != IntPtr.Zero;
+            }
 
-            if (_semReady == IntPtr.Zero || _semPromptsWritten == IntPtr.Zero ||
-                _semResponseWritten == IntPtr.Zero || _semChunkReady == IntPtr.Zero)
+            if (_semQueue == IntPtr.Zero || _semQueueLock == IntPtr.Zero ||
+                _semQueueFree == IntPtr.Zero || !slotsOpen)
             {
                 throw new Exception("Failed to open semaphores");
             }
+
+            // Open the slot data segments, they are mapped on first use
+            for (int i = 0; i < _queueSlots; i++)
+            {
+                _slotSegments[i] = new DataSegment();
+                OpenSegment(_slotSegments[i], SlotDataNamePrefix + i, SlotPtr(i) + SlotDataSizeOffset);
+            }
+
+            // Tokenizer channel
+            _semTokenizerLock = PosixInterop.sem_open(SemTokenizerLockName, 0);
+            _semTokenizerRequest = PosixInterop.sem_open(SemTokenizerRequestName, 0);
+            _semTokenizerResponse = PosixInterop.sem_open(SemTokenizerResponseName, 0);
+            if (_semTokenizerLock == IntPtr.Zero || _semTokenizerRequest == IntPtr.Zero || _semTokenizerResponse == IntPtr.Zero)
+            {
+                throw new Exception("Failed to open tokenizer semaphores");
+            }
+            OpenSegment(_tokenizerSegment, TokenizerDataName, _sharedMemoryPtr + TokenizerOffset + TokenizerDataSizeOffset);
         }
         #endregion
 
@@ -218,36 +381,117 @@ namespace LlamaCpp.Service
         /// </summary>
         /// <param name="userPrompt">User's question or input</param>
         /// <param name="systemPrompt">Optional system prompt (uses default if null)</param>
+        /// <param name="options">Optional priority and deadline (interactive, no deadline if null)</param>
         /// <returns>Complete response text</returns>
-        public string GetResponse(string userPrompt, string systemPrompt = null)
+        public string GetResponse(string userPrompt, string systemPrompt = null, LLMRequestOptions options = null)
         {
-            if (!_isInitialized)
-                throw new InvalidOperationException("Service not initialized. Call Initialize() first.");
+            return RunRequest(userPrompt, systemPrompt, options, streamMode: false, onUpdate: null);
+        }
 
-            systemPrompt = systemPrompt ?? _config.DefaultSystemPrompt;
+        /// <summary>
+        /// Get response asynchronously in normal mode
+        /// </summary>
+        public async Task<string> GetResponseAsync(string userPrompt, string systemPrompt = null, LLMRequestOptions options = null)
+        {
+            return await Task.Run(() => GetResponse(userPrompt, systemPrompt, options));
+        }
+        #endregion
+
+        #region Public API - Tokenizer
+        // Tokenizer calls bypass the request queue: they are answered while generations run, and each call
+        // handles many strings at once.
+
+        /// <summary>
+        /// Tokenize texts with the model vocabulary
+        /// </summary>
+        /// <param name="addSpecial">Add BOS/EOS as the model expects</param>
+        /// <param name="parseSpecial">Treat special token text (e.g. &lt;|end|&gt;) as special tokens</param>
+        public int[][] Tokenize(IReadOnlyList<string> texts, bool addSpecial = false, bool parseSpecial = false)
+        {
+            byte[] response = RunTokenizerRequest(TokenizerTokenize, texts.Count, TokenizerFlags(addSpecial, parseSpecial),
+                                                  WriteTextItems(texts));
+            var reader = new BinaryReader(new MemoryStream(response));
+            var result = new int[texts.Count][];
+            for (int i = 0; i < result.Length; i++)
+            {
+                result[i] = new int[reader.ReadInt32()];
+                for (int k = 0; k < result[i].Length; k++)
+                    result[i][k] = reader.ReadInt32();
+            }
+            return result;
+        }
 
-            // Wait for C++ to be ready
-            PosixInterop.sem_wait(_semReady);
+        public int[] Tokenize(string text, bool addSpecial = false, bool parseSpecial = false)
+        {
+            return Tokenize(new[] { text }, addSpecial, parseSpecial)[0];
+        }
 
-            // Write request
-            WriteRequest(systemPrompt, userPrompt, streamMode: false);
+        /// <summary>
+        /// Convert token sequences back to text
+        /// </summary>
+        /// <param name="renderSpecial">Render special tokens as their text instead of dropping them</param>
+        public string[] Detokenize(IReadOnlyList<int[]> tokens, bool renderSpecial = true)
+        {
+            var stream = new MemoryStream();
+            var writer = new BinaryWriter(stream);
+            foreach (int[] sequence in tokens)
+            {
+                writer.Write(sequence.Length);
+                foreach (int token in sequence)
+                    writer.Write(token);
+            }
 
-            // Signal C++
-            PosixInterop.sem_post(_semPromptsWritten);
+            byte[] response = RunTokenizerRequest(TokenizerDetokenize, tokens.Count, TokenizerFlags(false, renderSpecial),
+                                                  stream.ToArray());
+            var reader = new BinaryReader(new MemoryStream(response));
+            var result = new string[tokens.Count];
+            for (int i = 0; i < result.Length; i++)
+                result[i] = Encoding.UTF8.GetString(reader.ReadBytes(reader.ReadInt32()));
+            return result;
+        }
 
-            // Wait for complete response
-            PosixInterop.sem_wait(_semResponseWritten);
+        public string Detokenize(int[] tokens, bool renderSpecial = true)
+        {
+            return Detokenize(new[] { tokens }, renderSpecial)[0];
+        }
 
-            // Read and return response
-            return ReadResponse();
+        /// <summary>
+        /// Count the tokens of texts, cheaper than Tokenize when only the counts are needed
+        /// </summary>
+        public int[] CountTokens(IReadOnlyList<string> texts, bool addSpecial = false, bool parseSpecial = false)
+        {
+            byte[] response = RunTokenizerRequest(TokenizerCount, texts.Count, TokenizerFlags(addSpecial, parseSpecial),
+                                                  WriteTextItems(texts));
+            return ReadCounts(response, texts.Count);
+        }
+
+        public int CountTokens(string text, bool addSpecial = false, bool parseSpecial = false)
+        {
+            return CountTokens(new[] { text }, addSpecial, parseSpecial)[0];
         }
 
         /// <summary>
-        /// Get response asynchronously in normal mode
+        /// Count the prompt tokens GetResponse would evaluate for each user prompt, chat template included.
+        /// Prompts must stay below the context size (2048 tokens) minus the room needed for the response.
         /// </summary>
-        public async Task<string> GetResponseAsync(string userPrompt, string systemPrompt = null)
+        /// <param name="systemPrompt">Optional system prompt (uses default if null)</param>
+        public int[] CountPromptTokens(IReadOnlyList<string> userPrompts, string systemPrompt = null)
         {
-            return await Task.Run(() => GetResponse(userPrompt, systemPrompt));
+            systemPrompt = systemPrompt ?? _config.DefaultSystemPrompt;
+            var items = new List<string>(2 * userPrompts.Count);
+            foreach (string userPrompt in userPrompts)
+            {
+                items.Add(systemPrompt);
+                items.Add(userPrompt);
+            }
+
+            byte[] response = RunTokenizerRequest(TokenizerCountPrompt, userPrompts.Count, 0, WriteTextItems(items));
+            return ReadCounts(response, userPrompts.Count);
+        }
+
+        public int CountPromptTokens(string userPrompt, string systemPrompt = null)
+        {
+            return CountPromptTokens(new[] { userPrompt }, systemPrompt)[0];
         }
         #endregion
 
@@ -258,66 +502,60 @@ namespace LlamaCpp.Service
         /// </summary>
         /// <param name="userPrompt">User's question or input</param>
         /// <param name="systemPrompt">Optional system prompt (uses default if null)</param>
+        /// <param name="options">Optional priority and deadline (interactive, no deadline if null)</param>
         /// <returns>Complete final response text</returns>
-        public string GetResponseStreaming(string userPrompt, string systemPrompt = null)
+        public string GetResponseStreaming(string userPrompt, string systemPrompt = null, LLMRequestOptions options = null)
         {
-            if (!_isInitialized)
-                throw new InvalidOperationException("Service not initialized. Call Initialize() first.");
-
-            systemPrompt = systemPrompt ?? _config.DefaultSystemPrompt;
-
-            // Wait for C++ to be ready
-            PosixInterop.sem_wait(_semReady);
-
-            // Write request with streaming enabled
-            WriteRequest(systemPrompt, userPrompt, streamMode: true);
+            return RunRequest(userPrompt, systemPrompt, options, streamMode: true, onUpdate: e => OnStreamUpdate?.Invoke(this, e));
+        }
 
-            // Signal C++
-            PosixInterop.sem_post(_semPromptsWritten);
+        /// <summary>
+        /// Get response asynchronously in streaming mode
+        /// </summary>
+        public async Task<string> GetResponseStreamingAsync(string userPrompt, string systemPrompt = null, LLMRequestOptions options = null)
+        {
+            return await Task.Run(() => GetResponseStreaming(userPrompt, systemPrompt, options));
+        }
 
-            // Process streaming updates
-            string finalResponse = "";
-            int lastUpdateCounter = 0;
+        /// <summary>
+        /// Stream the response as text deltas
+        /// </summary>
+        /// <param name="userPrompt">User's question or input</param>
+        /// <param name="systemPrompt">Optional system prompt (uses default if null)</param>
+        /// <param name="options">Optional priority and deadline (interactive, no deadline if null)</param>
+        /// <param name="cancellationToken">Stops the enumeration; the request itself still runs to completion</param>
+        /// <returns>Text generated since the previous delta, in order</returns>
+        public async IAsyncEnumerable<string> StreamResponseAsync(
+            string userPrompt,
+            string systemPrompt = null,
+            LLMRequestOptions options = null,
+            [EnumeratorCancellation] CancellationToken cancellationToken = default)
+        {
+            var deltas = Channel.CreateUnbounded<string>(new UnboundedChannelOptions { SingleReader = true, SingleWriter = true });
 
-            while (true)
+            Task<string> request = Task.Run(() =>
             {
-                // Wait for chunk signal
-                PosixInterop.sem_wait(_semChunkReady);
-
-                // Read current state
-                var (response, updateCounter, isComplete, tokensGenerated) = ReadStreamingState();
-
-                // Check if this is a new update
-                if (updateCounter > lastUpdateCounter)
+                try
                 {
-                    finalResponse = response;
-                    lastUpdateCounter = updateCounter;
-
-                    // Fire event for UI update
-                    OnStreamUpdate?.Invoke(this, new StreamTextEventArgs
+                    return RunRequest(userPrompt, systemPrompt, options, streamMode: true, onUpdate: e =>
                     {
-                        Text = response,
-                        TokensGenerated = tokensGenerated,
-                        IsComplete = isComplete
+                        if (e.Delta.Length > 0)
+                            deltas.Writer.TryWrite(e.Delta);
                     });
-
-                    if (isComplete)
-                        break;
                 }
-            }
-
-            // Wait for final completion signal
-            PosixInterop.sem_wait(_semResponseWritten);
+                finally
+                {
+                    deltas.Writer.TryComplete();
+                }
+            });
 
-            return finalResponse;
-        }
+            await foreach (string delta in deltas.Reader.ReadAllAsync(cancellationToken))
+            {
+                yield return delta;
+            }
 
-        /// <summary>
-        /// Get response asynchronously in streaming mode
-        /// </summary>
-        public async Task<string> GetResponseStreamingAsync(string userPrompt, string systemPrompt = null)
-        {
-            return await Task.Run(() => GetResponseStreaming(userPrompt, systemPrompt));
+            // Surface failures of the request
+            await request;
         }
         #endregion
 
@@ -337,31 +575,21 @@ namespace LlamaCpp.Service
             if (textBox == null)
                 throw new ArgumentNullException(nameof(textBox));
 
-            // Subscribe to streaming updates
-            EventHandler<StreamTextEventArgs> handler = (s, e) =>
+            // Receive the updates of this request only (other requests may be streaming concurrently)
+            Action<StreamTextEventArgs> handler = e =>
             {
                 // Update TextBox on UI thread
                 if (textBox.InvokeRequired)
                 {
-                    textBox.Invoke(new Action(() => textBox.Text = e.Text));
+                    textBox.Invoke(new Action(() => textBox.AppendText(e.Delta)));
                 }
                 else
                 {
-                    textBox.Text = e.Text;
+                    textBox.AppendText(e.Delta);
                 }
             };
 
-            OnStreamUpdate += handler;
-
-            try
-            {
-                string result = await GetResponseStreamingAsync(userPrompt, systemPrompt);
-                return result;
-            }
-            finally
-            {
-                OnStreamUpdate -= handler;
-            }
+            return await Task.Run(() => RunRequest(userPrompt, systemPrompt, null, streamMode: true, onUpdate: handler));
         }
 
         /// <summary>
@@ -379,79 +607,400 @@ namespace LlamaCpp.Service
             if (textBox == null)
                 throw new ArgumentNullException(nameof(textBox));
 
-            // Subscribe to streaming updates
-            EventHandler<StreamTextEventArgs> handler = (s, e) =>
+            // Receive the updates of this request only (other requests may be streaming concurrently)
+            Action<StreamTextEventArgs> handler = e =>
             {
                 // Update TextBox on UI thread
-                textBox.Dispatcher.Invoke(() => textBox.Text = e.Text);
+                textBox.Dispatcher.Invoke(() => textBox.AppendText(e.Delta));
             };
 
-            OnStreamUpdate += handler;
+            return await Task.Run(() => RunRequest(userPrompt, systemPrompt, null, streamMode: true, onUpdate: handler));
+        }
+        #endregion
+
+        #region Helper Methods
+        private string RunRequest(string userPrompt, string systemPrompt, LLMRequestOptions options, bool streamMode,
+                                  Action<StreamTextEventArgs> onUpdate)
+        {
+            if (!_isInitialized)
+                throw new InvalidOperationException("Service not initialized. Call Initialize() first.");
+
+            systemPrompt = systemPrompt ?? _config.DefaultSystemPrompt;
+            options = options ?? new LLMRequestOptions();
+
+            // Take a free slot of the request queue, write the request and ring the scheduler
+            var (slot, requestId) = ClaimSlot();
+            IntPtr slotPtr = SlotPtr(slot);
+            int lastUpdateCounter = 0;
+            bool queued = false;
 
             try
             {
-                string result = await GetResponseStreamingAsync(userPrompt, systemPrompt);
-                return result;
+                WriteRequest(slot, requestId, systemPrompt, userPrompt, options, streamMode);
+                Thread.MemoryBarrier(); // the request must be complete before the slot is marked queued
+                Marshal.WriteInt32(slotPtr + SlotStateOffset, SlotQueued);
+                PosixInterop.sem_post(_semQueue);
+                queued = true;
+
+                // Process updates: C++ appends to the response and publishes its length,
+                // so only the bytes after the last read offset are copied and decoded
+                var text = new StringBuilder();
+                Decoder decoder = Encoding.UTF8.GetDecoder(); // keeps UTF-8 sequences split across tokens
+                int readOffset = 0;
+
+                while (true)
+                {
+                    // Wait for the next (coalesced) update
+                    WaitForUpdate(slot, lastUpdateCounter);
+
+                    // Read current state
+                    var (responseLength, updateCounter, isComplete, tokensGenerated) = ReadStreamingState(slotPtr);
+
+                    // Check if this is a new update
+                    if (updateCounter > lastUpdateCounter)
+                    {
+                        lastUpdateCounter = updateCounter;
+
+                        int offset = readOffset;
+                        string delta = ReadResponseDelta(slot, decoder, readOffset, responseLength, flush: isComplete);
+                        readOffset = responseLength;
+                        text.Append(delta);
+
+                        // Fire event for UI update
+                        if (streamMode && onUpdate != null)
+                        {
+                            onUpdate(new StreamTextEventArgs(text)
+                            {
+                                Delta = delta,
+                                Offset = offset,
+                                RequestId = requestId,
+                                TokensGenerated = tokensGenerated,
+                                IsComplete = isComplete
+                            });
+                        }
+
+                        // Tell C++ we kept up, it batches more updates together while we lag behind
+                        Marshal.WriteInt32(slotPtr + SlotUpdateAckOffset, updateCounter);
+
+                        if (isComplete)
+                            break;
+                    }
+                }
+
+                switch (Marshal.ReadInt32(slotPtr + SlotStatusOffset))
+                {
+                    case StatusExpired:
+                        throw new TimeoutException("The request deadline passed before generation started");
+                    case StatusFailed:
+                        throw new Exception("Generation failed (the prompt may not fit in the context)");
+                }
+
+                return text.ToString();
             }
             finally
             {
-                OnStreamUpdate -= handler;
+                // C++ owns the slot until the request is done, even if an update handler threw
+                if (queued)
+                    WaitForSlotDone(slot, lastUpdateCounter);
+                ReleaseSlot(slot);
             }
         }
-        #endregion
 
-        #region Helper Methods
-        private void WriteRequest(string systemPrompt, string userPrompt, bool streamMode)
+        private byte[] RunTokenizerRequest(int op, int nItems, int flags, byte[] request)
+        {
+            if (!_isInitialized)
+                throw new InvalidOperationException("Service not initialized. Call Initialize() first.");
+
+            PosixInterop.sem_wait(_semTokenizerLock);
+            try
+            {
+                IntPtr tokenizerPtr = _sharedMemoryPtr + TokenizerOffset;
+                IntPtr data = EnsureSegment(_tokenizerSegment, request.Length);
+                Marshal.Copy(request, 0, data, request.Length);
+                Marshal.WriteInt32(tokenizerPtr + TokenizerOpOffset, op);
+                Marshal.WriteInt32(tokenizerPtr + TokenizerItemsOffset, nItems);
+                Marshal.WriteInt32(tokenizerPtr + TokenizerFlagsOffset, flags);
+                Marshal.WriteInt32(tokenizerPtr + TokenizerRequestSizeOffset, request.Length);
+                Thread.MemoryBarrier(); // the request must be complete before C++ is rung
+
+                PosixInterop.sem_post(_semTokenizerRequest);
+                PosixInterop.sem_wait(_semTokenizerResponse);
+                Thread.MemoryBarrier();
+
+                if (Marshal.ReadInt32(tokenizerPtr + TokenizerStatusOffset) != 0)
+                    throw new ArgumentException("The tokenizer rejected the request (invalid token id?)");
+
+                // C++ may have grown the segment to fit the response
+                data = MapSegment(_tokenizerSegment);
+                int responseOffset = Marshal.ReadInt32(tokenizerPtr + TokenizerResponseOffsetOffset);
+                byte[] response = new byte[Marshal.ReadInt32(tokenizerPtr + TokenizerResponseSizeOffset)];
+                Marshal.Copy(data + responseOffset, response, 0, response.Length);
+                return response;
+            }
+            finally
+            {
+                PosixInterop.sem_post(_semTokenizerLock);
+            }
+        }
+
+        private static int TokenizerFlags(bool addSpecial, bool parseSpecial)
+        {
+            return (addSpecial ? TokenizerAddSpecial : 0) | (parseSpecial ? TokenizerParseSpecial : 0);
+        }
+
+        private static byte[] WriteTextItems(IReadOnlyList<string> texts)
+        {
+            var stream = new MemoryStream();
+            var writer = new BinaryWriter(stream);
+            foreach (string text in texts)
+            {
+                byte[] bytes = Encoding.UTF8.GetBytes(text ?? string.Empty);
+                writer.Write(bytes.Length);
+                writer.Write(bytes);
+            }
+            return stream.ToArray();
+        }
+
+        private static int[] ReadCounts(byte[] response, int count)
+        {
+            var counts = new int[count];
+            Buffer.BlockCopy(response, 0, counts, 0, count * sizeof(int));
+            return counts;
+        }
+
+        private IntPtr SlotPtr(int slot)
+        {
+            return _sharedMemoryPtr + SlotsOffset + slot * SlotSize;
+        }
+
+        private (int slot, int requestId) ClaimSlot()
+        {
+            PosixInterop.sem_wait(_semQueueFree);
+            PosixInterop.sem_wait(_semQueueLock);
+            try
+            {
+                for (int i = 0; i < _queueSlots; i++)
+                {
+                    if (Marshal.ReadInt32(SlotPtr(i) + SlotStateOffset) == SlotFree)
+                    {
+                        Marshal.WriteInt32(SlotPtr(i) + SlotStateOffset, SlotClaimed);
+                        int requestId = Marshal.ReadInt32(_sharedMemoryPtr + NextRequestIdOffset) + 1;
+                        Marshal.WriteInt32(_sharedMemoryPtr + NextRequestIdOffset, requestId);
+                        return (i, requestId);
+                    }
+                }
+            }
+            finally
+            {
+                PosixInterop.sem_post(_semQueueLock);
+            }
+
+            PosixInterop.sem_post(_semQueueFree);
+            throw new InvalidOperationException("No free request slot");
+        }
+
+        private void ReleaseSlot(int slot)
+        {
+            Thread.MemoryBarrier();
+            Marshal.WriteInt32(SlotPtr(slot) + SlotStateOffset, SlotFree);
+            PosixInterop.sem_post(_semQueueFree);
+        }
+
+        /// <summary>
+        /// Wait until the update_counter of a slot moves past lastUpdateCounter. Spins briefly first; before blocking on
+        /// the slot semaphore, sets reader_waiting so C++ posts it (it skips the post otherwise).
+        /// </summary>
+        private void WaitForUpdate(int slot, int lastUpdateCounter)
         {
-            // Write system prompt at offset 0
-            byte[] systemBytes = new byte[4096];
-            if (!string.IsNullOrEmpty(systemPrompt))
+            IntPtr slotPtr = SlotPtr(slot);
+            var spinner = new SpinWait();
+            while (Marshal.ReadInt32(slotPtr + SlotUpdateCounterOffset) == lastUpdateCounter)
             {
-                byte[] temp = System.Text.Encoding.UTF8.GetBytes(systemPrompt);
-                Array.Copy(temp, systemBytes, Math.Min(temp.Length, 4095));
+                if (!spinner.NextSpinWillYield)
+                {
+                    spinner.SpinOnce();
+                    continue;
+                }
+
+                Marshal.WriteInt32(slotPtr + SlotReaderWaitingOffset, 1);
+                Thread.MemoryBarrier(); // the flag must be visible before update_counter is checked again
+                if (Marshal.ReadInt32(slotPtr + SlotUpdateCounterOffset) != lastUpdateCounter)
+                    break; // a post may still come, the loop above tolerates the spurious wakeup
+
+                PosixInterop.sem_wait(_semSlots[slot]);
+                spinner.Reset();
             }
-            Marshal.Copy(systemBytes, 0, _sharedMemoryPtr, 4096);
+            Thread.MemoryBarrier();
+        }
 
-            // Write user prompt at offset 4096
-            byte[] userBytes = new byte[4096];
-            if (!string.IsNullOrEmpty(userPrompt))
+        /// <summary>
+        /// Wait until C++ marks a slot SLOT_DONE. complete_slot sets generation_complete and bumps update_counter for
+        /// the last time before it stores the state, so once generation_complete is visible no further update comes:
+        /// the remaining window is polled instead of waiting on update_counter, which would block forever.
+        /// </summary>
+        private void WaitForSlotDone(int slot, int lastUpdateCounter)
+        {
+            IntPtr slotPtr = SlotPtr(slot);
+            var spinner = new SpinWait();
+            while (Marshal.ReadInt32(slotPtr + SlotStateOffset) != SlotDone)
             {
-                byte[] temp = System.Text.Encoding.UTF8.GetBytes(userPrompt);
-                Array.Copy(temp, userBytes, Math.Min(temp.Length, 4095));
+                if (Marshal.ReadByte(slotPtr + SlotGenerationCompleteOffset) != 0)
+                {
+                    spinner.SpinOnce(); // yields and sleeps once spinning no longer pays off
+                    continue;
+                }
+
+                WaitForUpdate(slot, lastUpdateCounter);
+                lastUpdateCounter = Marshal.ReadInt32(slotPtr + SlotUpdateCounterOffset);
             }
-            Marshal.Copy(userBytes, 0, _sharedMemoryPtr + 4096, 4096);
+            Thread.MemoryBarrier();
+        }
 
-            // Clear response buffer
-            byte[] clearBytes = new byte[32768];
-            Marshal.Copy(clearBytes, 0, _sharedMemoryPtr + 8192, 32768);
+        /// <summary>
+        /// A shared memory segment either side can grow: the grower resizes it and then publishes the new size
+        /// in the shared memory header, the other side remaps when the size no longer matches its mapping
+        /// </summary>
+        private sealed class DataSegment
+        {
+            public string Name;
+            public int Fd = -1;
+            public IntPtr Ptr = IntPtr.Zero;
+            public long Mapped;
+            public IntPtr SizePtr; // published size in SharedMemoryData
+        }
 
-            // Write flags
-            Marshal.WriteByte(_sharedMemoryPtr + 40960, 0); // shutdown_requested = false
-            Marshal.WriteByte(_sharedMemoryPtr + 40961, streamMode ? (byte)1 : (byte)0); // stream_mode
-            Marshal.WriteInt32(_sharedMemoryPtr + 40962, 0); // update_counter = 0
-            Marshal.WriteByte(_sharedMemoryPtr + 40966, 0); // generation_complete = false
-            Marshal.WriteInt32(_sharedMemoryPtr + 40967, 0); // tokens_generated = 0
+        private static void OpenSegment(DataSegment segment, string name, IntPtr sizePtr)
+        {
+            segment.Name = name;
+            segment.SizePtr = sizePtr;
+            segment.Fd = PosixInterop.shm_open(name, PosixInterop.O_RDWR, 0666);
+            if (segment.Fd < 0)
+            {
+                throw new Exception($"Failed to open {name}: {Marshal.GetLastWin32Error()}");
+            }
+        }
+
+        /// <summary>
+        /// Map the current size of a data segment. Either side may have grown it since it was last mapped.
+        /// </summary>
+        private static IntPtr MapSegment(DataSegment segment)
+        {
+            long size = Marshal.ReadInt64(segment.SizePtr);
+            Thread.MemoryBarrier(); // pairs with the release store of the size in C++
+            if (segment.Ptr != IntPtr.Zero && segment.Mapped == size)
+                return segment.Ptr;
+
+            IntPtr data = PosixInterop.mmap(IntPtr.Zero, new IntPtr(size), PosixInterop.PROT_READ | PosixInterop.PROT_WRITE,
+                                            PosixInterop.MAP_SHARED, segment.Fd, IntPtr.Zero);
+            if (data == PosixInterop.MAP_FAILED)
+            {
+                throw new Exception($"Failed to map {segment.Name}: {Marshal.GetLastWin32Error()}");
+            }
+
+            if (segment.Ptr != IntPtr.Zero)
+                PosixInterop.munmap(segment.Ptr, new IntPtr(segment.Mapped));
+            segment.Ptr = data;
+            segment.Mapped = size;
+            return data;
+        }
+
+        /// <summary>
+        /// Grow a data segment to at least minSize bytes, then map it
+        /// </summary>
+        private static IntPtr EnsureSegment(DataSegment segment, long minSize)
+        {
+            long size = Marshal.ReadInt64(segment.SizePtr);
+            if (size < minSize)
+            {
+                size = Math.Max(minSize, 2 * size);
+                if (PosixInterop.ftruncate(segment.Fd, size) != 0)
+                {
+                    throw new Exception($"Failed to grow {segment.Name}: {Marshal.GetLastWin32Error()}");
+                }
+                Marshal.WriteInt64(segment.SizePtr, size);
+            }
+            return MapSegment(segment);
         }
 
-        private string ReadResponse()
+        private static void CloseSegment(DataSegment segment)
         {
-            byte[] responseBytes = new byte[32768];
-            Marshal.Copy(_sharedMemoryPtr + 8192, responseBytes, 0, 32768);
+            if (segment == null) return;
+            if (segment.Ptr != IntPtr.Zero) PosixInterop.munmap(segment.Ptr, new IntPtr(segment.Mapped));
+            segment.Ptr = IntPtr.Zero;
+            segment.Mapped = 0;
+            if (segment.Fd >= 0) PosixInterop.close(segment.Fd);
+            segment.Fd = -1;
+        }
 
-            int length = Array.IndexOf(responseBytes, (byte)0);
-            if (length < 0) length = 32768;
+        private void WriteRequest(int slot, int requestId, string systemPrompt, string userPrompt,
+                                  LLMRequestOptions options, bool streamMode)
+        {
+            IntPtr slotPtr = SlotPtr(slot);
+
+            // Write the request record: [int32 length][system prompt][int32 length][user prompt], no size limit
+            byte[] systemBytes = Encoding.UTF8.GetBytes(systemPrompt ?? string.Empty);
+            byte[] userBytes = Encoding.UTF8.GetBytes(userPrompt ?? string.Empty);
+            int requestSize = 8 + systemBytes.Length + userBytes.Length;
+            int responseOffset = (requestSize + 63) & ~63;
+
+            IntPtr data = EnsureSegment(_slotSegments[slot], (long)responseOffset + InitialResponseReserve);
+            Marshal.WriteInt32(data, systemBytes.Length);
+            Marshal.Copy(systemBytes, 0, data + 4, systemBytes.Length);
+            Marshal.WriteInt32(data + 4 + systemBytes.Length, userBytes.Length);
+            Marshal.Copy(userBytes, 0, data + 8 + systemBytes.Length, userBytes.Length);
+            Marshal.WriteInt32(slotPtr + SlotRequestSizeOffset, requestSize);
+            Marshal.WriteInt32(slotPtr + SlotResponseOffsetOffset, responseOffset);
+
+            // Scheduling
+            long deadline = options.Deadline.HasValue
+                ? DateTimeOffset.UtcNow.Add(options.Deadline.Value).ToUnixTimeMilliseconds()
+                : 0;
+            Marshal.WriteInt32(slotPtr + SlotRequestIdOffset, requestId);
+            Marshal.WriteInt32(slotPtr + SlotPriorityOffset, (int)options.Priority);
+            Marshal.WriteInt32(slotPtr + SlotStatusOffset, 0);
+            Marshal.WriteInt64(slotPtr + SlotDeadlineOffset, deadline);
+            Marshal.WriteInt32(slotPtr + SlotMaxTokensOffset, Math.Max(options.MaxTokens, 0));
+
+            // Write flags (the response is delimited by response_length, nothing needs clearing)
+            Marshal.WriteByte(slotPtr + SlotStreamModeOffset, streamMode ? (byte)1 : (byte)0); // stream_mode
+            Marshal.WriteByte(slotPtr + SlotGenerationCompleteOffset, 0); // generation_complete = false
+            Marshal.WriteInt32(slotPtr + SlotUpdateCounterOffset, 0); // update_counter = 0
+            Marshal.WriteInt32(slotPtr + SlotTokensGeneratedOffset, 0); // tokens_generated = 0
+            Marshal.WriteInt32(slotPtr + SlotResponseLengthOffset, 0); // response_length = 0
+            Marshal.WriteInt32(slotPtr + SlotReaderWaitingOffset, 0); // reader_waiting = 0
+            Marshal.WriteInt32(slotPtr + SlotUpdateAckOffset, 0); // update_ack = 0
+        }
 
-            return System.Text.Encoding.UTF8.GetString(responseBytes, 0, length);
+        private int ReadResponseLength(IntPtr slotPtr)
+        {
+            int length = Marshal.ReadInt32(slotPtr + SlotResponseLengthOffset);
+            Thread.MemoryBarrier(); // pairs with the release store in C++, the bytes before length are complete
+            return Math.Max(length, 0);
         }
 
-        private (string response, int updateCounter, bool isComplete, int tokensGenerated) ReadStreamingState()
+        private string ReadResponseDelta(int slot, Decoder decoder, int from, int to, bool flush)
         {
-            string response = ReadResponse();
-            int updateCounter = Marshal.ReadInt32(_sharedMemoryPtr + 40962);
-            bool isComplete = Marshal.ReadByte(_sharedMemoryPtr + 40966) != 0;
-            int tokensGenerated = Marshal.ReadInt32(_sharedMemoryPtr + 40967);
+            // C++ publishes a grown data segment before the bytes written into it, remap if needed
+            IntPtr data = MapSegment(_slotSegments[slot]);
+            int responseOffset = Marshal.ReadInt32(SlotPtr(slot) + SlotResponseOffsetOffset);
+            to = (int)Math.Min(to, _slotSegments[slot].Mapped - responseOffset);
+            int count = Math.Max(0, to - from);
+            byte[] bytes = new byte[count];
+            Marshal.Copy(data + responseOffset + from, bytes, 0, count);
+
+            char[] chars = new char[decoder.GetCharCount(bytes, 0, count, flush)];
+            int n = decoder.GetChars(bytes, 0, count, chars, 0, flush);
+            return new string(chars, 0, n);
+        }
+
+        private (int responseLength, int updateCounter, bool isComplete, int tokensGenerated) ReadStreamingState(IntPtr slotPtr)
+        {
+            int updateCounter = Marshal.ReadInt32(slotPtr + SlotUpdateCounterOffset);
+            bool isComplete = Marshal.ReadByte(slotPtr + SlotGenerationCompleteOffset) != 0;
+            int tokensGenerated = Marshal.ReadInt32(slotPtr + SlotTokensGeneratedOffset);
+            int responseLength = ReadResponseLength(slotPtr);
 
-            return (response, updateCounter, isComplete, tokensGenerated);
+            return (responseLength, updateCounter, isComplete, tokensGenerated);
         }
         #endregion
 
@@ -470,12 +1019,24 @@ namespace LlamaCpp.Service
                 _shmFd = -1;
             }
 
-            if (_semReady != IntPtr.Zero) PosixInterop.sem_close(_semReady);
-            if (_semPromptsWritten != IntPtr.Zero) PosixInterop.sem_close(_semPromptsWritten);
-            if (_semResponseWritten != IntPtr.Zero) PosixInterop.sem_close(_semResponseWritten);
-            if (_semChunkReady != IntPtr.Zero) PosixInterop.sem_close(_semChunkReady);
+            if (_semQueue != IntPtr.Zero) PosixInterop.sem_close(_semQueue);
+            if (_semQueueLock != IntPtr.Zero) PosixInterop.sem_close(_semQueueLock);
+            if (_semQueueFree != IntPtr.Zero) PosixInterop.sem_close(_semQueueFree);
+            for (int i = 0; i < MaxQueueSlots; i++)
+            {
+                if (_semSlots[i] != IntPtr.Zero) PosixInterop.sem_close(_semSlots[i]);
+                _semSlots[i] = IntPtr.Zero;
+
+                CloseSegment(_slotSegments[i]);
+            }
+
+            CloseSegment(_tokenizerSegment);
+            if (_semTokenizerLock != IntPtr.Zero) PosixInterop.sem_close(_semTokenizerLock);
+            if (_semTokenizerRequest != IntPtr.Zero) PosixInterop.sem_close(_semTokenizerRequest);
+            if (_semTokenizerResponse != IntPtr.Zero) PosixInterop.sem_close(_semTokenizerResponse);
+            _semTokenizerLock = _semTokenizerRequest = _semTokenizerResponse = IntPtr.Zero;
 
-            _semReady = _semPromptsWritten = _semResponseWritten = _semChunkReady = IntPtr.Zero;
+            _semQueue = _semQueueLock = _semQueueFree = IntPtr.Zero;
 
             if (_cppProcess != null && !_cppProcess.HasExited)
             {
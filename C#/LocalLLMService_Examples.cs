@@ -32,13 +32,20 @@ namespace LlamaCpp.Examples
             Console.WriteLine("--- Streaming Mode ---");
             llm.OnStreamUpdate += (sender, e) =>
             {
-                Console.Write(e.Text.Substring(Math.Max(0, e.Text.Length - 1)));
+                Console.Write(e.Delta);
                 if (e.IsComplete)
                     Console.WriteLine($"\n[{e.TokensGenerated} tokens]");
             };
 
             await llm.GetResponseStreamingAsync("Explain pointers");
 
+            // Example 3: Streaming mode with await foreach
+            Console.WriteLine("\n--- Streaming Deltas ---");
+            await foreach (string delta in llm.StreamResponseAsync("What is RAII?"))
+            {
+                Console.Write(delta);
+            }
+
             Console.WriteLine("\nDone!");
         }
     }
@@ -318,7 +325,7 @@ namespace LlamaCpp.Examples
                 // You can update ANY UI control here
                 // myLabel.Text = $"Tokens: {e.TokensGenerated}";
                 // myProgressBar.Value = e.TokensGenerated;
-                // myRichTextBox.Text = e.Text;
+                // myRichTextBox.AppendText(e.Delta);
 
                 if (e.IsComplete)
                 {
@@ -357,5 +364,26 @@ namespace LlamaCpp.Examples
         }
     }
     #endregion
+
+    #region Example 6: Background Jobs
+    public class BackgroundJobExample
+    {
+        public static async Task RunAsync()
+        {
+            using var llm = new LocalLLMService();
+            await llm.InitializeAsync();
+
+            // Background work is preempted whenever an interactive request comes in
+            Task<string> summary = llm.GetResponseAsync(
+                "Summarise the history of C++ in ten paragraphs",
+                options: new LLMRequestOptions { Priority = LLMRequestPriority.Background });
+
+            string answer = await llm.GetResponseAsync("What is RAII?");
+            Console.WriteLine($"A: {answer}");
+
+            Console.WriteLine($"Summary: {await summary}");
+        }
+    }
+    #endregion
 }
 
@@ -12,9 +12,14 @@
 #include <cstdio>
 #include <exception>
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <vector>
 
 using json = nlohmann::ordered_json;
@@ -125,12 +130,45 @@ std::vector<common_chat_msg_diff> common_chat_msg_diff::compute_diffs(const comm
 
 typedef minja::chat_template common_chat_template;
 
+// Parsing a template and probing its capabilities takes tens of ms, so the parsed templates are shared by all the
+// common_chat_templates created with the same source and special tokens.
+static std::shared_ptr<const common_chat_template> common_chat_template_get(const std::string & src, const std::string & bos, const std::string & eos) {
+    static std::mutex mtx;
+    static std::map<std::tuple<std::string, std::string, std::string>, std::weak_ptr<const common_chat_template>> cache;
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    for (auto it = cache.begin(); it != cache.end();) {
+        it = it->second.expired() ? cache.erase(it) : std::next(it);
+    }
+
+    auto & entry = cache[{src, bos, eos}];
+
+    auto tmpl = entry.lock();
+    if (!tmpl) {
+        tmpl  = std::make_shared<const common_chat_template>(src, bos, eos);
+        entry = tmpl;
+    }
+    return tmpl;
+}
+
+struct common_chat_render_memo {
+    common_chat_templates_inputs inputs;
+    std::string                  time_format; // format of inputs.now printed by the render, empty if none
+    std::string                  time;        // inputs.now in time_format
+    common_chat_params           params;
+};
+
 struct common_chat_templates {
     bool add_bos;
     bool add_eos;
     bool has_explicit_template; // Model had builtin template or template overridde was specified.
-    std::unique_ptr<common_chat_template> template_default; // always set (defaults to chatml)
-    std::unique_ptr<common_chat_template> template_tool_use;
+    std::shared_ptr<const common_chat_template> template_default; // always set (defaults to chatml)
+    std::shared_ptr<const common_chat_template> template_tool_use;
+
+    // recent results of common_chat_templates_apply, most recent first
+    mutable std::mutex                         renders_mtx;
+    mutable std::list<common_chat_render_memo> renders;
 };
 
 struct templates_params {
@@ -144,12 +182,21 @@ struct templates_params {
     bool add_generation_prompt = true;
     bool enable_thinking = true;
     std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+    std::string * now_format = nullptr; // set to the format of now when a handler prints it
     json extra_context;
     bool add_bos;
     bool add_eos;
     bool is_inference = true;
 };
 
+// inputs.now as printed by a handler, the format is recorded so that memoized renders are keyed on it
+static std::string format_now(const templates_params & inputs, const std::string & format) {
+    if (inputs.now_format) {
+        *inputs.now_format = format;
+    }
+    return format_time(inputs.now, format);
+}
+
 common_chat_tool_choice common_chat_tool_choice_parse_oaicompat(const std::string & tool_choice) {
     if (tool_choice == "auto") {
         return COMMON_CHAT_TOOL_CHOICE_AUTO;
@@ -605,14 +652,14 @@ common_chat_templates_ptr common_chat_templates_init(
     tmpls->add_bos = add_bos;
     tmpls->add_eos = add_eos;
     try {
-        tmpls->template_default = std::make_unique<minja::chat_template>(default_template_src, token_bos, token_eos);
+        tmpls->template_default = common_chat_template_get(default_template_src, token_bos, token_eos);
     } catch (const std::exception & e) {
         LOG_ERR("%s: failed to parse chat template (defaulting to chatml): %s \n", __func__, e.what());
-        tmpls->template_default = std::make_unique<minja::chat_template>(CHATML_TEMPLATE_SRC, token_bos, token_eos);
+        tmpls->template_default = common_chat_template_get(CHATML_TEMPLATE_SRC, token_bos, token_eos);
     }
     if (!template_tool_use_src.empty()) {
         try {
-            tmpls->template_tool_use = std::make_unique<minja::chat_template>(template_tool_use_src, token_bos, token_eos);
+            tmpls->template_tool_use = common_chat_template_get(template_tool_use_src, token_bos, token_eos);
         } catch (const std::exception & e) {
             LOG_ERR("%s: failed to parse tool use chat template (ignoring it): %s\n", __func__, e.what());
         }
@@ -1271,7 +1318,7 @@ static common_chat_params common_chat_params_init_llama_3_x(const common_chat_te
         data.format = COMMON_CHAT_FORMAT_CONTENT_ONLY;
     }
     data.prompt = apply(tmpl, inputs, /* messages_override =*/ std::nullopt, /* tools_override= */ std::nullopt, json {
-        {"date_string", format_time(inputs.now, "%d %b %Y")},
+        {"date_string", format_now(inputs, "%d %b %Y")},
         {"tools_in_user_message", false},
         {"builtin_tools", builtin_tools.empty() ? json() : builtin_tools},
     });
@@ -1907,7 +1954,7 @@ static common_chat_params common_chat_params_init_firefunction_v2(const common_c
     common_chat_params data;
     const std::optional<json> tools_override = json();
     const std::optional<json> additional_context = json {
-        {"datetime", format_time(inputs.now, "%b %d %Y %H:%M:%S GMT")},
+        {"datetime", format_now(inputs, "%b %d %Y %H:%M:%S GMT")},
         {"functions", json(inputs.tools.empty() ? "" : inputs.tools.dump(2))},
     };
     data.prompt = apply(tmpl, inputs, /* messages_override =*/ std::nullopt, tools_override, additional_context);
@@ -2659,7 +2706,8 @@ static common_chat_params common_chat_params_init_seed_oss(
 
 static common_chat_params common_chat_templates_apply_jinja(
     const struct common_chat_templates        * tmpls,
-    const struct common_chat_templates_inputs & inputs)
+    const struct common_chat_templates_inputs & inputs,
+    std::string                               * now_format = nullptr)
 {
     templates_params params;
     params.tools = common_chat_tools_to_json_oaicompat<json>(inputs.tools);
@@ -2674,6 +2722,7 @@ static common_chat_params common_chat_templates_apply_jinja(
     params.enable_thinking = inputs.enable_thinking;
     params.grammar = inputs.grammar;
     params.now = inputs.now;
+    params.now_format = now_format;
     params.add_bos = tmpls->add_bos;
     params.add_eos = tmpls->add_eos;
 
@@ -2853,14 +2902,75 @@ static common_chat_params common_chat_templates_apply_legacy(
     return params;
 }
 
+static bool common_chat_templates_inputs_equal(const common_chat_templates_inputs & a, const common_chat_templates_inputs & b) {
+    if (a.tools.size() != b.tools.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.tools.size(); ++i) {
+        if (a.tools[i].name != b.tools[i].name || a.tools[i].description != b.tools[i].description || a.tools[i].parameters != b.tools[i].parameters) {
+            return false;
+        }
+    }
+    return a.messages              == b.messages
+        && a.grammar               == b.grammar
+        && a.json_schema           == b.json_schema
+        && a.add_generation_prompt == b.add_generation_prompt
+        && a.use_jinja             == b.use_jinja
+        && a.tool_choice           == b.tool_choice
+        && a.parallel_tool_calls   == b.parallel_tool_calls
+        && a.reasoning_format      == b.reasoning_format
+        && a.enable_thinking       == b.enable_thinking
+        && a.chat_template_kwargs  == b.chat_template_kwargs
+        && a.add_bos               == b.add_bos
+        && a.add_eos               == b.add_eos;
+}
+
 common_chat_params common_chat_templates_apply(
     const struct common_chat_templates * tmpls,
     const struct common_chat_templates_inputs & inputs)
 {
     GGML_ASSERT(tmpls != nullptr);
-    return inputs.use_jinja
-        ? common_chat_templates_apply_jinja(tmpls, inputs)
+
+    static const size_t n_renders_max = 4;
+
+    // identical inputs are rendered again on retries and by common_chat_format_single, which renders the
+    // history the previous call ended with, so the last results are memoized; a grown chat never matches an
+    // older entry, only byte-identical inputs do. A render that printed inputs.now only matches while the
+    // time reads the same in the format it printed
+    const auto uses_src = [&](const char * str) {
+        return tmpls->template_default->source().find(str) != std::string::npos
+            || (tmpls->template_tool_use && tmpls->template_tool_use->source().find(str) != std::string::npos);
+    };
+    const bool memoize = !inputs.use_jinja || !uses_src("strftime_now");
+
+    if (memoize) {
+        std::lock_guard<std::mutex> lock(tmpls->renders_mtx);
+        for (auto it = tmpls->renders.begin(); it != tmpls->renders.end(); ++it) {
+            if (!it->time_format.empty() && format_time(inputs.now, it->time_format) != it->time) {
+                continue;
+            }
+            if (common_chat_templates_inputs_equal(it->inputs, inputs)) {
+                tmpls->renders.splice(tmpls->renders.begin(), tmpls->renders, it);
+                return it->params;
+            }
+        }
+    }
+
+    std::string time_format;
+    auto params = inputs.use_jinja
+        ? common_chat_templates_apply_jinja(tmpls, inputs, &time_format)
         : common_chat_templates_apply_legacy(tmpls, inputs);
+
+    if (memoize) {
+        const std::string time = time_format.empty() ? std::string() : format_time(inputs.now, time_format);
+        std::lock_guard<std::mutex> lock(tmpls->renders_mtx);
+        tmpls->renders.push_front({ inputs, time_format, time, params });
+        if (tmpls->renders.size() > n_renders_max) {
+            tmpls->renders.pop_back();
+        }
+    }
+
+    return params;
 }
 
 static void common_chat_parse_content_only(common_chat_msg_parser & builder) {
@@ -1576,6 +1576,19 @@ ggml_opt_dataset_t common_opt_dataset_init(struct llama_context * ctx, const std
     return result;
 }
 
+ggml_opt_dataset_t common_opt_dataset_init_mmap(
+        struct llama_context * ctx, const std::vector<std::string> & paths, int64_t stride, int64_t shuffle_window) {
+    std::vector<const char *> c_paths;
+    for (const auto & path : paths) {
+        c_paths.push_back(path.c_str());
+    }
+
+    static_assert(sizeof(llama_token) == sizeof(int32_t), "the dataset files are read as I32");
+    return ggml_opt_dataset_init_mmap(
+        GGML_TYPE_I32, llama_n_ctx(ctx), stride, c_paths.data(), c_paths.size(),
+        /*ndata_shard =*/ 1, shuffle_window, /*nprefetch =*/ 2);
+}
+
 ggml_opt_optimizer_params common_opt_lr_pars(void * userdata) {
     ggml_opt_optimizer_params result = ggml_opt_get_default_optimizer_params(nullptr);
     const lr_opt &            d      = *(lr_opt *) userdata;
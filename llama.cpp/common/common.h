@@ -756,5 +756,9 @@ static llama_model_tensor_buft_override llm_ffn_exps_cpu_override() {
 
 ggml_opt_dataset_t common_opt_dataset_init(struct llama_context * ctx, const std::vector<llama_token> & tokens, int64_t stride);
 
+// streaming dataset over pre-tokenized files that contain raw llama_token arrays, see ggml_opt_dataset_init_mmap
+ggml_opt_dataset_t common_opt_dataset_init_mmap(
+        struct llama_context * ctx, const std::vector<std::string> & paths, int64_t stride, int64_t shuffle_window);
+
 // "adamw" or "sgd" (case insensitive)
 enum ggml_opt_optimizer_type common_opt_get_optimizer(const char *);
@@ -4,7 +4,9 @@
 #include <nlohmann/json.hpp>
 
 #include <algorithm>
+#include <list>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <sstream>
 #include <string>
@@ -980,11 +982,38 @@ std::string json_schema_to_grammar(const json & schema, bool force_gbnf) {
 #else
     (void)force_gbnf;
 #endif // LLAMA_USE_LLGUIDANCE
-    return build_grammar([&](const common_grammar_builder & callbacks) {
+
+    // clients tend to send the same few schemas with every request, so the last conversions are kept by schema
+    static const size_t n_cached_max = 32;
+    static std::mutex mtx;
+    static std::list<std::pair<std::string, std::string>> cached; // most recently used first
+
+    const std::string key = schema.dump();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto it = cached.begin(); it != cached.end(); ++it) {
+            if (it->first == key) {
+                cached.splice(cached.begin(), cached, it);
+                return it->second;
+            }
+        }
+    }
+
+    auto grammar = build_grammar([&](const common_grammar_builder & callbacks) {
         auto copy = schema;
         callbacks.resolve_refs(copy);
         callbacks.add_schema("", copy);
     });
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        cached.emplace_front(key, grammar);
+        if (cached.size() > n_cached_max) {
+            cached.pop_back();
+        }
+    }
+
+    return grammar;
 }
 
 std::string build_grammar(const std::function<void(const common_grammar_builder &)> & cb, const common_grammar_options & options) {
@@ -1,13 +1,17 @@
 #include "log.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cinttypes>
 #include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <memory>
 #include <mutex>
-#include <sstream>
 #include <thread>
 #include <vector>
 
@@ -87,10 +91,24 @@ struct common_log_entry {
 
     int64_t timestamp;
 
+    // global order of the entry, used to merge the per-thread queues
+    uint64_t seq;
+
     std::vector<char> msg;
 
-    // signals the worker thread to stop
-    bool is_end;
+    // structured fields, string values are stored in strs
+    struct field {
+        const char * key;
+
+        common_log_field_type type;
+
+        int64_t i;
+        double  f;
+        size_t  s; // offset in strs
+    };
+
+    std::vector<field> fields;
+    std::vector<char>  strs;
 
     void print(FILE * file = nullptr) const {
         FILE * fcur = file;
@@ -130,36 +148,122 @@ struct common_log_entry {
             }
         }
 
-        fprintf(fcur, "%s", msg.data());
+        fputs(msg.data(), fcur);
+
+        if (!fields.empty()) {
+            // logfmt-style: key=value pairs, string values are quoted when needed
+            for (const auto & fld : fields) {
+                switch (fld.type) {
+                    case COMMON_LOG_FIELD_INT:   fprintf(fcur, " %s%s%s=%" PRId64, g_col[COMMON_LOG_COL_CYAN], fld.key, g_col[COMMON_LOG_COL_DEFAULT], fld.i); break;
+                    case COMMON_LOG_FIELD_FLOAT: fprintf(fcur, " %s%s%s=%.3f",     g_col[COMMON_LOG_COL_CYAN], fld.key, g_col[COMMON_LOG_COL_DEFAULT], fld.f); break;
+                    case COMMON_LOG_FIELD_STR:
+                        {
+                            fprintf(fcur, " %s%s%s=", g_col[COMMON_LOG_COL_CYAN], fld.key, g_col[COMMON_LOG_COL_DEFAULT]);
+
+                            const char * str = strs.data() + fld.s;
+                            if (str[0] != '\0' && strpbrk(str, " \t\r\n\"=") == nullptr) {
+                                fputs(str, fcur);
+                                break;
+                            }
+
+                            fputc('"', fcur);
+                            for (const char * c = str; *c; c++) {
+                                switch (*c) {
+                                    case '"':  fputs("\\\"", fcur); break;
+                                    case '\\': fputs("\\\\", fcur); break;
+                                    case '\n': fputs("\\n",  fcur); break;
+                                    case '\r': fputs("\\r",  fcur); break;
+                                    case '\t': fputs("\\t",  fcur); break;
+                                    default:   fputc(*c, fcur);     break;
+                                }
+                            }
+                            fputc('"', fcur);
+                        } break;
+                }
+            }
+            fputc('\n', fcur);
+        }
 
         if (level == GGML_LOG_LEVEL_WARN || level == GGML_LOG_LEVEL_ERROR || level == GGML_LOG_LEVEL_DEBUG) {
-            fprintf(fcur, "%s", g_col[COMMON_LOG_COL_DEFAULT]);
+            fputs(g_col[COMMON_LOG_COL_DEFAULT], fcur);
+        }
+    }
+};
+
+// single-producer single-consumer ring of entries owned by one thread
+// the producer formats the message in place, the worker thread prints it and releases the slot
+// entries that do not fit in the ring go to the spill buffer, which grows as needed
+struct common_log_queue {
+    common_log_queue(size_t capacity) : entries(capacity), mask(capacity - 1) {
+        GGML_ASSERT((capacity & (capacity - 1)) == 0);
+
+        // initial message size - will be expanded if longer messages arrive
+        for (auto & entry : entries) {
+            entry.msg.resize(256);
         }
+    }
+
+    std::vector<common_log_entry> entries;
+
+    const size_t mask;
+
+    std::atomic<size_t> head { 0 }; // next entry to print, written by the worker thread
+    std::atomic<size_t> tail { 0 }; // next entry to fill,  written by the owner thread
 
-        fflush(fcur);
+    // cleared when the owner thread exits, the worker thread drops the queue once it is empty
+    std::atomic<bool> alive { true };
+
+    // entry formatted by the owner thread when the ring is full
+    common_log_entry scratch;
+
+    // entries moved out of the ring's way, in seq order, the worker thread takes them all at once
+    std::mutex mtx_spill;
+    std::vector<common_log_entry> spill;
+    std::atomic<size_t> n_spill { 0 };
+
+    // spilled entries taken by the worker thread but not printed yet, only used by the worker thread
+    std::deque<common_log_entry> spilled;
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire) &&
+            n_spill.load(std::memory_order_acquire) == 0 && spilled.empty();
+    }
+};
+
+// the queues of the logs the current thread has written to
+struct common_log_thread_queues {
+    std::vector<std::pair<uint64_t, std::shared_ptr<common_log_queue>>> queues;
+
+    ~common_log_thread_queues() {
+        for (auto & q : queues) {
+            q.second->alive.store(false, std::memory_order_release);
+        }
     }
 };
 
+static thread_local common_log_thread_queues g_thread_queues;
+
+static std::atomic<uint64_t> g_log_id { 0 };
+
 struct common_log {
-    // default capacity - will be expanded if needed
+    // default per-thread capacity
     common_log() : common_log(256) {}
 
-    common_log(size_t capacity) {
+    common_log(size_t capacity) : id(++g_log_id) {
         file = nullptr;
         prefix = false;
         timestamps = false;
         running = false;
+        stop = false;
+        sleeping = false;
         t_start = t_us();
 
-        // initial message size - will be expanded if longer messages arrive
-        entries.resize(capacity);
-        for (auto & entry : entries) {
-            entry.msg.resize(256);
+        // round up to a power of 2 for the per-thread rings
+        this->capacity = 1;
+        while (this->capacity < capacity) {
+            this->capacity *= 2;
         }
 
-        head = 0;
-        tail = 0;
-
         resume();
     }
 
@@ -171,156 +275,310 @@ struct common_log {
     }
 
 private:
+    const uint64_t id;
+
+    size_t capacity;
+
+    // registration of the per-thread queues, only taken once per thread and by the worker thread
+    std::mutex mtx_queues;
+    std::vector<std::shared_ptr<common_log_queue>> queues;
+
+    // wakes up the worker thread, producers only take it when the worker thread is sleeping
     std::mutex mtx;
     std::thread thrd;
     std::condition_variable cv;
 
     FILE * file;
 
-    bool prefix;
-    bool timestamps;
-    bool running;
+    std::atomic<bool> prefix;
+    std::atomic<bool> timestamps;
+    std::atomic<bool> running;
+    std::atomic<bool> sleeping;
+
+    bool stop;
 
     int64_t t_start;
 
-    // ring buffer of entries
-    std::vector<common_log_entry> entries;
-    size_t head;
-    size_t tail;
+    // global order of the entries, every seq below this is taken by an entry that is or will be in a queue
+    std::atomic<uint64_t> seq { 0 };
 
-    // worker thread copies into this
-    common_log_entry cur;
+    // entries printed by the worker thread, also the seq of the next entry to print
+    uint64_t n_printed = 0;
 
-public:
-    void add(enum ggml_log_level level, const char * fmt, va_list args) {
-        std::lock_guard<std::mutex> lock(mtx);
+    // queues being drained, only used by the worker thread
+    std::vector<std::shared_ptr<common_log_queue>> cur;
 
-        if (!running) {
-            // discard messages while the worker thread is paused
-            return;
+    common_log_queue & get_queue() {
+        for (auto & q : g_thread_queues.queues) {
+            if (q.first == id) {
+                return *q.second;
+            }
+        }
+
+        auto q = std::make_shared<common_log_queue>(capacity);
+        {
+            std::lock_guard<std::mutex> lock(mtx_queues);
+            queues.push_back(q);
         }
+        g_thread_queues.queues.emplace_back(id, q);
 
-        auto & entry = entries[tail];
+        return *q;
+    }
+
+    // reserve the next entry of the queue of the current thread, the scratch entry of the queue when the ring is full
+    common_log_entry * reserve(common_log_queue & q) {
+        const size_t t = q.tail.load(std::memory_order_relaxed);
+
+        if (t - q.head.load(std::memory_order_acquire) <= q.mask) {
+            return &q.entries[t & q.mask];
+        }
+
+        if (!running.load(std::memory_order_relaxed) && q.n_spill.load(std::memory_order_relaxed) >= 16*capacity) {
+            // nothing is printed while the worker thread is paused, keep a bounded backlog per thread
+            return nullptr;
+        }
+
+        return &q.scratch;
+    }
 
+    void commit(common_log_queue & q, common_log_entry & entry, enum ggml_log_level level) {
+        entry.level = level;
+        entry.prefix = prefix.load(std::memory_order_relaxed);
+        entry.timestamp = 0;
+        if (timestamps.load(std::memory_order_relaxed)) {
+            entry.timestamp = t_us() - t_start;
+        }
+
+        const uint64_t s = seq.fetch_add(1, std::memory_order_relaxed);
+        entry.seq = s;
+
+        // the entry is published in the queue of this thread only, the worker thread merges the queues by seq
+        if (&entry == &q.scratch) {
+            std::lock_guard<std::mutex> lock(q.mtx_spill);
+            q.spill.push_back(std::move(entry));
+            q.n_spill.fetch_add(1, std::memory_order_release);
+        } else {
+            q.tail.store(q.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // pairs with the check of seq in the worker thread before it goes to sleep
+        if (sleeping.load(std::memory_order_seq_cst)) {
+            wake();
+        }
+    }
+
+    void wake() {
+        std::lock_guard<std::mutex> lock(mtx);
+        cv.notify_one();
+    }
+
+    bool has_pending() const {
+        return seq.load(std::memory_order_seq_cst) != n_printed;
+    }
+
+    // refresh the queues being drained and take the entries spilled since the last refresh
+    void collect() {
         {
-            // cannot use args twice, so make a copy in case we need to expand the buffer
-            va_list args_copy;
-            va_copy(args_copy, args);
+            std::lock_guard<std::mutex> lock(mtx_queues);
 
-#if 1
-            const size_t n = vsnprintf(entry.msg.data(), entry.msg.size(), fmt, args);
-            if (n >= entry.msg.size()) {
-                entry.msg.resize(n + 1);
-                vsnprintf(entry.msg.data(), entry.msg.size(), fmt, args_copy);
+            // drop the queues of exited threads that have nothing left to print
+            queues.erase(std::remove_if(queues.begin(), queues.end(), [](const std::shared_ptr<common_log_queue> & q) {
+                return !q->alive.load(std::memory_order_acquire) && q->empty();
+            }), queues.end());
+
+            cur = queues;
+        }
+
+        for (auto & q : cur) {
+            if (q->n_spill.load(std::memory_order_acquire) == 0) {
+                continue;
             }
-#else
-            // hack for bolding arguments
-
-            std::stringstream ss;
-            for (int i = 0; fmt[i] != 0; i++) {
-                if (fmt[i] == '%') {
-                    ss << LOG_COL_BOLD;
-                    while (fmt[i] != ' ' && fmt[i] != ')' && fmt[i] != ']' && fmt[i] != 0) ss << fmt[i++];
-                    ss << LOG_COL_DEFAULT;
-                    if (fmt[i] == 0) break;
+            std::lock_guard<std::mutex> lock(q->mtx_spill);
+            for (auto & entry : q->spill) {
+                q->spilled.push_back(std::move(entry));
+            }
+            q->spill.clear();
+            q->n_spill.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // print the entries in the order in which they were added
+    void drain() {
+        // entries with a higher seq are printed by the next drain
+        const uint64_t limit = seq.load(std::memory_order_acquire);
+
+        collect();
+
+        FILE * fprev = nullptr;
+
+        while (n_printed != limit) {
+            // the next entry is the first of the ring or of the spilled entries of one of the queues
+            const common_log_entry * emin = nullptr;
+            common_log_queue * qmin = nullptr;
+            bool spilled = false;
+
+            for (auto & q : cur) {
+                const size_t h = q->head.load(std::memory_order_relaxed);
+                if (h != q->tail.load(std::memory_order_acquire) && q->entries[h & q->mask].seq == n_printed) {
+                    emin = &q->entries[h & q->mask];
+                    qmin = q.get();
+                    break;
+                }
+                if (!q->spilled.empty() && q->spilled.front().seq == n_printed) {
+                    emin = &q->spilled.front();
+                    qmin = q.get();
+                    spilled = true;
+                    break;
                 }
-                ss << fmt[i];
             }
-            const size_t n = vsnprintf(entry.msg.data(), entry.msg.size(), ss.str().c_str(), args);
-            if (n >= entry.msg.size()) {
-                entry.msg.resize(n + 1);
-                vsnprintf(entry.msg.data(), entry.msg.size(), ss.str().c_str(), args_copy);
+
+            if (!emin) {
+                // the producer took the seq but has not stored the entry yet, or its queue or spill is new
+                // only the worker thread waits for it, the other producers go on filling their queues
+                std::this_thread::yield();
+                collect();
+                continue;
             }
-#endif
-            va_end(args_copy);
+
+            const auto & entry = *emin;
+
+            // keep the relative order of stdout and stderr without flushing after every entry
+            FILE * fcur = entry.level == GGML_LOG_LEVEL_NONE ? stdout : stderr;
+            if (fprev && fprev != fcur) {
+                fflush(fprev);
+            }
+            fprev = fcur;
+
+            entry.print(); // stdout and stderr
+
+            if (file) {
+                entry.print(file);
+            }
+
+            if (spilled) {
+                qmin->spilled.pop_front();
+            } else {
+                qmin->head.store(qmin->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            n_printed++;
         }
 
-        entry.level = level;
-        entry.prefix = prefix;
-        entry.timestamp = 0;
-        if (timestamps) {
-            entry.timestamp = t_us() - t_start;
+        fflush(stdout);
+        fflush(stderr);
+        if (file) {
+            fflush(file);
         }
-        entry.is_end = false;
+    }
+
+public:
+    void add(enum ggml_log_level level, const char * fmt, va_list args) {
+        auto & q = get_queue();
+
+        auto * entry = reserve(q);
+        if (!entry) {
+            return;
+        }
+
+        {
+            // cannot use args twice, so make a copy in case we need to expand the buffer
+            va_list args_copy;
+            va_copy(args_copy, args);
+
+            const size_t n = vsnprintf(entry->msg.data(), entry->msg.size(), fmt, args);
+            if (n >= entry->msg.size()) {
+                entry->msg.resize(n + 1);
+                vsnprintf(entry->msg.data(), entry->msg.size(), fmt, args_copy);
+            }
 
-        tail = (tail + 1) % entries.size();
-        if (tail == head) {
-            // expand the buffer
-            std::vector<common_log_entry> new_entries(2*entries.size());
+            va_end(args_copy);
+        }
 
-            size_t new_tail = 0;
+        entry->fields.clear();
+        entry->strs.clear();
 
-            do {
-                new_entries[new_tail] = std::move(entries[head]);
+        commit(q, *entry, level);
+    }
 
-                head     = (head     + 1) % entries.size();
-                new_tail = (new_tail + 1);
-            } while (head != tail);
+    void add_fields(enum ggml_log_level level, const char * msg, const common_log_field * fields, size_t n_fields) {
+        auto & q = get_queue();
 
-            head = 0;
-            tail = new_tail;
+        auto * entry = reserve(q);
+        if (!entry) {
+            return;
+        }
 
-            for (size_t i = tail; i < new_entries.size(); i++) {
-                new_entries[i].msg.resize(256);
+        const size_t n = strlen(msg);
+        if (n >= entry->msg.size()) {
+            entry->msg.resize(n + 1);
+        }
+        memcpy(entry->msg.data(), msg, n + 1);
+
+        // the values are only copied here, they are formatted by the worker thread
+        entry->fields.clear();
+        entry->strs.clear();
+
+        for (size_t i = 0; i < n_fields; i++) {
+            const auto & src = fields[i];
+
+            common_log_entry::field dst = { src.key, src.type, 0, 0.0, 0 };
+
+            switch (src.type) {
+                case COMMON_LOG_FIELD_INT:   dst.i = src.i; break;
+                case COMMON_LOG_FIELD_FLOAT: dst.f = src.f; break;
+                case COMMON_LOG_FIELD_STR:
+                    {
+                        const char * str = src.s ? src.s : "";
+                        dst.s = entry->strs.size();
+                        entry->strs.insert(entry->strs.end(), str, str + strlen(str) + 1);
+                    } break;
             }
 
-            entries = std::move(new_entries);
+            entry->fields.push_back(dst);
         }
 
-        cv.notify_one();
+        commit(q, *entry, level);
     }
 
     void resume() {
-        std::lock_guard<std::mutex> lock(mtx);
-
         if (running) {
             return;
         }
 
+        stop = false;
         running = true;
 
         thrd = std::thread([this]() {
             while (true) {
-                {
-                    std::unique_lock<std::mutex> lock(mtx);
-                    cv.wait(lock, [this]() { return head != tail; });
-
-                    cur = entries[head];
+                drain();
 
-                    head = (head + 1) % entries.size();
-                }
+                std::unique_lock<std::mutex> lock(mtx);
 
-                if (cur.is_end) {
+                if (stop) {
                     break;
                 }
 
-                cur.print(); // stdout and stderr
-
-                if (file) {
-                    cur.print(file);
-                }
+                sleeping.store(true, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                cv.wait(lock, [this]() { return stop || has_pending(); });
+                sleeping.store(false, std::memory_order_relaxed);
             }
+
+            // print whatever was added while stopping
+            drain();
         });
     }
 
     void pause() {
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-
-            if (!running) {
-                return;
-            }
-
-            running = false;
-
-            // push an entry to signal the worker thread to stop
-            {
-                auto & entry = entries[tail];
-                entry.is_end = true;
+        if (!running) {
+            return;
+        }
 
-                tail = (tail + 1) % entries.size();
-            }
+        running = false;
 
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
             cv.notify_one();
         }
 
@@ -366,14 +624,10 @@ public:
     }
 
     void set_prefix(bool prefix) {
-        std::lock_guard<std::mutex> lock(mtx);
-
         this->prefix = prefix;
     }
 
     void set_timestamps(bool timestamps) {
-        std::lock_guard<std::mutex> lock(mtx);
-
         this->timestamps = timestamps;
     }
 };
@@ -416,6 +670,10 @@ void common_log_add(struct common_log * log, enum ggml_log_level level, const ch
     va_end(args);
 }
 
+void common_log_add_fields(struct common_log * log, enum ggml_log_level level, const char * msg, const common_log_field * fields, size_t n_fields) {
+    log->add_fields(level, msg, fields, n_fields);
+}
+
 void common_log_set_file(struct common_log * log, const char * file) {
     log->set_file(file);
 }
@@ -2,6 +2,10 @@
 
 #include "ggml.h" // for ggml_log_level
 
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
 #define LOG_CLR_TO_EOL  "\033[K\r"
 #define LOG_COL_DEFAULT "\033[0m"
 #define LOG_COL_BOLD    "\033[1m"
@@ -37,7 +41,8 @@ extern int common_log_verbosity_thold;
 void common_log_set_verbosity_thold(int verbosity); // not thread-safe
 
 // the common_log uses an internal worker thread to print/write log messages
-// when the worker thread is paused, incoming log messages are discarded
+// each thread adds its messages to its own lock-free queue, only the worker thread does I/O
+// when the worker thread is paused, incoming log messages are kept (up to a limit per thread) and printed after it resumes
 struct common_log;
 
 struct common_log * common_log_init();
@@ -49,6 +54,37 @@ void                common_log_free  (struct common_log * log);
 LOG_ATTRIBUTE_FORMAT(3, 4)
 void common_log_add(struct common_log * log, enum ggml_log_level level, const char * fmt, ...);
 
+enum common_log_field_type {
+    COMMON_LOG_FIELD_INT,
+    COMMON_LOG_FIELD_FLOAT,
+    COMMON_LOG_FIELD_STR,
+};
+
+// structured key/value field (request id, slot, tokens, timings, ...)
+// the key must outlive the log (typically a string literal), string values are copied
+struct common_log_field {
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    common_log_field(const char * key, T value) : key(key), type(COMMON_LOG_FIELD_INT), i((int64_t) value) {}
+
+    template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+    common_log_field(const char * key, T value) : key(key), type(COMMON_LOG_FIELD_FLOAT), f((double) value) {}
+
+    common_log_field(const char * key, const char *        value) : key(key), type(COMMON_LOG_FIELD_STR), s(value) {}
+    common_log_field(const char * key, const std::string & value) : key(key), type(COMMON_LOG_FIELD_STR), s(value.c_str()) {}
+
+    const char * key;
+
+    common_log_field_type type;
+
+    int64_t      i = 0;
+    double       f = 0.0;
+    const char * s = nullptr;
+};
+
+// adds msg followed by the fields as key=value pairs and a new line
+// only the values are copied by the caller, the formatting is done by the worker thread
+void common_log_add_fields(struct common_log * log, enum ggml_log_level level, const char * msg, const common_log_field * fields, size_t n_fields);
+
 // defaults: file = NULL, colors = false, prefix = false, timestamps = false
 //
 // regular log output:
@@ -107,3 +143,25 @@ void common_log_set_timestamps(struct common_log * log, bool timestamps);   // w
 #define LOG_ERRV(verbosity, ...) LOG_TMPL(GGML_LOG_LEVEL_ERROR, verbosity, __VA_ARGS__)
 #define LOG_DBGV(verbosity, ...) LOG_TMPL(GGML_LOG_LEVEL_DEBUG, verbosity, __VA_ARGS__)
 #define LOG_CNTV(verbosity, ...) LOG_TMPL(GGML_LOG_LEVEL_CONT,  verbosity, __VA_ARGS__)
+
+// structured logging, the fields are given as { key, value } pairs:
+//
+//   LOG_INF_KV("request done", { "id", id }, { "n_gen", n_gen }, { "t_ms", t_ms });
+//
+// with prefix = true, timestamps = true, the log output will look like this:
+//
+//   0.01.042.317 I request done id=3 n_gen=128 t_ms=2345.120
+//
+
+#define LOG_KV_TMPL(level, verbosity, msg, ...) \
+    do { \
+        if ((verbosity) <= common_log_verbosity_thold) { \
+            const common_log_field log_fields_[] = { __VA_ARGS__ }; \
+            common_log_add_fields(common_log_main(), (level), (msg), log_fields_, sizeof(log_fields_)/sizeof(log_fields_[0])); \
+        } \
+    } while (0)
+
+#define LOG_INF_KV(msg, ...) LOG_KV_TMPL(GGML_LOG_LEVEL_INFO,  0,                 msg, __VA_ARGS__)
+#define LOG_WRN_KV(msg, ...) LOG_KV_TMPL(GGML_LOG_LEVEL_WARN,  0,                 msg, __VA_ARGS__)
+#define LOG_ERR_KV(msg, ...) LOG_KV_TMPL(GGML_LOG_LEVEL_ERROR, 0,                 msg, __VA_ARGS__)
+#define LOG_DBG_KV(msg, ...) LOG_KV_TMPL(GGML_LOG_LEVEL_DEBUG, LOG_DEFAULT_DEBUG, msg, __VA_ARGS__)
@@ -60,6 +60,16 @@ GGML_API bool ggml_gallocr_reserve_n(
     const int * node_buffer_ids,
     const int * leaf_buffer_ids);
 
+// compute the size of the buffers needed for a measure graph, without allocating them
+// sizes: [n_bufs], buffers shared with a previous buffer of the same type are reported as 0
+// the current allocations are invalidated, the next ggml_gallocr_alloc_graph will reserve the graph again
+GGML_API void ggml_gallocr_reserve_n_size(
+    ggml_gallocr_t galloc,
+    struct ggml_cgraph * graph,
+    const int * node_buffer_ids,
+    const int * leaf_buffer_ids,
+    size_t * sizes);
+
 // automatic reallocation if the topology changes when using a single buffer
 // returns false if using multiple buffers and a re-allocation is needed (call ggml_gallocr_reserve_n first to set the node buffers)
 GGML_API bool ggml_gallocr_alloc_graph(ggml_gallocr_t galloc, struct ggml_cgraph * graph);
@@ -70,6 +80,8 @@ GGML_API size_t ggml_gallocr_get_buffer_size(ggml_gallocr_t galloc, int buffer_i
 // Create a buffer and allocate all the tensors in a ggml_context
 GGML_API struct ggml_backend_buffer * ggml_backend_alloc_ctx_tensors_from_buft(struct ggml_context * ctx, ggml_backend_buffer_type_t buft);
 GGML_API struct ggml_backend_buffer * ggml_backend_alloc_ctx_tensors(struct ggml_context * ctx, ggml_backend_t backend);
+// Same as ggml_backend_alloc_ctx_tensors_from_buft, but the tensors are placed in a dummy buffer that does not own any memory (dry runs)
+GGML_API struct ggml_backend_buffer * ggml_backend_alloc_ctx_tensors_from_buft_dummy(struct ggml_context * ctx, ggml_backend_buffer_type_t buft);
 
 #ifdef  __cplusplus
 }
@@ -41,6 +41,9 @@ extern "C" {
     GGML_API size_t                ggml_backend_buft_get_alloc_size(ggml_backend_buffer_type_t buft, const struct ggml_tensor * tensor);
     GGML_API bool                  ggml_backend_buft_is_host       (ggml_backend_buffer_type_t buft);
     GGML_API ggml_backend_dev_t    ggml_backend_buft_get_device    (ggml_backend_buffer_type_t buft);
+    // buffer of the given type that does not own any memory
+    // tensors can be allocated in it to plan graphs and measure memory usage (dry runs), but their data cannot be accessed
+    GGML_API ggml_backend_buffer_t ggml_backend_buft_alloc_dummy_buffer(ggml_backend_buffer_type_t buft, size_t size);
 
     //
     // Backend buffer
@@ -308,6 +311,9 @@ extern "C" {
 
     // Initialize backend buffers from a measure graph
     GGML_API bool                 ggml_backend_sched_reserve(ggml_backend_sched_t sched, struct ggml_cgraph * measure_graph); // returns success
+    // Compute the size of the backend buffers needed for a measure graph, without allocating them
+    // sizes: [n_backends]
+    GGML_API void                 ggml_backend_sched_reserve_size(ggml_backend_sched_t sched, struct ggml_cgraph * measure_graph, size_t * sizes);
 
     GGML_API int                  ggml_backend_sched_get_n_backends(ggml_backend_sched_t sched);
     GGML_API ggml_backend_t       ggml_backend_sched_get_backend(ggml_backend_sched_t sched, int i);
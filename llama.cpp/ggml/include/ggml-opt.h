@@ -43,9 +43,25 @@ extern "C" {
             int64_t        ne_label,     // number of elements per label
             int64_t        ndata,        // total number of datapoints/labels
             int64_t        ndata_shard); // number of datapoints/labels per shard (unit at which the dataset is shuffled/copied)
+
+    // streaming dataset for corpora that don't fit into memory, the files are memory-mapped and read on demand
+    // each file is a flat array of type_data elements (e.g. the I32 tokens of a pre-tokenized text),
+    // datapoint i of a file is made up of the elements [i*stride, i*stride + ne_datapoint),
+    // its label of the same elements shifted by one (next token prediction)
+    // returns NULL if a file cannot be mapped
+    GGML_API ggml_opt_dataset_t ggml_opt_dataset_init_mmap(
+            enum ggml_type type_data,      // the type of the elements in the files, labels use the same type
+            int64_t        ne_datapoint,   // number of elements per datapoint/label
+            int64_t        stride,         // number of elements between the starts of consecutive datapoints
+            const char  ** paths,          // files of the dataset, the datapoints are numbered across the files in order
+            int            n_paths,
+            int64_t        ndata_shard,    // number of datapoints per shard (unit at which the dataset is shuffled/copied)
+            int64_t        shuffle_window, // shuffle only within windows of this many consecutive shards, 0 = shuffle globally
+            int64_t        nprefetch);     // number of batches to read ahead on a background thread, 0 = disabled
     GGML_API void ggml_opt_dataset_free(ggml_opt_dataset_t dataset);
 
     // get underlying tensors that store the data
+    // the tensors of streaming datasets only describe the shapes and have no data
     GGML_API int64_t              ggml_opt_dataset_ndata (ggml_opt_dataset_t dataset);
     GGML_API struct ggml_tensor * ggml_opt_dataset_data  (ggml_opt_dataset_t dataset); // shape = [ne_datapoint, ndata]
     GGML_API struct ggml_tensor * ggml_opt_dataset_labels(ggml_opt_dataset_t dataset); // shape = [nd_label,     ndata]
@@ -113,6 +129,8 @@ extern "C" {
 
         // by default the forward graph needs to be reconstructed for each eval
         // if ctx_compute, inputs, and outputs are set the graphs are instead allocated statically
+        // if the forward graph contains tensors marked with ggml_set_checkpoint only those activations are kept for the backward pass,
+        // the others are recomputed from them; ctx_compute then needs room for the recomputed tensors and one more graph
         struct ggml_context * ctx_compute;
         struct ggml_tensor  * inputs;
         struct ggml_tensor  * outputs;
@@ -613,10 +613,11 @@ extern "C" {
 
     // this tensor...
     enum ggml_tensor_flag {
-        GGML_TENSOR_FLAG_INPUT  =  1, // ...is an input for the GGML compute graph
-        GGML_TENSOR_FLAG_OUTPUT =  2, // ...is an output for the GGML compute graph
-        GGML_TENSOR_FLAG_PARAM  =  4, // ...contains trainable parameters
-        GGML_TENSOR_FLAG_LOSS   =  8, // ...defines loss for numerical optimization (multiple loss tensors add up)
+        GGML_TENSOR_FLAG_INPUT      =  1, // ...is an input for the GGML compute graph
+        GGML_TENSOR_FLAG_OUTPUT     =  2, // ...is an output for the GGML compute graph
+        GGML_TENSOR_FLAG_PARAM      =  4, // ...contains trainable parameters
+        GGML_TENSOR_FLAG_LOSS       =  8, // ...defines loss for numerical optimization (multiple loss tensors add up)
+        GGML_TENSOR_FLAG_CHECKPOINT = 16, // ...is kept for the backward pass, other activations are recomputed from the checkpoints
     };
 
     struct ggml_init_params {
@@ -834,6 +835,7 @@ extern "C" {
     GGML_API void ggml_set_output(struct ggml_tensor * tensor);
     GGML_API void ggml_set_param(struct ggml_tensor * tensor);
     GGML_API void ggml_set_loss(struct ggml_tensor * tensor);
+    GGML_API void ggml_set_checkpoint(struct ggml_tensor * tensor);
 
     //
     // operations on tensors with backpropagation
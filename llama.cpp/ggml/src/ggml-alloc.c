@@ -268,7 +268,7 @@ static struct buffer_address ggml_dyn_tallocr_alloc(struct ggml_dyn_tallocr * al
 #ifdef GGML_ALLOCATOR_DEBUG
     add_allocated_tensor(alloc, addr, tensor);
     size_t cur_max = addr.offset + size;
-    if (cur_max > alloc->max_size[addr.chunk]) {
+    if (cur_max > alloc->chunks[addr.chunk]->max_size) {
         // sort allocated_tensors by chunk/offset
         for (int i = 0; i < 1024; i++) {
             for (int j = i + 1; j < 1024; j++) {
@@ -466,6 +466,7 @@ struct hash_node {
     int buffer_id;
     struct buffer_address addr;
     bool allocated;
+    int interval; // index + 1 into ggml_gallocr::intervals, 0 if not allocated by the graph allocator
 };
 
 struct tensor_alloc {
@@ -483,6 +484,31 @@ struct node_alloc {
     struct tensor_alloc src[GGML_MAX_SRC];
 };
 
+// lifetime of a block allocated from a dynamic allocator while walking the graph
+// inplace operations inherit the block of their parent, extending its lifetime
+struct alloc_interval {
+    struct ggml_dyn_tallocr * alloc;
+    struct buffer_address addr; // address assigned by the dynamic allocator
+    size_t size;
+    int start;     // allocation event
+    int end;       // free event, INT_MAX if never freed
+    bool planned;  // offset was assigned by the offline planner
+    size_t offset; // offset assigned by the offline planner
+};
+
+// allocations of a previous graph, reused when a graph with the same shape is reserved again
+#define GGML_GALLOCR_MAX_PLANS 4
+
+struct gallocr_plan {
+    uint64_t key; // 0 = empty
+    uint64_t last_used;
+    struct node_alloc * node_allocs; // [n_nodes]
+    int n_nodes;
+    struct leaf_alloc * leaf_allocs; // [n_leafs]
+    int n_leafs;
+    size_t * chunk_sizes; // [n_buffers * GGML_VBUFFER_MAX_CHUNKS]
+};
+
 struct ggml_gallocr {
     ggml_backend_buffer_type_t * bufts; // [n_buffers]
     struct vbuffer ** buffers; // [n_buffers]
@@ -497,6 +523,14 @@ struct ggml_gallocr {
 
     struct leaf_alloc * leaf_allocs; // [n_leafs]
     int n_leafs;
+
+    struct alloc_interval * intervals; // [n_intervals]
+    int n_intervals;
+    int intervals_size;
+    int clock;
+
+    struct gallocr_plan plans[GGML_GALLOCR_MAX_PLANS];
+    uint64_t n_plan_uses;
 };
 
 ggml_gallocr_t ggml_gallocr_new_n(ggml_backend_buffer_type_t * bufts, int n_bufs) {
@@ -580,6 +614,12 @@ void ggml_gallocr_free(ggml_gallocr_t galloc) {
     free(galloc->buf_tallocs);
     free(galloc->node_allocs);
     free(galloc->leaf_allocs);
+    free(galloc->intervals);
+    for (int i = 0; i < GGML_GALLOCR_MAX_PLANS; i++) {
+        free(galloc->plans[i].node_allocs);
+        free(galloc->plans[i].leaf_allocs);
+        free(galloc->plans[i].chunk_sizes);
+    }
     free(galloc);
 }
 
@@ -598,6 +638,36 @@ static bool ggml_gallocr_is_allocated(ggml_gallocr_t galloc, struct ggml_tensor
     return t->data != NULL || ggml_gallocr_hash_get(galloc, t)->allocated;
 }
 
+static int ggml_gallocr_add_interval(ggml_gallocr_t galloc, struct ggml_dyn_tallocr * alloc, struct buffer_address addr, size_t size) {
+    if (galloc->n_intervals == galloc->intervals_size) {
+        galloc->intervals_size = MAX(256, 2*galloc->intervals_size);
+        galloc->intervals = realloc(galloc->intervals, sizeof(struct alloc_interval) * galloc->intervals_size);
+        GGML_ASSERT(galloc->intervals != NULL);
+    }
+    galloc->intervals[galloc->n_intervals] = (struct alloc_interval) {
+        /*.alloc   = */ alloc,
+        /*.addr    = */ addr,
+        /*.size    = */ aligned_offset(NULL, size, alloc->alignment),
+        /*.start   = */ galloc->clock++,
+        /*.end     = */ INT_MAX,
+        /*.planned = */ false,
+        /*.offset  = */ 0,
+    };
+    return ++galloc->n_intervals;
+}
+
+// address of a tensor after the offline planner has (possibly) moved its block
+static struct buffer_address ggml_gallocr_get_addr(ggml_gallocr_t galloc, const struct hash_node * hn) {
+    struct buffer_address addr = hn->addr;
+    if (hn->interval > 0) {
+        const struct alloc_interval * iv = &galloc->intervals[hn->interval - 1];
+        if (iv->planned) {
+            addr.offset = iv->offset + (hn->addr.offset - iv->addr.offset);
+        }
+    }
+    return addr;
+}
+
 // free the extra space at the end if the new tensor is smaller
 static void ggml_gallocr_free_extra_space(ggml_gallocr_t galloc, struct ggml_tensor * node, struct ggml_tensor * parent) {
     struct hash_node * hn = ggml_gallocr_hash_get(galloc, node);
@@ -661,6 +731,7 @@ static void ggml_gallocr_allocate_node(ggml_gallocr_t galloc, struct ggml_tensor
                             assert(view_src_hn->addr.chunk == p_hn->addr.chunk && view_src_hn->addr.offset == p_hn->addr.offset);
                             hn->buffer_id = p_hn->buffer_id;
                             hn->addr = p_hn->addr;
+                            hn->interval = view_src_hn->interval;
                             p_hn->allocated = false; // avoid freeing the parent
                             view_src_hn->allocated = false;
                             ggml_gallocr_free_extra_space(galloc, node, view_src);
@@ -670,6 +741,7 @@ static void ggml_gallocr_allocate_node(ggml_gallocr_t galloc, struct ggml_tensor
                         AT_PRINTF("reusing parent %s for %s\n", parent->name, node->name);
                         hn->buffer_id = p_hn->buffer_id;
                         hn->addr = p_hn->addr;
+                        hn->interval = p_hn->interval;
                         p_hn->allocated = false; // avoid freeing the parent
                         ggml_gallocr_free_extra_space(galloc, node, parent);
                         return;
@@ -683,6 +755,7 @@ static void ggml_gallocr_allocate_node(ggml_gallocr_t galloc, struct ggml_tensor
         size_t size = ggml_backend_buft_get_alloc_size(buft, node);
         hn->buffer_id = buffer_id;
         hn->addr = ggml_dyn_tallocr_alloc(alloc, size, node);
+        hn->interval = ggml_gallocr_add_interval(galloc, alloc, hn->addr, size);
     }
 }
 
@@ -700,6 +773,9 @@ static void ggml_gallocr_free_node(ggml_gallocr_t galloc, struct ggml_tensor * n
     size_t size = ggml_backend_buft_get_alloc_size(buft, node);
     ggml_dyn_tallocr_free_tensor(alloc, hn->addr, size, node);
     hn->allocated = false;
+    if (hn->interval > 0) {
+        galloc->intervals[hn->interval - 1].end = galloc->clock++;
+    }
 }
 
 static int get_node_buffer_id(const int * node_buffer_ids, int i) {
@@ -710,6 +786,8 @@ static void ggml_gallocr_alloc_graph_impl(ggml_gallocr_t galloc, struct ggml_cgr
     // clear hash tables
     ggml_hash_set_reset(&galloc->hash_set);
     memset(galloc->hash_values, 0, sizeof(struct hash_node) * galloc->hash_set.size);
+    galloc->n_intervals = 0;
+    galloc->clock = 0;
 
     // allocate leafs
     // these may be tensors that the application is not using in the graph, but may still want to allocate for other purposes
@@ -813,7 +891,273 @@ static void ggml_gallocr_alloc_graph_impl(ggml_gallocr_t galloc, struct ggml_cgr
     }
 }
 
-bool ggml_gallocr_reserve_n(ggml_gallocr_t galloc, struct ggml_cgraph * graph, const int * node_buffer_ids, const int * leaf_buffer_ids) {
+// offline planner
+// the dynamic allocator places tensors in the order they are allocated, which can fragment the buffer
+// once the whole graph has been walked, the lifetime of every block is known and the blocks can be packed again:
+// largest blocks first, each one into the smallest gap left by the blocks that are live at the same time
+
+static int alloc_interval_cmp_size(const void * a, const void * b) {
+    const struct alloc_interval * ia = *(const struct alloc_interval * const *)a;
+    const struct alloc_interval * ib = *(const struct alloc_interval * const *)b;
+    if (ia->size != ib->size) {
+        return ia->size > ib->size ? -1 : 1;
+    }
+    return ia->start - ib->start;
+}
+
+static int alloc_interval_cmp_offset(const void * a, const void * b) {
+    const struct alloc_interval * ia = *(const struct alloc_interval * const *)a;
+    const struct alloc_interval * ib = *(const struct alloc_interval * const *)b;
+    if (ia->offset != ib->offset) {
+        return ia->offset < ib->offset ? -1 : 1;
+    }
+    return 0;
+}
+
+static void ggml_gallocr_plan_allocator(ggml_gallocr_t galloc, struct ggml_dyn_tallocr * alloc) {
+    // blocks spread over multiple chunks are left to the dynamic allocator
+    if (alloc->n_chunks != 1) {
+        return;
+    }
+
+    int n = 0;
+    for (int i = 0; i < galloc->n_intervals; i++) {
+        n += galloc->intervals[i].alloc == alloc;
+    }
+    if (n < 2) {
+        return;
+    }
+
+    struct alloc_interval ** order  = malloc(sizeof(struct alloc_interval *) * n);
+    struct alloc_interval ** live   = malloc(sizeof(struct alloc_interval *) * n);
+    GGML_ASSERT(order != NULL && live != NULL);
+
+    n = 0;
+    for (int i = 0; i < galloc->n_intervals; i++) {
+        if (galloc->intervals[i].alloc == alloc) {
+            order[n++] = &galloc->intervals[i];
+        }
+    }
+    qsort(order, n, sizeof(order[0]), alloc_interval_cmp_size);
+
+    size_t peak = 0;
+    for (int i = 0; i < n; i++) {
+        struct alloc_interval * iv = order[i];
+
+        // blocks already placed that are live at the same time as this one
+        int n_live = 0;
+        for (int j = 0; j < i; j++) {
+            if (order[j]->start < iv->end && iv->start < order[j]->end) {
+                live[n_live++] = order[j];
+            }
+        }
+        qsort(live, n_live, sizeof(live[0]), alloc_interval_cmp_offset);
+
+        // best fit among the gaps, otherwise after the last live block
+        size_t best_offset = SIZE_MAX;
+        size_t best_size   = SIZE_MAX;
+        size_t cur = 0;
+        for (int j = 0; j < n_live; j++) {
+            if (live[j]->offset > cur) {
+                size_t gap = live[j]->offset - cur;
+                if (gap >= iv->size && gap < best_size) {
+                    best_offset = cur;
+                    best_size   = gap;
+                }
+            }
+            cur = MAX(cur, live[j]->offset + live[j]->size);
+        }
+        iv->offset = best_offset != SIZE_MAX ? best_offset : cur;
+        peak = MAX(peak, iv->offset + iv->size);
+    }
+
+    free(order);
+    free(live);
+
+    struct tallocr_chunk * chunk = alloc->chunks[0];
+    if (peak >= chunk->max_size) {
+        return;
+    }
+
+#ifndef NDEBUG
+    GGML_LOG_DEBUG("%s: planned %d blocks in %.02f MiB instead of %.02f MiB\n", __func__, n, peak / 1024.0 / 1024.0, chunk->max_size / 1024.0 / 1024.0);
+#endif
+
+    for (int i = 0; i < galloc->n_intervals; i++) {
+        if (galloc->intervals[i].alloc == alloc) {
+            galloc->intervals[i].planned = true;
+        }
+    }
+    chunk->max_size = peak;
+
+#ifdef GGML_ALLOCATOR_DEBUG
+    // blocks that are live at the same time must not share memory
+    for (int i = 0; i < galloc->n_intervals; i++) {
+        const struct alloc_interval * a = &galloc->intervals[i];
+        if (a->alloc != alloc) {
+            continue;
+        }
+        for (int j = i + 1; j < galloc->n_intervals; j++) {
+            const struct alloc_interval * b = &galloc->intervals[j];
+            if (b->alloc != alloc || !(a->start < b->end && b->start < a->end)) {
+                continue;
+            }
+            if (a->offset < b->offset + b->size && b->offset < a->offset + a->size) {
+                GGML_ABORT("planned blocks %d [%zu, %zu) and %d [%zu, %zu) overlap while both are live",
+                    i, a->offset, a->offset + a->size, j, b->offset, b->offset + b->size);
+            }
+        }
+    }
+#endif
+}
+
+static void ggml_gallocr_plan(ggml_gallocr_t galloc) {
+    for (int i = 0; i < galloc->n_buffers; i++) {
+        // skip allocators shared by multiple buffers
+        bool planned = false;
+        for (int j = 0; j < i; j++) {
+            if (galloc->buf_tallocs[j] == galloc->buf_tallocs[i]) {
+                planned = true;
+                break;
+            }
+        }
+        if (!planned) {
+            ggml_gallocr_plan_allocator(galloc, galloc->buf_tallocs[i]);
+        }
+    }
+}
+
+// plan cache
+
+static uint64_t ggml_gallocr_hash_bytes(uint64_t h, const void * data, size_t size) {
+    // FNV-1a
+    const uint8_t * p = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static uint64_t ggml_gallocr_hash_tensor(uint64_t h, const struct ggml_tensor * t, int buffer_id) {
+    const bool has_data = t->data != NULL;
+    h = ggml_gallocr_hash_bytes(h, &t, sizeof(t));
+    h = ggml_gallocr_hash_bytes(h, &t->op, sizeof(t->op));
+    h = ggml_gallocr_hash_bytes(h, &t->type, sizeof(t->type));
+    h = ggml_gallocr_hash_bytes(h, t->ne, sizeof(t->ne));
+    h = ggml_gallocr_hash_bytes(h, t->nb, sizeof(t->nb));
+    h = ggml_gallocr_hash_bytes(h, &t->flags, sizeof(t->flags));
+    h = ggml_gallocr_hash_bytes(h, &has_data, sizeof(has_data));
+    h = ggml_gallocr_hash_bytes(h, &t->view_src, sizeof(t->view_src));
+    h = ggml_gallocr_hash_bytes(h, &t->view_offs, sizeof(t->view_offs));
+    h = ggml_gallocr_hash_bytes(h, t->src, sizeof(t->src));
+    h = ggml_gallocr_hash_bytes(h, &buffer_id, sizeof(buffer_id));
+    return h;
+}
+
+// the tensor pointers are part of the key: graphs rebuilt in the same context produce the same pointers,
+// and this captures the topology of the graph without having to walk it
+static uint64_t ggml_gallocr_graph_key(struct ggml_cgraph * graph, const int * node_buffer_ids, const int * leaf_buffer_ids) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = ggml_gallocr_hash_bytes(h, &graph->n_nodes, sizeof(graph->n_nodes));
+    h = ggml_gallocr_hash_bytes(h, &graph->n_leafs, sizeof(graph->n_leafs));
+    for (int i = 0; i < graph->n_leafs; i++) {
+        h = ggml_gallocr_hash_tensor(h, graph->leafs[i], get_node_buffer_id(leaf_buffer_ids, i));
+    }
+    for (int i = 0; i < graph->n_nodes; i++) {
+        h = ggml_gallocr_hash_tensor(h, graph->nodes[i], get_node_buffer_id(node_buffer_ids, i));
+    }
+    return h != 0 ? h : 1;
+}
+
+static bool ggml_gallocr_load_plan(ggml_gallocr_t galloc, uint64_t key) {
+    for (int i = 0; i < GGML_GALLOCR_MAX_PLANS; i++) {
+        struct gallocr_plan * plan = &galloc->plans[i];
+        if (plan->key != key) {
+            continue;
+        }
+
+        // the buffers may have been reallocated with a different layout since the plan was made
+        for (int b = 0; b < galloc->n_buffers; b++) {
+            if (galloc->buffers[b] == NULL) {
+                return false;
+            }
+            for (int c = 0; c < GGML_VBUFFER_MAX_CHUNKS; c++) {
+                if (plan->chunk_sizes[b*GGML_VBUFFER_MAX_CHUNKS + c] > ggml_vbuffer_chunk_size(galloc->buffers[b], c)) {
+                    return false;
+                }
+            }
+        }
+
+        if (galloc->n_nodes < plan->n_nodes) {
+            free(galloc->node_allocs);
+            galloc->node_allocs = calloc(plan->n_nodes, sizeof(struct node_alloc));
+            GGML_ASSERT(galloc->node_allocs != NULL);
+        }
+        galloc->n_nodes = plan->n_nodes;
+        memcpy(galloc->node_allocs, plan->node_allocs, sizeof(struct node_alloc) * plan->n_nodes);
+
+        if (galloc->n_leafs < plan->n_leafs) {
+            free(galloc->leaf_allocs);
+            galloc->leaf_allocs = calloc(plan->n_leafs, sizeof(struct leaf_alloc));
+            GGML_ASSERT(galloc->leaf_allocs != NULL);
+        }
+        galloc->n_leafs = plan->n_leafs;
+        memcpy(galloc->leaf_allocs, plan->leaf_allocs, sizeof(struct leaf_alloc) * plan->n_leafs);
+
+        plan->last_used = ++galloc->n_plan_uses;
+        return true;
+    }
+    return false;
+}
+
+static void ggml_gallocr_store_plan(ggml_gallocr_t galloc, uint64_t key) {
+    // replace a stale plan with the same key, or the least recently used one
+    struct gallocr_plan * plan = NULL;
+    for (int i = 0; i < GGML_GALLOCR_MAX_PLANS; i++) {
+        if (galloc->plans[i].key == key) {
+            plan = &galloc->plans[i];
+            break;
+        }
+    }
+    if (plan == NULL) {
+        plan = &galloc->plans[0];
+        for (int i = 1; i < GGML_GALLOCR_MAX_PLANS && plan->key != 0; i++) {
+            if (galloc->plans[i].key == 0 || galloc->plans[i].last_used < plan->last_used) {
+                plan = &galloc->plans[i];
+            }
+        }
+    }
+
+    if (plan->key == 0 || plan->n_nodes < galloc->n_nodes) {
+        free(plan->node_allocs);
+        plan->node_allocs = malloc(sizeof(struct node_alloc) * MAX(galloc->n_nodes, 1));
+        GGML_ASSERT(plan->node_allocs != NULL);
+    }
+    if (plan->key == 0 || plan->n_leafs < galloc->n_leafs) {
+        free(plan->leaf_allocs);
+        plan->leaf_allocs = malloc(sizeof(struct leaf_alloc) * MAX(galloc->n_leafs, 1));
+        GGML_ASSERT(plan->leaf_allocs != NULL);
+    }
+    if (plan->chunk_sizes == NULL) {
+        plan->chunk_sizes = malloc(sizeof(size_t) * galloc->n_buffers * GGML_VBUFFER_MAX_CHUNKS);
+        GGML_ASSERT(plan->chunk_sizes != NULL);
+    }
+
+    plan->key = key;
+    plan->last_used = ++galloc->n_plan_uses;
+    plan->n_nodes = galloc->n_nodes;
+    plan->n_leafs = galloc->n_leafs;
+    memcpy(plan->node_allocs, galloc->node_allocs, sizeof(struct node_alloc) * galloc->n_nodes);
+    memcpy(plan->leaf_allocs, galloc->leaf_allocs, sizeof(struct leaf_alloc) * galloc->n_leafs);
+    for (int b = 0; b < galloc->n_buffers; b++) {
+        for (int c = 0; c < GGML_VBUFFER_MAX_CHUNKS; c++) {
+            plan->chunk_sizes[b*GGML_VBUFFER_MAX_CHUNKS + c] = ggml_dyn_tallocr_max_size(galloc->buf_tallocs[b], c);
+        }
+    }
+}
+
+static void ggml_gallocr_plan_graph(ggml_gallocr_t galloc, struct ggml_cgraph * graph, const int * node_buffer_ids, const int * leaf_buffer_ids) {
     size_t min_hash_size = graph->n_nodes + graph->n_leafs;
     // add 25% margin to avoid hash collisions
     min_hash_size += min_hash_size / 4;
@@ -837,6 +1181,9 @@ bool ggml_gallocr_reserve_n(ggml_gallocr_t galloc, struct ggml_cgraph * graph, c
     // allocate in hash table
     ggml_gallocr_alloc_graph_impl(galloc, graph, node_buffer_ids, leaf_buffer_ids);
 
+    // pack the blocks again now that their lifetimes are known
+    ggml_gallocr_plan(galloc);
+
     // set the node_allocs from the hash table
     if (galloc->n_nodes < graph->n_nodes) {
         free(galloc->node_allocs);
@@ -854,7 +1201,7 @@ bool ggml_gallocr_reserve_n(ggml_gallocr_t galloc, struct ggml_cgraph * graph, c
         } else {
             struct hash_node * hn = ggml_gallocr_hash_get(galloc, node);
             node_alloc->dst.buffer_id = hn->buffer_id;
-            node_alloc->dst.addr = hn->addr;
+            node_alloc->dst.addr = ggml_gallocr_get_addr(galloc, hn);
             node_alloc->dst.size_max  = ggml_backend_buft_get_alloc_size(galloc->bufts[hn->buffer_id], node);
         }
         for (int j = 0; j < GGML_MAX_SRC; j++) {
@@ -866,7 +1213,7 @@ bool ggml_gallocr_reserve_n(ggml_gallocr_t galloc, struct ggml_cgraph * graph, c
             } else {
                 struct hash_node * hn = ggml_gallocr_hash_get(galloc, src);
                 node_alloc->src[j].buffer_id = hn->buffer_id;
-                node_alloc->src[j].addr = hn->addr;
+                node_alloc->src[j].addr = ggml_gallocr_get_addr(galloc, hn);
                 node_alloc->src[j].size_max = ggml_backend_buft_get_alloc_size(galloc->bufts[hn->buffer_id], src);
             }
         }
@@ -886,10 +1233,20 @@ bool ggml_gallocr_reserve_n(ggml_gallocr_t galloc, struct ggml_cgraph * graph, c
             galloc->leaf_allocs[i].leaf.size_max = 0;
         } else {
             galloc->leaf_allocs[i].leaf.buffer_id = hn->buffer_id;
-            galloc->leaf_allocs[i].leaf.addr = hn->addr;
+            galloc->leaf_allocs[i].leaf.addr = ggml_gallocr_get_addr(galloc, hn);
             galloc->leaf_allocs[i].leaf.size_max = ggml_backend_buft_get_alloc_size(galloc->bufts[hn->buffer_id], leaf);
         }
     }
+}
+
+bool ggml_gallocr_reserve_n(ggml_gallocr_t galloc, struct ggml_cgraph * graph, const int * node_buffer_ids, const int * leaf_buffer_ids) {
+    // reuse the allocations of a previous graph with the same shape
+    const uint64_t key = ggml_gallocr_graph_key(graph, node_buffer_ids, leaf_buffer_ids);
+    if (ggml_gallocr_load_plan(galloc, key)) {
+        return true;
+    }
+
+    ggml_gallocr_plan_graph(galloc, graph, node_buffer_ids, leaf_buffer_ids);
 
     // reallocate buffers if needed
     for (int i = 0; i < galloc->n_buffers; i++) {
@@ -927,9 +1284,39 @@ bool ggml_gallocr_reserve_n(ggml_gallocr_t galloc, struct ggml_cgraph * graph, c
         }
     }
 
+    ggml_gallocr_store_plan(galloc, key);
+
     return true;
 }
 
+void ggml_gallocr_reserve_n_size(ggml_gallocr_t galloc, struct ggml_cgraph * graph, const int * node_buffer_ids, const int * leaf_buffer_ids, size_t * sizes) {
+    ggml_gallocr_plan_graph(galloc, graph, node_buffer_ids, leaf_buffer_ids);
+
+    for (int i = 0; i < galloc->n_buffers; i++) {
+        sizes[i] = 0;
+
+        // if the buffer type is used multiple times, only count it the first time
+        bool shared = false;
+        for (int j = 0; j < i; j++) {
+            if (galloc->buf_tallocs[j] == galloc->buf_tallocs[i]) {
+                shared = true;
+                break;
+            }
+        }
+        if (shared) {
+            continue;
+        }
+
+        for (int c = 0; c < galloc->buf_tallocs[i]->n_chunks; c++) {
+            sizes[i] += ggml_dyn_tallocr_max_size(galloc->buf_tallocs[i], c);
+        }
+    }
+
+    // the node allocations do not match the buffers anymore
+    galloc->n_nodes = 0;
+    galloc->n_leafs = 0;
+}
+
 bool ggml_gallocr_reserve(ggml_gallocr_t galloc, struct ggml_cgraph *graph) {
     return ggml_gallocr_reserve_n(galloc, graph, NULL, NULL);
 }
@@ -1093,10 +1480,10 @@ static void free_buffers(ggml_backend_buffer_t ** buffers, const size_t * n_buff
 
 static bool alloc_tensor_range(struct ggml_context * ctx,
         struct ggml_tensor * first, struct ggml_tensor * last,
-        ggml_backend_buffer_type_t buft, size_t size,
+        ggml_backend_buffer_type_t buft, size_t size, bool dummy,
         ggml_backend_buffer_t ** buffers, size_t * n_buffers) {
 
-    ggml_backend_buffer_t buffer = ggml_backend_buft_alloc_buffer(buft, size);
+    ggml_backend_buffer_t buffer = dummy ? ggml_backend_buft_alloc_dummy_buffer(buft, size) : ggml_backend_buft_alloc_buffer(buft, size);
     if (buffer == NULL) {
         GGML_LOG_ERROR("%s: failed to allocate %s buffer of size %zu\n", __func__, ggml_backend_buft_name(buft), size);
         free_buffers(buffers, n_buffers);
@@ -1132,7 +1519,7 @@ static bool alloc_tensor_range(struct ggml_context * ctx,
     return true;
 }
 
-ggml_backend_buffer_t ggml_backend_alloc_ctx_tensors_from_buft(struct ggml_context * ctx, ggml_backend_buffer_type_t buft) {
+static ggml_backend_buffer_t ggml_backend_alloc_ctx_tensors_from_buft_impl(struct ggml_context * ctx, ggml_backend_buffer_type_t buft, bool dummy) {
     GGML_ASSERT(ggml_get_no_alloc(ctx) == true);
 
     size_t alignment = ggml_backend_buft_get_alignment(buft);
@@ -1151,7 +1538,7 @@ ggml_backend_buffer_t ggml_backend_alloc_ctx_tensors_from_buft(struct ggml_conte
 
         if (cur_buf_size > 0 && (cur_buf_size + this_size) > max_size) {
             // allocate tensors in the current buffer
-            if (!alloc_tensor_range(ctx, first, t, buft, cur_buf_size, &buffers, &n_buffers)) {
+            if (!alloc_tensor_range(ctx, first, t, buft, cur_buf_size, dummy, &buffers, &n_buffers)) {
                 return NULL;
             }
             first = t;
@@ -1163,7 +1550,7 @@ ggml_backend_buffer_t ggml_backend_alloc_ctx_tensors_from_buft(struct ggml_conte
 
     // allocate remaining tensors
     if (cur_buf_size > 0) {
-        if (!alloc_tensor_range(ctx, first, NULL, buft, cur_buf_size, &buffers, &n_buffers)) {
+        if (!alloc_tensor_range(ctx, first, NULL, buft, cur_buf_size, dummy, &buffers, &n_buffers)) {
             return NULL;
         }
     }
@@ -1185,6 +1572,14 @@ ggml_backend_buffer_t ggml_backend_alloc_ctx_tensors_from_buft(struct ggml_conte
     return buffer;
 }
 
+ggml_backend_buffer_t ggml_backend_alloc_ctx_tensors_from_buft(struct ggml_context * ctx, ggml_backend_buffer_type_t buft) {
+    return ggml_backend_alloc_ctx_tensors_from_buft_impl(ctx, buft, false);
+}
+
+ggml_backend_buffer_t ggml_backend_alloc_ctx_tensors_from_buft_dummy(struct ggml_context * ctx, ggml_backend_buffer_type_t buft) {
+    return ggml_backend_alloc_ctx_tensors_from_buft_impl(ctx, buft, true);
+}
+
 ggml_backend_buffer_t ggml_backend_alloc_ctx_tensors(struct ggml_context * ctx, ggml_backend_t backend) {
     return ggml_backend_alloc_ctx_tensors_from_buft(ctx, ggml_backend_get_default_buffer_type(backend));
 }
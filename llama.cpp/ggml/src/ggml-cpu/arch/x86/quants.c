@@ -133,6 +133,17 @@ static inline __m256 mul_sum_i8_pairs_float(const __m256i x, const __m256i y) {
 #endif
 }
 
+// multiply int16_t, add results pairwise and add the accumulator
+static inline __m256i mul_sum_i16_pairs_acc_int32x8(const __m256i acc, const __m256i x, const __m256i y) {
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return _mm256_dpwssd_epi32(acc, x, y);
+#elif defined(__AVXVNNI__)
+    return _mm256_dpwssd_avx_epi32(acc, x, y);
+#else
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(x, y));
+#endif
+}
+
 static inline __m128i packNibbles( __m256i bytes )
 {
     // Move bits within 16-bit lanes from 0000_abcd_0000_efgh into 0000_0000_abcd_efgh
@@ -263,7 +274,6 @@ static inline __m256 mul_sum_i8_quad_float(const __m128i x_1_0, const __m128i x_
 
 // quad fp16 delta calculation
 static inline __m256 quad_fp16_delta_float(const float x0, const float y0, const float x1, const float y1) {
-    // GGML_CPU_FP16_TO_FP32 is faster than Intel F16C
     return _mm256_set_m128(_mm_set1_ps(GGML_CPU_FP16_TO_FP32(x1) * GGML_CPU_FP16_TO_FP32(y1)),
                            _mm_set1_ps(GGML_CPU_FP16_TO_FP32(x0) * GGML_CPU_FP16_TO_FP32(y0)));
 }
@@ -540,12 +550,47 @@ static inline __m128i get_scale_shuffle(int i) {
 }
 #endif
 
+#if defined(__AVX2__)
+// Dot products of nr rows of x, bx bytes apart, with one column of y: each y
+// block is loaded once for all the rows. The x quants are multiplied unsigned
+// and their -8 offset is applied through the sum of the y block, which is also
+// shared by the rows.
+static inline void vec_dot_q4_0_q8_0_rows(int nb, float * GGML_RESTRICT s, const void * GGML_RESTRICT vx, size_t bx, const block_q8_0 * GGML_RESTRICT y, const int nr) {
+    const block_q4_0 * GGML_RESTRICT x[4];
+    __m256 acc[4];
+    for (int r = 0; r < nr; ++r) {
+        x[r] = (const block_q4_0 *) ((const char *) vx + r*bx);
+        acc[r] = _mm256_setzero_ps();
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        const float dy = GGML_CPU_FP16_TO_FP32(y[ib].d);
+        const __m256i qy = _mm256_loadu_si256((const __m256i *)y[ib].qs);
+        const __m256 off = mul_sum_us8_pairs_float(_mm256_set1_epi8(8), qy);
+
+        for (int r = 0; r < nr; ++r) {
+            const __m256 d = _mm256_set1_ps(GGML_CPU_FP16_TO_FP32(x[r][ib].d) * dy);
+            const __m256 q = _mm256_sub_ps(mul_sum_us8_pairs_float(bytes_from_nibbles_32(x[r][ib].qs), qy), off);
+            acc[r] = _mm256_fmadd_ps(d, q, acc[r]);
+        }
+    }
+
+    for (int r = 0; r < nr; ++r) {
+        s[r] = hsum_float_8(acc[r]);
+    }
+}
+#endif
+
 void ggml_vec_dot_q4_0_q8_0(int n, float * GGML_RESTRICT s, size_t bs, const void * GGML_RESTRICT vx, size_t bx, const void * GGML_RESTRICT vy, size_t by, int nrc) {
     const int qk = QK8_0;
     const int nb = n / qk;
 
     assert(n % qk == 0);
+#if defined(__AVX2__)
+    assert((nrc == 4) || (nrc == 2) || (nrc == 1));
+#else
     assert(nrc == 1);
+#endif
     UNUSED(nrc);
     UNUSED(bx);
     UNUSED(by);
@@ -554,6 +599,21 @@ void ggml_vec_dot_q4_0_q8_0(int n, float * GGML_RESTRICT s, size_t bs, const voi
     const block_q4_0 * GGML_RESTRICT x = vx;
     const block_q8_0 * GGML_RESTRICT y = vy;
 
+#if defined(__AVX2__)
+    if (nrc > 1) {
+        // nrc rows of x against nrc columns of y, or against a single column when by == 0
+        for (int c = 0; c < (by ? nrc : 1); ++c) {
+            const block_q8_0 * GGML_RESTRICT yc = (const block_q8_0 *) ((const char *) vy + c*by);
+            if (nrc == 4) {
+                vec_dot_q4_0_q8_0_rows(nb, s + c*bs, vx, bx, yc, 4);
+            } else {
+                vec_dot_q4_0_q8_0_rows(nb, s + c*bs, vx, bx, yc, 2);
+            }
+        }
+        return;
+    }
+#endif
+
     int ib = 0;
     float sumf = 0;
 
@@ -698,12 +758,47 @@ void ggml_vec_dot_q4_0_q8_0(int n, float * GGML_RESTRICT s, size_t bs, const voi
     *s = sumf;
 }
 
+#if defined(__AVX2__)
+// Dot products of nr rows of x, bx bytes apart, with one column of y: each y
+// block is loaded once for all the rows.
+static inline void vec_dot_q4_1_q8_1_rows(int nb, float * GGML_RESTRICT s, const void * GGML_RESTRICT vx, size_t bx, const block_q8_1 * GGML_RESTRICT y, const int nr) {
+    const block_q4_1 * GGML_RESTRICT x[4];
+    __m256 acc[4];
+    float summs[4];
+    for (int r = 0; r < nr; ++r) {
+        x[r] = (const block_q4_1 *) ((const char *) vx + r*bx);
+        acc[r] = _mm256_setzero_ps();
+        summs[r] = 0;
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        const float dy = GGML_CPU_FP16_TO_FP32(y[ib].d);
+        const float sy = GGML_CPU_FP16_TO_FP32(y[ib].s);
+        const __m256i qy = _mm256_loadu_si256((const __m256i *)y[ib].qs);
+
+        for (int r = 0; r < nr; ++r) {
+            summs[r] += GGML_CPU_FP16_TO_FP32(x[r][ib].m) * sy;
+            const __m256 d = _mm256_set1_ps(GGML_CPU_FP16_TO_FP32(x[r][ib].d) * dy);
+            acc[r] = _mm256_fmadd_ps(d, mul_sum_us8_pairs_float(bytes_from_nibbles_32(x[r][ib].qs), qy), acc[r]);
+        }
+    }
+
+    for (int r = 0; r < nr; ++r) {
+        s[r] = hsum_float_8(acc[r]) + summs[r];
+    }
+}
+#endif
+
 void ggml_vec_dot_q4_1_q8_1(int n, float * GGML_RESTRICT s, size_t bs, const void * GGML_RESTRICT vx, size_t bx, const void * GGML_RESTRICT vy, size_t by, int nrc) {
     const int qk = QK8_1;
     const int nb = n / qk;
 
     assert(n % qk == 0);
+#if defined(__AVX2__)
+    assert((nrc == 4) || (nrc == 2) || (nrc == 1));
+#else
     assert(nrc == 1);
+#endif
     UNUSED(nrc);
     UNUSED(bx);
     UNUSED(by);
@@ -712,6 +807,21 @@ void ggml_vec_dot_q4_1_q8_1(int n, float * GGML_RESTRICT s, size_t bs, const voi
     const block_q4_1 * GGML_RESTRICT x = vx;
     const block_q8_1 * GGML_RESTRICT y = vy;
 
+#if defined(__AVX2__)
+    if (nrc > 1) {
+        // nrc rows of x against nrc columns of y, or against a single column when by == 0
+        for (int c = 0; c < (by ? nrc : 1); ++c) {
+            const block_q8_1 * GGML_RESTRICT yc = (const block_q8_1 *) ((const char *) vy + c*by);
+            if (nrc == 4) {
+                vec_dot_q4_1_q8_1_rows(nb, s + c*bs, vx, bx, yc, 4);
+            } else {
+                vec_dot_q4_1_q8_1_rows(nb, s + c*bs, vx, bx, yc, 2);
+            }
+        }
+        return;
+    }
+#endif
+
     int ib = 0;
 
 #if defined(__AVX2__) || defined(__AVX__)
@@ -1008,12 +1118,45 @@ void ggml_vec_dot_q5_1_q8_1(int n, float * GGML_RESTRICT s, size_t bs, const voi
 #endif
 }
 
+#if defined(__AVX2__)
+// Dot products of nr rows of x, bx bytes apart, with one column of y: each y
+// block is loaded once for all the rows, and y is the side made unsigned so
+// that its absolute value is shared by the rows.
+static inline void vec_dot_q8_0_q8_0_rows(int nb, float * GGML_RESTRICT s, const void * GGML_RESTRICT vx, size_t bx, const block_q8_0 * GGML_RESTRICT y, const int nr) {
+    const block_q8_0 * GGML_RESTRICT x[4];
+    __m256 acc[4];
+    for (int r = 0; r < nr; ++r) {
+        x[r] = (const block_q8_0 *) ((const char *) vx + r*bx);
+        acc[r] = _mm256_setzero_ps();
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        const float dy = GGML_CPU_FP16_TO_FP32(y[ib].d);
+        const __m256i qy = _mm256_loadu_si256((const __m256i *)y[ib].qs);
+
+        for (int r = 0; r < nr; ++r) {
+            const __m256 d = _mm256_set1_ps(GGML_CPU_FP16_TO_FP32(x[r][ib].d) * dy);
+            const __m256i qx = _mm256_loadu_si256((const __m256i *)x[r][ib].qs);
+            acc[r] = _mm256_fmadd_ps(d, mul_sum_i8_pairs_float(qy, qx), acc[r]);
+        }
+    }
+
+    for (int r = 0; r < nr; ++r) {
+        s[r] = hsum_float_8(acc[r]);
+    }
+}
+#endif
+
 void ggml_vec_dot_q8_0_q8_0(int n, float * GGML_RESTRICT s, size_t bs, const void * GGML_RESTRICT vx, size_t bx, const void * GGML_RESTRICT vy, size_t by, int nrc) {
     const int qk = QK8_0;
     const int nb = n / qk;
 
     assert(n % qk == 0);
+#if defined(__AVX2__)
+    assert((nrc == 4) || (nrc == 2) || (nrc == 1));
+#else
     assert(nrc == 1);
+#endif
     UNUSED(nrc);
     UNUSED(bx);
     UNUSED(by);
@@ -1022,6 +1165,21 @@ void ggml_vec_dot_q8_0_q8_0(int n, float * GGML_RESTRICT s, size_t bs, const voi
     const block_q8_0 * GGML_RESTRICT x = vx;
     const block_q8_0 * GGML_RESTRICT y = vy;
 
+#if defined(__AVX2__)
+    if (nrc > 1) {
+        // nrc rows of x against nrc columns of y, or against a single column when by == 0
+        for (int c = 0; c < (by ? nrc : 1); ++c) {
+            const block_q8_0 * GGML_RESTRICT yc = (const block_q8_0 *) ((const char *) vy + c*by);
+            if (nrc == 4) {
+                vec_dot_q8_0_q8_0_rows(nb, s + c*bs, vx, bx, yc, 4);
+            } else {
+                vec_dot_q8_0_q8_0_rows(nb, s + c*bs, vx, bx, yc, 2);
+            }
+        }
+        return;
+    }
+#endif
+
     int ib = 0;
     float sumf = 0;
 
@@ -1336,12 +1494,10 @@ void ggml_vec_dot_q2_K_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const voi
             __m256i p3 = _mm256_maddubs_epi16(q2_3, q8_3);
 
             p0 = _mm256_madd_epi16(_mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(0)), p0);
-            p1 = _mm256_madd_epi16(_mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(1)), p1);
             p2 = _mm256_madd_epi16(_mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(2)), p2);
-            p3 = _mm256_madd_epi16(_mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(3)), p3);
 
-            p0 = _mm256_add_epi32(p0, p1);
-            p2 = _mm256_add_epi32(p2, p3);
+            p0 = mul_sum_i16_pairs_acc_int32x8(p0, _mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(1)), p1);
+            p2 = mul_sum_i16_pairs_acc_int32x8(p2, _mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(3)), p3);
 
             sumi = _mm256_add_epi32(sumi, _mm256_add_epi32(p0, p2));
         }
@@ -1568,13 +1724,11 @@ void ggml_vec_dot_q3_K_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const voi
 
             // multiply with scales
             p16_0 = _mm256_madd_epi16(_mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(is + 0)), p16_0);
-            p16_1 = _mm256_madd_epi16(_mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(is + 1)), p16_1);
             p16_2 = _mm256_madd_epi16(_mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(is + 2)), p16_2);
-            p16_3 = _mm256_madd_epi16(_mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(is + 3)), p16_3);
 
-            // accumulate
-            p16_0 = _mm256_add_epi32(p16_0, p16_1);
-            p16_2 = _mm256_add_epi32(p16_2, p16_3);
+            // multiply with scales and accumulate
+            p16_0 = mul_sum_i16_pairs_acc_int32x8(p16_0, _mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(is + 1)), p16_1);
+            p16_2 = mul_sum_i16_pairs_acc_int32x8(p16_2, _mm256_shuffle_epi8(scales[j], get_scale_shuffle_q3k(is + 3)), p16_3);
             sumi  = _mm256_add_epi32(sumi, _mm256_add_epi32(p16_0, p16_2));
 
         }
@@ -1805,9 +1959,8 @@ void ggml_vec_dot_q4_K_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const voi
             p16l = _mm256_madd_epi16(scale_l, p16l);
 
             const __m256i q8h = _mm256_loadu_si256((const __m256i*)q8); q8 += 32;
-            __m256i p16h = _mm256_maddubs_epi16(q4h, q8h);
-            p16h = _mm256_madd_epi16(scale_h, p16h);
-            const __m256i sumj = _mm256_add_epi32(p16l, p16h);
+            const __m256i p16h = _mm256_maddubs_epi16(q4h, q8h);
+            const __m256i sumj = mul_sum_i16_pairs_acc_int32x8(p16l, scale_h, p16h);
 
             sumi = _mm256_add_epi32(sumi, sumj);
         }
@@ -1935,7 +2088,82 @@ void ggml_vec_dot_q5_K_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const voi
 
     uint32_t utmp[4];
 
-#if defined __AVX2__
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__)
+
+    const __m512i m4  = _mm512_set1_epi8(0xF);
+    const __m512i m16 = _mm512_set1_epi8(16);
+    // int32 lanes 0-7 hold the products of the first sub-block of a pair, lanes 8-15 those of the second
+    const __m512i scale_idx = _mm512_set_epi32(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    __m256 acc = _mm256_setzero_ps();
+    __m128 acc_m = _mm_setzero_ps();
+
+    for (int i = 0; i < nb; ++i) {
+        const uint8_t * GGML_RESTRICT q5 = x[i].qs;
+        const int8_t  * GGML_RESTRICT q8 = y[i].qs;
+
+        const float d = y[i].d * GGML_CPU_FP16_TO_FP32(x[i].d);
+        const float dmin = -y[i].d * GGML_CPU_FP16_TO_FP32(x[i].dmin);
+
+        memcpy(utmp, x[i].scales, 12);
+        utmp[3] = ((utmp[2] >> 4) & kmask2) | (((utmp[1] >> 6) & kmask3) << 4);
+        const uint32_t uaux = utmp[1] & kmask1;
+        utmp[1] = (utmp[2] & kmask2) | (((utmp[0] >> 6) & kmask3) << 4);
+        utmp[2] = uaux;
+        utmp[0] &= kmask1;
+
+        const __m128i utmps = _mm_set_epi32(utmp[3], utmp[2], utmp[1], utmp[0]);
+
+        const __m256i q8sums = _mm256_loadu_si256((const __m256i*)y[i].bsums);
+        const __m128i q8s = _mm_hadd_epi16(_mm256_extracti128_si256(q8sums, 0), _mm256_extracti128_si256(q8sums, 1));
+        const __m128i prod = _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_unpackhi_epi64(utmps, utmps)), q8s);
+        acc_m = _mm_fmadd_ps(_mm_set1_ps(dmin), _mm_cvtepi32_ps(prod), acc_m);
+
+        // one scale per int32 lane, with the upper int16 half of the lane zero
+        const __m512i scales = _mm512_cvtepu8_epi32(utmps);
+
+        // bit 2j of qh is the fifth bit of sub-block 2j, bit 2j+1 that of sub-block 2j+1
+        const __m512i hbits = _mm512_broadcast_i64x4(_mm256_loadu_si256((const __m256i*)x[i].qh));
+        __m512i hmask = _mm512_inserti64x4(_mm512_set1_epi8(1), _mm256_set1_epi8(2), 1);
+
+        __m512i sumi_0 = _mm512_setzero_si512();
+        __m512i sumi_1 = _mm512_setzero_si512();
+        __m512i idx    = scale_idx;
+
+        for (int j = 0; j < QK_K/128; ++j) {
+
+            // the low nibbles of 32 bytes go with the first 32 q8, the high nibbles with the next 32
+            const __m512i q5bits_0 = _mm512_broadcast_i64x4(_mm256_loadu_si256((const __m256i*)q5)); q5 += 32;
+            const __m512i q5bits_1 = _mm512_broadcast_i64x4(_mm256_loadu_si256((const __m256i*)q5)); q5 += 32;
+            __m512i q5_0 = _mm512_and_si512(_mm512_mask_srli_epi16(q5bits_0, 0xFFFF0000, q5bits_0, 4), m4);
+            __m512i q5_1 = _mm512_and_si512(_mm512_mask_srli_epi16(q5bits_1, 0xFFFF0000, q5bits_1, 4), m4);
+            q5_0  = _mm512_mask_add_epi8(q5_0, _mm512_test_epi8_mask(hbits, hmask), q5_0, m16);
+            hmask = _mm512_slli_epi16(hmask, 2);
+            q5_1  = _mm512_mask_add_epi8(q5_1, _mm512_test_epi8_mask(hbits, hmask), q5_1, m16);
+            hmask = _mm512_slli_epi16(hmask, 2);
+
+            const __m512i q8_0 = _mm512_loadu_si512((const __m512i*)q8); q8 += 64;
+            const __m512i q8_1 = _mm512_loadu_si512((const __m512i*)q8); q8 += 64;
+
+            // the sums of 4 products fit in an int16, so each lane is scaled by the low half of its scale
+            const __m512i dot_0 = _mm512_dpbusd_epi32(_mm512_setzero_si512(), q5_0, q8_0);
+            const __m512i dot_1 = _mm512_dpbusd_epi32(_mm512_setzero_si512(), q5_1, q8_1);
+            sumi_0 = _mm512_dpwssd_epi32(sumi_0, dot_0, _mm512_permutexvar_epi32(idx, scales));
+            sumi_1 = _mm512_dpwssd_epi32(sumi_1, dot_1, _mm512_permutexvar_epi32(_mm512_add_epi32(idx, _mm512_set1_epi32(2)), scales));
+            idx    = _mm512_add_epi32(idx, _mm512_set1_epi32(4));
+        }
+
+        const __m512i sumi = _mm512_add_epi32(sumi_0, sumi_1);
+        const __m256i sumi8 = _mm256_add_epi32(_mm512_castsi512_si256(sumi), _mm512_extracti64x4_epi64(sumi, 1));
+        acc = _mm256_fmadd_ps(_mm256_set1_ps(d), _mm256_cvtepi32_ps(sumi8), acc);
+    }
+
+    acc_m = _mm_add_ps(acc_m, _mm_movehl_ps(acc_m, acc_m));
+    acc_m = _mm_add_ss(acc_m, _mm_movehdup_ps(acc_m));
+
+    *s = hsum_float_8(acc) + _mm_cvtss_f32(acc_m);
+
+#elif defined __AVX2__
 
     const __m256i m4 = _mm256_set1_epi8(0xF);
     const __m128i mzero = _mm_setzero_si128();
@@ -2001,9 +2229,9 @@ void ggml_vec_dot_q5_K_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const voi
             __m256i p16_1 = _mm256_maddubs_epi16(q5_1, q8_1);
 
             p16_0 = _mm256_madd_epi16(scale_0, p16_0);
-            p16_1 = _mm256_madd_epi16(scale_1, p16_1);
+            p16_0 = mul_sum_i16_pairs_acc_int32x8(p16_0, scale_1, p16_1);
 
-            sumi = _mm256_add_epi32(sumi, _mm256_add_epi32(p16_0, p16_1));
+            sumi = _mm256_add_epi32(sumi, p16_0);
 
         }
 
@@ -2139,7 +2367,66 @@ void ggml_vec_dot_q6_K_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const voi
 
     const int nb = n / QK_K;
 
-#if defined __AVX2__
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__)
+
+    const __m512i m4 = _mm512_set1_epi8(0xF);
+    const __m512i m3 = _mm512_set1_epi8(0x30);
+    // int32 lanes 4k to 4k+3 hold the products of the k-th sub-block of 16 in a group of 64 values
+    const __m512i scale_idx = _mm512_set_epi32(3, 3, 3, 3, 2, 2, 2, 2, 1, 1, 1, 1, 0, 0, 0, 0);
+
+    __m256 acc = _mm256_setzero_ps();
+
+    for (int i = 0; i < nb; ++i) {
+
+        const float d = y[i].d * GGML_CPU_FP16_TO_FP32(x[i].d);
+
+        const uint8_t * GGML_RESTRICT q4 = x[i].ql;
+        const uint8_t * GGML_RESTRICT qh = x[i].qh;
+        const int8_t  * GGML_RESTRICT q8 = y[i].qs;
+
+        const __m256i scales16 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)x[i].scales));
+
+        // the values are stored with an offset of 32, taken off through the sums of the q8 sub-blocks
+        const __m256i q8sums = _mm256_madd_epi16(scales16, _mm256_loadu_si256((const __m256i*)y[i].bsums));
+
+        // one scale per int32 lane, with the upper int16 half of the lane zero
+        const __m512i scales = _mm512_cvtepu16_epi32(scales16);
+
+        __m512i sumi_0 = _mm512_setzero_si512();
+        __m512i sumi_1 = _mm512_setzero_si512();
+        __m512i idx    = scale_idx;
+
+        for (int j = 0; j < QK_K/128; ++j) {
+
+            // the low nibbles of 64 bytes are values 0-63, the high nibbles values 64-127
+            const __m512i q4bits = _mm512_loadu_si512((const __m512i*)q4); q4 += 64;
+            // bit pairs 0, 1, 2 and 3 of 32 bytes are the high bits of values 0-31, 32-63, 64-95 and 96-127
+            __m512i q4bitsH = _mm512_broadcast_i64x4(_mm256_loadu_si256((const __m256i*)qh)); qh += 32;
+            q4bitsH = _mm512_mask_srli_epi16(q4bitsH, 0xFFFF0000, q4bitsH, 2);
+
+            const __m512i q4_0 = _mm512_or_si512(_mm512_and_si512(q4bits, m4), _mm512_and_si512(_mm512_slli_epi16(q4bitsH, 4), m3));
+            const __m512i q4_1 = _mm512_or_si512(_mm512_and_si512(_mm512_srli_epi16(q4bits, 4), m4), _mm512_and_si512(q4bitsH, m3));
+
+            const __m512i q8_0 = _mm512_loadu_si512((const __m512i*)q8); q8 += 64;
+            const __m512i q8_1 = _mm512_loadu_si512((const __m512i*)q8); q8 += 64;
+
+            // the sums of 4 products fit in an int16, so each lane is scaled by the low half of its scale
+            const __m512i dot_0 = _mm512_dpbusd_epi32(_mm512_setzero_si512(), q4_0, q8_0);
+            const __m512i dot_1 = _mm512_dpbusd_epi32(_mm512_setzero_si512(), q4_1, q8_1);
+            sumi_0 = _mm512_dpwssd_epi32(sumi_0, dot_0, _mm512_permutexvar_epi32(idx, scales));
+            sumi_1 = _mm512_dpwssd_epi32(sumi_1, dot_1, _mm512_permutexvar_epi32(_mm512_add_epi32(idx, _mm512_set1_epi32(4)), scales));
+            idx    = _mm512_add_epi32(idx, _mm512_set1_epi32(8));
+        }
+
+        const __m512i sumi = _mm512_add_epi32(sumi_0, sumi_1);
+        __m256i sumi8 = _mm256_add_epi32(_mm512_castsi512_si256(sumi), _mm512_extracti64x4_epi64(sumi, 1));
+        sumi8 = _mm256_sub_epi32(sumi8, _mm256_slli_epi32(q8sums, 5));
+        acc = _mm256_fmadd_ps(_mm256_set1_ps(d), _mm256_cvtepi32_ps(sumi8), acc);
+    }
+
+    *s = hsum_float_8(acc);
+
+#elif defined __AVX2__
 
     const __m256i m4 = _mm256_set1_epi8(0xF);
     const __m256i m2 = _mm256_set1_epi8(3);
@@ -2204,12 +2491,12 @@ void ggml_vec_dot_q6_K_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const voi
             p16_3 = _mm256_sub_epi16(p16_3, q8s_3);
 
             p16_0 = _mm256_madd_epi16(_mm256_cvtepi8_epi16(scale_0), p16_0);
-            p16_1 = _mm256_madd_epi16(_mm256_cvtepi8_epi16(scale_1), p16_1);
             p16_2 = _mm256_madd_epi16(_mm256_cvtepi8_epi16(scale_2), p16_2);
-            p16_3 = _mm256_madd_epi16(_mm256_cvtepi8_epi16(scale_3), p16_3);
 
-            sumi = _mm256_add_epi32(sumi, _mm256_add_epi32(p16_0, p16_1));
-            sumi = _mm256_add_epi32(sumi, _mm256_add_epi32(p16_2, p16_3));
+            p16_0 = mul_sum_i16_pairs_acc_int32x8(p16_0, _mm256_cvtepi8_epi16(scale_1), p16_1);
+            p16_2 = mul_sum_i16_pairs_acc_int32x8(p16_2, _mm256_cvtepi8_epi16(scale_3), p16_3);
+
+            sumi = _mm256_add_epi32(sumi, _mm256_add_epi32(p16_0, p16_2));
 
         }
 
@@ -2411,10 +2698,8 @@ void ggml_vec_dot_iq2_xxs_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const
             const __m256i dot2  = _mm256_maddubs_epi16(q2_2, q8s_2);
             const uint16_t ls1 = aux32[1] >> 28;
             const uint16_t ls2 = aux32[3] >> 28;
-            const __m256i p1 = _mm256_madd_epi16(dot1, _mm256_set1_epi16(2*ls1+1));
-            const __m256i p2 = _mm256_madd_epi16(dot2, _mm256_set1_epi16(2*ls2+1));
-            sumi1 = _mm256_add_epi32(sumi1, p1);
-            sumi2 = _mm256_add_epi32(sumi2, p2);
+            sumi1 = mul_sum_i16_pairs_acc_int32x8(sumi1, dot1, _mm256_set1_epi16(2*ls1+1));
+            sumi2 = mul_sum_i16_pairs_acc_int32x8(sumi2, dot2, _mm256_set1_epi16(2*ls2+1));
         }
 
         accumf = _mm256_fmadd_ps(_mm256_set1_ps(d), _mm256_cvtepi32_ps(_mm256_add_epi32(sumi1, sumi2)), accumf);
@@ -2605,10 +2890,10 @@ void ggml_vec_dot_iq2_xs_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const v
             const __m256i sc3 = _mm256_cvtepi8_epi16(_mm_shuffle_epi8(scales, get_scale_shuffle(ib32+2)));
             const __m256i sc4 = _mm256_cvtepi8_epi16(_mm_shuffle_epi8(scales, get_scale_shuffle(ib32+3)));
 
-            sumi1 = _mm256_add_epi32(sumi1, _mm256_madd_epi16(dot1, sc1));
-            sumi2 = _mm256_add_epi32(sumi2, _mm256_madd_epi16(dot2, sc2));
-            sumi1 = _mm256_add_epi32(sumi1, _mm256_madd_epi16(dot3, sc3));
-            sumi2 = _mm256_add_epi32(sumi2, _mm256_madd_epi16(dot4, sc4));
+            sumi1 = mul_sum_i16_pairs_acc_int32x8(sumi1, dot1, sc1);
+            sumi2 = mul_sum_i16_pairs_acc_int32x8(sumi2, dot2, sc2);
+            sumi1 = mul_sum_i16_pairs_acc_int32x8(sumi1, dot3, sc3);
+            sumi2 = mul_sum_i16_pairs_acc_int32x8(sumi2, dot4, sc4);
         }
 
         accumf = _mm256_fmadd_ps(_mm256_set1_ps(d), _mm256_cvtepi32_ps(_mm256_add_epi32(sumi1, sumi2)), accumf);
@@ -2856,10 +3141,8 @@ void ggml_vec_dot_iq2_s_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const vo
             const __m256i dot1  = _mm256_maddubs_epi16(q2_1, q8s_1); // blocks 2*ib32+0, 2*ib32+1
             const __m256i dot2  = _mm256_maddubs_epi16(q2_2, q8s_2); // blocks 2*ib32+2, 2*ib32+3
 
-            const __m256i p1 = _mm256_madd_epi16(dot1, _mm256_shuffle_epi8(scales16, get_scale_shuffle_k4(ib32+0)));
-            const __m256i p2 = _mm256_madd_epi16(dot2, _mm256_shuffle_epi8(scales16, get_scale_shuffle_k4(ib32+1)));
-            sumi1 = _mm256_add_epi32(sumi1, p1);
-            sumi2 = _mm256_add_epi32(sumi2, p2);
+            sumi1 = mul_sum_i16_pairs_acc_int32x8(sumi1, dot1, _mm256_shuffle_epi8(scales16, get_scale_shuffle_k4(ib32+0)));
+            sumi2 = mul_sum_i16_pairs_acc_int32x8(sumi2, dot2, _mm256_shuffle_epi8(scales16, get_scale_shuffle_k4(ib32+1)));
         }
 
         accumf = _mm256_fmadd_ps(_mm256_set1_ps(d), _mm256_cvtepi32_ps(_mm256_add_epi32(sumi1, sumi2)), accumf);
@@ -3015,10 +3298,8 @@ void ggml_vec_dot_iq3_xxs_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const
             const __m256i dot2  = _mm256_maddubs_epi16(q2_2, q8s_2);
             const uint16_t ls1 = aux32[0] >> 28;
             const uint16_t ls2 = aux32[1] >> 28;
-            const __m256i p1 = _mm256_madd_epi16(dot1, _mm256_set1_epi16(2*ls1+1));
-            const __m256i p2 = _mm256_madd_epi16(dot2, _mm256_set1_epi16(2*ls2+1));
-            sumi1 = _mm256_add_epi32(sumi1, p1);
-            sumi2 = _mm256_add_epi32(sumi2, p2);
+            sumi1 = mul_sum_i16_pairs_acc_int32x8(sumi1, dot1, _mm256_set1_epi16(2*ls1+1));
+            sumi2 = mul_sum_i16_pairs_acc_int32x8(sumi2, dot2, _mm256_set1_epi16(2*ls2+1));
         }
 
         accumf = _mm256_fmadd_ps(_mm256_set1_ps(d), _mm256_cvtepi32_ps(_mm256_add_epi32(sumi1, sumi2)), accumf);
@@ -3176,10 +3457,8 @@ void ggml_vec_dot_iq3_s_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const vo
             const __m256i dot2  = _mm256_maddubs_epi16(q2_2, q8s_2);
             const uint16_t ls1 = x[i].scales[ib32/2] & 0xf;
             const uint16_t ls2 = x[i].scales[ib32/2] >>  4;
-            const __m256i p1 = _mm256_madd_epi16(dot1, _mm256_set1_epi16(2*ls1+1));
-            const __m256i p2 = _mm256_madd_epi16(dot2, _mm256_set1_epi16(2*ls2+1));
-            sumi1 = _mm256_add_epi32(sumi1, p1);
-            sumi2 = _mm256_add_epi32(sumi2, p2);
+            sumi1 = mul_sum_i16_pairs_acc_int32x8(sumi1, dot1, _mm256_set1_epi16(2*ls1+1));
+            sumi2 = mul_sum_i16_pairs_acc_int32x8(sumi2, dot2, _mm256_set1_epi16(2*ls2+1));
         }
 
         accumf = _mm256_fmadd_ps(_mm256_set1_ps(d), _mm256_cvtepi32_ps(_mm256_add_epi32(sumi1, sumi2)), accumf);
@@ -3350,9 +3629,9 @@ void ggml_vec_dot_iq1_s_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const vo
             const int16_t ls1 = 2*((qh[ib+0] >> 12) & 7) + 1;
             const int16_t ls2 = 2*((qh[ib+1] >> 12) & 7) + 1;
             const __m256i p1 = _mm256_madd_epi16(dot1, _mm256_set1_epi16(ls1));
-            const __m256i p2 = _mm256_madd_epi16(dot2, _mm256_set1_epi16(ls2));
+            const __m256i p2 = mul_sum_i16_pairs_acc_int32x8(p1, dot2, _mm256_set1_epi16(ls2));
 
-            sumi = _mm256_add_epi32(sumi, _mm256_add_epi32(p1, p2));
+            sumi = _mm256_add_epi32(sumi, p2);
             sumi1 += (y[i].bsums[2*ib+0] + y[i].bsums[2*ib+1]) * (qh[ib+0] & 0x8000 ? -1 : 1) * ls1
                    + (y[i].bsums[2*ib+2] + y[i].bsums[2*ib+3]) * (qh[ib+1] & 0x8000 ? -1 : 1) * ls2;
         }
@@ -3515,12 +3794,12 @@ void ggml_vec_dot_iq1_m_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const vo
             scales_idx2 = _mm256_add_epi8(scales_idx2, mtwo8);
 
             const __m256i p1 = _mm256_madd_epi16(dot1, scale1);
-            const __m256i p2 = _mm256_madd_epi16(dot2, scale2);
+            const __m256i p2 = mul_sum_i16_pairs_acc_int32x8(p1, dot2, scale2);
             const __m256i p3 = _mm256_madd_epi16(dot3, scale1);
-            const __m256i p4 = _mm256_madd_epi16(dot4, scale2);
+            const __m256i p4 = mul_sum_i16_pairs_acc_int32x8(p3, dot4, scale2);
 
-            sumi1 = _mm256_add_epi32(sumi1, _mm256_add_epi32(p1, p2));
-            sumi2 = _mm256_add_epi32(sumi2, _mm256_add_epi32(p3, p4));
+            sumi1 = _mm256_add_epi32(sumi1, p2);
+            sumi2 = _mm256_add_epi32(sumi2, p4);
 
             qs += 8; qh += 4;
         }
@@ -3725,7 +4004,60 @@ void ggml_vec_dot_iq4_xs_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const v
 
     const int nb = n / QK_K;
 
-#if defined __AVX2__
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__)
+
+    // the values offset by 128, so that they can be the unsigned operand of dpbusd
+    const __m512i values = _mm512_broadcast_i32x4(_mm_xor_si128(_mm_loadu_si128((const __m128i*)kvalues_iq4nl), _mm_set1_epi8((char)0x80)));
+    const __m512i m4b = _mm512_set1_epi8(0x0f);
+    const __m256i shift_l = _mm256_set_epi32(28, 24, 20, 16, 12, 8, 4, 0);
+    const __m256i shift_h = _mm256_set_epi32(14, 12, 10, 8, 6, 4, 2, 0);
+    // 128-bit lane k holds the products of the k-th sub-block in a group of 4
+    const __m512i scale_idx = _mm512_set_epi32(3, 3, 3, 3, 2, 2, 2, 2, 1, 1, 1, 1, 0, 0, 0, 0);
+
+    __m256 accum = _mm256_setzero_ps();
+    for (int ibl = 0; ibl < nb; ++ibl) {
+        const uint8_t * qs = x[ibl].qs;
+        const int8_t  * q8 = y[ibl].qs;
+
+        uint32_t sl;
+        memcpy(&sl, x[ibl].scales_l, sizeof(sl));
+        const __m256i ls_l = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(sl), shift_l), _mm256_set1_epi32(0xf));
+        const __m256i ls_h = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(x[ibl].scales_h), shift_h), _mm256_set1_epi32(3));
+        const __m256i ls   = _mm256_sub_epi32(_mm256_or_si256(ls_l, _mm256_slli_epi32(ls_h, 4)), _mm256_set1_epi32(32));
+        const __m512i scales = _mm512_broadcast_i64x4(ls);
+
+        // the offset of the values is taken off through the sums of the q8 sub-blocks
+        const __m256i ls16 = _mm256_or_si256(_mm256_and_si256(ls, _mm256_set1_epi32(0xffff)), _mm256_slli_epi32(ls, 16));
+        const __m256i q8sums = _mm256_madd_epi16(ls16, _mm256_loadu_si256((const __m256i*)y[ibl].bsums));
+
+        __m512i sumi = _mm512_setzero_si512();
+        __m512i idx  = scale_idx;
+
+        for (int ib = 0; ib < QK_K/32; ib += 4) {
+            // 128-bit lane k holds sub-block ib+k, its first 16 values in the low nibbles
+            const __m512i q4bits = _mm512_loadu_si512((const __m512i*)qs); qs += 64;
+            const __m512i q4b_l = _mm512_shuffle_epi8(values, _mm512_and_si512(q4bits, m4b));
+            const __m512i q4b_h = _mm512_shuffle_epi8(values, _mm512_and_si512(_mm512_srli_epi16(q4bits, 4), m4b));
+
+            const __m512i q8b_0 = _mm512_loadu_si512((const __m512i*)q8); q8 += 64;
+            const __m512i q8b_1 = _mm512_loadu_si512((const __m512i*)q8); q8 += 64;
+            const __m512i q8b_l = _mm512_shuffle_i64x2(q8b_0, q8b_1, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m512i q8b_h = _mm512_shuffle_i64x2(q8b_0, q8b_1, _MM_SHUFFLE(3, 1, 3, 1));
+
+            __m512i dot = _mm512_dpbusd_epi32(_mm512_setzero_si512(), q4b_l, q8b_l);
+            dot  = _mm512_dpbusd_epi32(dot, q4b_h, q8b_h);
+            sumi = _mm512_add_epi32(sumi, _mm512_mullo_epi32(dot, _mm512_permutexvar_epi32(idx, scales)));
+            idx  = _mm512_add_epi32(idx, _mm512_set1_epi32(4));
+        }
+
+        __m256i sumi8 = _mm256_add_epi32(_mm512_castsi512_si256(sumi), _mm512_extracti64x4_epi64(sumi, 1));
+        sumi8 = _mm256_sub_epi32(sumi8, _mm256_slli_epi32(q8sums, 7));
+        accum = _mm256_fmadd_ps(_mm256_set1_ps(GGML_CPU_FP16_TO_FP32(x[ibl].d)*y[ibl].d), _mm256_cvtepi32_ps(sumi8), accum);
+    }
+
+    *s = hsum_float_8(accum);
+
+#elif defined __AVX2__
 
     const __m128i values128 = _mm_loadu_si128((const __m128i*)kvalues_iq4nl);
     const __m128i m4b  = _mm_set1_epi8(0x0f);
@@ -3751,10 +4083,8 @@ void ggml_vec_dot_iq4_xs_q8_K(int n, float * GGML_RESTRICT s, size_t bs, const v
             const int16_t ls1 = ((x[ibl].scales_l[ib/2] & 0xf) | ((sh << 4) & 0x30)) - 32;
             const int16_t ls2 = ((x[ibl].scales_l[ib/2] >>  4) | ((sh << 2) & 0x30)) - 32;
             sh >>= 4;
-            const __m256i p_1 = _mm256_madd_epi16(p16_1, _mm256_set1_epi16(ls1));
-            const __m256i p_2 = _mm256_madd_epi16(p16_2, _mm256_set1_epi16(ls2));
-            sumi1 = _mm256_add_epi32(p_1, sumi1);
-            sumi2 = _mm256_add_epi32(p_2, sumi2);
+            sumi1 = mul_sum_i16_pairs_acc_int32x8(sumi1, p16_1, _mm256_set1_epi16(ls1));
+            sumi2 = mul_sum_i16_pairs_acc_int32x8(sumi2, p16_2, _mm256_set1_epi16(ls2));
         }
         accum = _mm256_fmadd_ps(_mm256_set1_ps(GGML_CPU_FP16_TO_FP32(x[ibl].d)*y[ibl].d),
                 _mm256_cvtepi32_ps(_mm256_add_epi32(sumi1, sumi2)), accum);
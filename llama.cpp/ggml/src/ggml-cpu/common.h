@@ -17,7 +17,12 @@ static inline ggml_fp16_t f32_to_f16(float x) {
 }
 
 static inline float f16_to_f32(ggml_fp16_t x) {
+#if defined(__F16C__)
+    // these feed element-wise loops that the compiler vectorizes, which the scalar F16C intrinsic would prevent
+    return GGML_COMPUTE_FP16_TO_FP32(x);
+#else
     return GGML_CPU_FP16_TO_FP32(x);
+#endif
 }
 
 static inline ggml_bf16_t f32_to_bf16(float x) {
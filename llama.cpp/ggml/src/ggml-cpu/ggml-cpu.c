@@ -72,8 +72,10 @@
 #define UNUSED GGML_UNUSED
 #define SWAP(x, y, T) do { T SWAP = x; (x) = y; (y) = SWAP; } while (0)
 
+#if defined(GGML_CPU_FP16_TABLE)
 // precomputed f32 table for f16 (256 KB) (simd-mappings.h)
 float ggml_table_f32_f16[1 << 16];
+#endif
 
 #if defined(__ARM_ARCH)
 struct ggml_arm_arch_features_type {
@@ -193,6 +195,16 @@ typedef pthread_t ggml_thread_t;
 #include <TargetConditionals.h>
 #endif
 
+// the x86 multi-row kernels also take nrows rows against a single col (by == 0), the mmla kernels
+// always compute nrows x nrows and are called with one row at a time for a single col. The k-quants
+// stay at one row on x86: decoding the x scales and nibbles dominates, and sharing the y loads across
+// 2 or 4 rows measured slower for Q4_K
+#if defined(__AVX2__) && !defined(__ARM_FEATURE_MATMUL_INT8)
+#define GGML_VEC_DOT_SINGLE_COL_ROWS 1
+#else
+#define GGML_VEC_DOT_SINGLE_COL_ROWS 0
+#endif
+
 static const struct ggml_type_traits_cpu type_traits_cpu[GGML_TYPE_COUNT] = {
     [GGML_TYPE_F32] = {
         .from_float               = (ggml_from_float_t) ggml_cpu_fp32_to_fp32,
@@ -212,6 +224,8 @@ static const struct ggml_type_traits_cpu type_traits_cpu[GGML_TYPE_COUNT] = {
         .vec_dot_type             = GGML_TYPE_Q8_0,
 #if defined (__ARM_FEATURE_MATMUL_INT8)
         .nrows                    = 2,
+#elif defined(__AVX2__)
+        .nrows                    = 4,
 #else
         .nrows                    = 1,
 #endif
@@ -222,6 +236,8 @@ static const struct ggml_type_traits_cpu type_traits_cpu[GGML_TYPE_COUNT] = {
         .vec_dot_type             = GGML_TYPE_Q8_1,
 #if defined (__ARM_FEATURE_MATMUL_INT8)
         .nrows                    = 2,
+#elif defined(__AVX2__)
+        .nrows                    = 4,
 #else
         .nrows                    = 1,
 #endif
@@ -244,6 +260,8 @@ static const struct ggml_type_traits_cpu type_traits_cpu[GGML_TYPE_COUNT] = {
         .vec_dot_type             = GGML_TYPE_Q8_0,
 #if defined (__ARM_FEATURE_MATMUL_INT8)
         .nrows                    = 2,
+#elif defined(__AVX2__)
+        .nrows                    = 4,
 #else
         .nrows                    = 1,
 #endif
@@ -1122,6 +1140,7 @@ static void ggml_compute_forward_mul_mat_one_chunk(
     struct ggml_tensor * dst,
     const enum ggml_type type,
     const int64_t num_rows_per_vec_dot,
+    const int64_t num_cols_per_vec_dot,
     const int64_t ir0_start,
     const int64_t ir0_end,
     const int64_t ir1_start,
@@ -1161,12 +1180,12 @@ static void ggml_compute_forward_mul_mat_one_chunk(
     const size_t src1_col_stride = src1_cont || src1->type != vec_dot_type ? row_size : nb11;
 
     // attempt to reduce false-sharing (does not seem to make a difference)
-    // 16 * 2, accounting for mmla kernels
-    float tmp[32];
+    // 16 * 4, accounting for multi-row kernels
+    float tmp[64];
 
     for (int64_t iir1 = ir1_start; iir1 < ir1_end; iir1 += blck_1) {
         for (int64_t iir0 = ir0_start; iir0 < ir0_end; iir0 += blck_0) {
-            for (int64_t ir1 = iir1; ir1 < iir1 + blck_1 && ir1 < ir1_end; ir1 += num_rows_per_vec_dot) {
+            for (int64_t ir1 = iir1; ir1 < iir1 + blck_1 && ir1 < ir1_end; ir1 += num_cols_per_vec_dot) {
                 const int64_t i13 = (ir1 / (ne12 * ne1));
                 const int64_t i12 = (ir1 - i13 * ne12 * ne1) / ne1;
                 const int64_t i11 = (ir1 - i13 * ne12 * ne1 - i12 * ne1);
@@ -1195,11 +1214,16 @@ static void ggml_compute_forward_mul_mat_one_chunk(
                 //    vec_dot(ne00, &dst_col[ir0], src0_row + ir0*nb01, src1_col);
                 //}
 
-                for (int64_t ir0 = iir0; ir0 < iir0 + blck_0 && ir0 < ir0_end; ir0 += num_rows_per_vec_dot) {
-                    vec_dot(ne00, &tmp[ir0 - iir0], (num_rows_per_vec_dot > 1 ? 16 : 0), src0_row + ir0 * nb01, (num_rows_per_vec_dot > 1 ? nb01 : 0), src1_col, (num_rows_per_vec_dot > 1 ? src1_col_stride : 0), num_rows_per_vec_dot);
+                const int64_t ir0_blck_end = MIN(iir0 + blck_0, ir0_end);
+
+                for (int64_t ir0 = iir0; ir0 < ir0_blck_end; ) {
+                    // with a single col, the rows left over at the end of the block are done one at a time
+                    const int64_t nr = ir0 + num_rows_per_vec_dot <= ir0_blck_end ? num_rows_per_vec_dot : 1;
+                    vec_dot(ne00, &tmp[ir0 - iir0], (num_cols_per_vec_dot > 1 ? 16 : 0), src0_row + ir0 * nb01, (nr > 1 ? nb01 : 0), src1_col, (num_cols_per_vec_dot > 1 ? src1_col_stride : 0), nr);
+                    ir0 += nr;
                 }
 
-                for (int cn = 0; cn < num_rows_per_vec_dot; ++cn) {
+                for (int cn = 0; cn < num_cols_per_vec_dot; ++cn) {
                     memcpy(&dst_col[iir0 + cn * nb1 / nb0], tmp + (cn * 16), (MIN(iir0 + blck_0, ir0_end) - iir0) * sizeof(float));
                 }
             }
@@ -1383,15 +1407,18 @@ UseGgmlGemm2:;
         const int64_t ir1_start = dr1 * ith1;
         const int64_t ir1_end = MIN(ir1_start + dr1, nr1);
 
-        // dot kernels can handle 1 row and col at a time, but mmla kernels can process 2 rows and cols
+        // dot kernels can handle 1 row and col at a time, but multi-row kernels (mmla, x86) process
+        // vec_dot_num_rows rows against as many cols, the x86 ones also against a single col
         int64_t num_rows_per_vec_dot = vec_dot_num_rows;
+        int64_t num_cols_per_vec_dot = vec_dot_num_rows;
 
         // these checks are needed to avoid crossing dim1 boundaries
         // can be optimized, but the logic would become more complicated, so keeping it like this for simplicity
-        if ((nr0 % 2 != 0) || (ne11 % 2 != 0) || ((ir0_end - ir0_start) % 2 != 0) || ((ir1_end - ir1_start) % 2 != 0)) {
-            num_rows_per_vec_dot = 1;
+        if ((nr0 % num_cols_per_vec_dot != 0) || (ne11 % num_cols_per_vec_dot != 0) || ((ir0_end - ir0_start) % num_cols_per_vec_dot != 0) || ((ir1_end - ir1_start) % num_cols_per_vec_dot != 0)) {
+            num_rows_per_vec_dot = GGML_VEC_DOT_SINGLE_COL_ROWS ? vec_dot_num_rows : 1;
+            num_cols_per_vec_dot = 1;
         }
-        ggml_compute_forward_mul_mat_one_chunk(params, dst, src0->type, num_rows_per_vec_dot, ir0_start, ir0_end, ir1_start, ir1_end);
+        ggml_compute_forward_mul_mat_one_chunk(params, dst, src0->type, num_rows_per_vec_dot, num_cols_per_vec_dot, ir0_start, ir0_end, ir1_start, ir1_end);
 
         if (nth >= nchunk0 * nchunk1) {
             break;
@@ -1432,6 +1459,7 @@ static void ggml_compute_forward_mul_mat_id_one_chunk(
 
     ggml_vec_dot_t    const vec_dot      = type_traits_cpu[type].vec_dot;
     enum ggml_type    const vec_dot_type = type_traits_cpu[type].vec_dot_type;
+    int64_t           const vec_dot_num_rows = GGML_VEC_DOT_SINGLE_COL_ROWS ? type_traits_cpu[type].nrows : 1;
 
     const int64_t blck_0 = 16;
     const int64_t blck_1 = 16;
@@ -1463,8 +1491,10 @@ static void ggml_compute_forward_mul_mat_id_one_chunk(
 
                 float * dst_col = (float *) ((char *) dst->data + (i1*nb1 + i2*nb2));
 
-                for (int64_t ir0 = iir0; ir0 < iir0 + blck_0 && ir0 < ir0_end; ++ir0) {
-                    vec_dot(ne00, &tmp[ir0 - iir0], 0, src0_cur + ir0*nb01, 0, src1_col, 0, 1);
+                for (int64_t ir0 = iir0; ir0 < iir0 + blck_0 && ir0 < ir0_end; ) {
+                    const int64_t nr = ir0 + vec_dot_num_rows <= MIN(iir0 + blck_0, ir0_end) ? vec_dot_num_rows : 1;
+                    vec_dot(ne00, &tmp[ir0 - iir0], 0, src0_cur + ir0*nb01, (nr > 1 ? nb01 : 0), src1_col, 0, nr);
+                    ir0 += nr;
                 }
 
                 memcpy(&dst_col[iir0], tmp, (MIN(iir0 + blck_0, ir0_end) - iir0)*sizeof(float));
@@ -2822,7 +2852,7 @@ struct ggml_cplan ggml_graph_plan(
                         const int64_t ne10 = node->src[1]->ne[0]; // DK
                         const int64_t ne20 = node->src[2]->ne[0]; // DV
 
-                        cur = sizeof(float)*(1*ne10 + 2*ne20)*n_tasks; // 1x head size K + 2x head size V (per thread)
+                        cur = sizeof(float)*(1*ne10 + 2*ne20 + 2*GGML_FLASH_ATTN_EXT_KV_BLOCK)*n_tasks; // 1x head size K + 2x head size V + 2x KQ block (per thread)
                     } break;
                 case GGML_OP_FLASH_ATTN_BACK:
                     {
@@ -3241,6 +3271,11 @@ void ggml_cpu_fp32_to_fp16(const float * x, ggml_fp16_t * y, int64_t n) {
         __m128i y_vec = _mm_cvtps_ph(x_vec, _MM_FROUND_TO_NEAREST_INT);
         _mm_storel_epi64((__m128i *)(y + i), y_vec);
     }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 3 < n; i += 4) {
+        const float16x4_t y_vec = vcvt_f16_f32(vld1q_f32(x + i));
+        vst1_u16((uint16_t *)(y + i), vreinterpret_u16_f16(y_vec));
+    }
 #elif defined(__riscv_zvfh)
     for (int vl; i < n; i += vl) {
         vl = __riscv_vsetvl_e32m2(n - i);
@@ -3274,6 +3309,11 @@ void ggml_cpu_fp16_to_fp32(const ggml_fp16_t * x, float * y, int64_t n) {
         __m128 y_vec = _mm_cvtph_ps(x_vec);
         _mm_storeu_ps(y + i, y_vec);
     }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 3 < n; i += 4) {
+        const float16x4_t x_vec = vreinterpret_f16_u16(vld1_u16((const uint16_t *)(x + i)));
+        vst1q_f32(y + i, vcvt_f32_f16(x_vec));
+    }
 #endif
 
     for (; i < n; ++i) {
@@ -3545,8 +3585,9 @@ void ggml_cpu_init(void) {
     static bool is_first_call = true;
 
     if (is_first_call) {
-        // initialize GELU, Quick GELU, SILU and EXP F32 tables
+        // initialize the f16 -> f32 table on targets without a native conversion
         {
+#if defined(GGML_CPU_FP16_TABLE)
             const uint64_t t_start = ggml_time_us(); UNUSED(t_start);
 
             for (int i = 0; i < (1 << 16); ++i) {
@@ -3554,15 +3595,13 @@ void ggml_cpu_init(void) {
                     uint16_t u16;
                     ggml_fp16_t fp16;
                 } u = {i};
-                float f = GGML_COMPUTE_FP16_TO_FP32(u.fp16);
-                ggml_table_f32_f16[i] = f;
-                ggml_table_gelu_f16[i] = GGML_CPU_FP32_TO_FP16(ggml_gelu_f32(f));
-                ggml_table_gelu_quick_f16[i] = GGML_CPU_FP32_TO_FP16(ggml_gelu_quick_f32(f));
+                ggml_table_f32_f16[i] = GGML_COMPUTE_FP16_TO_FP32(u.fp16);
             }
 
             const uint64_t t_end = ggml_time_us(); UNUSED(t_end);
 
-            GGML_PRINT_DEBUG("%s: GELU, Quick GELU, SILU and EXP tables initialized in %f ms\n", __func__, (t_end - t_start)/1000.0);
+            GGML_PRINT_DEBUG("%s: F16 table initialized in %f ms\n", __func__, (t_end - t_start)/1000.0);
+#endif
 
 #ifdef GGML_USE_OPENMP
             //if (!getenv("OMP_WAIT_POLICY")) {
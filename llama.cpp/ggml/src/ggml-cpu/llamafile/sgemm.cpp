@@ -1075,6 +1075,349 @@ class tinyBLAS_Q0_AVX {
 };
 #endif // __AVX__
 
+#if defined(__AVX2__)
+// K-quant super-blocks (Q4_K, Q5_K, Q6_K) against Q8_K. The quants of a row
+// are unpacked to unsigned bytes one chunk at a time (32 values, or 64 with
+// AVX512BW), multiplied with maddubs, and weighted with their sub-block scale
+// using madd (dpwssd with VNNI) into a per super-block integer sum. The mins
+// (and the -32 offset of Q6_K) are applied once per super-block through the
+// bsums of Q8_K, so each tile only does two float FMAs per super-block.
+template <typename TA>
+class tinyBLAS_QK_AVX {
+  public:
+    tinyBLAS_QK_AVX(int64_t k,
+                    const TA *A, int64_t lda,
+                    const block_q8_K *B, int64_t ldb,
+                    float *C, int64_t ldc,
+                    int ith, int nth)
+        : A(A), B(B), C(C), k(k), lda(lda), ldb(ldb), ldc(ldc), ith(ith), nth(nth) {
+    }
+
+    void matmul(int64_t m, int64_t n) {
+        mnpack(0, m, 0, n);
+    }
+
+  private:
+#if defined(__AVX512BW__)
+    typedef __m512i ivec;
+    static constexpr int CHUNK = 64;
+#else
+    typedef __m256i ivec;
+    static constexpr int CHUNK = 32;
+#endif
+    static constexpr int CHUNKS = QK_K / CHUNK;
+
+    void mnpack(int64_t m0, int64_t m, int64_t n0, int64_t n) {
+        int64_t mc, nc, mp, np;
+        switch ((MIN(m - m0, 4) << 4) | MIN(n - n0, 4)) {
+#if VECTOR_REGISTERS == 32
+        case 0x44:
+            mc = 4;
+            nc = 4;
+            gemm<4, 4>(m0, m, n0, n);
+            break;
+        case 0x43:
+            mc = 4;
+            nc = 3;
+            gemm<4, 3>(m0, m, n0, n);
+            break;
+        case 0x34:
+            mc = 3;
+            nc = 4;
+            gemm<3, 4>(m0, m, n0, n);
+            break;
+        case 0x33:
+            mc = 3;
+            nc = 3;
+            gemm<3, 3>(m0, m, n0, n);
+            break;
+        case 0x42:
+            mc = 4;
+            nc = 2;
+            gemm<4, 2>(m0, m, n0, n);
+            break;
+        case 0x24:
+            mc = 2;
+            nc = 4;
+            gemm<2, 4>(m0, m, n0, n);
+            break;
+#else
+        case 0x44:
+        case 0x43:
+        case 0x42:
+            mc = 4;
+            nc = 2;
+            gemm<4, 2>(m0, m, n0, n);
+            break;
+        case 0x34:
+        case 0x24:
+            mc = 2;
+            nc = 4;
+            gemm<2, 4>(m0, m, n0, n);
+            break;
+        case 0x33:
+#endif
+        case 0x32:
+            mc = 3;
+            nc = 2;
+            gemm<3, 2>(m0, m, n0, n);
+            break;
+        case 0x23:
+            mc = 2;
+            nc = 3;
+            gemm<2, 3>(m0, m, n0, n);
+            break;
+        case 0x41:
+            mc = 4;
+            nc = 1;
+            gemm<4, 1>(m0, m, n0, n);
+            break;
+        case 0x22:
+            mc = 2;
+            nc = 2;
+            gemm<2, 2>(m0, m, n0, n);
+            break;
+        case 0x14:
+            mc = 1;
+            nc = 4;
+            gemm<1, 4>(m0, m, n0, n);
+            break;
+        case 0x31:
+            mc = 3;
+            nc = 1;
+            gemm<3, 1>(m0, m, n0, n);
+            break;
+        case 0x13:
+            mc = 1;
+            nc = 3;
+            gemm<1, 3>(m0, m, n0, n);
+            break;
+        case 0x21:
+            mc = 2;
+            nc = 1;
+            gemm<2, 1>(m0, m, n0, n);
+            break;
+        case 0x12:
+            mc = 1;
+            nc = 2;
+            gemm<1, 2>(m0, m, n0, n);
+            break;
+        case 0x11:
+            mc = 1;
+            nc = 1;
+            gemm<1, 1>(m0, m, n0, n);
+            break;
+        default:
+            return;
+        }
+        mp = m0 + (m - m0) / mc * mc;
+        np = n0 + (n - n0) / nc * nc;
+        mnpack(mp, m, n0, np);
+        mnpack(m0, m, np, n);
+    }
+
+    template <int RM, int RN>
+    NOINLINE void gemm(int64_t m0, int64_t m, int64_t n0, int64_t n) {
+        int64_t ytiles = (m - m0) / RM;
+        int64_t xtiles = (n - n0) / RN;
+        int64_t tiles = xtiles * ytiles;
+        int64_t duty = (tiles + nth - 1) / nth;
+        int64_t start = duty * ith;
+        int64_t end = start + duty;
+        if (end > tiles)
+            end = tiles;
+        for (int64_t job = start; job < end; ++job) {
+            int64_t ii = m0 + job / xtiles * RM;
+            int64_t jj = n0 + job % xtiles * RN;
+            __m256 Cv[RN][RM] = {};
+            for (int64_t l = 0; l < k; ++l) {
+                __m256i scales[RM];
+                __m256i mins[RM];
+                float da[RM];
+                float ma[RM];
+                for (int64_t i = 0; i < RM; ++i)
+                    prepare(A + lda * (ii + i) + l, scales[i], mins[i], da[i], ma[i]);
+                ivec sumi[RN][RM] = {};
+                for (int c = 0; c < CHUNKS; ++c) {
+                    ivec bv[RN];
+                    for (int64_t j = 0; j < RN; ++j)
+                        bv[j] = loadb(B + ldb * (jj + j) + l, c);
+                    for (int64_t i = 0; i < RM; ++i) {
+                        const ivec av = load(A + lda * (ii + i) + l, c);
+                        const ivec sv = spread(scales[i], c);
+                        for (int64_t j = 0; j < RN; ++j)
+                            sumi[j][i] = dot(sumi[j][i], av, bv[j], sv);
+                    }
+                }
+                for (int64_t j = 0; j < RN; ++j) {
+                    const block_q8_K *b = B + ldb * (jj + j) + l;
+                    const __m256i bsums = _mm256_loadu_si256((const __m256i *)b->bsums);
+                    for (int64_t i = 0; i < RM; ++i) {
+                        Cv[j][i] = madd(_mm256_set1_ps(da[i] * b->d), _mm256_cvtepi32_ps(reduce(sumi[j][i])), Cv[j][i]);
+                        Cv[j][i] = madd(_mm256_set1_ps(-ma[i] * b->d),
+                                        _mm256_cvtepi32_ps(_mm256_madd_epi16(mins[i], bsums)), Cv[j][i]);
+                    }
+                }
+            }
+            for (int64_t j = 0; j < RN; ++j)
+                for (int64_t i = 0; i < RM; ++i)
+                    C[ldc * (jj + j) + (ii + i)] = hsum(Cv[j][i]);
+        }
+    }
+
+    // Decodes the scales of a super-block into one int16 per 16 values, and
+    // the factor applied to the bsums of Q8_K with its float multiplier.
+    inline void prepare(const block_q4_K *x, __m256i &scales, __m256i &mins, float &d, float &m) {
+        prepare_k4(x->scales, scales, mins);
+        d = unhalf(x->d);
+        m = unhalf(x->dmin);
+    }
+
+    inline void prepare(const block_q5_K *x, __m256i &scales, __m256i &mins, float &d, float &m) {
+        prepare_k4(x->scales, scales, mins);
+        d = unhalf(x->d);
+        m = unhalf(x->dmin);
+    }
+
+    inline void prepare(const block_q6_K *x, __m256i &scales, __m256i &mins, float &d, float &m) {
+        scales = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)x->scales));
+        mins = _mm256_slli_epi16(scales, 5);
+        d = unhalf(x->d);
+        m = d;
+    }
+
+    static inline void prepare_k4(const uint8_t *s, __m256i &scales, __m256i &mins) {
+        uint32_t utmp[4];
+        memcpy(utmp, s, 12);
+        utmp[3] = ((utmp[2] >> 4) & 0x0f0f0f0f) | (((utmp[1] >> 6) & 0x03030303) << 4);
+        const uint32_t uaux = utmp[1] & 0x3f3f3f3f;
+        utmp[1] = (utmp[2] & 0x0f0f0f0f) | (((utmp[0] >> 6) & 0x03030303) << 4);
+        utmp[2] = uaux;
+        utmp[0] &= 0x3f3f3f3f;
+        const __m128i x = _mm_loadu_si128((const __m128i *)utmp);
+        scales = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(x, x));
+        mins = _mm256_cvtepu8_epi16(_mm_unpackhi_epi8(x, x));
+    }
+
+#if defined(__AVX512BW__)
+    // Chunk c covers the values [64c, 64c + 64).
+    static inline __m512i nibbles(const uint8_t *qs, int c) {
+        __m512i q = _mm512_broadcast_i64x4(_mm256_loadu_si256((const __m256i *)(qs + 32 * c)));
+        q = _mm512_mask_srli_epi16(q, 0xffff0000, q, 4);
+        return _mm512_and_si512(q, _mm512_set1_epi8(15));
+    }
+
+    inline __m512i load(const block_q4_K *x, int c) {
+        return nibbles(x->qs, c);
+    }
+
+    inline __m512i load(const block_q5_K *x, int c) {
+        __m512i h = _mm512_broadcast_i64x4(_mm256_loadu_si256((const __m256i *)x->qh));
+        h = _mm512_srl_epi16(h, _mm_cvtsi32_si128(2 * c));
+        h = _mm512_mask_srli_epi16(h, 0xffff0000, h, 1);
+        h = _mm512_slli_epi16(_mm512_and_si512(h, _mm512_set1_epi8(1)), 4);
+        return _mm512_or_si512(nibbles(x->qs, c), h);
+    }
+
+    inline __m512i load(const block_q6_K *x, int c) {
+        __m512i q = _mm512_loadu_si512((const __m512i *)(x->ql + 64 * (c >> 1)));
+        q = _mm512_and_si512(_mm512_srl_epi16(q, _mm_cvtsi32_si128(4 * (c & 1))), _mm512_set1_epi8(15));
+        __m512i h = _mm512_broadcast_i64x4(_mm256_loadu_si256((const __m256i *)(x->qh + 32 * (c >> 1))));
+        h = _mm512_srl_epi16(h, _mm_cvtsi32_si128(4 * (c & 1)));
+        h = _mm512_mask_srli_epi16(h, 0xffff0000, h, 2);
+        h = _mm512_slli_epi16(_mm512_and_si512(h, _mm512_set1_epi8(3)), 4);
+        return _mm512_or_si512(q, h);
+    }
+
+    inline __m512i loadb(const block_q8_K *b, int c) {
+        return _mm512_loadu_si512((const __m512i *)(b->qs + 64 * c));
+    }
+
+    // Scale of each 16 values of chunk c, repeated over their 8 int16 products.
+    static inline __m512i spread(__m256i scales, int c) {
+        const __m512i idx = _mm512_add_epi16(_mm512_set1_epi16(4 * c),
+                                             _mm512_srli_epi16(_mm512_set_epi16(31, 30, 29, 28, 27, 26, 25, 24,
+                                                                                23, 22, 21, 20, 19, 18, 17, 16,
+                                                                                15, 14, 13, 12, 11, 10,  9,  8,
+                                                                                 7,  6,  5,  4,  3,  2,  1,  0), 3));
+        return _mm512_permutexvar_epi16(idx, _mm512_castsi256_si512(scales));
+    }
+
+    static inline __m512i dot(__m512i acc, __m512i a, __m512i b, __m512i scales) {
+#if defined(__AVX512VNNI__)
+        return _mm512_dpwssd_epi32(acc, _mm512_maddubs_epi16(a, b), scales);
+#else
+        return _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_maddubs_epi16(a, b), scales));
+#endif
+    }
+
+    static inline __m256i reduce(__m512i x) {
+        return _mm256_add_epi32(_mm512_castsi512_si256(x), _mm512_extracti64x4_epi64(x, 1));
+    }
+#else
+    // Chunk c covers the values [32c, 32c + 32).
+    static inline __m256i nibbles(const uint8_t *qs, int c) {
+        const __m256i q = _mm256_loadu_si256((const __m256i *)(qs + 32 * (c >> 1)));
+        return _mm256_and_si256(_mm256_srl_epi16(q, _mm_cvtsi32_si128(4 * (c & 1))), _mm256_set1_epi8(15));
+    }
+
+    inline __m256i load(const block_q4_K *x, int c) {
+        return nibbles(x->qs, c);
+    }
+
+    inline __m256i load(const block_q5_K *x, int c) {
+        __m256i h = _mm256_srl_epi16(_mm256_loadu_si256((const __m256i *)x->qh), _mm_cvtsi32_si128(c));
+        h = _mm256_slli_epi16(_mm256_and_si256(h, _mm256_set1_epi8(1)), 4);
+        return _mm256_or_si256(nibbles(x->qs, c), h);
+    }
+
+    inline __m256i load(const block_q6_K *x, int c) {
+        const int g = c & 3;
+        __m256i q = _mm256_loadu_si256((const __m256i *)(x->ql + 64 * (c >> 2) + 32 * (g & 1)));
+        q = _mm256_and_si256(_mm256_srl_epi16(q, _mm_cvtsi32_si128(4 * (g >> 1))), _mm256_set1_epi8(15));
+        __m256i h = _mm256_loadu_si256((const __m256i *)(x->qh + 32 * (c >> 2)));
+        h = _mm256_and_si256(_mm256_srl_epi16(h, _mm_cvtsi32_si128(2 * g)), _mm256_set1_epi8(3));
+        return _mm256_or_si256(q, _mm256_slli_epi16(h, 4));
+    }
+
+    inline __m256i loadb(const block_q8_K *b, int c) {
+        return _mm256_loadu_si256((const __m256i *)(b->qs + 32 * c));
+    }
+
+    // Scale of each 16 values of chunk c, repeated over their 8 int16 products.
+    static inline __m256i spread(__m256i scales, int c) {
+        const __m256i pair = _mm256_permutevar8x32_epi32(scales, _mm256_set1_epi32(c));
+        return _mm256_shuffle_epi8(pair, _mm256_set_epi64x(0x0302030203020302, 0x0302030203020302,
+                                                           0x0100010001000100, 0x0100010001000100));
+    }
+
+    static inline __m256i dot(__m256i acc, __m256i a, __m256i b, __m256i scales) {
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+        return _mm256_dpwssd_epi32(acc, _mm256_maddubs_epi16(a, b), scales);
+#elif defined(__AVXVNNI__)
+        return _mm256_dpwssd_avx_epi32(acc, _mm256_maddubs_epi16(a, b), scales);
+#else
+        return _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(a, b), scales));
+#endif
+    }
+
+    static inline __m256i reduce(__m256i x) {
+        return x;
+    }
+#endif
+
+    const TA *const A;
+    const block_q8_K *const B;
+    float *const C;
+    const int64_t k;
+    const int64_t lda;
+    const int64_t ldb;
+    const int64_t ldc;
+    const int ith;
+    const int nth;
+};
+#endif // __AVX2__
+
 //PPC Implementation
 #if defined(__MMA__)
 
@@ -2932,6 +3275,40 @@ bool llamafile_sgemm(const struct ggml_compute_params * params, int64_t m, int64
 #endif
     }
 
+    case GGML_TYPE_Q4_K:
+    case GGML_TYPE_Q5_K:
+    case GGML_TYPE_Q6_K: {
+        if (Btype != GGML_TYPE_Q8_K)
+            return false;
+#if defined(__AVX2__)
+        if (Atype == GGML_TYPE_Q4_K) {
+            tinyBLAS_QK_AVX<block_q4_K> tb{
+                k, (const block_q4_K *)A, lda,
+                (const block_q8_K *)B, ldb,
+                (float *)C, ldc,
+                params->ith, params->nth};
+            tb.matmul(m, n);
+        } else if (Atype == GGML_TYPE_Q5_K) {
+            tinyBLAS_QK_AVX<block_q5_K> tb{
+                k, (const block_q5_K *)A, lda,
+                (const block_q8_K *)B, ldb,
+                (float *)C, ldc,
+                params->ith, params->nth};
+            tb.matmul(m, n);
+        } else {
+            tinyBLAS_QK_AVX<block_q6_K> tb{
+                k, (const block_q6_K *)A, lda,
+                (const block_q8_K *)B, ldb,
+                (float *)C, ldc,
+                params->ith, params->nth};
+            tb.matmul(m, n);
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
     default:
         return false;
     }
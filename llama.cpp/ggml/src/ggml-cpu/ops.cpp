@@ -8013,10 +8013,11 @@ static void ggml_compute_forward_flash_attn_ext_f16(
         float S = 0.0f;      // sum
         float M = -INFINITY; // maximum KQ value
 
-        float       * VKQ32 = (float       *) params->wdata + ith*(1*DK + 2*DV + CACHE_LINE_SIZE_F32); // FP32 VKQ accumulator
+        float       * VKQ32 = (float       *) params->wdata + ith*(1*DK + 2*DV + 2*GGML_FLASH_ATTN_EXT_KV_BLOCK + CACHE_LINE_SIZE_F32); // FP32 VKQ accumulator
         float       * V32   =                 (VKQ32 + 1*DV); // (temporary) FP32 V buffer
         ggml_fp16_t * VKQ16 = (ggml_fp16_t *) (VKQ32 + 1*DV); // (temporary) FP16 VKQ accumulator
         ggml_fp16_t * Q_q   = (ggml_fp16_t *) (VKQ32 + 2*DV); // (temporary) buffer for Q converted to quantized/FP16
+        float       * KQ    =                 (VKQ32 + 2*DV + 1*DK); // (temporary) KQ values of two blocks of KV positions
 
         if (v->type == GGML_TYPE_F16) {
             memset(VKQ16, 0, DV*sizeof(ggml_fp16_t));
@@ -8040,71 +8041,95 @@ static void ggml_compute_forward_flash_attn_ext_f16(
         // online softmax / attention
         // loop over n_kv and n_head_kv
         // ref: https://arxiv.org/pdf/2112.05682.pdf
-        for (int64_t ic = 0; ic < nek1; ++ic) {
-            const float mv = mp ? slope*GGML_CPU_FP16_TO_FP32(mp[ic]) : 0.0f;
-            if (mv == -INFINITY) {
-                continue;
-            }
+        // the KQ values are computed a block of KV positions at a time, so that the maximum update and the rescaling
+        // of VKQ happen once per block and the exponentials are evaluated with vector instructions
+        // the V rows of a block are accumulated while the KQ values of the next block are computed
+        const int64_t nb = (nek1 + GGML_FLASH_ATTN_EXT_KV_BLOCK - 1)/GGML_FLASH_ATTN_EXT_KV_BLOCK;
+
+        for (int64_t ib = 0; ib <= nb; ++ib) {
+            const int64_t ic0 = ib*GGML_FLASH_ATTN_EXT_KV_BLOCK;
+            const int64_t ip0 = ic0 - GGML_FLASH_ATTN_EXT_KV_BLOCK;
+            const int64_t nc  = ib < nb ? MIN(GGML_FLASH_ATTN_EXT_KV_BLOCK, nek1 - ic0) : 0;
+            const int64_t np  = ib > 0  ? MIN(GGML_FLASH_ATTN_EXT_KV_BLOCK, nek1 - ip0) : 0;
+
+            float       * KQc = KQ + ((ib + 0) % 2)*GGML_FLASH_ATTN_EXT_KV_BLOCK; // KQ values of the current block
+            const float * KQp = KQ + ((ib + 1) % 2)*GGML_FLASH_ATTN_EXT_KV_BLOCK; // post-softmax KQ values of the previous block
+
+            float Mnew = M;
+
+            for (int64_t j = 0; j < MAX(nc, np); ++j) {
+                if (j < np && KQp[j] != 0.0f) {
+                    const float vs = KQp[j];
+
+                    const char * v_data = ((const char *) v->data + ((ip0 + j)*nbv1 + iv2*nbv2 + iv3*nbv3));
+
+                    // V += v*expf(s - M)
+                    if (v->type == GGML_TYPE_F16) {
+                        ggml_vec_mad_f16(DV, VKQ16, (const ggml_fp16_t *) v_data, vs);
+                    } else if (v_to_float) {
+                        v_to_float(v_data, V32, DV);
+                        ggml_vec_mad_f32(DV, VKQ32, V32, vs);
+                    } else {
+                        // V is F32
+                        ggml_vec_mad_f32(DV, VKQ32, (const float *) v_data, vs);
+                    }
+                }
 
-            float s; // KQ value
+                if (j < nc) {
+                    const int64_t ic = ic0 + j;
 
-            const char * k_data = (const char *) k->data + ( ic*nbk1 + ik2*nbk2 + ik3*nbk3);
-            kq_vec_dot(DK, &s, 0, k_data, 0, Q_q, 0, 1);
+                    const float mv = mp ? slope*GGML_CPU_FP16_TO_FP32(mp[ic]) : 0.0f;
+                    if (mv == -INFINITY) {
+                        KQc[j] = -INFINITY;
+                        continue;
+                    }
 
-            s = s*scale; // scale KQ value
+                    float s; // KQ value
 
-            if (logit_softcap != 0.0f) {
-                s = logit_softcap*tanhf(s);
-            }
+                    const char * k_data = (const char *) k->data + ( ic*nbk1 + ik2*nbk2 + ik3*nbk3);
+                    kq_vec_dot(DK, &s, 0, k_data, 0, Q_q, 0, 1);
 
-            s += mv; // apply mask
+                    s = s*scale; // scale KQ value
 
-            const float Mold = M;
+                    if (logit_softcap != 0.0f) {
+                        s = logit_softcap*tanhf(s);
+                    }
 
-            float ms = 1.0f; // upon new higher max val, scale VKQ and KQ sum with this value
-            float vs = 1.0f; // post-softmax KQ value, expf(s - M)
+                    s += mv; // apply mask
 
-            const char * v_data = ((const char *) v->data + (ic*nbv1 + iv2*nbv2 + iv3*nbv3));
+                    KQc[j] = s;
+                    Mnew = MAX(Mnew, s);
+                }
+            }
 
-            if (v->type == GGML_TYPE_F16) {
-                if (s > M) {
-                    // s is new maximum, ms < 1.0f, vs == expf(s - s) == 1.0f
-                    M = s;
-                    ms = expf(Mold - M);
+            if (nc == 0) {
+                break;
+            }
 
-                    // V = V*expf(Mold - M)
-                    ggml_vec_scale_f16(DV, VKQ16, ms);
-                } else {
-                    // no new maximum, ms == 1.0f, vs != 1.0f
-                    vs = expf(s - M);
-                }
+            if (Mnew > M) {
+                // new maximum, scale VKQ and KQ sum with ms = expf(Mold - M) < 1.0f
+                if (M != -INFINITY) {
+                    const float ms = expf(M - Mnew);
 
-                // V += v*expf(s - M)
-                ggml_vec_mad_f16(DV, VKQ16, (const ggml_fp16_t *) v_data, vs);
-            } else {
-                if (s > M) {
-                    // s is new maximum, ms < 1.0f, vs == expf(s - s) == 1.0f
-                    M = s;
-                    ms = expf(Mold - M);
+                    if (v->type == GGML_TYPE_F16) {
+                        ggml_vec_scale_f16(DV, VKQ16, ms);
+                    } else {
+                        ggml_vec_scale_f32(DV, VKQ32, ms);
+                    }
 
-                    // V = V*expf(Mold - M)
-                    ggml_vec_scale_f32(DV, VKQ32, ms);
-                } else {
-                    // no new maximum, ms == 1.0f, vs != 1.0f
-                    vs = expf(s - M);
+                    S = S*ms;
                 }
 
-                // V += v*expf(s - M)
-                if (v_to_float) {
-                    v_to_float(v_data, V32, DV);
-                    ggml_vec_mad_f32(DV, VKQ32, V32, vs);
-                } else {
-                    // V is F32
-                    ggml_vec_mad_f32(DV, VKQ32, (const float *) v_data, vs);
-                }
+                M = Mnew;
             }
 
-            S = S*ms + vs; // scale and increment sum with partial sum
+            if (M == -INFINITY) {
+                // everything so far is masked out
+                memset(KQc, 0, nc*sizeof(float));
+            } else {
+                // post-softmax KQ values expf(s - M), masked positions become 0.0f
+                S += (float) ggml_vec_soft_max_f32(nc, KQc, KQc, M);
+            }
         }
 
         if (v->type == GGML_TYPE_F16) {
@@ -10089,6 +10114,31 @@ static void ggml_compute_forward_opt_step_adamw_f32(
     GGML_TENSOR_UNARY_OP_LOCALS
     GGML_ASSERT(nb00 == sizeof(float));
 
+    const float * adamw_params_ptr = ggml_get_data_f32(adamw_params);
+
+    if (ggml_is_contiguous(src0) && ggml_is_contiguous(src0_grad) &&
+        ggml_is_contiguous(src0_grad_m) && ggml_is_contiguous(src0_grad_v)) {
+        // split the flattened tensor instead of the rows:
+        // LoRA tensors have either very few or very short rows
+        const int64_t ne = ggml_nelements(src0);
+
+        // elements per thread, rounded up to a multiple of 64 to keep the chunks cache line aligned
+        const int64_t de = ((ne + nth - 1)/nth + 63) & ~(int64_t) 63;
+
+        const int64_t ie0 = MIN(de*ith, ne);
+        const int64_t ie1 = MIN(ie0 + de, ne);
+
+        if (ie0 < ie1) {
+            ggml_vec_adamw_f32(ie1 - ie0,
+                (float       *) src0->data        + ie0,
+                (const float *) src0_grad->data   + ie0,
+                (float       *) src0_grad_m->data + ie0,
+                (float       *) src0_grad_v->data + ie0,
+                adamw_params_ptr);
+        }
+        return;
+    }
+
     // rows per thread
     const int dr = (nr + nth - 1)/nth;
 
@@ -10096,16 +10146,6 @@ static void ggml_compute_forward_opt_step_adamw_f32(
     const int ir0 = dr*ith;
     const int ir1 = MIN(ir0 + dr, nr);
 
-    const float * adamw_params_ptr = ggml_get_data_f32(adamw_params);
-
-    const float alpha  = adamw_params_ptr[0];
-    const float beta1  = adamw_params_ptr[1];
-    const float beta2  = adamw_params_ptr[2];
-    const float eps    = adamw_params_ptr[3];
-    const float wd     = adamw_params_ptr[4];
-    const float beta1h = adamw_params_ptr[5];
-    const float beta2h = adamw_params_ptr[6];
-    const float keep   = 1.f - alpha * wd;
     for (int ir = ir0; ir < ir1; ++ir) {
         const int64_t i03 = ir/(ne02*ne01);
         const int64_t i02 = (ir - i03*ne02*ne01)/ne01;
@@ -10118,18 +10158,7 @@ static void ggml_compute_forward_opt_step_adamw_f32(
         float       * m = (float       *) ((char       *) src0_grad_m->data + offset);
         float       * v = (float       *) ((char       *) src0_grad_v->data + offset);
 
-        for (int i00 = 0; i00 < ne00; ++i00) {
-            m[i00] = m[i00]*beta1 +        g[i00]*(1.0f - beta1);
-            v[i00] = v[i00]*beta2 + g[i00]*g[i00]*(1.0f - beta2);
-
-            const float mh =       m[i00]*beta1h;
-            const float vh = sqrtf(v[i00]*beta2h) + eps;
-
-            // The weight decay is applied independently of the Adam momenta m and v.
-            // This is NOT equivalent to l2 regularization that adds w[i00]*w[i00] to the loss.
-            // See: https://arxiv.org/pdf/1711.05101v3.pdf
-            w[i00] = w[i00] * keep - alpha * mh / vh;
-        }
+        ggml_vec_adamw_f32(ne00, w, g, m, v, adamw_params_ptr);
     }
 }
 
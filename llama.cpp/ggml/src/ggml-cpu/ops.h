@@ -23,6 +23,9 @@ static const size_t CACHE_LINE_SIZE_F32 = CACHE_LINE_SIZE/sizeof(float);
 // Work buffer size for im2col operations in CONV2D
 #define GGML_IM2COL_WORK_SIZE (16 * 1024 * 1024)
 
+// Number of KV positions whose KQ values are computed before being folded into the online softmax of FLASH_ATTN_EXT
+#define GGML_FLASH_ATTN_EXT_KV_BLOCK 32
+
 #ifdef __cplusplus
 extern "C" {
 #endif
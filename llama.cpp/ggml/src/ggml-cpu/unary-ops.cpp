@@ -1,4 +1,7 @@
 #include "unary-ops.h"
+#include "vec.h"
+
+#include <type_traits>
 
 static inline float op_abs(float x) {
     return fabsf(x);
@@ -99,7 +102,8 @@ static inline void vec_unary_op(int64_t n, dst_t * y, const src0_t * x) {
     }
 }
 
-template <float (*op)(float), typename src0_t, typename dst_t>
+// vec_op, when given, is a vectorized f32 kernel computing op over a whole row
+template <float (*op)(float), typename src0_t, typename dst_t, void (*vec_op)(const int, float *, const float *) = nullptr>
 static void apply_unary_op(const ggml_compute_params * params, ggml_tensor * dst) {
     const ggml_tensor * src0 = dst->src[0];
 
@@ -120,17 +124,21 @@ static void apply_unary_op(const ggml_compute_params * params, ggml_tensor * dst
         dst_t        * dst_ptr  = (dst_t  *)       ((char *)       dst->data  + i03*nb3  + i02*nb2  + i01*nb1 );
         const src0_t * src0_ptr = (const src0_t *) ((const char *) src0->data + i03*nb03 + i02*nb02 + i01*nb01);
 
-        vec_unary_op<op>(ne0, dst_ptr, src0_ptr);
+        if constexpr (vec_op != nullptr && std::is_same_v<src0_t, float> && std::is_same_v<dst_t, float>) {
+            vec_op(ne0, dst_ptr, src0_ptr);
+        } else {
+            vec_unary_op<op>(ne0, dst_ptr, src0_ptr);
+        }
     }
 }
 
 // TODO: Use the 'traits' lookup table (for type conversion fns), instead of a mass of 'if' conditions with long templates
-template <float (*op)(float)>
+template <float (*op)(float), void (*vec_op)(const int, float *, const float *) = nullptr>
 static void unary_op(const ggml_compute_params * params, ggml_tensor * dst) {
     const ggml_tensor * src0 = dst->src[0];
 
     /*  */ if (src0->type == GGML_TYPE_F32  && dst->type == GGML_TYPE_F32) { // all f32
-        apply_unary_op<op, float, float>(params, dst);
+        apply_unary_op<op, float, float, vec_op>(params, dst);
     } else if (src0->type == GGML_TYPE_F16  && dst->type == GGML_TYPE_F16) { // all f16
         apply_unary_op<op, ggml_fp16_t, ggml_fp16_t>(params, dst);
     } else if (src0->type == GGML_TYPE_BF16 && dst->type == GGML_TYPE_BF16) { // all bf16
@@ -255,7 +263,7 @@ void ggml_compute_forward_relu(const ggml_compute_params * params, ggml_tensor *
 }
 
 void ggml_compute_forward_sigmoid(const ggml_compute_params * params, ggml_tensor * dst) {
-    unary_op<op_sigmoid>(params, dst);
+    unary_op<op_sigmoid, ggml_vec_sigmoid_f32>(params, dst);
 }
 
 void ggml_compute_forward_hardsigmoid(const ggml_compute_params * params, ggml_tensor * dst) {
@@ -263,7 +271,7 @@ void ggml_compute_forward_hardsigmoid(const ggml_compute_params * params, ggml_t
 }
 
 void ggml_compute_forward_exp(const ggml_compute_params * params, ggml_tensor * dst) {
-    unary_op<op_exp>(params, dst);
+    unary_op<op_exp, ggml_vec_exp_f32>(params, dst);
 }
 
 void ggml_compute_forward_hardswish(const ggml_compute_params * params, ggml_tensor * dst) {
@@ -287,7 +295,7 @@ void ggml_compute_forward_cos(const ggml_compute_params * params, ggml_tensor *
 }
 
 void ggml_compute_forward_log(const ggml_compute_params * params, ggml_tensor * dst) {
-    unary_op<op_log>(params, dst);
+    unary_op<op_log, ggml_vec_log_f32>(params, dst);
 }
 
 void ggml_compute_forward_floor(const ggml_compute_params * params, ggml_tensor * dst) {
@@ -1,12 +1,10 @@
 #include "vec.h"
 
+#include <algorithm>
 #include <cassert>
 
-// precomputed gelu table for f16 (128 KB)
-ggml_fp16_t ggml_table_gelu_f16[1 << 16];
-
-// precomputed quick gelu table for f16 (128 KB)
-ggml_fp16_t ggml_table_gelu_quick_f16[1 << 16];
+// f16 rows are converted through a small f32 buffer on the stack
+#define GGML_VEC_F16_CHUNK 256
 
 void ggml_vec_dot_f32(int n, float * GGML_RESTRICT s, size_t bs, const float * GGML_RESTRICT x, size_t bx, const float * GGML_RESTRICT y, size_t by, int nrc) {
    assert(nrc == 1);
@@ -404,6 +402,379 @@ void ggml_vec_swiglu_f32(const int n, float * y, const float * x, const float *
     }
 }
 
+void ggml_vec_sigmoid_f32(const int n, float * y, const float * x) {
+    int i = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    for (; i + 15 < n; i += 16) {
+        _mm512_storeu_ps(y + i, ggml_v_sigmoid(_mm512_loadu_ps(x + i)));
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    for (; i + 7 < n; i += 8) {
+        _mm256_storeu_ps(y + i, ggml_v_sigmoid(_mm256_loadu_ps(x + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 3 < n; i += 4) {
+        _mm_storeu_ps(y + i, ggml_v_sigmoid(_mm_loadu_ps(x + i)));
+    }
+#elif defined(__ARM_FEATURE_SVE) && defined(__aarch64__)
+    const int vlen = svcntw();
+    for (; i < n; i += vlen) {
+        const svbool_t pg = svwhilelt_b32_s32(i, n);
+        svst1_f32(pg, y + i, ggml_v_sigmoid(pg, svld1_f32(pg, x + i)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 3 < n; i += 4) {
+        vst1q_f32(y + i, ggml_v_sigmoid(vld1q_f32(x + i)));
+    }
+#endif
+    for (; i < n; ++i) {
+        y[i] = 1.f / (1.f + expf(-x[i]));
+    }
+}
+
+void ggml_vec_exp_f32(const int n, float * y, const float * x) {
+    int i = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    for (; i + 15 < n; i += 16) {
+        _mm512_storeu_ps(y + i, ggml_v_expf(_mm512_loadu_ps(x + i)));
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    for (; i + 7 < n; i += 8) {
+        _mm256_storeu_ps(y + i, ggml_v_expf(_mm256_loadu_ps(x + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 3 < n; i += 4) {
+        _mm_storeu_ps(y + i, ggml_v_expf(_mm_loadu_ps(x + i)));
+    }
+#elif defined(__ARM_FEATURE_SVE) && defined(__aarch64__)
+    const int vlen = svcntw();
+    for (; i < n; i += vlen) {
+        const svbool_t pg = svwhilelt_b32_s32(i, n);
+        svst1_f32(pg, y + i, ggml_v_expf(pg, svld1_f32(pg, x + i)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 3 < n; i += 4) {
+        vst1q_f32(y + i, ggml_v_expf(vld1q_f32(x + i)));
+    }
+#elif defined(__riscv_v_intrinsic)
+    for (int vl; i < n; i += vl) {
+        vl = __riscv_vsetvl_e32m2(n - i);
+        __riscv_vse32_v_f32m2(&y[i], ggml_v_expf_m2(__riscv_vle32_v_f32m2(&x[i], vl), vl), vl);
+    }
+#endif
+    for (; i < n; ++i) {
+        y[i] = expf(x[i]);
+    }
+}
+
+void ggml_vec_log_f32(const int n, float * y, const float * x) {
+    int i = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    for (; i + 15 < n; i += 16) {
+        _mm512_storeu_ps(y + i, ggml_v_logf(_mm512_loadu_ps(x + i)));
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    for (; i + 7 < n; i += 8) {
+        _mm256_storeu_ps(y + i, ggml_v_logf(_mm256_loadu_ps(x + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 3 < n; i += 4) {
+        _mm_storeu_ps(y + i, ggml_v_logf(_mm_loadu_ps(x + i)));
+    }
+#elif defined(__ARM_FEATURE_SVE) && defined(__aarch64__)
+    const int vlen = svcntw();
+    for (; i < n; i += vlen) {
+        const svbool_t pg = svwhilelt_b32_s32(i, n);
+        svst1_f32(pg, y + i, ggml_v_logf(pg, svld1_f32(pg, x + i)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 3 < n; i += 4) {
+        vst1q_f32(y + i, ggml_v_logf(vld1q_f32(x + i)));
+    }
+#endif
+    for (; i < n; ++i) {
+        y[i] = logf(x[i]);
+    }
+}
+
+// gelu(x) = 0.5*x*(1 + tanh(z)) = x*sigmoid(2*z), with z = sqrt(2/pi)*x*(1 + a*x^2)
+// saturates to 0 for x <= -10 and to x for x >= 10, where x*sigmoid(2*z) would give -inf*0 = nan for x = -inf
+void ggml_vec_gelu_f32(const int n, float * y, const float * x) {
+    int i = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    const __m512 c = _mm512_set1_ps(2.0f*SQRT_2_OVER_PI);
+    const __m512 a = _mm512_set1_ps(GELU_COEF_A);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 lim_hi = _mm512_set1_ps(10.0f);
+    const __m512 lim_lo = _mm512_set1_ps(-10.0f);
+    for (; i + 15 < n; i += 16) {
+        const __m512 vx = _mm512_loadu_ps(x + i);
+        const __m512 z = _mm512_mul_ps(_mm512_mul_ps(c, vx), _mm512_fmadd_ps(_mm512_mul_ps(a, vx), vx, one));
+        __m512 r = _mm512_mul_ps(vx, ggml_v_sigmoid(z));
+        r = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(vx, lim_hi, _CMP_GE_OQ), r, vx);
+        r = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(vx, lim_lo, _CMP_NLE_UQ), r);
+        _mm512_storeu_ps(y + i, r);
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    const __m256 c = _mm256_set1_ps(2.0f*SQRT_2_OVER_PI);
+    const __m256 a = _mm256_set1_ps(GELU_COEF_A);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 lim_hi = _mm256_set1_ps(10.0f);
+    const __m256 lim_lo = _mm256_set1_ps(-10.0f);
+    for (; i + 7 < n; i += 8) {
+        const __m256 vx = _mm256_loadu_ps(x + i);
+        const __m256 z = _mm256_mul_ps(_mm256_mul_ps(c, vx), _mm256_fmadd_ps(_mm256_mul_ps(a, vx), vx, one));
+        __m256 r = _mm256_mul_ps(vx, ggml_v_sigmoid(z));
+        r = _mm256_blendv_ps(r, vx, _mm256_cmp_ps(vx, lim_hi, _CMP_GE_OQ));
+        r = _mm256_andnot_ps(_mm256_cmp_ps(vx, lim_lo, _CMP_LE_OQ), r);
+        _mm256_storeu_ps(y + i, r);
+    }
+#elif defined(__SSE2__)
+    const __m128 c = _mm_set1_ps(2.0f*SQRT_2_OVER_PI);
+    const __m128 a = _mm_set1_ps(GELU_COEF_A);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 lim_hi = _mm_set1_ps(10.0f);
+    const __m128 lim_lo = _mm_set1_ps(-10.0f);
+    for (; i + 3 < n; i += 4) {
+        const __m128 vx = _mm_loadu_ps(x + i);
+        const __m128 z = _mm_mul_ps(_mm_mul_ps(c, vx), MADD128(_mm_mul_ps(a, vx), vx, one));
+        const __m128 hi = _mm_cmpge_ps(vx, lim_hi);
+        __m128 r = _mm_mul_ps(vx, ggml_v_sigmoid(z));
+        r = _mm_or_ps(_mm_and_ps(hi, vx), _mm_andnot_ps(hi, r));
+        r = _mm_andnot_ps(_mm_cmple_ps(vx, lim_lo), r);
+        _mm_storeu_ps(y + i, r);
+    }
+#elif defined(__ARM_FEATURE_SVE) && defined(__aarch64__)
+    const int vlen = svcntw();
+    for (; i < n; i += vlen) {
+        const svbool_t pg = svwhilelt_b32_s32(i, n);
+        const svfloat32_t vx = svld1_f32(pg, x + i);
+        const svfloat32_t z = svmul_f32_x(pg, svmul_n_f32_x(pg, vx, 2.0f*SQRT_2_OVER_PI),
+                                          svmla_f32_x(pg, svdup_n_f32_x(pg, 1.0f), svmul_n_f32_x(pg, vx, GELU_COEF_A), vx));
+        svfloat32_t r = svmul_f32_x(pg, vx, ggml_v_sigmoid(pg, z));
+        r = svsel_f32(svcmpge_n_f32(pg, vx, 10.0f), vx, r);
+        r = svsel_f32(svcmple_n_f32(pg, vx, -10.0f), svdup_n_f32(0.0f), r);
+        svst1_f32(pg, y + i, r);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 3 < n; i += 4) {
+        const float32x4_t vx = vld1q_f32(x + i);
+        const float32x4_t z = vmulq_f32(vmulq_n_f32(vx, 2.0f*SQRT_2_OVER_PI),
+                                        vfmaq_f32(vdupq_n_f32(1.0f), vmulq_n_f32(vx, GELU_COEF_A), vx));
+        float32x4_t r = vmulq_f32(vx, ggml_v_sigmoid(z));
+        r = vbslq_f32(vcgeq_f32(vx, vdupq_n_f32(10.0f)), vx, r);
+        r = vbslq_f32(vcleq_f32(vx, vdupq_n_f32(-10.0f)), vdupq_n_f32(0.0f), r);
+        vst1q_f32(y + i, r);
+    }
+#endif
+    for (; i < n; ++i) {
+        if (x[i] <= -10.0f) {
+            y[i] = 0.0f;
+        } else if (x[i] >= 10.0f) {
+            y[i] = x[i];
+        } else {
+            y[i] = ggml_gelu_f32(x[i]);
+        }
+    }
+}
+
+// saturates to 0 for x <= GELU_QUICK_SAT, like ggml_gelu_quick_f32
+void ggml_vec_gelu_quick_f32(const int n, float * y, const float * x) {
+    int i = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    const __m512 c = _mm512_set1_ps(-GELU_QUICK_COEF);
+    const __m512 lim_lo = _mm512_set1_ps(GELU_QUICK_SAT);
+    for (; i + 15 < n; i += 16) {
+        const __m512 vx = _mm512_loadu_ps(x + i);
+        const __m512 r = _mm512_mul_ps(vx, ggml_v_sigmoid(_mm512_mul_ps(c, vx)));
+        _mm512_storeu_ps(y + i, _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(vx, lim_lo, _CMP_NLE_UQ), r));
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    const __m256 c = _mm256_set1_ps(-GELU_QUICK_COEF);
+    const __m256 lim_lo = _mm256_set1_ps(GELU_QUICK_SAT);
+    for (; i + 7 < n; i += 8) {
+        const __m256 vx = _mm256_loadu_ps(x + i);
+        const __m256 r = _mm256_mul_ps(vx, ggml_v_sigmoid(_mm256_mul_ps(c, vx)));
+        _mm256_storeu_ps(y + i, _mm256_andnot_ps(_mm256_cmp_ps(vx, lim_lo, _CMP_LE_OQ), r));
+    }
+#elif defined(__SSE2__)
+    const __m128 c = _mm_set1_ps(-GELU_QUICK_COEF);
+    const __m128 lim_lo = _mm_set1_ps(GELU_QUICK_SAT);
+    for (; i + 3 < n; i += 4) {
+        const __m128 vx = _mm_loadu_ps(x + i);
+        const __m128 r = _mm_mul_ps(vx, ggml_v_sigmoid(_mm_mul_ps(c, vx)));
+        _mm_storeu_ps(y + i, _mm_andnot_ps(_mm_cmple_ps(vx, lim_lo), r));
+    }
+#elif defined(__ARM_FEATURE_SVE) && defined(__aarch64__)
+    const int vlen = svcntw();
+    for (; i < n; i += vlen) {
+        const svbool_t pg = svwhilelt_b32_s32(i, n);
+        const svfloat32_t vx = svld1_f32(pg, x + i);
+        svfloat32_t r = svmul_f32_x(pg, vx, ggml_v_sigmoid(pg, svmul_n_f32_x(pg, vx, -GELU_QUICK_COEF)));
+        r = svsel_f32(svcmple_n_f32(pg, vx, GELU_QUICK_SAT), svdup_n_f32(0.0f), r);
+        svst1_f32(pg, y + i, r);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 3 < n; i += 4) {
+        const float32x4_t vx = vld1q_f32(x + i);
+        float32x4_t r = vmulq_f32(vx, ggml_v_sigmoid(vmulq_n_f32(vx, -GELU_QUICK_COEF)));
+        r = vbslq_f32(vcleq_f32(vx, vdupq_n_f32(GELU_QUICK_SAT)), vdupq_n_f32(0.0f), r);
+        vst1q_f32(y + i, r);
+    }
+#endif
+    for (; i < n; ++i) {
+        y[i] = ggml_gelu_quick_f32(x[i]);
+    }
+}
+
+// the f16 variants convert in chunks and reuse the f32 kernels, instead of gathering from 64K-entry tables
+void ggml_vec_gelu_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x) {
+    float buf[GGML_VEC_F16_CHUNK];
+    for (int i = 0; i < n; i += GGML_VEC_F16_CHUNK) {
+        const int nc = std::min(GGML_VEC_F16_CHUNK, n - i);
+        ggml_cpu_fp16_to_fp32(x + i, buf, nc);
+        ggml_vec_gelu_f32(nc, buf, buf);
+        ggml_cpu_fp32_to_fp16(buf, y + i, nc);
+    }
+}
+
+void ggml_vec_gelu_quick_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x) {
+    float buf[GGML_VEC_F16_CHUNK];
+    for (int i = 0; i < n; i += GGML_VEC_F16_CHUNK) {
+        const int nc = std::min(GGML_VEC_F16_CHUNK, n - i);
+        ggml_cpu_fp16_to_fp32(x + i, buf, nc);
+        ggml_vec_gelu_quick_f32(nc, buf, buf);
+        ggml_cpu_fp32_to_fp16(buf, y + i, nc);
+    }
+}
+
+void ggml_vec_geglu_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x, const ggml_fp16_t * g) {
+    float buf[GGML_VEC_F16_CHUNK];
+    float gbuf[GGML_VEC_F16_CHUNK];
+    for (int i = 0; i < n; i += GGML_VEC_F16_CHUNK) {
+        const int nc = std::min(GGML_VEC_F16_CHUNK, n - i);
+        ggml_cpu_fp16_to_fp32(x + i, buf,  nc);
+        ggml_cpu_fp16_to_fp32(g + i, gbuf, nc);
+        ggml_vec_gelu_f32(nc, buf, buf);
+        ggml_vec_mul_f32(nc, buf, buf, gbuf);
+        ggml_cpu_fp32_to_fp16(buf, y + i, nc);
+    }
+}
+
+void ggml_vec_geglu_quick_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x, const ggml_fp16_t * g) {
+    float buf[GGML_VEC_F16_CHUNK];
+    float gbuf[GGML_VEC_F16_CHUNK];
+    for (int i = 0; i < n; i += GGML_VEC_F16_CHUNK) {
+        const int nc = std::min(GGML_VEC_F16_CHUNK, n - i);
+        ggml_cpu_fp16_to_fp32(x + i, buf,  nc);
+        ggml_cpu_fp16_to_fp32(g + i, gbuf, nc);
+        ggml_vec_gelu_quick_f32(nc, buf, buf);
+        ggml_vec_mul_f32(nc, buf, buf, gbuf);
+        ggml_cpu_fp32_to_fp16(buf, y + i, nc);
+    }
+}
+
+void ggml_vec_adamw_f32(const int n, float * w, const float * g, float * m, float * v, const float * pars) {
+    const float alpha  = pars[0];
+    const float beta1  = pars[1];
+    const float beta2  = pars[2];
+    const float eps    = pars[3];
+    const float wd     = pars[4];
+    const float beta1h = pars[5];
+    const float beta2h = pars[6];
+    const float keep   = 1.f - alpha * wd;
+
+    // w, m and v are read and written exactly once per element, the update is memory bound
+    int i = 0;
+#if defined(__AVX512F__)
+    const __m512 vbeta1  = _mm512_set1_ps(beta1);
+    const __m512 vbeta2  = _mm512_set1_ps(beta2);
+    const __m512 vbeta1c = _mm512_set1_ps(1.0f - beta1);
+    const __m512 vbeta2c = _mm512_set1_ps(1.0f - beta2);
+    const __m512 vbeta1h = _mm512_set1_ps(beta1h);
+    const __m512 vbeta2h = _mm512_set1_ps(beta2h);
+    const __m512 veps    = _mm512_set1_ps(eps);
+    const __m512 vkeep   = _mm512_set1_ps(keep);
+    const __m512 valpha  = _mm512_set1_ps(alpha);
+    for (; i + 15 < n; i += 16) {
+        const __m512 vg = _mm512_loadu_ps(g + i);
+        const __m512 vm = _mm512_fmadd_ps(_mm512_loadu_ps(m + i), vbeta1, _mm512_mul_ps(vg, vbeta1c));
+        const __m512 vv = _mm512_fmadd_ps(_mm512_loadu_ps(v + i), vbeta2, _mm512_mul_ps(_mm512_mul_ps(vg, vg), vbeta2c));
+        _mm512_storeu_ps(m + i, vm);
+        _mm512_storeu_ps(v + i, vv);
+        const __m512 vh = _mm512_add_ps(_mm512_sqrt_ps(_mm512_mul_ps(vv, vbeta2h)), veps);
+        const __m512 vu = _mm512_div_ps(_mm512_mul_ps(valpha, _mm512_mul_ps(vm, vbeta1h)), vh);
+        _mm512_storeu_ps(w + i, _mm512_fmsub_ps(_mm512_loadu_ps(w + i), vkeep, vu));
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    const __m256 vbeta1  = _mm256_set1_ps(beta1);
+    const __m256 vbeta2  = _mm256_set1_ps(beta2);
+    const __m256 vbeta1c = _mm256_set1_ps(1.0f - beta1);
+    const __m256 vbeta2c = _mm256_set1_ps(1.0f - beta2);
+    const __m256 vbeta1h = _mm256_set1_ps(beta1h);
+    const __m256 vbeta2h = _mm256_set1_ps(beta2h);
+    const __m256 veps    = _mm256_set1_ps(eps);
+    const __m256 vkeep   = _mm256_set1_ps(keep);
+    const __m256 valpha  = _mm256_set1_ps(alpha);
+    for (; i + 7 < n; i += 8) {
+        const __m256 vg = _mm256_loadu_ps(g + i);
+        const __m256 vm = _mm256_fmadd_ps(_mm256_loadu_ps(m + i), vbeta1, _mm256_mul_ps(vg, vbeta1c));
+        const __m256 vv = _mm256_fmadd_ps(_mm256_loadu_ps(v + i), vbeta2, _mm256_mul_ps(_mm256_mul_ps(vg, vg), vbeta2c));
+        _mm256_storeu_ps(m + i, vm);
+        _mm256_storeu_ps(v + i, vv);
+        const __m256 vh = _mm256_add_ps(_mm256_sqrt_ps(_mm256_mul_ps(vv, vbeta2h)), veps);
+        const __m256 vu = _mm256_div_ps(_mm256_mul_ps(valpha, _mm256_mul_ps(vm, vbeta1h)), vh);
+        _mm256_storeu_ps(w + i, _mm256_fmsub_ps(_mm256_loadu_ps(w + i), vkeep, vu));
+    }
+#elif defined(__SSE2__)
+    const __m128 vbeta1  = _mm_set1_ps(beta1);
+    const __m128 vbeta2  = _mm_set1_ps(beta2);
+    const __m128 vbeta1c = _mm_set1_ps(1.0f - beta1);
+    const __m128 vbeta2c = _mm_set1_ps(1.0f - beta2);
+    const __m128 vbeta1h = _mm_set1_ps(beta1h);
+    const __m128 vbeta2h = _mm_set1_ps(beta2h);
+    const __m128 veps    = _mm_set1_ps(eps);
+    const __m128 vkeep   = _mm_set1_ps(keep);
+    const __m128 valpha  = _mm_set1_ps(alpha);
+    for (; i + 3 < n; i += 4) {
+        const __m128 vg = _mm_loadu_ps(g + i);
+        const __m128 vm = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m + i), vbeta1), _mm_mul_ps(vg, vbeta1c));
+        const __m128 vv = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(v + i), vbeta2), _mm_mul_ps(_mm_mul_ps(vg, vg), vbeta2c));
+        _mm_storeu_ps(m + i, vm);
+        _mm_storeu_ps(v + i, vv);
+        const __m128 vh = _mm_add_ps(_mm_sqrt_ps(_mm_mul_ps(vv, vbeta2h)), veps);
+        const __m128 vu = _mm_div_ps(_mm_mul_ps(valpha, _mm_mul_ps(vm, vbeta1h)), vh);
+        _mm_storeu_ps(w + i, _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(w + i), vkeep), vu));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t vbeta1c = vdupq_n_f32(1.0f - beta1);
+    const float32x4_t vbeta2c = vdupq_n_f32(1.0f - beta2);
+    const float32x4_t veps    = vdupq_n_f32(eps);
+    for (; i + 3 < n; i += 4) {
+        const float32x4_t vg = vld1q_f32(g + i);
+        const float32x4_t vm = vfmaq_n_f32(vmulq_f32(vg, vbeta1c), vld1q_f32(m + i), beta1);
+        const float32x4_t vv = vfmaq_n_f32(vmulq_f32(vmulq_f32(vg, vg), vbeta2c), vld1q_f32(v + i), beta2);
+        vst1q_f32(m + i, vm);
+        vst1q_f32(v + i, vv);
+        const float32x4_t vh = vaddq_f32(vsqrtq_f32(vmulq_n_f32(vv, beta2h)), veps);
+        const float32x4_t vu = vdivq_f32(vmulq_n_f32(vm, alpha*beta1h), vh);
+        vst1q_f32(w + i, vsubq_f32(vmulq_n_f32(vld1q_f32(w + i), keep), vu));
+    }
+#endif
+    for (; i < n; ++i) {
+        m[i] = m[i]*beta1 +      g[i]*(1.0f - beta1);
+        v[i] = v[i]*beta2 + g[i]*g[i]*(1.0f - beta2);
+
+        const float mh =       m[i]*beta1h;
+        const float vh = sqrtf(v[i]*beta2h) + eps;
+
+        // The weight decay is applied independently of the Adam momenta m and v.
+        // This is NOT equivalent to l2 regularization that adds w[i]*w[i] to the loss.
+        // See: https://arxiv.org/pdf/1711.05101v3.pdf
+        w[i] = w[i] * keep - alpha * mh / vh;
+    }
+}
+
 ggml_float ggml_vec_cvar_f32(const int n, float * y, const float * x, const float mean) {
     int i = 0;
     ggml_float sum = 0;
@@ -14,9 +14,6 @@
 // floating point type used to accumulate sums
 typedef double ggml_float;
 
-#define GGML_GELU_FP16
-#define GGML_GELU_QUICK_FP16
-
 #define GGML_SOFT_MAX_UNROLL 4
 #define GGML_VEC_DOT_UNROLL  2
 #define GGML_VEC_MAD_UNROLL  32
@@ -25,16 +22,6 @@ typedef double ggml_float;
 extern "C" {
 #endif
 
-//
-// global data
-//
-
-// precomputed gelu table for f16 (128 KB)
-extern ggml_fp16_t ggml_table_gelu_f16[1 << 16];
-
-// precomputed quick gelu table for f16 (128 KB)
-extern ggml_fp16_t ggml_table_gelu_quick_f16[1 << 16];
-
 //
 // fundamental operations
 //
@@ -44,7 +31,17 @@ void ggml_vec_dot_bf16(int n, float * GGML_RESTRICT s, size_t bs, ggml_bf16_t *
 void ggml_vec_dot_f16(int n, float * GGML_RESTRICT s, size_t bs, ggml_fp16_t * GGML_RESTRICT x, size_t bx, ggml_fp16_t * GGML_RESTRICT y, size_t by, int nrc);
 
 void ggml_vec_silu_f32(const int n, float * y, const float * x);
+void ggml_vec_sigmoid_f32(const int n, float * y, const float * x);
+void ggml_vec_exp_f32(const int n, float * y, const float * x);
+void ggml_vec_log_f32(const int n, float * y, const float * x);
+void ggml_vec_gelu_f32(const int n, float * y, const float * x);
+void ggml_vec_gelu_quick_f32(const int n, float * y, const float * x);
+void ggml_vec_gelu_f16      (const int n, ggml_fp16_t * y, const ggml_fp16_t * x);
+void ggml_vec_gelu_quick_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x);
+void ggml_vec_geglu_f16      (const int n, ggml_fp16_t * y, const ggml_fp16_t * x, const ggml_fp16_t * g);
+void ggml_vec_geglu_quick_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x, const ggml_fp16_t * g);
 ggml_float ggml_vec_cvar_f32(const int n, float * y, const float * x, const float mean); //it will also center y ( y = y - mean )
+void ggml_vec_adamw_f32(const int n, float * w, const float * g, float * m, float * v, const float * pars); // pars: alpha, beta1, beta2, eps, wd, beta1h, beta2h
 ggml_float ggml_vec_soft_max_f32(const int n, float * y, const float * x, float max);
 ggml_float ggml_vec_log_soft_max_f32(const int n, float * y, const float * x, float max);
 
@@ -774,7 +771,6 @@ inline static void ggml_vec_sqrt_f16 (const int n, ggml_fp16_t * y, const ggml_f
         y[i] = GGML_CPU_FP32_TO_FP16(sqrtf(GGML_CPU_FP16_TO_FP32(x[i])));
     }
 }
-inline static void ggml_vec_log_f32  (const int n, float * y, const float * x) { for (int i = 0; i < n; ++i) y[i] = logf(x[i]);  }
 inline static void ggml_vec_log_f16 (const int n, ggml_fp16_t * y, const ggml_fp16_t * x) {
     for (int i = 0; i < n; ++i) {
         y[i] = GGML_CPU_FP32_TO_FP16(logf(GGML_CPU_FP16_TO_FP32(x[i])));
@@ -838,7 +834,6 @@ inline static void ggml_vec_leaky_relu_f16 (const int n, ggml_fp16_t * y, const
         y[i] = GGML_CPU_FP32_TO_FP16(((v > 0.f) ? v : 0.f) + ns * ((v < 0.0f) ? v : 0.f));
     }
 }
-inline static void ggml_vec_sigmoid_f32 (const int n, float * y, const float * x) { for (int i = 0; i < n; ++i) y[i] = 1.f / (1.f + expf(-x[i])); }
 inline static void ggml_vec_sigmoid_f16 (const int n, ggml_fp16_t * y, const ggml_fp16_t * x) {
     for (int i = 0; i < n; ++i) {
         y[i] = GGML_CPU_FP32_TO_FP16(1.f / (1.f + expf(-GGML_CPU_FP16_TO_FP32(x[i]))));
@@ -858,7 +853,6 @@ inline static void ggml_vec_hardsigmoid_f16 (const int n, ggml_fp16_t * y, const
         y[i] = GGML_CPU_FP32_TO_FP16(fminf(1.0f, fmaxf(0.0f, (GGML_CPU_FP16_TO_FP32(x[i]) + 3.0f) / 6.0f)));
     }
 }
-inline static void ggml_vec_exp_f32 (const int n, float * y, const float * x) { for (int i = 0; i < n; ++i) y[i] = expf(x[i]); }
 inline static void ggml_vec_exp_f16 (const int n, ggml_fp16_t * y, const ggml_fp16_t * x) {
     for (int i = 0; i < n; ++i) {
         y[i] = GGML_CPU_FP32_TO_FP16(expf(GGML_CPU_FP16_TO_FP32(x[i])));
@@ -874,84 +868,39 @@ inline static float ggml_gelu_f32(float x) {
     return 0.5f*x*(1.0f + tanhf(SQRT_2_OVER_PI*x*(1.0f + GELU_COEF_A*x*x)));
 }
 
-inline static void ggml_vec_gelu_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x) {
-    const uint16_t * i16 = (const uint16_t *) x;
-    for (int i = 0; i < n; ++i) {
-        y[i] = ggml_table_gelu_f16[i16[i]];
+// saturates like ggml_vec_gelu_f32: 0 for x <= -10 and x for x >= 10, so that -inf does not give -inf*0 = nan
+inline static float ggml_gelu_erf_f32(float x) {
+    if (x <= -10.0f) {
+        return 0.0f;
+    }
+    if (x >= 10.0f) {
+        return x;
     }
+    return 0.5f*x*(1.0f + erff(x*SQRT_2_INV));
 }
 
 inline static void ggml_vec_gelu_erf_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x) {
     for (int i = 0; i < n; ++i) {
         float xi = GGML_CPU_FP16_TO_FP32(x[i]);
-        float res = 0.5f*xi*(1.0f + erff(xi*SQRT_2_INV));
-        y[i] = GGML_CPU_FP32_TO_FP16(res);
-    }
-}
-
-#ifdef GGML_GELU_FP16
-inline static void ggml_vec_gelu_f32(const int n, float * y, const float * x) {
-    uint16_t t;
-    for (int i = 0; i < n; ++i) {
-        if (x[i] <= -10.0f) {
-            y[i] = 0.0f;
-        } else if (x[i] >= 10.0f) {
-            y[i] = x[i];
-        } else {
-            ggml_fp16_t fp16 = GGML_CPU_FP32_TO_FP16(x[i]);
-            memcpy(&t, &fp16, sizeof(uint16_t));
-            y[i] = GGML_CPU_FP16_TO_FP32(ggml_table_gelu_f16[t]);
-        }
-    }
-}
-#else
-inline static void ggml_vec_gelu_f32(const int n, float * y, const float * x) {
-    for (int i = 0; i < n; ++i) {
-        y[i] = ggml_gelu_f32(x[i]);
+        y[i] = GGML_CPU_FP32_TO_FP16(ggml_gelu_erf_f32(xi));
     }
 }
-#endif
 
 inline static void ggml_vec_gelu_erf_f32(const int n, float * y, const float * x) {
     for (int i = 0; i < n; ++i) {
-        float xi = x[i];
-        y[i] = 0.5f*xi*(1.0f + erff(xi*SQRT_2_INV));
+        y[i] = ggml_gelu_erf_f32(x[i]);
     }
 }
 
-inline static float ggml_gelu_quick_f32(float x) {
-    return x*(1.0f/(1.0f+expf(GELU_QUICK_COEF*x)));
-}
+// x*sigmoid(1.702*x) only underflows to 0 far below -10, so it saturates at -60 instead, where the result is
+// already smaller than the smallest float
+static const float GELU_QUICK_SAT  = -60.0f;
 
-//inline static void ggml_vec_gelu_quick_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x) {
-//    const uint16_t * i16 = (const uint16_t *) x;
-//    for (int i = 0; i < n; ++i) {
-//        y[i] = ggml_table_gelu_quick_f16[i16[i]];
-//    }
-//}
-
-#ifdef GGML_GELU_QUICK_FP16
-inline static void ggml_vec_gelu_quick_f32(const int n, float * y, const float * x) {
-    uint16_t t;
-    for (int i = 0; i < n; ++i) {
-        ggml_fp16_t fp16 = GGML_CPU_FP32_TO_FP16(x[i]);
-        memcpy(&t, &fp16, sizeof(uint16_t));
-        y[i] = GGML_CPU_FP16_TO_FP32(ggml_table_gelu_quick_f16[t]);
-    }
-}
-#else
-inline static void ggml_vec_gelu_quick_f32(const int n, float * y, const float * x) {
-    for (int i = 0; i < n; ++i) {
-        y[i] = ggml_gelu_quick_f32(x[i]);
-    }
-}
-#endif
-
-inline static void ggml_vec_gelu_quick_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x) {
-    for (int i = 0; i < n; ++i) {
-        float v = GGML_CPU_FP16_TO_FP32(x[i]);
-        y[i] = GGML_CPU_FP32_TO_FP16(v*(1.0f/(1.0f+expf(GELU_QUICK_COEF*v))));
+inline static float ggml_gelu_quick_f32(float x) {
+    if (x <= GELU_QUICK_SAT) {
+        return 0.0f;
     }
+    return x*(1.0f/(1.0f+expf(GELU_QUICK_COEF*x)));
 }
 
 // Sigmoid Linear Unit (SiLU) function
@@ -1036,6 +985,40 @@ inline static svfloat32_t ggml_v_silu(svbool_t pg, svfloat32_t x) {
     return svdiv_f32_x(pg, x, one_plus_exp_neg_x);
 }
 
+// computes sigmoid 1/(1+exp(-x)) in single precision vector
+inline static svfloat32_t ggml_v_sigmoid(svbool_t pg, svfloat32_t x) {
+    const svfloat32_t one = svdup_n_f32_x(pg, 1.0f);
+    const svfloat32_t exp_neg_x = ggml_v_expf(pg, svneg_f32_x(pg, x));
+    return svdiv_f32_x(pg, one, svadd_f32_x(pg, one, exp_neg_x));
+}
+
+// adapted from arm limited optimized routine
+// the maximum error is 3.34 ulps
+// subnormals are scaled into the normal range, zero gives -inf, negative numbers give nan
+inline static svfloat32_t ggml_v_logf(svbool_t pg, svfloat32_t x) {
+    const svbool_t t = svcmplt_n_f32(pg, x, 0x1p-126f);
+    const svfloat32_t xs = svmul_n_f32_m(t, x, 0x1p23f);
+    const svint32_t u = svsub_n_s32_x(pg, svreinterpret_s32_f32(xs), 0x3f2aaaab);
+    const svfloat32_t n = svsub_n_f32_m(t, svcvt_f32_s32_x(pg, svasr_n_s32_x(pg, u, 23)), 23.0f);
+    const svfloat32_t r = svsub_n_f32_x(pg, svreinterpret_f32_s32(
+        svadd_n_s32_x(pg, svand_n_s32_x(pg, u, 0x007fffff), 0x3f2aaaab)), 1.0f);
+    const svfloat32_t r2 = svmul_f32_x(pg, r, r);
+    svfloat32_t p = svmla_n_f32_x(pg, svdup_n_f32_x(pg, -0x1.4f9934p-3f), r, 0x1.5a9aa2p-3f);
+    svfloat32_t q = svmla_n_f32_x(pg, svdup_n_f32_x(pg, -0x1.00187cp-2f), r, 0x1.961348p-3f);
+    svfloat32_t y = svmla_n_f32_x(pg, svdup_n_f32_x(pg, -0x1.ffffc8p-2f), r, 0x1.555d7cp-2f);
+    p = svmla_n_f32_x(pg, p, r2, -0x1.3e737cp-3f);
+    q = svmla_f32_x(pg, q, p, r2);
+    y = svmla_f32_x(pg, y, q, r2);
+    const svfloat32_t res = svmla_f32_x(pg, svmla_n_f32_x(pg, r, n, 0x1.62e43p-1f), y, r2);
+    const svbool_t ok = svand_b_z(pg, svcmpgt_n_f32(pg, x, 0.0f), svcmplt_n_f32(pg, x, INFINITY));
+    if (!svptest_any(pg, svnot_b_z(pg, ok)))
+        return res;
+    return svsel_f32(ok, res,
+                     svsel_f32(svcmpeq_n_f32(pg, x, 0.0f), svdup_n_f32_x(pg, -INFINITY),
+                               svsel_f32(svcmpeq_n_f32(pg, x, INFINITY), svdup_n_f32_x(pg, INFINITY),
+                                                                         svdup_n_f32_x(pg, NAN))));
+}
+
 #elif defined(__ARM_NEON) && defined(__aarch64__)
 
 // adapted from arm limited optimized routine
@@ -1075,6 +1058,41 @@ inline static float32x4_t ggml_v_silu(float32x4_t x) {
     return vdivq_f32(x, one_plus_exp_neg_x);
 }
 
+// computes sigmoid 1/(1+exp(-x)) in single precision vector
+inline static float32x4_t ggml_v_sigmoid(float32x4_t x) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t exp_neg_x = ggml_v_expf(vnegq_f32(x));
+    return vdivq_f32(one, vaddq_f32(one, exp_neg_x));
+}
+
+// adapted from arm limited optimized routine
+// the maximum error is 3.34 ulps
+// subnormals are scaled into the normal range, zero gives -inf, negative numbers give nan
+inline static float32x4_t ggml_v_logf(float32x4_t x) {
+    const uint32x4_t t = vcltq_f32(x, vdupq_n_f32(0x1p-126f));
+    const float32x4_t xs = vbslq_f32(t, vmulq_f32(x, vdupq_n_f32(0x1p23f)), x);
+    const int32x4_t u = vsubq_s32(vreinterpretq_s32_f32(xs), vdupq_n_s32(0x3f2aaaab));
+    const float32x4_t n = vsubq_f32(vcvtq_f32_s32(vshrq_n_s32(u, 23)),
+                                    vreinterpretq_f32_u32(vandq_u32(t, vreinterpretq_u32_f32(vdupq_n_f32(23)))));
+    const float32x4_t r = vsubq_f32(vreinterpretq_f32_s32(vaddq_s32(vandq_s32(u, vdupq_n_s32(0x007fffff)),
+                                                                    vdupq_n_s32(0x3f2aaaab))), vdupq_n_f32(1.0f));
+    const float32x4_t r2 = vmulq_f32(r, r);
+    float32x4_t p = vfmaq_f32(vdupq_n_f32(-0x1.4f9934p-3f), vdupq_n_f32(0x1.5a9aa2p-3f), r);
+    float32x4_t q = vfmaq_f32(vdupq_n_f32(-0x1.00187cp-2f), vdupq_n_f32(0x1.961348p-3f), r);
+    float32x4_t y = vfmaq_f32(vdupq_n_f32(-0x1.ffffc8p-2f), vdupq_n_f32(0x1.555d7cp-2f), r);
+    p = vfmaq_f32(p, vdupq_n_f32(-0x1.3e737cp-3f), r2);
+    q = vfmaq_f32(q, p, r2);
+    y = vfmaq_f32(y, q, r2);
+    const float32x4_t res = vfmaq_f32(vfmaq_f32(r, n, vdupq_n_f32(0x1.62e43p-1f)), y, r2);
+    const uint32x4_t ok = vandq_u32(vcgtq_f32(x, vdupq_n_f32(0.0f)), vcltq_f32(x, vdupq_n_f32(INFINITY)));
+    if (vminvq_u32(ok))
+        return res;
+    return vbslq_f32(ok, res,
+                     vbslq_f32(vceqq_f32(x, vdupq_n_f32(0.0f)), vdupq_n_f32(-INFINITY),
+                               vbslq_f32(vceqq_f32(x, vdupq_n_f32(INFINITY)), vdupq_n_f32(INFINITY),
+                                                                              vdupq_n_f32(NAN))));
+}
+
 #elif defined(__AVX512F__) && defined(__AVX512DQ__)
 
 // adapted from arm limited optimized routine
@@ -1118,6 +1136,49 @@ inline static __m512 ggml_v_silu(__m512 x) {
     return _mm512_div_ps(x, one_plus_exp_neg_x);
 }
 
+// computes sigmoid 1/(1+exp(-x)) in single precision vector
+inline static __m512 ggml_v_sigmoid(__m512 x) {
+    const __m512 one = _mm512_set1_ps(1);
+    const __m512 exp_neg_x = ggml_v_expf(_mm512_sub_ps(_mm512_setzero_ps(), x));
+    return _mm512_div_ps(one, _mm512_add_ps(one, exp_neg_x));
+}
+
+// adapted from arm limited optimized routine
+// the maximum error is 3.34 ulps
+// subnormals are scaled into the normal range, zero gives -inf, negative numbers give nan
+inline static __m512 ggml_v_logf(__m512 x) {
+  const __mmask16 t = _mm512_cmp_ps_mask(x, _mm512_set1_ps(0x1p-126f), _CMP_LT_OQ);
+  const __m512 xs = _mm512_mask_mul_ps(x, t, x, _mm512_set1_ps(0x1p23f));
+  const __m512i u = _mm512_sub_epi32(_mm512_castps_si512(xs), _mm512_set1_epi32(0x3f2aaaab));
+  const __m512 c = _mm512_cvtepi32_ps(_mm512_srai_epi32(u, 23));
+  const __m512 n = _mm512_mask_sub_ps(c, t, c, _mm512_set1_ps(23));
+  const __m512 r = _mm512_sub_ps(
+      _mm512_castsi512_ps(_mm512_add_epi32(_mm512_and_si512(u, _mm512_set1_epi32(0x007fffff)),
+                                           _mm512_set1_epi32(0x3f2aaaab))),
+      _mm512_set1_ps(1.0f));
+  const __m512 r2 = _mm512_mul_ps(r, r);
+  const __m512 p = _mm512_fmadd_ps(_mm512_set1_ps(-0x1.3e737cp-3f), r2,
+                                   _mm512_fmadd_ps(_mm512_set1_ps(0x1.5a9aa2p-3f), r,
+                                                   _mm512_set1_ps(-0x1.4f9934p-3f)));
+  const __m512 q = _mm512_fmadd_ps(p, r2,
+                                   _mm512_fmadd_ps(_mm512_set1_ps(0x1.961348p-3f), r,
+                                                   _mm512_set1_ps(-0x1.00187cp-2f)));
+  const __m512 y = _mm512_fmadd_ps(q, r2,
+                                   _mm512_fmadd_ps(_mm512_set1_ps(0x1.555d7cp-2f), r,
+                                                   _mm512_set1_ps(-0x1.ffffc8p-2f)));
+  const __m512 res = _mm512_fmadd_ps(y, r2, _mm512_fmadd_ps(n, _mm512_set1_ps(0x1.62e43p-1f), r));
+  const __mmask16 ok = _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ) &
+                       _mm512_cmp_ps_mask(x, _mm512_set1_ps(INFINITY), _CMP_LT_OQ);
+  if (ok == 0xffff)
+    return res;
+  const __m512 alt = _mm512_mask_blend_ps(
+      _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_EQ_OQ),
+      _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_set1_ps(INFINITY), _CMP_EQ_OQ),
+                           _mm512_set1_ps(NAN), _mm512_set1_ps(INFINITY)),
+      _mm512_set1_ps(-INFINITY));
+  return _mm512_mask_blend_ps(ok, alt, res);
+}
+
 #elif defined(__AVX2__) && defined(__FMA__)
 
 // adapted from arm limited optimized routine
@@ -1173,6 +1234,48 @@ inline static __m256 ggml_v_silu(__m256 x) {
     return _mm256_div_ps(x, one_plus_exp_neg_x);
 }
 
+// computes sigmoid 1/(1+exp(-x)) in single precision vector
+inline static __m256 ggml_v_sigmoid(__m256 x) {
+    const __m256 one = _mm256_set1_ps(1);
+    const __m256 exp_neg_x = ggml_v_expf(_mm256_sub_ps(_mm256_setzero_ps(), x));
+    return _mm256_div_ps(one, _mm256_add_ps(one, exp_neg_x));
+}
+
+// adapted from arm limited optimized routine
+// the maximum error is 3.34 ulps
+// subnormals are scaled into the normal range, zero gives -inf, negative numbers give nan
+inline static __m256 ggml_v_logf(__m256 x) {
+  const __m256 t = _mm256_cmp_ps(x, _mm256_set1_ps(0x1p-126f), _CMP_LT_OQ);
+  const __m256 xs = _mm256_blendv_ps(x, _mm256_mul_ps(x, _mm256_set1_ps(0x1p23f)), t);
+  const __m256i u = _mm256_sub_epi32(_mm256_castps_si256(xs), _mm256_set1_epi32(0x3f2aaaab));
+  const __m256 n = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(u, 23)),
+                                 _mm256_and_ps(t, _mm256_set1_ps(23)));
+  const __m256 r = _mm256_sub_ps(
+      _mm256_castsi256_ps(_mm256_add_epi32(_mm256_and_si256(u, _mm256_set1_epi32(0x007fffff)),
+                                           _mm256_set1_epi32(0x3f2aaaab))),
+      _mm256_set1_ps(1.0f));
+  const __m256 r2 = _mm256_mul_ps(r, r);
+  const __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(-0x1.3e737cp-3f), r2,
+                                   _mm256_fmadd_ps(_mm256_set1_ps(0x1.5a9aa2p-3f), r,
+                                                   _mm256_set1_ps(-0x1.4f9934p-3f)));
+  const __m256 q = _mm256_fmadd_ps(p, r2,
+                                   _mm256_fmadd_ps(_mm256_set1_ps(0x1.961348p-3f), r,
+                                                   _mm256_set1_ps(-0x1.00187cp-2f)));
+  const __m256 y = _mm256_fmadd_ps(q, r2,
+                                   _mm256_fmadd_ps(_mm256_set1_ps(0x1.555d7cp-2f), r,
+                                                   _mm256_set1_ps(-0x1.ffffc8p-2f)));
+  const __m256 res = _mm256_fmadd_ps(y, r2, _mm256_fmadd_ps(n, _mm256_set1_ps(0x1.62e43p-1f), r));
+  const __m256 ok = _mm256_and_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ),
+                                  _mm256_cmp_ps(x, _mm256_set1_ps(INFINITY), _CMP_LT_OQ));
+  if (_mm256_movemask_ps(ok) == 0xff)
+    return res;
+  const __m256 alt = _mm256_blendv_ps(
+      _mm256_blendv_ps(_mm256_set1_ps(NAN), _mm256_set1_ps(INFINITY),
+                       _mm256_cmp_ps(x, _mm256_set1_ps(INFINITY), _CMP_EQ_OQ)),
+      _mm256_set1_ps(-INFINITY), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_EQ_OQ));
+  return _mm256_blendv_ps(alt, res, ok);
+}
+
 #elif defined(__SSE2__) // __AVX2__ / __ARM_NEON
 
 #if defined(__FMA__)
@@ -1227,6 +1330,41 @@ inline static __m128 ggml_v_silu(__m128 x) {
     return _mm_div_ps(x, one_plus_exp_neg_x);
 }
 
+// computes sigmoid 1/(1+exp(-x)) in single precision vector
+inline static __m128 ggml_v_sigmoid(__m128 x) {
+    const __m128 one = _mm_set1_ps(1);
+    const __m128 exp_neg_x = ggml_v_expf(_mm_sub_ps(_mm_setzero_ps(), x));
+    return _mm_div_ps(one, _mm_add_ps(one, exp_neg_x));
+}
+
+// adapted from arm limited optimized routine
+// the maximum error is 3.34 ulps with fma, 4 ulps without
+// subnormals are scaled into the normal range, zero gives -inf, negative numbers give nan
+inline static __m128 ggml_v_logf(__m128 x) {
+    const __m128 t = _mm_cmplt_ps(x, _mm_set1_ps(0x1p-126f));
+    const __m128 xs = _mm_or_ps(_mm_and_ps(t, _mm_mul_ps(x, _mm_set1_ps(0x1p23f))), _mm_andnot_ps(t, x));
+    const __m128i u = _mm_sub_epi32(_mm_castps_si128(xs), _mm_set1_epi32(0x3f2aaaab));
+    const __m128 n = _mm_sub_ps(_mm_cvtepi32_ps(_mm_srai_epi32(u, 23)), _mm_and_ps(t, _mm_set1_ps(23)));
+    const __m128 r = _mm_sub_ps(
+        _mm_castsi128_ps(_mm_add_epi32(_mm_and_si128(u, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f2aaaab))),
+        _mm_set1_ps(1.0f));
+    const __m128 r2 = _mm_mul_ps(r, r);
+    const __m128 p = MADD128(_mm_set1_ps(-0x1.3e737cp-3f), r2,
+                             MADD128(_mm_set1_ps(0x1.5a9aa2p-3f), r, _mm_set1_ps(-0x1.4f9934p-3f)));
+    const __m128 q = MADD128(p, r2, MADD128(_mm_set1_ps(0x1.961348p-3f), r, _mm_set1_ps(-0x1.00187cp-2f)));
+    const __m128 y = MADD128(q, r2, MADD128(_mm_set1_ps(0x1.555d7cp-2f), r, _mm_set1_ps(-0x1.ffffc8p-2f)));
+    const __m128 res = MADD128(y, r2, MADD128(n, _mm_set1_ps(0x1.62e43p-1f), r));
+    const __m128 ok = _mm_and_ps(_mm_cmpgt_ps(x, _mm_setzero_ps()), _mm_cmplt_ps(x, _mm_set1_ps(INFINITY)));
+    if (_mm_movemask_ps(ok) == 0xf)
+        return res;
+    const __m128 z = _mm_cmpeq_ps(x, _mm_setzero_ps());
+    const __m128 i = _mm_cmpeq_ps(x, _mm_set1_ps(INFINITY));
+    const __m128 alt = _mm_or_ps(_mm_and_ps(z, _mm_set1_ps(-INFINITY)),
+                                 _mm_andnot_ps(z, _mm_or_ps(_mm_and_ps(i, _mm_set1_ps(INFINITY)),
+                                                            _mm_andnot_ps(i, _mm_set1_ps(NAN)))));
+    return _mm_or_ps(_mm_and_ps(ok, res), _mm_andnot_ps(ok, alt));
+}
+
 #elif defined(__riscv_v_intrinsic)
 
 // adapted from arm limited optimized routine
@@ -1323,35 +1461,9 @@ inline static void ggml_vec_reglu_f16 (const int n, ggml_fp16_t * y, const ggml_
     }
 }
 
-#ifdef GGML_GELU_FP16
-inline static void ggml_vec_geglu_f32(const int n, float * y, const float * x, const float * g) {
-    uint16_t t;
-    for (int i = 0; i < n; ++i) {
-        if (x[i] <= -10.0f) {
-            y[i] = 0.0f;
-        } else if (x[i] >= 10.0f) {
-            y[i] = x[i] * g[i];
-        } else {
-            ggml_fp16_t fp16 = GGML_CPU_FP32_TO_FP16(x[i]);
-            memcpy(&t, &fp16, sizeof(uint16_t));
-            y[i] = GGML_CPU_FP16_TO_FP32(ggml_table_gelu_f16[t]) * g[i];
-        }
-    }
-}
-#else
 inline static void ggml_vec_geglu_f32(const int n, float * y, const float * x, const float * g) {
-    for (int i = 0; i < n; ++i) {
-        y[i] = ggml_gelu_f32(x[i]) * g[i];
-    }
-}
-#endif
-
-inline static void ggml_vec_geglu_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x, const ggml_fp16_t * g) {
-    const uint16_t * i16 = (const uint16_t *) x;
-    for (int i = 0; i < n; ++i) {
-        float v = GGML_CPU_FP16_TO_FP32(g[i]);
-        y[i] = GGML_CPU_FP32_TO_FP16(GGML_CPU_FP16_TO_FP32(ggml_table_gelu_f16[i16[i]]) * v);
-    }
+    ggml_vec_gelu_f32(n, y, x);
+    ggml_vec_mul_f32(n, y, y, g);
 }
 
 void ggml_vec_swiglu_f32(const int n, float * y, const float * x, const float * g);
@@ -1366,8 +1478,7 @@ inline static void ggml_vec_swiglu_f16(const int n, ggml_fp16_t * y, const ggml_
 
 inline static void ggml_vec_geglu_erf_f32(const int n, float * y, const float * x, const float * g) {
     for (int i = 0; i < n; ++i) {
-        float xi = x[i];
-        y[i] = 0.5f * xi * (1.0f + erff(xi*SQRT_2_INV)) * g[i];
+        y[i] = ggml_gelu_erf_f32(x[i]) * g[i];
     }
 }
 
@@ -1375,33 +1486,13 @@ inline static void ggml_vec_geglu_erf_f16(const int n, ggml_fp16_t * y, const gg
     for (int i = 0; i < n; ++i) {
         float xi = GGML_CPU_FP16_TO_FP32(x[i]);
         float gi = GGML_CPU_FP16_TO_FP32(g[i]);
-        y[i] = GGML_CPU_FP32_TO_FP16(0.5f * xi * (1.0f + erff(xi*SQRT_2_INV)) * gi);
+        y[i] = GGML_CPU_FP32_TO_FP16(ggml_gelu_erf_f32(xi) * gi);
     }
 }
 
-#ifdef GGML_GELU_QUICK_FP16
 inline static void ggml_vec_geglu_quick_f32(const int n, float * y, const float * x, const float * g) {
-    uint16_t t;
-    for (int i = 0; i < n; ++i) {
-        ggml_fp16_t fp16 = GGML_CPU_FP32_TO_FP16(x[i]);
-        memcpy(&t, &fp16, sizeof(uint16_t));
-        y[i] = GGML_CPU_FP16_TO_FP32(ggml_table_gelu_quick_f16[t]) * g[i];
-    }
-}
-#else
-inline static void ggml_vec_geglu_quick_f32(const int n, float * y, const float * x, const float * g) {
-    for (int i = 0; i < n; ++i) {
-        y[i] = ggml_gelu_quick_f32(x[i]) * g[i];
-    }
-}
-#endif
-
-inline static void ggml_vec_geglu_quick_f16(const int n, ggml_fp16_t * y, const ggml_fp16_t * x, const ggml_fp16_t * g) {
-    const uint16_t * i16 = (const uint16_t *) x;
-    for (int i = 0; i < n; ++i) {
-        float v = GGML_CPU_FP16_TO_FP32(g[i]);
-        y[i] = GGML_CPU_FP32_TO_FP16(GGML_CPU_FP16_TO_FP32(ggml_table_gelu_quick_f16[i16[i]]) * v);
-    }
+    ggml_vec_gelu_quick_f32(n, y, x);
+    ggml_vec_mul_f32(n, y, y, g);
 }
 
 inline static void ggml_vec_sum_f32(const int n, float * s, const float * x) {
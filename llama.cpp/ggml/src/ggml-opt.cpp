@@ -7,12 +7,41 @@
 
 #include <algorithm>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <cinttypes>
 #include <map>
+#include <mutex>
+#include <numeric>
 #include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#   include <io.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+// memory-mapped file of a streaming dataset
+struct ggml_opt_dataset_file {
+    FILE  * file   = nullptr;
+    void  * addr   = nullptr;
+    size_t  size   = 0;
+    int64_t idata0 = 0; // index of the first datapoint in this file
+#if defined(_WIN32)
+    HANDLE  mapping = nullptr;
+#endif
+};
+
 struct ggml_opt_dataset {
     struct ggml_context   * ctx    = nullptr;
     ggml_backend_buffer_t   buf    = nullptr;
@@ -25,6 +54,20 @@ struct ggml_opt_dataset {
     size_t  nbs_labels  = -1;
 
     std::vector<int64_t> permutation;
+
+    // streaming datasets read the datapoints from memory-mapped files, data and labels then only describe the shapes
+    std::vector<ggml_opt_dataset_file> files;
+    int64_t stride         = 0; // elements between the starts of consecutive datapoints in a file
+    int64_t shuffle_window = 0; // shuffle the shards only within windows of this many shards, 0 = shuffle globally
+    int64_t nprefetch      = 0; // number of batches to prefetch
+
+    // the prefetch thread touches the pages of the upcoming shards so that the page faults are taken off the critical path
+    std::thread             prefetch_thread;
+    std::mutex              prefetch_mutex;
+    std::condition_variable prefetch_cv;
+    int64_t                 prefetch_begin = 0; // range of positions in permutation that are still to be prefetched
+    int64_t                 prefetch_end   = 0;
+    bool                    prefetch_stop  = false;
 };
 
 struct ggml_opt_context {
@@ -55,6 +98,7 @@ struct ggml_opt_context {
     struct ggml_cgraph * gb_opt  = nullptr;
     bool static_graphs           = false;
     bool eval_ready              = false;
+    bool checkpointing           = false; // the forward graph has checkpoints, recompute the other activations
     std::vector<struct ggml_tensor *> grad_accs;
     std::vector<struct ggml_tensor *> grad_m;
     std::vector<struct ggml_tensor *> grad_v;
@@ -129,7 +173,210 @@ ggml_opt_dataset_t ggml_opt_dataset_init(
     return result;
 }
 
+static bool ggml_opt_dataset_file_map(ggml_opt_dataset_file & file, const char * path) {
+    file.file = ggml_fopen(path, "rb");
+    if (!file.file) {
+        GGML_LOG_ERROR("%s: failed to open '%s'\n", __func__, path);
+        return false;
+    }
+#if defined(_WIN32)
+    HANDLE handle = (HANDLE) _get_osfhandle(_fileno(file.file));
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        GGML_LOG_ERROR("%s: failed to get the size of '%s'\n", __func__, path);
+        return false;
+    }
+    file.size = (size_t) size.QuadPart;
+    if (file.size == 0) {
+        return true;
+    }
+    file.mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file.mapping) {
+        GGML_LOG_ERROR("%s: CreateFileMappingA failed for '%s'\n", __func__, path);
+        return false;
+    }
+    file.addr = MapViewOfFile(file.mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!file.addr) {
+        GGML_LOG_ERROR("%s: MapViewOfFile failed for '%s'\n", __func__, path);
+        return false;
+    }
+#else
+    struct stat st;
+    if (fstat(fileno(file.file), &st) != 0) {
+        GGML_LOG_ERROR("%s: failed to get the size of '%s'\n", __func__, path);
+        return false;
+    }
+    file.size = (size_t) st.st_size;
+    if (file.size == 0) {
+        return true;
+    }
+    void * addr = mmap(nullptr, file.size, PROT_READ, MAP_SHARED, fileno(file.file), 0);
+    if (addr == MAP_FAILED) {
+        GGML_LOG_ERROR("%s: mmap failed for '%s'\n", __func__, path);
+        return false;
+    }
+    file.addr = addr;
+#endif
+    return true;
+}
+
+static void ggml_opt_dataset_file_unmap(ggml_opt_dataset_file & file) {
+#if defined(_WIN32)
+    if (file.addr) {
+        UnmapViewOfFile(file.addr);
+    }
+    if (file.mapping) {
+        CloseHandle(file.mapping);
+    }
+#else
+    if (file.addr) {
+        munmap(file.addr, file.size);
+    }
+#endif
+    if (file.file) {
+        fclose(file.file);
+    }
+}
+
+// address of a datapoint of a streaming dataset, the label starts one element later
+static const char * ggml_opt_dataset_stream_ptr(const ggml_opt_dataset * dataset, int64_t idata) {
+    auto it = std::upper_bound(dataset->files.begin(), dataset->files.end(), idata,
+        [](int64_t i, const ggml_opt_dataset_file & file) { return i < file.idata0; });
+    GGML_ASSERT(it != dataset->files.begin());
+    --it;
+    return (const char *) it->addr + (idata - it->idata0)*dataset->stride*ggml_type_size(dataset->data->type);
+}
+
+static void ggml_opt_dataset_prefetch_thread(ggml_opt_dataset * dataset) {
+    const size_t nb_datapoint = dataset->nbs_data/dataset->ndata_shard + ggml_type_size(dataset->data->type);
+    const size_t page_size    = 4096;
+
+    std::unique_lock<std::mutex> lock(dataset->prefetch_mutex);
+    while (true) {
+        dataset->prefetch_cv.wait(lock, [dataset] {
+            return dataset->prefetch_stop || dataset->prefetch_begin < dataset->prefetch_end;
+        });
+        if (dataset->prefetch_stop) {
+            return;
+        }
+        const int64_t ishard = dataset->permutation[dataset->prefetch_begin++];
+        lock.unlock();
+
+        volatile char sink = 0;
+        for (int64_t j = 0; j < dataset->ndata_shard; ++j) {
+            const char * ptr = ggml_opt_dataset_stream_ptr(dataset, ishard*dataset->ndata_shard + j);
+            for (size_t offs = 0; offs < nb_datapoint; offs += page_size) {
+                sink = sink + ptr[offs];
+            }
+            sink = sink + ptr[nb_datapoint - 1];
+        }
+
+        lock.lock();
+    }
+}
+
+// prefetch the shards at the positions [begin, end) of the permutation, replaces the previous request
+static void ggml_opt_dataset_prefetch(ggml_opt_dataset_t dataset, int64_t begin, int64_t end) {
+    if (!dataset->prefetch_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(dataset->prefetch_mutex);
+        dataset->prefetch_begin = std::min(begin, int64_t(dataset->permutation.size()));
+        dataset->prefetch_end   = std::min(end,   int64_t(dataset->permutation.size()));
+    }
+    dataset->prefetch_cv.notify_one();
+}
+
+ggml_opt_dataset_t ggml_opt_dataset_init_mmap(
+        enum ggml_type type_data,
+        int64_t        ne_datapoint,
+        int64_t        stride,
+        const char  ** paths,
+        int            n_paths,
+        int64_t        ndata_shard,
+        int64_t        shuffle_window,
+        int64_t        nprefetch) {
+    GGML_ASSERT(ne_datapoint   >  0);
+    GGML_ASSERT(stride         >  0);
+    GGML_ASSERT(n_paths        >  0);
+    GGML_ASSERT(ndata_shard    >  0);
+    GGML_ASSERT(shuffle_window >= 0);
+    GGML_ASSERT(nprefetch      >= 0);
+    GGML_ASSERT(ggml_blck_size(type_data) == 1);
+
+    const size_t ts = ggml_type_size(type_data);
+
+    ggml_opt_dataset_t result = new ggml_opt_dataset;
+    result->stride         = stride;
+    result->shuffle_window = shuffle_window;
+    result->nprefetch      = nprefetch;
+
+    int64_t ndata = 0;
+    for (int i = 0; i < n_paths; ++i) {
+        ggml_opt_dataset_file file;
+        const bool ok = ggml_opt_dataset_file_map(file, paths[i]);
+        file.idata0 = ndata;
+        result->files.push_back(file);
+        if (!ok) {
+            ggml_opt_dataset_free(result);
+            return nullptr;
+        }
+
+        // every datapoint needs one more element for the last label
+        const int64_t ne_file = file.size/ts;
+        if (ne_file >= ne_datapoint + 1) {
+            ndata += (ne_file - ne_datapoint - 1)/stride + 1;
+        }
+    }
+    ndata -= ndata % ndata_shard;
+    if (ndata == 0) {
+        GGML_LOG_ERROR("%s: the files do not contain a single shard of datapoints\n", __func__);
+        ggml_opt_dataset_free(result);
+        return nullptr;
+    }
+
+    result->ndata       = ndata;
+    result->ndata_shard = ndata_shard;
+
+    {
+        struct ggml_init_params params = {
+            /*.mem_size   =*/ 2*ggml_tensor_overhead(),
+            /*.mem_buffer =*/ nullptr,
+            /*.no_alloc   =*/ true,
+        };
+        result->ctx = ggml_init(params);
+    }
+
+    result->data       = ggml_new_tensor_2d(result->ctx, type_data, ne_datapoint, ndata);
+    result->labels     = ggml_new_tensor_2d(result->ctx, type_data, ne_datapoint, ndata);
+    result->nbs_data   = ggml_nbytes(result->data)   * ndata_shard/ndata;
+    result->nbs_labels = ggml_nbytes(result->labels) * ndata_shard/ndata;
+
+    const int64_t nshards = ndata/ndata_shard;
+    result->permutation.resize(nshards);
+    for (int64_t i = 0; i < nshards; ++i) {
+        result->permutation[i] = i;
+    }
+
+    if (nprefetch > 0) {
+        result->prefetch_thread = std::thread(ggml_opt_dataset_prefetch_thread, result);
+    }
+    return result;
+}
+
 void ggml_opt_dataset_free(ggml_opt_dataset_t dataset) {
+    if (dataset->prefetch_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(dataset->prefetch_mutex);
+            dataset->prefetch_stop = true;
+        }
+        dataset->prefetch_cv.notify_one();
+        dataset->prefetch_thread.join();
+    }
+    for (ggml_opt_dataset_file & file : dataset->files) {
+        ggml_opt_dataset_file_unmap(file);
+    }
     ggml_backend_buffer_free(dataset->buf);
     ggml_free(dataset->ctx);
     delete dataset;
@@ -147,17 +394,52 @@ struct ggml_tensor * ggml_opt_dataset_labels(ggml_opt_dataset_t dataset) {
     return dataset->labels;
 }
 
+// shuffle the first nshards positions of the permutation
+static void ggml_opt_dataset_shuffle_impl(ggml_opt_dataset_t dataset, std::mt19937 & rng, int64_t nshards) {
+    const auto begin = dataset->permutation.begin();
+    const auto end   = dataset->permutation.begin() + nshards;
+
+    const int64_t window = dataset->shuffle_window;
+    if (window <= 0 || window >= nshards) {
+        std::shuffle(begin, end, rng);
+        return;
+    }
+
+    // windowed shuffle: shuffle the order of windows of consecutive shards and the shards within each window,
+    // this keeps the accesses to the files local enough for the page cache and readahead
+    std::sort(begin, end);
+
+    std::vector<int64_t> windows((nshards + window - 1)/window);
+    std::iota(windows.begin(), windows.end(), 0);
+    std::shuffle(windows.begin(), windows.end(), rng);
+
+    std::vector<int64_t> permutation;
+    permutation.reserve(nshards);
+    for (const int64_t iwindow : windows) {
+        const int64_t i0 = iwindow*window;
+        const int64_t i1 = std::min(i0 + window, nshards);
+        permutation.insert(permutation.end(), begin + i0, begin + i1);
+        std::shuffle(permutation.end() - (i1 - i0), permutation.end(), rng);
+    }
+    std::copy(permutation.begin(), permutation.end(), begin);
+}
+
 void ggml_opt_dataset_shuffle(ggml_opt_context_t opt_ctx, ggml_opt_dataset_t dataset, int64_t idata) {
     GGML_ASSERT(idata <= dataset->ndata);
 
+    // the prefetch thread reads the permutation
+    std::lock_guard<std::mutex> lock(dataset->prefetch_mutex);
+    dataset->prefetch_begin = 0;
+    dataset->prefetch_end   = 0;
+
     if (idata < 0) {
-        std::shuffle(dataset->permutation.begin(), dataset->permutation.end(), opt_ctx->rng);
+        ggml_opt_dataset_shuffle_impl(dataset, opt_ctx->rng, dataset->permutation.size());
         return;
     }
 
     GGML_ASSERT(idata % dataset->ndata_shard == 0);
     const int64_t ishard_max = idata / dataset->ndata_shard;
-    std::shuffle(dataset->permutation.begin(), dataset->permutation.begin() + ishard_max, opt_ctx->rng);
+    ggml_opt_dataset_shuffle_impl(dataset, opt_ctx->rng, ishard_max);
 }
 
 void ggml_opt_dataset_get_batch(ggml_opt_dataset_t dataset, struct ggml_tensor * data_batch, struct ggml_tensor * labels_batch, int64_t ibatch) {
@@ -178,6 +460,27 @@ void ggml_opt_dataset_get_batch(ggml_opt_dataset_t dataset, struct ggml_tensor *
 
     GGML_ASSERT((ibatch + 1)*shards_per_batch <= int64_t(dataset->permutation.size()));
 
+    if (!dataset->files.empty()) {
+        const size_t nb_datapoint = dataset->nbs_data/dataset->ndata_shard;
+        const size_t ts           = ggml_type_size(dataset->data->type);
+
+        for (int64_t ishard_batch = 0; ishard_batch < shards_per_batch; ++ishard_batch) {
+            const int64_t ishard = dataset->permutation[ibatch*shards_per_batch + ishard_batch];
+
+            for (int64_t j = 0; j < dataset->ndata_shard; ++j) {
+                const char * ptr  = ggml_opt_dataset_stream_ptr(dataset, ishard*dataset->ndata_shard + j);
+                const size_t offs = (ishard_batch*dataset->ndata_shard + j)*nb_datapoint;
+                ggml_backend_tensor_set(data_batch, ptr, offs, nb_datapoint);
+                if (labels_batch) {
+                    ggml_backend_tensor_set(labels_batch, ptr + ts, offs, nb_datapoint);
+                }
+            }
+        }
+
+        ggml_opt_dataset_prefetch(dataset, (ibatch + 1)*shards_per_batch, (ibatch + 1 + dataset->nprefetch)*shards_per_batch);
+        return;
+    }
+
     for (int64_t ishard_batch = 0; ishard_batch < shards_per_batch; ++ishard_batch) {
         const int64_t ishard = dataset->permutation[ibatch*shards_per_batch + ishard_batch];
 
@@ -201,6 +504,27 @@ void ggml_opt_dataset_get_batch_host(ggml_opt_dataset_t dataset, void * data_bat
 
     GGML_ASSERT((ibatch + 1)*shards_per_batch <= int64_t(dataset->permutation.size()));
 
+    if (!dataset->files.empty()) {
+        const size_t nb_datapoint = dataset->nbs_data/dataset->ndata_shard;
+        const size_t ts           = ggml_type_size(dataset->data->type);
+
+        for (int64_t ishard_batch = 0; ishard_batch < shards_per_batch; ++ishard_batch) {
+            const int64_t ishard = dataset->permutation[ibatch*shards_per_batch + ishard_batch];
+
+            for (int64_t j = 0; j < dataset->ndata_shard; ++j) {
+                const char * ptr  = ggml_opt_dataset_stream_ptr(dataset, ishard*dataset->ndata_shard + j);
+                const size_t offs = (ishard_batch*dataset->ndata_shard + j)*nb_datapoint;
+                memcpy((char *) data_batch + offs, ptr, nb_datapoint);
+                if (labels_batch) {
+                    memcpy((char *) labels_batch + offs, ptr + ts, nb_datapoint);
+                }
+            }
+        }
+
+        ggml_opt_dataset_prefetch(dataset, (ibatch + 1)*shards_per_batch, (ibatch + 1 + dataset->nprefetch)*shards_per_batch);
+        return;
+    }
+
     for (int64_t ishard_batch = 0; ishard_batch < shards_per_batch; ++ishard_batch) {
         const int64_t ishard = dataset->permutation[ibatch*shards_per_batch + ishard_batch];
 
@@ -319,6 +643,103 @@ static ggml_cgraph * dup_graph(ggml_context * ctx, ggml_cgraph * src) {
     return dst;
 }
 
+// ====== Gradient checkpointing ======
+
+struct ggml_opt_recompute_state {
+    ggml_context * ctx;
+    std::unordered_set<ggml_tensor *>                 forward;    // nodes of the forward graph
+    std::unordered_map<ggml_tensor *, ggml_tensor *>  recomputed; // forward node -> its recomputed copy
+};
+
+// returns the tensor to use in place of a forward tensor in the backward pass:
+// checkpoints, inputs, outputs, parameters and preallocated tensors are kept alive anyway and are used as-is,
+// everything else is recomputed from the nearest of those
+static ggml_tensor * ggml_opt_recompute(ggml_opt_recompute_state & state, ggml_tensor * tensor) {
+    if (!tensor || state.forward.find(tensor) == state.forward.end()) {
+        return tensor;
+    }
+    const int32_t keep_flags = GGML_TENSOR_FLAG_CHECKPOINT | GGML_TENSOR_FLAG_INPUT | GGML_TENSOR_FLAG_OUTPUT |
+        GGML_TENSOR_FLAG_PARAM | GGML_TENSOR_FLAG_LOSS;
+    if ((tensor->flags & keep_flags) || tensor->op == GGML_OP_NONE || tensor->data) {
+        return tensor;
+    }
+
+    auto it = state.recomputed.find(tensor);
+    if (it != state.recomputed.end()) {
+        return it->second;
+    }
+
+    ggml_tensor * view_src = ggml_opt_recompute(state, tensor->view_src);
+    if (tensor->view_src && view_src == tensor->view_src) {
+        // views of kept tensors don't need any memory of their own
+        state.recomputed[tensor] = tensor;
+        return tensor;
+    }
+
+    ggml_tensor * result = ggml_dup_tensor(state.ctx, tensor);
+    result->op = tensor->op;
+    for (int i = 0; i < GGML_MAX_DIMS; i++) {
+        result->nb[i] = tensor->nb[i];
+    }
+    memcpy(result->op_params, tensor->op_params, sizeof(tensor->op_params));
+    ggml_format_name(result, "%s (recomputed)", tensor->name);
+    result->view_src  = view_src;
+    result->view_offs = tensor->view_offs;
+    for (int i = 0; i < GGML_MAX_SRC; i++) {
+        result->src[i] = ggml_opt_recompute(state, tensor->src[i]);
+    }
+
+    state.recomputed[tensor] = result;
+    return result;
+}
+
+// rewrite the backward pass of gb so that it only uses the checkpoints of the forward pass gf,
+// the recomputed activations are inserted right before their first use in the backward pass
+// so the allocator can free the forward activations as soon as the forward pass no longer needs them
+static ggml_cgraph * ggml_opt_checkpoint_graph(ggml_context * ctx, ggml_cgraph * gf, ggml_cgraph * gb) {
+    const int n_nodes_f = gf->n_nodes;
+
+    ggml_opt_recompute_state state;
+    state.ctx = ctx;
+    state.forward.insert(gf->nodes, gf->nodes + n_nodes_f);
+
+    for (int i = n_nodes_f; i < gb->n_nodes; ++i) {
+        ggml_tensor * node = gb->nodes[i];
+        node->view_src = ggml_opt_recompute(state, node->view_src);
+        for (int j = 0; j < GGML_MAX_SRC; ++j) {
+            node->src[j] = ggml_opt_recompute(state, node->src[j]);
+        }
+    }
+
+    int n_recomputed = 0;
+    for (const auto & it : state.recomputed) {
+        n_recomputed += it.first != it.second;
+    }
+    if (n_recomputed == 0) {
+        return gb;
+    }
+
+    ggml_cgraph * result = ggml_new_graph_custom(ctx, gb->size + n_recomputed, /*grads =*/ true);
+    for (int i = 0; i < gb->n_nodes; ++i) {
+        ggml_build_forward_expand(result, gb->nodes[i]);
+    }
+    GGML_ASSERT(result->n_nodes == gb->n_nodes + n_recomputed);
+
+    for (int i = 0; i < n_nodes_f; ++i) {
+        GGML_ASSERT(result->nodes[i] == gb->nodes[i]);
+
+        const size_t igrad_src = ggml_hash_find(&gb->visited_hash_set,     gb->nodes[i]);
+        const size_t igrad_dst = ggml_hash_find(&result->visited_hash_set, result->nodes[i]);
+
+        result->grads[igrad_dst]     = gb->grads[igrad_src];
+        result->grad_accs[igrad_dst] = gb->grad_accs[igrad_src];
+    }
+
+    GGML_LOG_DEBUG("%s: recomputing %d of %d forward nodes in the backward pass\n", __func__, n_recomputed, n_nodes_f);
+
+    return result;
+}
+
 static void ggml_opt_build(ggml_opt_context_t opt_ctx) {
     GGML_ASSERT(opt_ctx->ctx_compute && "no compute context set, either use static graphs or set one with ggml_opt_prepare_alloc");
     GGML_ASSERT((!opt_ctx->static_graphs || opt_ctx->inputs->data) && "when using static graphs the inputs must be allocated statically");
@@ -335,11 +756,15 @@ static void ggml_opt_build(ggml_opt_context_t opt_ctx) {
     ggml_set_output(opt_ctx->outputs);
 
     int n_param = 0;
+    opt_ctx->checkpointing = false;
     for (int i = 0; i < opt_ctx->gf->n_nodes; ++i) {
         const struct ggml_tensor * node = opt_ctx->gf->nodes[i];
         if (node->flags & GGML_TENSOR_FLAG_PARAM) {
             n_param++;
         }
+        if (node->flags & GGML_TENSOR_FLAG_CHECKPOINT) {
+            opt_ctx->checkpointing = true;
+        }
         GGML_ASSERT(!(node->flags & GGML_TENSOR_FLAG_LOSS) && "support for extra loss terms not implemented");
     }
 
@@ -488,6 +913,21 @@ static void ggml_opt_build(ggml_opt_context_t opt_ctx) {
     // gb_grad == graph backward gradients, forward pass, then backward pass to calculate gradients.
     opt_ctx->gb_grad = ggml_graph_dup(opt_ctx->ctx_compute, opt_ctx->gf, /*force_grads =*/ true);
     ggml_build_backward_expand(opt_ctx->ctx_compute, opt_ctx->gb_grad, opt_ctx->grad_accs.data());
+    // a parameter without a gradient would never be updated by the optimizer,
+    // with gradient accumulation its gradient is then only the accumulator itself
+    for (int i = 0; i < opt_ctx->gf->n_nodes; ++i) {
+        ggml_tensor * node = opt_ctx->gf->nodes[i];
+        if (!(node->flags & GGML_TENSOR_FLAG_PARAM)) {
+            continue;
+        }
+        ggml_tensor * grad = ggml_graph_get_grad(opt_ctx->gb_grad, node);
+        if (grad == nullptr || grad == ggml_graph_get_grad_acc(opt_ctx->gb_grad, node)) {
+            GGML_ABORT("%s: no gradient reaches parameter '%s', it must not be trained", __func__, node->name);
+        }
+    }
+    if (opt_ctx->checkpointing) {
+        opt_ctx->gb_grad = ggml_opt_checkpoint_graph(opt_ctx->ctx_compute, opt_ctx->gf, opt_ctx->gb_grad);
+    }
 
     if (opt_ctx->buf_static) {
         if (opt_ctx->build_type == GGML_OPT_BUILD_TYPE_GRAD) {
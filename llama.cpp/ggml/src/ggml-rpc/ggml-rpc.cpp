@@ -3,11 +3,16 @@
 #include "ggml-backend-impl.h"
 #include "ggml-cpp.h"
 
+#include <atomic>
 #include <cinttypes>
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #ifdef _WIN32
@@ -25,6 +30,10 @@
 #  include <netinet/tcp.h>
 #  include <netdb.h>
 #  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <sys/un.h>
 #endif
 #include <cstring>
 #include <fstream>
@@ -41,6 +50,10 @@ namespace fs = std::filesystem;
 
 static constexpr size_t MAX_CHUNK_SIZE = 1024ull * 1024ull * 1024ull; // 1 GiB
 
+// endpoints with this prefix are Unix domain sockets on the same host, tensor data goes through shared memory
+static const std::string UNIX_ENDPOINT_PREFIX = "unix://";
+static constexpr size_t DEFAULT_SHM_SIZE = 64ull * 1024ull * 1024ull; // 64 MiB
+
 #ifdef _WIN32
 typedef SOCKET sockfd_t;
 using ssize_t = __int64;
@@ -48,15 +61,39 @@ using ssize_t = __int64;
 typedef int sockfd_t;
 #endif
 
+// status of the asynchronous graph computations of a backend
+// a failure is kept until the next graph_compute of the backend returns it
+struct rpc_async_status {
+    enum ggml_status status = GGML_STATUS_SUCCESS;
+};
+
+// response to an asynchronous graph computation that has not been received yet
+struct rpc_pending_rsp {
+    size_t                            size;
+    std::shared_ptr<rpc_async_status> owner;
+};
+
 // cross-platform socket
 struct socket_t {
     sockfd_t fd;
+    // shared-memory arena for tensor data, only attached on Unix domain socket connections
+    void *   shm_ptr  = nullptr;
+    size_t   shm_size = 0;
+    std::deque<rpc_pending_rsp> pending_rsp;
+    uint64_t n_async_sent = 0;
+    uint64_t n_async_done = 0;
+    // incremented when the server drops all stored graphs, i.e. when a buffer is freed,
+    // the next graph_compute then stores its graph again
+    uint64_t graph_epoch = 0;
     socket_t(sockfd_t fd) : fd(fd) {}
     ~socket_t() {
         LOG_DBG("[%s] closing socket %d\n", __func__, this->fd);
 #ifdef _WIN32
         closesocket(this->fd);
 #else
+        if (this->shm_ptr) {
+            munmap(this->shm_ptr, this->shm_size);
+        }
         close(this->fd);
 #endif
     }
@@ -106,6 +143,11 @@ enum rpc_cmd {
     RPC_CMD_GET_ALLOC_SIZE,
     RPC_CMD_HELLO,
     RPC_CMD_DEVICE_COUNT,
+    RPC_CMD_GRAPH_COMPUTE_STORE,
+    RPC_CMD_GRAPH_COMPUTE_DELTA,
+    RPC_CMD_SHM_ATTACH,
+    RPC_CMD_SET_TENSOR_SHM,
+    RPC_CMD_GET_TENSOR_SHM,
     RPC_CMD_COUNT,
 };
 
@@ -209,6 +251,27 @@ struct rpc_msg_graph_compute_rsp {
     uint8_t result;
 };
 
+// sent before the computation, which is answered by a rpc_msg_graph_compute_rsp if the graph was found
+struct rpc_msg_graph_compute_delta_rsp {
+    uint8_t found;
+};
+
+struct rpc_msg_shm_attach_req {
+    char     name[64];
+    uint64_t size;
+};
+
+struct rpc_msg_shm_attach_rsp {
+    uint8_t result;
+};
+
+// the data is in the shared-memory arena
+struct rpc_msg_set_tensor_shm_req {
+    rpc_tensor tensor;
+    uint64_t offset;
+    uint64_t size;
+};
+
 struct rpc_msg_get_device_memory_req {
     uint32_t device;
 };
@@ -238,6 +301,23 @@ struct ggml_backend_rpc_context {
     std::string endpoint;
     uint32_t    device;
     std::string name;
+
+    // the connection is kept for the lifetime of the backend, so that computations and events never
+    // move to a new connection while responses are pending on the old one
+    std::shared_ptr<socket_t> sock;
+    uint8_t                   proto_minor;
+    std::shared_ptr<rpc_async_status> async_status;
+
+    // the last graph stored on the server under graph_id
+    // subsequent computes of the same topology only send the tensors that changed
+    uint64_t                graph_id;
+    std::weak_ptr<socket_t> graph_sock;
+    uint64_t                graph_epoch;
+    std::vector<uint64_t>   graph_nodes;
+    std::vector<rpc_tensor> graph_tensors;
+
+    // SET_TENSOR command reused by the asynchronous copies into this backend
+    std::vector<uint8_t>    copy_input;
 };
 
 struct ggml_backend_rpc_buffer_context {
@@ -311,19 +391,41 @@ static std::shared_ptr<socket_t> socket_connect(const char * host, int port) {
     return sock_ptr;
 }
 
-static std::shared_ptr<socket_t> socket_accept(sockfd_t srv_sockfd) {
+static std::shared_ptr<socket_t> socket_accept(sockfd_t srv_sockfd, bool tcp) {
     auto client_socket_fd = accept(srv_sockfd, NULL, NULL);
     auto client_socket = make_socket(client_socket_fd);
     if (client_socket == nullptr) {
         return nullptr;
     }
-    if (!set_no_delay(client_socket_fd)) {
+    if (tcp && !set_no_delay(client_socket_fd)) {
         GGML_LOG_ERROR("Failed to set TCP_NODELAY\n");
         return nullptr;
     }
     return client_socket;
 }
 
+#ifndef _WIN32
+// the user id of the process on the other end of a Unix domain socket
+static bool socket_peer_uid(sockfd_t sockfd, uid_t & uid) {
+#if defined(__linux__)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) {
+        return false;
+    }
+    uid = cred.uid;
+    return true;
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+    gid_t gid;
+    return getpeereid(sockfd, &uid, &gid) == 0;
+#else
+    GGML_UNUSED(sockfd);
+    GGML_UNUSED(uid);
+    return false;
+#endif
+}
+#endif
+
 static std::shared_ptr<socket_t> create_server_socket(const char * host, int port) {
     auto sockfd = socket(AF_INET, SOCK_STREAM, 0);
     auto sock = make_socket(sockfd);
@@ -352,6 +454,61 @@ static std::shared_ptr<socket_t> create_server_socket(const char * host, int por
     return sock;
 }
 
+#ifndef _WIN32
+static bool make_unix_addr(const char * path, struct sockaddr_un & addr) {
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        GGML_LOG_ERROR("Unix socket path too long: %s\n", path);
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    return true;
+}
+
+static std::shared_ptr<socket_t> socket_connect_unix(const char * path) {
+    struct sockaddr_un addr;
+    if (!make_unix_addr(path, addr)) {
+        return nullptr;
+    }
+    auto sock_ptr = make_socket(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (sock_ptr == nullptr) {
+        return nullptr;
+    }
+    if (connect(sock_ptr->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        return nullptr;
+    }
+    return sock_ptr;
+}
+
+static std::shared_ptr<socket_t> create_server_socket_unix(const char * path) {
+    struct sockaddr_un addr;
+    if (!make_unix_addr(path, addr)) {
+        return nullptr;
+    }
+    auto sock = make_socket(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (sock == nullptr) {
+        return nullptr;
+    }
+    // remove a stale socket file left by a previous server, but never anything else
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            GGML_LOG_ERROR("Unix socket path exists and is not a socket: %s\n", path);
+            return nullptr;
+        }
+        unlink(path);
+    }
+    if (bind(sock->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        return nullptr;
+    }
+    if (listen(sock->fd, 1) < 0) {
+        return nullptr;
+    }
+    return sock;
+}
+#endif
+
 static bool send_data(sockfd_t sockfd, const void * data, size_t size) {
     size_t bytes_sent = 0;
     while (bytes_sent < size) {
@@ -418,6 +575,14 @@ static bool recv_msg(sockfd_t sockfd, std::vector<uint8_t> & input) {
     return recv_data(sockfd, input.data(), size);
 }
 
+static bool parse_unix_endpoint(const std::string & endpoint, std::string & path) {
+    if (endpoint.compare(0, UNIX_ENDPOINT_PREFIX.size(), UNIX_ENDPOINT_PREFIX) != 0) {
+        return false;
+    }
+    path = endpoint.substr(UNIX_ENDPOINT_PREFIX.size());
+    return !path.empty();
+}
+
 static bool parse_endpoint(const std::string & endpoint, std::string & host, int & port) {
     size_t pos = endpoint.find(':');
     if (pos == std::string::npos) {
@@ -444,14 +609,7 @@ static bool send_rpc_cmd(const std::shared_ptr<socket_t> & sock, enum rpc_cmd cm
     return true;
 }
 
-// RPC request : | rpc_cmd (1 byte) | request_size (8 bytes) | request_data (request_size bytes) |
-// RPC response: | response_size (8 bytes) | response_data (response_size bytes) |
-static bool send_rpc_cmd(const std::shared_ptr<socket_t> & sock, enum rpc_cmd cmd, const void * input, size_t input_size, void * output, size_t output_size) {
-    if (!send_rpc_cmd(sock, cmd, input, input_size)) {
-        return false;
-    }
-    // TODO: currently the output_size is always known, do we need support for commands with variable output size?
-    // even if we do, we can skip sending output_size from the server for commands with known output size
+static bool recv_rpc_rsp(const std::shared_ptr<socket_t> & sock, void * output, size_t output_size) {
     uint64_t out_size;
     if (!recv_data(sock->fd, &out_size, sizeof(out_size))) {
         return false;
@@ -459,16 +617,67 @@ static bool send_rpc_cmd(const std::shared_ptr<socket_t> & sock, enum rpc_cmd cm
     if (out_size != output_size) {
         return false;
     }
-    if (!recv_data(sock->fd, output, output_size)) {
+    return recv_data(sock->fd, output, output_size);
+}
+
+// receives the responses of asynchronous graph computations until n_async_done reaches until
+// a failed computation is recorded on the backend that sent it, only a lost connection fails
+static bool recv_async_rsp(const std::shared_ptr<socket_t> & sock, uint64_t until) {
+    while (sock->n_async_done < until) {
+        GGML_ASSERT(!sock->pending_rsp.empty());
+        rpc_pending_rsp pending = std::move(sock->pending_rsp.front());
+        sock->pending_rsp.pop_front();
+        rpc_msg_graph_compute_rsp response;
+        GGML_ASSERT(pending.size == sizeof(response));
+        if (!recv_rpc_rsp(sock, &response, sizeof(response))) {
+            return false;
+        }
+        sock->n_async_done++;
+        enum ggml_status status = (enum ggml_status) (int8_t) response.result;
+        if (status != GGML_STATUS_SUCCESS) {
+            GGML_LOG_ERROR("RPC graph computation failed with status %d\n", (int) status);
+            if (pending.owner->status == GGML_STATUS_SUCCESS) {
+                pending.owner->status = status;
+            }
+        }
+    }
+    return true;
+}
+
+// registers the response to a graph computation that has already been sent, it is received later
+static void push_async_rsp(const std::shared_ptr<socket_t> & sock, const std::shared_ptr<rpc_async_status> & owner) {
+    sock->pending_rsp.push_back({ sizeof(rpc_msg_graph_compute_rsp), owner });
+    sock->n_async_sent++;
+}
+
+// sends a graph compute command without waiting for its response
+static bool send_rpc_cmd_async(const std::shared_ptr<socket_t> & sock, enum rpc_cmd cmd, const void * input, size_t input_size,
+                               const std::shared_ptr<rpc_async_status> & owner) {
+    if (!send_rpc_cmd(sock, cmd, input, input_size)) {
         return false;
     }
+    push_async_rsp(sock, owner);
     return true;
 }
 
+// RPC request : | rpc_cmd (1 byte) | request_size (8 bytes) | request_data (request_size bytes) |
+// RPC response: | response_size (8 bytes) | response_data (response_size bytes) |
+static bool send_rpc_cmd(const std::shared_ptr<socket_t> & sock, enum rpc_cmd cmd, const void * input, size_t input_size, void * output, size_t output_size) {
+    if (!send_rpc_cmd(sock, cmd, input, input_size)) {
+        return false;
+    }
+    // the server answers in order, receive the responses of pending graph computations first
+    if (!recv_async_rsp(sock, sock->n_async_sent)) {
+        return false;
+    }
+    // TODO: currently the output_size is always known, do we need support for commands with variable output size?
+    // even if we do, we can skip sending output_size from the server for commands with known output size
+    return recv_rpc_rsp(sock, output, output_size);
+}
+
 // RPC client-side implementation
 
-static bool check_server_version(const std::shared_ptr<socket_t> & sock) {
-    rpc_msg_hello_rsp response;
+static bool check_server_version(const std::shared_ptr<socket_t> & sock, rpc_msg_hello_rsp & response) {
     bool status = send_rpc_cmd(sock, RPC_CMD_HELLO, nullptr, 0, &response, sizeof(response));
     RPC_STATUS_ASSERT(status);
     if (response.major != RPC_PROTO_MAJOR_VERSION || response.minor > RPC_PROTO_MINOR_VERSION) {
@@ -481,24 +690,82 @@ static bool check_server_version(const std::shared_ptr<socket_t> & sock) {
     return true;
 }
 
-static std::shared_ptr<socket_t> get_socket(const std::string & endpoint) {
+// creates a shared-memory arena and maps it on the server, the name is unlinked once both sides have it mapped
+static bool shm_attach(const std::shared_ptr<socket_t> & sock) {
+#ifdef _WIN32
+    GGML_UNUSED(sock);
+    return false;
+#else
+    static std::atomic<uint32_t> counter { 0 };
+    size_t size = DEFAULT_SHM_SIZE;
+    if (const char * env = std::getenv("GGML_RPC_SHM_SIZE")) {
+        size = (size_t) std::strtoull(env, nullptr, 10) * 1024ull * 1024ull;
+    }
+    if (size == 0) {
+        return false;
+    }
+    rpc_msg_shm_attach_req request;
+    memset(&request, 0, sizeof(request));
+    snprintf(request.name, sizeof(request.name), "/ggml-rpc-%d-%u", (int) getpid(), counter++);
+    request.size = size;
+
+    int fd = shm_open(request.name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    void * ptr = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        shm_unlink(request.name);
+        return false;
+    }
+    rpc_msg_shm_attach_rsp response;
+    bool status = send_rpc_cmd(sock, RPC_CMD_SHM_ATTACH, &request, sizeof(request), &response, sizeof(response));
+    shm_unlink(request.name);
+    RPC_STATUS_ASSERT(status);
+    if (!response.result) {
+        munmap(ptr, size);
+        return false;
+    }
+    LOG_DBG("[%s] attached %s, size: %zu\n", __func__, request.name, size);
+    sock->shm_ptr  = ptr;
+    sock->shm_size = size;
+    return true;
+#endif
+}
+
+// proto_minor (optional) receives the minor protocol version reported by the server
+static std::shared_ptr<socket_t> get_socket(const std::string & endpoint, uint8_t * proto_minor = nullptr) {
     static std::mutex mutex;
     std::lock_guard<std::mutex> lock(mutex);
     static std::unordered_map<std::string, std::weak_ptr<socket_t>> sockets;
+    static std::unordered_map<std::string, uint8_t> minor_versions;
     static bool initialized = false;
 
     auto it = sockets.find(endpoint);
     if (it != sockets.end()) {
         if (auto sock = it->second.lock()) {
+            if (proto_minor) {
+                *proto_minor = minor_versions[endpoint];
+            }
             return sock;
         }
     }
     std::string host;
-    int port;
-    if (!parse_endpoint(endpoint, host, port)) {
+    int port = 0;
+    std::string unix_path;
+    bool is_unix = parse_unix_endpoint(endpoint, unix_path);
+    if (!is_unix && !parse_endpoint(endpoint, host, port)) {
         return nullptr;
     }
 #ifdef _WIN32
+    if (is_unix) {
+        GGML_LOG_ERROR("Unix domain socket endpoints are not supported on Windows\n");
+        return nullptr;
+    }
     if (!initialized) {
         WSADATA wsaData;
         int res = WSAStartup(MAKEWORD(2, 2), &wsaData);
@@ -510,15 +777,27 @@ static std::shared_ptr<socket_t> get_socket(const std::string & endpoint) {
 #else
     GGML_UNUSED(initialized);
 #endif
+#ifdef _WIN32
     auto sock = socket_connect(host.c_str(), port);
+#else
+    auto sock = is_unix ? socket_connect_unix(unix_path.c_str()) : socket_connect(host.c_str(), port);
+#endif
     if (sock == nullptr) {
         return nullptr;
     }
-    if (!check_server_version(sock)) {
+    rpc_msg_hello_rsp version;
+    if (!check_server_version(sock, version)) {
         return nullptr;
     }
     LOG_DBG("[%s] connected to %s, sockfd=%d\n", __func__, endpoint.c_str(), sock->fd);
+    if (is_unix && version.minor >= 2 && !shm_attach(sock)) {
+        GGML_LOG_WARN("Failed to attach shared memory to %s, tensor data will be sent over the socket\n", endpoint.c_str());
+    }
     sockets[endpoint] = sock;
+    minor_versions[endpoint] = version.minor;
+    if (proto_minor) {
+        *proto_minor = version.minor;
+    }
     return sock;
 }
 
@@ -527,6 +806,7 @@ static void ggml_backend_rpc_buffer_free_buffer(ggml_backend_buffer_t buffer) {
     rpc_msg_free_buffer_req request = {ctx->remote_ptr};
     bool status = send_rpc_cmd(ctx->sock, RPC_CMD_FREE_BUFFER, &request, sizeof(request), nullptr, 0);
     RPC_STATUS_ASSERT(status);
+    ctx->sock->graph_epoch++;
     delete ctx;
 }
 
@@ -611,6 +891,21 @@ static void ggml_backend_rpc_buffer_set_tensor(ggml_backend_buffer_t buffer, ggm
             return;
         }
     }
+    if (ctx->sock->shm_ptr) {
+        // copy the data through the shared-memory arena, one chunk at a time
+        rpc_msg_set_tensor_shm_req request;
+        request.tensor = rpc_tensor;
+        for (size_t done = 0; done < size; ) {
+            size_t chunk = std::min(size - done, ctx->sock->shm_size);
+            memcpy(ctx->sock->shm_ptr, (const uint8_t *)data + done, chunk);
+            request.offset = offset + done;
+            request.size = chunk;
+            bool status = send_rpc_cmd(ctx->sock, RPC_CMD_SET_TENSOR_SHM, &request, sizeof(request), nullptr, 0);
+            RPC_STATUS_ASSERT(status);
+            done += chunk;
+        }
+        return;
+    }
     // input serialization format: | rpc_tensor | offset (8 bytes) | data (size bytes)
     size_t input_size = sizeof(rpc_tensor) + sizeof(uint64_t) + size;
     std::vector<uint8_t> input(input_size, 0);
@@ -625,6 +920,18 @@ static void ggml_backend_rpc_buffer_get_tensor(ggml_backend_buffer_t buffer, con
     ggml_backend_rpc_buffer_context * ctx = (ggml_backend_rpc_buffer_context *)buffer->context;
     rpc_msg_get_tensor_req request;
     request.tensor = serialize_tensor(tensor);
+    if (ctx->sock->shm_ptr) {
+        for (size_t done = 0; done < size; ) {
+            size_t chunk = std::min(size - done, ctx->sock->shm_size);
+            request.offset = offset + done;
+            request.size = chunk;
+            bool status = send_rpc_cmd(ctx->sock, RPC_CMD_GET_TENSOR_SHM, &request, sizeof(request), nullptr, 0);
+            RPC_STATUS_ASSERT(status);
+            memcpy((uint8_t *)data + done, ctx->sock->shm_ptr, chunk);
+            done += chunk;
+        }
+        return;
+    }
     request.offset = offset;
     request.size = size;
     bool status = send_rpc_cmd(ctx->sock, RPC_CMD_GET_TENSOR, &request, sizeof(request), data, size);
@@ -760,17 +1067,21 @@ static const char * ggml_backend_rpc_name(ggml_backend_t backend) {
     return rpc_ctx->name.c_str();
 }
 
+// a failed computation does not abort here, it is returned by the next graph_compute of the backend
+static void ggml_backend_rpc_synchronize(ggml_backend_t backend) {
+    ggml_backend_rpc_context * rpc_ctx = (ggml_backend_rpc_context *)backend->context;
+    // graph computations are asynchronous, wait for the responses of all of them
+    bool status = recv_async_rsp(rpc_ctx->sock, rpc_ctx->sock->n_async_sent);
+    RPC_STATUS_ASSERT(status);
+}
+
 static void ggml_backend_rpc_free(ggml_backend_t backend) {
+    ggml_backend_rpc_synchronize(backend);
     ggml_backend_rpc_context * rpc_ctx = (ggml_backend_rpc_context *)backend->context;
     delete rpc_ctx;
     delete backend;
 }
 
-static void ggml_backend_rpc_synchronize(ggml_backend_t backend) {
-    GGML_UNUSED(backend);
-    // this is no-op because we don't have any async operations
-}
-
 static void add_tensor(ggml_tensor * tensor, std::vector<rpc_tensor> & tensors, std::unordered_set<ggml_tensor*> & visited) {
     if (tensor == nullptr) {
         return;
@@ -786,26 +1097,29 @@ static void add_tensor(ggml_tensor * tensor, std::vector<rpc_tensor> & tensors,
     tensors.push_back(serialize_tensor(tensor));
 }
 
-static void serialize_graph(uint32_t device, const ggml_cgraph * cgraph, std::vector<uint8_t> & output) {
+static void collect_graph(const ggml_cgraph * cgraph, std::vector<uint64_t> & nodes, std::vector<rpc_tensor> & tensors) {
     uint32_t n_nodes = cgraph->n_nodes;
-    std::vector<rpc_tensor> tensors;
     std::unordered_set<ggml_tensor*> visited;
+    nodes.resize(n_nodes);
     for (uint32_t i = 0; i < n_nodes; i++) {
+        nodes[i] = reinterpret_cast<uint64_t>(cgraph->nodes[i]);
         add_tensor(cgraph->nodes[i], tensors, visited);
     }
+}
+
+static void serialize_graph(uint32_t device, const std::vector<uint64_t> & nodes, const std::vector<rpc_tensor> & tensors, std::vector<uint8_t> & output) {
     // serialization format:
     // | device (4 bytes) | n_nodes (4 bytes) | nodes (n_nodes * sizeof(uint64_t) | n_tensors (4 bytes) | tensors (n_tensors * sizeof(rpc_tensor)) |
+    uint32_t n_nodes = nodes.size();
     uint32_t n_tensors = tensors.size();
-    int output_size = 2*sizeof(uint32_t) + n_nodes * sizeof(uint64_t) + sizeof(uint32_t) + n_tensors * sizeof(rpc_tensor);
-    output.resize(output_size, 0);
-    uint8_t * dest = output.data();
+    size_t offset = output.size();
+    output.resize(offset + 2*sizeof(uint32_t) + n_nodes * sizeof(uint64_t) + sizeof(uint32_t) + n_tensors * sizeof(rpc_tensor), 0);
+    uint8_t * dest = output.data() + offset;
     memcpy(dest, &device, sizeof(device));
     dest += sizeof(device);
     memcpy(dest, &n_nodes, sizeof(n_nodes));
     dest += sizeof(n_nodes);
-    for (uint32_t i = 0; i < n_nodes; i++) {
-        memcpy(dest + i * sizeof(uint64_t), &cgraph->nodes[i], sizeof(uint64_t));
-    }
+    memcpy(dest, nodes.data(), n_nodes * sizeof(uint64_t));
     dest += n_nodes * sizeof(uint64_t);
     memcpy(dest, &n_tensors, sizeof(n_tensors));
     dest += sizeof(n_tensors);
@@ -813,15 +1127,144 @@ static void serialize_graph(uint32_t device, const ggml_cgraph * cgraph, std::ve
     memcpy(out_tensors, tensors.data(), n_tensors * sizeof(rpc_tensor));
 }
 
+// returns true if the graph has the same nodes and tensors (in the same order) as the graph stored on the server
+static bool graph_matches_stored(const ggml_backend_rpc_context * rpc_ctx, const std::vector<uint64_t> & nodes, const std::vector<rpc_tensor> & tensors) {
+    if (nodes != rpc_ctx->graph_nodes || tensors.size() != rpc_ctx->graph_tensors.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < tensors.size(); i++) {
+        if (tensors[i].id != rpc_ctx->graph_tensors[i].id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the computation is asynchronous: the command is sent without waiting for the response,
+// which is received by the next command that expects a response or by synchronize/events,
+// a failed computation is recorded there and returned by the next graph_compute of the backend
 static enum ggml_status ggml_backend_rpc_graph_compute(ggml_backend_t backend, ggml_cgraph * cgraph) {
     ggml_backend_rpc_context * rpc_ctx = (ggml_backend_rpc_context *)backend->context;
+    if (rpc_ctx->async_status->status != GGML_STATUS_SUCCESS) {
+        enum ggml_status status = rpc_ctx->async_status->status;
+        rpc_ctx->async_status->status = GGML_STATUS_SUCCESS;
+        return status;
+    }
+    const auto & sock = rpc_ctx->sock;
+    const uint8_t proto_minor = rpc_ctx->proto_minor;
+    std::vector<uint64_t> nodes;
+    std::vector<rpc_tensor> tensors;
+    collect_graph(cgraph, nodes, tensors);
     std::vector<uint8_t> input;
-    serialize_graph(rpc_ctx->device, cgraph, input);
-    rpc_msg_graph_compute_rsp response;
-    auto sock = get_socket(rpc_ctx->endpoint);
-    bool status = send_rpc_cmd(sock, RPC_CMD_GRAPH_COMPUTE, input.data(), input.size(), &response, sizeof(response));
+    if (proto_minor < 1) {
+        // the server does not support stored graphs
+        serialize_graph(rpc_ctx->device, nodes, tensors, input);
+        bool status = send_rpc_cmd_async(sock, RPC_CMD_GRAPH_COMPUTE, input.data(), input.size(), rpc_ctx->async_status);
+        RPC_STATUS_ASSERT(status);
+        return GGML_STATUS_SUCCESS;
+    }
+    // the server drops its stored graphs when a buffer is freed or a delta does not apply,
+    // servers before 3.3 answer a delta only after computing it and are sent the whole graph
+    if (proto_minor >= 3 && rpc_ctx->graph_sock.lock() == sock && rpc_ctx->graph_epoch == sock->graph_epoch &&
+        graph_matches_stored(rpc_ctx, nodes, tensors)) {
+        // serialization format:
+        // | graph_id (8 bytes) | n_changed (4 bytes) | changed (n_changed * (index (4 bytes) + rpc_tensor)) |
+        uint32_t n_changed = 0;
+        input.resize(sizeof(uint64_t) + sizeof(uint32_t));
+        memcpy(input.data(), &rpc_ctx->graph_id, sizeof(rpc_ctx->graph_id));
+        for (uint32_t i = 0; i < tensors.size(); i++) {
+            if (memcmp(&tensors[i], &rpc_ctx->graph_tensors[i], sizeof(rpc_tensor)) == 0) {
+                continue;
+            }
+            size_t offset = input.size();
+            input.resize(offset + sizeof(uint32_t) + sizeof(rpc_tensor));
+            memcpy(input.data() + offset, &i, sizeof(i));
+            memcpy(input.data() + offset + sizeof(uint32_t), &tensors[i], sizeof(rpc_tensor));
+            n_changed++;
+        }
+        memcpy(input.data() + sizeof(uint64_t), &n_changed, sizeof(n_changed));
+        // the server tells whether the delta applied before computing, so the graph can be stored again
+        // in this call if it did not; this waits for the computations already sent on the connection
+        rpc_msg_graph_compute_delta_rsp response;
+        bool status = send_rpc_cmd(sock, RPC_CMD_GRAPH_COMPUTE_DELTA, input.data(), input.size(), &response, sizeof(response));
+        RPC_STATUS_ASSERT(status);
+        if (response.found) {
+            push_async_rsp(sock, rpc_ctx->async_status);
+            rpc_ctx->graph_tensors = std::move(tensors);
+            return GGML_STATUS_SUCCESS;
+        }
+        GGML_LOG_DEBUG("RPC server no longer has graph %" PRIu64 ", storing it again\n", rpc_ctx->graph_id);
+        input.clear();
+    }
+    // serialization format:
+    // | graph_id (8 bytes) | graph (see serialize_graph) |
+    input.resize(sizeof(uint64_t));
+    memcpy(input.data(), &rpc_ctx->graph_id, sizeof(rpc_ctx->graph_id));
+    serialize_graph(rpc_ctx->device, nodes, tensors, input);
+    bool status = send_rpc_cmd_async(sock, RPC_CMD_GRAPH_COMPUTE_STORE, input.data(), input.size(), rpc_ctx->async_status);
+    RPC_STATUS_ASSERT(status);
+    rpc_ctx->graph_sock    = sock;
+    rpc_ctx->graph_epoch   = sock->graph_epoch;
+    rpc_ctx->graph_nodes   = std::move(nodes);
+    rpc_ctx->graph_tensors = std::move(tensors);
+    return GGML_STATUS_SUCCESS;
+}
+
+// copies a tensor computed on another backend, e.g. the activations of the previous pipeline stage on another server
+// only the source is waited for: the data is sent as a SET_TENSOR command, which has no response, so it is queued
+// behind the computations still running on this server instead of waiting for them
+static bool ggml_backend_rpc_cpy_tensor_async(ggml_backend_t backend_src, ggml_backend_t backend_dst, const ggml_tensor * src, ggml_tensor * dst) {
+    ggml_backend_rpc_context * rpc_ctx = (ggml_backend_rpc_context *)backend_dst->context;
+    if (dst->buffer == nullptr || !ggml_backend_buffer_is_rpc(dst->buffer) || !ggml_are_same_layout(src, dst)) {
+        return false;
+    }
+    ggml_backend_rpc_buffer_context * dst_ctx = (ggml_backend_rpc_buffer_context *)dst->buffer->context;
+    if (src->buffer != nullptr && ggml_backend_buffer_is_rpc(src->buffer)) {
+        ggml_backend_rpc_buffer_context * src_ctx = (ggml_backend_rpc_buffer_context *)src->buffer->context;
+        if (src_ctx->sock == dst_ctx->sock) {
+            // same server, COPY_TENSOR runs there but expects a response
+            return false;
+        }
+    }
+    ggml_backend_synchronize(backend_src);
+
+    // input serialization format: | rpc_tensor | offset (8 bytes) | data (size bytes)
+    const size_t size = ggml_nbytes(dst);
+    const size_t header_size = sizeof(rpc_tensor) + sizeof(uint64_t);
+    std::vector<uint8_t> & input = rpc_ctx->copy_input;
+    input.resize(header_size + size);
+    rpc_tensor tensor = serialize_tensor(dst);
+    uint64_t offset = 0;
+    memcpy(input.data(), &tensor, sizeof(tensor));
+    memcpy(input.data() + sizeof(tensor), &offset, sizeof(offset));
+    ggml_backend_tensor_get(src, input.data() + header_size, 0, size);
+    bool status = send_rpc_cmd(dst_ctx->sock, RPC_CMD_SET_TENSOR, input.data(), input.size());
+    RPC_STATUS_ASSERT(status);
+    return true;
+}
+
+// events mark a point in the sequence of asynchronous graph computations sent on a connection
+struct ggml_backend_rpc_event_context {
+    std::shared_ptr<socket_t> sock;
+    uint64_t                  n_async;
+};
+
+static void ggml_backend_rpc_event_record(ggml_backend_t backend, ggml_backend_event_t event) {
+    ggml_backend_rpc_context * rpc_ctx = (ggml_backend_rpc_context *)backend->context;
+    ggml_backend_rpc_event_context * event_ctx = (ggml_backend_rpc_event_context *)event->context;
+    event_ctx->sock = rpc_ctx->sock;
+    event_ctx->n_async = rpc_ctx->sock->n_async_sent;
+}
+
+static void ggml_backend_rpc_event_wait(ggml_backend_t backend, ggml_backend_event_t event) {
+    ggml_backend_rpc_context * rpc_ctx = (ggml_backend_rpc_context *)backend->context;
+    ggml_backend_rpc_event_context * event_ctx = (ggml_backend_rpc_event_context *)event->context;
+    if (event_ctx->sock == nullptr || event_ctx->sock == rpc_ctx->sock) {
+        // commands on the same connection are executed in order by the server
+        return;
+    }
+    bool status = recv_async_rsp(event_ctx->sock, event_ctx->n_async);
     RPC_STATUS_ASSERT(status);
-    return (enum ggml_status)response.result;
 }
 
 static ggml_backend_i ggml_backend_rpc_interface = {
@@ -829,15 +1272,15 @@ static ggml_backend_i ggml_backend_rpc_interface = {
     /* .free                    = */ ggml_backend_rpc_free,
     /* .set_tensor_async        = */ NULL,
     /* .get_tensor_async        = */ NULL,
-    /* .cpy_tensor_async        = */ NULL,
+    /* .cpy_tensor_async        = */ ggml_backend_rpc_cpy_tensor_async,
     /* .synchronize             = */ ggml_backend_rpc_synchronize,
     /* .graph_plan_create       = */ NULL,
     /* .graph_plan_free         = */ NULL,
     /* .graph_plan_update       = */ NULL,
     /* .graph_plan_compute      = */ NULL,
     /* .graph_compute           = */ ggml_backend_rpc_graph_compute,
-    /* .event_record            = */ NULL,
-    /* .event_wait              = */ NULL,
+    /* .event_record            = */ ggml_backend_rpc_event_record,
+    /* .event_wait              = */ ggml_backend_rpc_event_wait,
     /* .graph_optimize          = */ NULL,
 };
 
@@ -877,10 +1320,26 @@ ggml_backend_buffer_type_t ggml_backend_rpc_buffer_type(const char * endpoint, u
 
 ggml_backend_t ggml_backend_rpc_init(const char * endpoint, uint32_t device) {
     std::string dev_name = "RPC" + std::to_string(device) + "[" + std::string(endpoint) + "]";
+    static std::atomic<uint64_t> next_graph_id { 1 };
+    uint8_t proto_minor = 0;
+    auto sock = get_socket(endpoint, &proto_minor);
+    if (sock == nullptr) {
+        GGML_LOG_ERROR("%s: failed to connect to %s\n", __func__, endpoint);
+        return nullptr;
+    }
     ggml_backend_rpc_context * ctx = new ggml_backend_rpc_context {
-        /* .endpoint = */ endpoint,
-        /* .device   = */ device,
-        /* .name     = */ dev_name
+        /* .endpoint      = */ endpoint,
+        /* .device        = */ device,
+        /* .name          = */ dev_name,
+        /* .sock          = */ sock,
+        /* .proto_minor   = */ proto_minor,
+        /* .async_status  = */ std::make_shared<rpc_async_status>(),
+        /* .graph_id      = */ next_graph_id++,
+        /* .graph_sock    = */ {},
+        /* .graph_epoch   = */ 0,
+        /* .graph_nodes   = */ {},
+        /* .graph_tensors = */ {},
+        /* .copy_input    = */ {},
     };
     auto reg = ggml_backend_rpc_add_server(endpoint);
     ggml_backend_t backend = new ggml_backend {
@@ -918,13 +1377,65 @@ void ggml_backend_rpc_get_device_memory(const char * endpoint, uint32_t device,
 
 // RPC server-side implementation
 
+// serializes graph computations and buffer accesses from concurrent clients on the shared backends
+// each device has a ticket queue, so clients are served in FIFO order
+class rpc_compute_sched {
+public:
+    rpc_compute_sched(size_t n_devices) : queues(n_devices) {}
+
+    ggml_status compute(uint32_t device, ggml_backend_t backend, ggml_cgraph * graph) {
+        return run(device, [backend, graph] { return ggml_backend_graph_compute(backend, graph); });
+    }
+
+    template <typename F>
+    auto run(uint32_t device, F && fn) -> decltype(fn()) {
+        device_queue & q = queues[device];
+        std::unique_lock<std::mutex> lock(q.mutex);
+        const uint64_t ticket = q.next_ticket++;
+        q.cv.wait(lock, [&q, ticket] { return q.serving == ticket; });
+        lock.unlock();
+
+        struct release {
+            device_queue & q;
+            ~release() {
+                {
+                    std::lock_guard<std::mutex> lock(q.mutex);
+                    q.serving++;
+                }
+                q.cv.notify_all();
+            }
+        } release_ticket { q };
+        return fn();
+    }
+
+private:
+    struct device_queue {
+        std::mutex              mutex;
+        std::condition_variable cv;
+        uint64_t                next_ticket = 0;
+        uint64_t                serving     = 0;
+    };
+
+    std::vector<device_queue> queues;
+};
+
 class rpc_server {
 public:
-    rpc_server(std::vector<ggml_backend_t> backends, const char * cache_dir)
-        : backends(std::move(backends)), cache_dir(cache_dir) {
+    rpc_server(std::vector<ggml_backend_t> backends, std::shared_ptr<rpc_compute_sched> sched, const char * cache_dir)
+        : backends(std::move(backends)), sched(std::move(sched)), cache_dir(cache_dir) {
     }
     ~rpc_server();
 
+#ifndef _WIN32
+    // the client is a process of user uid on this host, connected through a Unix domain socket
+    void set_local_peer(uid_t uid) {
+        local_peer = true;
+        peer_uid = uid;
+    }
+#endif
+    // shared memory is only attached for local peers
+    bool is_local_peer() const { return local_peer; }
+
     void hello(rpc_msg_hello_rsp & response);
     bool alloc_buffer(const rpc_msg_alloc_buffer_req & request, rpc_msg_alloc_buffer_rsp & response);
     bool get_alignment(const rpc_msg_get_alignment_req & request, rpc_msg_get_alignment_rsp & response);
@@ -933,26 +1444,57 @@ public:
     bool free_buffer(const rpc_msg_free_buffer_req & request);
     bool buffer_clear(const rpc_msg_buffer_clear_req & request);
     bool set_tensor(const std::vector<uint8_t> & input);
+    bool set_tensor_shm(const rpc_msg_set_tensor_shm_req & request);
     bool set_tensor_hash(const rpc_msg_set_tensor_hash_req & request, rpc_msg_set_tensor_hash_rsp & response);
     bool get_tensor(const rpc_msg_get_tensor_req & request, std::vector<uint8_t> & response);
+    bool get_tensor_shm(const rpc_msg_get_tensor_req & request);
+    bool shm_attach(const rpc_msg_shm_attach_req & request, rpc_msg_shm_attach_rsp & response);
     bool copy_tensor(const rpc_msg_copy_tensor_req & request, rpc_msg_copy_tensor_rsp & response);
     bool graph_compute(const std::vector<uint8_t> & input, rpc_msg_graph_compute_rsp & response);
+    bool graph_compute_store(const std::vector<uint8_t> & input, rpc_msg_graph_compute_rsp & response);
+    // applies the delta to the stored graph, which is computed by graph_compute_stored if it was found
+    bool graph_compute_delta(const std::vector<uint8_t> & input, rpc_msg_graph_compute_delta_rsp & response, uint64_t & graph_id);
+    bool graph_compute_stored(uint64_t graph_id, rpc_msg_graph_compute_rsp & response);
     bool init_tensor(const rpc_msg_init_tensor_req & request);
     bool get_alloc_size(const rpc_msg_get_alloc_size_req & request, rpc_msg_get_alloc_size_rsp & response);
     bool get_device_memory(const rpc_msg_get_device_memory_req & request, rpc_msg_get_device_memory_rsp & response);
 
 private:
+    // deserialized graph kept alive between computes
+    struct stored_graph {
+        uint32_t device;
+        ggml_context_ptr ctx;
+        ggml_cgraph * graph;
+        std::vector<ggml_tensor *> tensors; // in serialization order
+        std::unordered_map<uint64_t, ggml_tensor *> tensor_map;
+    };
+
     bool get_cached_file(uint64_t hash, std::vector<uint8_t> & data);
+    // index of the device whose queue serializes accesses to the buffer
+    uint32_t buffer_device(ggml_backend_buffer_t buffer) const;
     ggml_tensor * deserialize_tensor(struct ggml_context * ctx, const rpc_tensor * tensor);
+    ggml_tensor * deserialize_tensor_region(struct ggml_context * ctx, const rpc_tensor * tensor, uint64_t offset, uint64_t size);
+    bool set_tensor_data(const rpc_tensor * tensor, uint64_t offset, const void * data, size_t size);
+    bool update_tensor(ggml_tensor * result, const rpc_tensor * tensor);
     ggml_tensor * create_node(uint64_t id,
                               struct ggml_context * ctx,
                               const std::unordered_map<uint64_t, const rpc_tensor*> & tensor_ptrs,
                               std::unordered_map<uint64_t, struct ggml_tensor*> & tensor_map);
+    bool deserialize_graph(const uint8_t * data, size_t size, stored_graph & result);
 
 
     std::vector<ggml_backend_t> backends;
+    std::shared_ptr<rpc_compute_sched> sched;
     const char * cache_dir;
     std::unordered_set<ggml_backend_buffer_t> buffers;
+    std::unordered_map<uint64_t, stored_graph> graphs;
+    // shared-memory arena attached by a same-host client
+    void * shm_ptr = nullptr;
+    size_t shm_size = 0;
+    bool local_peer = false;
+#ifndef _WIN32
+    uid_t peer_uid = 0;
+#endif
 };
 
 void rpc_server::hello(rpc_msg_hello_rsp & response) {
@@ -1062,9 +1604,21 @@ bool rpc_server::free_buffer(const rpc_msg_free_buffer_req & request) {
     }
     ggml_backend_buffer_free(buffer);
     buffers.erase(buffer);
+    // stored graphs may reference the freed buffer, the clients will send them again
+    graphs.clear();
     return true;
 }
 
+uint32_t rpc_server::buffer_device(ggml_backend_buffer_t buffer) const {
+    ggml_backend_dev_t dev = ggml_backend_buft_get_device(ggml_backend_buffer_get_type(buffer));
+    for (uint32_t i = 0; i < backends.size(); i++) {
+        if (ggml_backend_get_device(backends[i]) == dev) {
+            return i;
+        }
+    }
+    return 0;
+}
+
 bool rpc_server::buffer_clear(const rpc_msg_buffer_clear_req & request) {
     LOG_DBG("[%s] remote_ptr: %" PRIx64 ", value: %u\n", __func__, request.remote_ptr, request.value);
     ggml_backend_buffer_t buffer = reinterpret_cast<ggml_backend_buffer_t>(request.remote_ptr);
@@ -1072,7 +1626,7 @@ bool rpc_server::buffer_clear(const rpc_msg_buffer_clear_req & request) {
         GGML_LOG_ERROR("[%s] buffer not found\n", __func__);
         return false;
     }
-    ggml_backend_buffer_clear(buffer, request.value);
+    sched->run(buffer_device(buffer), [buffer, &request] { ggml_backend_buffer_clear(buffer, request.value); });
     return true;
 }
 
@@ -1092,7 +1646,21 @@ ggml_tensor * rpc_server::deserialize_tensor(struct ggml_context * ctx, const rp
         return nullptr;
     }
 
+    if (!update_tensor(result, tensor)) {
+        return nullptr;
+    }
+    return result;
+}
+
+// overwrites all fields of an existing tensor except for src and view_src
+bool rpc_server::update_tensor(ggml_tensor * result, const rpc_tensor * tensor) {
+    if (tensor->type >= GGML_TYPE_COUNT) {
+        GGML_LOG_ERROR("[%s] invalid tensor type received: %u\n", __func__, tensor->type);
+        return false;
+    }
+    result->type = (ggml_type) tensor->type;
     for (uint32_t i = 0; i < GGML_MAX_DIMS; i++) {
+        result->ne[i] = tensor->ne[i];
         result->nb[i] = tensor->nb[i];
     }
     result->buffer = reinterpret_cast<ggml_backend_buffer_t>(tensor->buffer);
@@ -1116,7 +1684,7 @@ ggml_tensor * rpc_server::deserialize_tensor(struct ggml_context * ctx, const rp
     result->flags = tensor->flags;
     result->data = reinterpret_cast<void *>(tensor->data);
     ggml_set_name(result, tensor->name);
-    return result;
+    return true;
 }
 
 
@@ -1129,21 +1697,25 @@ bool rpc_server::set_tensor(const std::vector<uint8_t> & input) {
     uint64_t offset;
     memcpy(&offset, input.data() + sizeof(rpc_tensor), sizeof(offset));
     const size_t size = input.size() - sizeof(rpc_tensor) - sizeof(offset);
+    const void * data = input.data() + sizeof(rpc_tensor) + sizeof(offset);
+    return set_tensor_data(in_tensor, offset, data, size);
+}
 
-    struct ggml_init_params params {
-        /*.mem_size   =*/ ggml_tensor_overhead(),
-        /*.mem_buffer =*/ NULL,
-        /*.no_alloc   =*/ true,
-    };
-    ggml_context_ptr ctx_ptr { ggml_init(params) };
-    GGML_ASSERT(ctx_ptr != nullptr);
-    ggml_context * ctx = ctx_ptr.get();
+bool rpc_server::set_tensor_shm(const rpc_msg_set_tensor_shm_req & request) {
+    if (shm_ptr == nullptr || request.size > shm_size) {
+        GGML_LOG_ERROR("[%s] shared memory not attached or size %" PRIu64 " too large\n", __func__, request.size);
+        return false;
+    }
+    return set_tensor_data(&request.tensor, request.offset, shm_ptr, request.size);
+}
+
+ggml_tensor * rpc_server::deserialize_tensor_region(struct ggml_context * ctx, const rpc_tensor * in_tensor, uint64_t offset, uint64_t size) {
     ggml_tensor * tensor = deserialize_tensor(ctx, in_tensor);
     if (tensor == nullptr || tensor->buffer == nullptr) {
         GGML_LOG_ERROR("[%s] error deserializing tensor\n", __func__);
-        return false;
+        return nullptr;
     }
-    LOG_DBG("[%s] buffer: %p, data: %p, offset: %" PRIu64 ", size: %zu\n", __func__, (void*)tensor->buffer, tensor->data, offset, size);
+    LOG_DBG("[%s] buffer: %p, data: %p, offset: %" PRIu64 ", size: %" PRIu64 "\n", __func__, (void*)tensor->buffer, tensor->data, offset, size);
 
     // sanitize tensor->data
     {
@@ -1151,24 +1723,51 @@ bool rpc_server::set_tensor(const std::vector<uint8_t> & input) {
         const size_t p1 = p0 + ggml_backend_buffer_get_size(tensor->buffer);
 
         if (in_tensor->data + offset < p0 || in_tensor->data + offset >= p1 || size > (p1 - in_tensor->data - offset)) {
-            GGML_LOG_ERROR("[%s] tensor data region (data=0x%" PRIx64 ", offset=%" PRIu64 ", size=%zu) out of buffer bounds [0x%zx, 0x%zx)\n",
+            GGML_LOG_ERROR("[%s] tensor data region (data=0x%" PRIx64 ", offset=%" PRIu64 ", size=%" PRIu64 ") out of buffer bounds [0x%zx, 0x%zx)\n",
                            __func__, in_tensor->data, offset, size, p0, p1);
-            return false;
+            return nullptr;
         }
     }
+    return tensor;
+}
+
+bool rpc_server::set_tensor_data(const rpc_tensor * in_tensor, uint64_t offset, const void * data, size_t size) {
+    struct ggml_init_params params {
+        /*.mem_size   =*/ ggml_tensor_overhead(),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    ggml_context_ptr ctx_ptr { ggml_init(params) };
+    GGML_ASSERT(ctx_ptr != nullptr);
+    ggml_context * ctx = ctx_ptr.get();
+    ggml_tensor * tensor = deserialize_tensor_region(ctx, in_tensor, offset, size);
+    if (tensor == nullptr) {
+        return false;
+    }
 
-    const void * data = input.data() + sizeof(rpc_tensor) + sizeof(offset);
     if (cache_dir && size > HASH_THRESHOLD) {
         uint64_t hash = fnv_hash((const uint8_t*)data, size);
         char hash_str[17];
         snprintf(hash_str, sizeof(hash_str), "%016" PRIx64, hash);
         // save to cache_dir/hash_str
         fs::path cache_file = fs::path(cache_dir) / hash_str;
-        std::ofstream ofs(cache_file, std::ios::binary);
-        ofs.write((const char *)data, size);
-        GGML_LOG_INFO("[%s] saved to '%s'\n", __func__, cache_file.c_str());
+        // other clients may read the same file concurrently, write it under a temporary name first
+        std::ostringstream tmp_name;
+        tmp_name << hash_str << ".tmp." << std::this_thread::get_id();
+        fs::path tmp_file = fs::path(cache_dir) / tmp_name.str();
+        {
+            std::ofstream ofs(tmp_file, std::ios::binary);
+            ofs.write((const char *)data, size);
+        }
+        std::error_code ec;
+        fs::rename(tmp_file, cache_file, ec);
+        if (ec) {
+            fs::remove(tmp_file, ec);
+        } else {
+            GGML_LOG_INFO("[%s] saved to '%s'\n", __func__, cache_file.c_str());
+        }
     }
-    ggml_backend_tensor_set(tensor, data, offset, size);
+    sched->run(buffer_device(tensor->buffer), [=] { ggml_backend_tensor_set(tensor, data, offset, size); });
     return true;
 }
 
@@ -1228,7 +1827,7 @@ bool rpc_server::set_tensor_hash(const rpc_msg_set_tensor_hash_req & request, rp
             return false;
         }
     }
-    ggml_backend_tensor_set(tensor, cached_file.data(), request.offset, size);
+    sched->run(buffer_device(tensor->buffer), [&] { ggml_backend_tensor_set(tensor, cached_file.data(), request.offset, size); });
     response.result = 1;
     return true;
 }
@@ -1251,7 +1850,7 @@ bool rpc_server::init_tensor(const rpc_msg_init_tensor_req & request) {
     // Call the backend's buffer_init_tensor function
     ggml_backend_buffer_t buffer = tensor->buffer;
     if (buffer && buffer->iface.init_tensor) {
-        buffer->iface.init_tensor(buffer, tensor);
+        sched->run(buffer_device(buffer), [buffer, tensor] { buffer->iface.init_tensor(buffer, tensor); });
     } else {
         GGML_LOG_ERROR("Null buffer for tensor passed to init_tensor function\n");
     }
@@ -1275,29 +1874,67 @@ bool rpc_server::get_tensor(const rpc_msg_get_tensor_req & request, std::vector<
     ggml_context_ptr ctx_ptr { ggml_init(params) };
     GGML_ASSERT(ctx_ptr != nullptr);
     ggml_context * ctx = ctx_ptr.get();
-    ggml_tensor * tensor = deserialize_tensor(ctx, &request.tensor);
-    if (tensor == nullptr || tensor->buffer == nullptr) {
-        GGML_LOG_ERROR("[%s] error deserializing tensor\n", __func__);
+    ggml_tensor * tensor = deserialize_tensor_region(ctx, &request.tensor, request.offset, request.size);
+    if (tensor == nullptr) {
         return false;
     }
-    LOG_DBG("[%s] buffer: %p, data: %p, offset: %" PRIu64 ", size: %" PRIu64 "\n", __func__, (void*)tensor->buffer, tensor->data, request.offset, request.size);
 
-    // sanitize tensor->data
-    {
-        const size_t p0 = (size_t) ggml_backend_buffer_get_base(tensor->buffer);
-        const size_t p1 = p0 + ggml_backend_buffer_get_size(tensor->buffer);
+    response.resize(request.size, 0);
+    sched->run(buffer_device(tensor->buffer), [&] { ggml_backend_tensor_get(tensor, response.data(), request.offset, request.size); });
+    return true;
+}
 
-        if (request.tensor.data + request.offset < p0 ||
-            request.tensor.data + request.offset >= p1 ||
-            request.size > (p1 - request.tensor.data - request.offset)) {
-                GGML_LOG_ERROR("[%s] requested tensor region (data=0x%" PRIx64 ", offset=%" PRIu64 ", size=%" PRIu64 ") out of buffer bounds [0x%zx, 0x%zx)\n",
-                               __func__, request.tensor.data, request.offset, request.size, p0, p1);
-                return false;
-        }
+bool rpc_server::get_tensor_shm(const rpc_msg_get_tensor_req & request) {
+    if (shm_ptr == nullptr || request.size > shm_size) {
+        GGML_LOG_ERROR("[%s] shared memory not attached or size %" PRIu64 " too large\n", __func__, request.size);
+        return false;
+    }
+    struct ggml_init_params params {
+        /*.mem_size   =*/ ggml_tensor_overhead(),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    ggml_context_ptr ctx_ptr { ggml_init(params) };
+    GGML_ASSERT(ctx_ptr != nullptr);
+    ggml_context * ctx = ctx_ptr.get();
+    ggml_tensor * tensor = deserialize_tensor_region(ctx, &request.tensor, request.offset, request.size);
+    if (tensor == nullptr) {
+        return false;
     }
+    sched->run(buffer_device(tensor->buffer), [&] { ggml_backend_tensor_get(tensor, shm_ptr, request.offset, request.size); });
+    return true;
+}
 
-    response.resize(request.size, 0);
-    ggml_backend_tensor_get(tensor, response.data(), request.offset, request.size);
+bool rpc_server::shm_attach(const rpc_msg_shm_attach_req & request, rpc_msg_shm_attach_rsp & response) {
+    response.result = 0;
+#ifndef _WIN32
+    if (!local_peer || shm_ptr != nullptr || memchr(request.name, 0, sizeof(request.name)) == nullptr) {
+        return true;
+    }
+    int fd = shm_open(request.name, O_RDWR, 0);
+    if (fd < 0) {
+        GGML_LOG_ERROR("[%s] failed to open shared memory '%s'\n", __func__, request.name);
+        return true;
+    }
+    // only map objects created by the client's user, not any object the server can open
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        GGML_LOG_ERROR("[%s] failed to stat shared memory '%s'\n", __func__, request.name);
+    } else if (st.st_uid != peer_uid) {
+        GGML_LOG_ERROR("[%s] shared memory '%s' is not owned by the client\n", __func__, request.name);
+    } else if ((uint64_t) st.st_size >= request.size) {
+        void * ptr = mmap(nullptr, request.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED) {
+            shm_ptr = ptr;
+            shm_size = request.size;
+            response.result = 1;
+        }
+    }
+    close(fd);
+    LOG_DBG("[%s] name: %s, size: %" PRIu64 ", result: %u\n", __func__, request.name, request.size, response.result);
+#else
+    GGML_UNUSED(request);
+#endif
     return true;
 }
 
@@ -1338,7 +1975,8 @@ bool rpc_server::copy_tensor(const rpc_msg_copy_tensor_req & request, rpc_msg_co
     LOG_DBG("[%s] src->buffer: %p, dst->buffer: %p\n",
             __func__, (void*) src->buffer, (void*) dst->buffer);
 
-    response.result = ggml_backend_buffer_copy_tensor(src, dst);
+    // a copy between devices is serialized with the destination, which it writes
+    response.result = sched->run(buffer_device(dst->buffer), [src, dst] { return ggml_backend_buffer_copy_tensor(src, dst); });
     return true;
 }
 
@@ -1394,13 +2032,13 @@ ggml_tensor * rpc_server::create_node(uint64_t id,
     return result;
 }
 
-bool rpc_server::graph_compute(const std::vector<uint8_t> & input, rpc_msg_graph_compute_rsp & response) {
+bool rpc_server::deserialize_graph(const uint8_t * data, size_t size, stored_graph & result) {
     // serialization format:
     // | device (4 bytes) | n_nodes (4 bytes) | nodes (n_nodes * sizeof(uint64_t) | n_tensors (4 bytes) | tensors (n_tensors * sizeof(rpc_tensor)) |
-    if (input.size() < 2*sizeof(uint32_t)) {
+    if (size < 2*sizeof(uint32_t)) {
         return false;
     }
-    const uint8_t * src = input.data();
+    const uint8_t * src = data;
     uint32_t device;
     memcpy(&device, src, sizeof(device));
     src += sizeof(device);
@@ -1410,7 +2048,7 @@ bool rpc_server::graph_compute(const std::vector<uint8_t> & input, rpc_msg_graph
     uint32_t n_nodes;
     memcpy(&n_nodes, src, sizeof(n_nodes));
     src += sizeof(n_nodes);
-    if (input.size() < 2*sizeof(uint32_t) + n_nodes*sizeof(uint64_t) + sizeof(uint32_t)) {
+    if (size < 2*sizeof(uint32_t) + n_nodes*sizeof(uint64_t) + sizeof(uint32_t)) {
         return false;
     }
     const uint64_t * nodes = (const uint64_t *)src;
@@ -1418,7 +2056,7 @@ bool rpc_server::graph_compute(const std::vector<uint8_t> & input, rpc_msg_graph
     uint32_t n_tensors;
     memcpy(&n_tensors, src, sizeof(n_tensors));
     src += sizeof(n_tensors);
-    if (input.size() < 2*sizeof(uint32_t) + n_nodes*sizeof(uint64_t) + sizeof(uint32_t) + n_tensors*sizeof(rpc_tensor)) {
+    if (size < 2*sizeof(uint32_t) + n_nodes*sizeof(uint64_t) + sizeof(uint32_t) + n_tensors*sizeof(rpc_tensor)) {
         return false;
     }
     const rpc_tensor * tensors = (const rpc_tensor *)src;
@@ -1431,16 +2069,19 @@ bool rpc_server::graph_compute(const std::vector<uint8_t> & input, rpc_msg_graph
         /*.mem_buffer =*/ NULL,
         /*.no_alloc   =*/ true,
     };
-    ggml_context_ptr ctx_ptr { ggml_init(params) };
-    GGML_ASSERT(ctx_ptr != nullptr);
-    ggml_context * ctx = ctx_ptr.get();
+    result.device = device;
+    result.ctx.reset(ggml_init(params));
+    GGML_ASSERT(result.ctx != nullptr);
+    ggml_context * ctx = result.ctx.get();
     struct ggml_cgraph * graph = ggml_new_graph_custom(ctx, n_nodes, false);
     graph->n_nodes = n_nodes;
+    result.graph = graph;
     std::unordered_map<uint64_t, const rpc_tensor*> tensor_ptrs;
     for (uint32_t i = 0; i < n_tensors; i++) {
         tensor_ptrs[tensors[i].id] = &tensors[i];
     }
-    std::unordered_map<uint64_t, ggml_tensor*> tensor_map;
+    std::unordered_map<uint64_t, ggml_tensor*> & tensor_map = result.tensor_map;
+    tensor_map.clear();
     for (uint32_t i = 0; i < n_nodes; i++) {
         int64_t id;
         memcpy(&id, &nodes[i], sizeof(id));
@@ -1454,7 +2095,116 @@ bool rpc_server::graph_compute(const std::vector<uint8_t> & input, rpc_msg_graph
             return false;
         }
     }
-    ggml_status status = ggml_backend_graph_compute(backends[device], graph);
+    result.tensors.resize(n_tensors);
+    for (uint32_t i = 0; i < n_tensors; i++) {
+        auto it = tensor_map.find(tensors[i].id);
+        result.tensors[i] = it != tensor_map.end() ? it->second : nullptr;
+    }
+    return true;
+}
+
+bool rpc_server::graph_compute(const std::vector<uint8_t> & input, rpc_msg_graph_compute_rsp & response) {
+    stored_graph graph;
+    if (!deserialize_graph(input.data(), input.size(), graph)) {
+        return false;
+    }
+    ggml_status status = sched->compute(graph.device, backends[graph.device], graph.graph);
+    response.result = status;
+    return true;
+}
+
+bool rpc_server::graph_compute_store(const std::vector<uint8_t> & input, rpc_msg_graph_compute_rsp & response) {
+    // serialization format:
+    // | graph_id (8 bytes) | graph (see deserialize_graph) |
+    if (input.size() < sizeof(uint64_t)) {
+        return false;
+    }
+    uint64_t graph_id;
+    memcpy(&graph_id, input.data(), sizeof(graph_id));
+    graphs.erase(graph_id);
+    stored_graph graph;
+    if (!deserialize_graph(input.data() + sizeof(uint64_t), input.size() - sizeof(uint64_t), graph)) {
+        return false;
+    }
+    ggml_status status = sched->compute(graph.device, backends[graph.device], graph.graph);
+    response.result = status;
+    graphs[graph_id] = std::move(graph);
+    return true;
+}
+
+bool rpc_server::graph_compute_delta(const std::vector<uint8_t> & input, rpc_msg_graph_compute_delta_rsp & response, uint64_t & graph_id) {
+    // serialization format:
+    // | graph_id (8 bytes) | n_changed (4 bytes) | changed (n_changed * (index (4 bytes) + rpc_tensor)) |
+    if (input.size() < sizeof(uint64_t) + sizeof(uint32_t)) {
+        return false;
+    }
+    const uint8_t * src = input.data();
+    memcpy(&graph_id, src, sizeof(graph_id));
+    src += sizeof(graph_id);
+    uint32_t n_changed;
+    memcpy(&n_changed, src, sizeof(n_changed));
+    src += sizeof(n_changed);
+    const size_t entry_size = sizeof(uint32_t) + sizeof(rpc_tensor);
+    if (input.size() < sizeof(uint64_t) + sizeof(uint32_t) + n_changed*entry_size) {
+        return false;
+    }
+    auto it = graphs.find(graph_id);
+    if (it == graphs.end()) {
+        response.found = 0;
+        return true;
+    }
+    stored_graph & graph = it->second;
+    LOG_DBG("[%s] graph_id: %" PRIu64 ", n_changed: %u\n", __func__, graph_id, n_changed);
+
+    auto find_tensor = [&graph](uint64_t id, ggml_tensor ** result) {
+        if (id == 0) {
+            *result = nullptr;
+            return true;
+        }
+        auto t = graph.tensor_map.find(id);
+        if (t == graph.tensor_map.end()) {
+            return false;
+        }
+        *result = t->second;
+        return true;
+    };
+    for (uint32_t i = 0; i < n_changed; i++) {
+        uint32_t index;
+        rpc_tensor tensor;
+        memcpy(&index, src, sizeof(index));
+        memcpy(&tensor, src + sizeof(index), sizeof(tensor));
+        src += entry_size;
+        if (index >= graph.tensors.size() || graph.tensors[index] == nullptr ||
+            graph.tensor_map.find(tensor.id) == graph.tensor_map.end() || graph.tensor_map[tensor.id] != graph.tensors[index]) {
+            GGML_LOG_ERROR("[%s] tensor %u does not match the stored graph\n", __func__, index);
+            graphs.erase(it);
+            response.found = 0;
+            return true;
+        }
+        ggml_tensor * result = graph.tensors[index];
+        bool ok = update_tensor(result, &tensor) && find_tensor(tensor.view_src, &result->view_src);
+        for (int j = 0; ok && j < GGML_MAX_SRC; j++) {
+            ok = find_tensor(tensor.src[j], &result->src[j]);
+        }
+        if (!ok) {
+            GGML_LOG_ERROR("[%s] failed to update tensor %u\n", __func__, index);
+            graphs.erase(it);
+            response.found = 0;
+            return true;
+        }
+        result->view_offs = tensor.view_offs;
+    }
+    response.found = 1;
+    return true;
+}
+
+bool rpc_server::graph_compute_stored(uint64_t graph_id, rpc_msg_graph_compute_rsp & response) {
+    auto it = graphs.find(graph_id);
+    if (it == graphs.end()) {
+        return false;
+    }
+    stored_graph & graph = it->second;
+    ggml_status status = sched->compute(graph.device, backends[graph.device], graph.graph);
     response.result = status;
     return true;
 }
@@ -1477,11 +2227,24 @@ rpc_server::~rpc_server() {
     for (auto buffer : buffers) {
         ggml_backend_buffer_free(buffer);
     }
+#ifndef _WIN32
+    if (shm_ptr) {
+        munmap(shm_ptr, shm_size);
+    }
+#endif
 }
 
-static void rpc_serve_client(const std::vector<ggml_backend_t> & backends, const char * cache_dir,
-                             sockfd_t sockfd) {
-    rpc_server server(backends, cache_dir);
+static void rpc_serve_client(const std::vector<ggml_backend_t> & backends, std::shared_ptr<rpc_compute_sched> sched,
+                             const char * cache_dir, sockfd_t sockfd, bool is_unix) {
+    rpc_server server(backends, std::move(sched), cache_dir);
+#ifndef _WIN32
+    uid_t peer_uid;
+    if (is_unix && socket_peer_uid(sockfd, peer_uid)) {
+        server.set_local_peer(peer_uid);
+    }
+#else
+    GGML_UNUSED(is_unix);
+#endif
     uint8_t cmd;
     if (!recv_data(sockfd, &cmd, 1)) {
         return;
@@ -1508,6 +2271,11 @@ static void rpc_serve_client(const std::vector<ggml_backend_t> & backends, const
             GGML_LOG_ERROR("Unknown command: %d\n", cmd);
             break;
         }
+        if ((cmd == RPC_CMD_SHM_ATTACH || cmd == RPC_CMD_SET_TENSOR_SHM || cmd == RPC_CMD_GET_TENSOR_SHM) && !server.is_local_peer()) {
+            // shared memory is local to the host, a TCP peer must not map or access it
+            GGML_LOG_ERROR("Shared memory command %d on a non-local connection\n", cmd);
+            break;
+        }
         switch (cmd) {
             case RPC_CMD_HELLO: {
                 // HELLO command is handled above
@@ -1699,6 +2467,84 @@ static void rpc_serve_client(const std::vector<ggml_backend_t> & backends, const
                 }
                 break;
             }
+            case RPC_CMD_GRAPH_COMPUTE_STORE: {
+                std::vector<uint8_t> input;
+                if (!recv_msg(sockfd, input)) {
+                    return;
+                }
+                rpc_msg_graph_compute_rsp response;
+                if (!server.graph_compute_store(input, response)) {
+                    return;
+                }
+                if (!send_msg(sockfd, &response, sizeof(response))) {
+                    return;
+                }
+                break;
+            }
+            case RPC_CMD_GRAPH_COMPUTE_DELTA: {
+                std::vector<uint8_t> input;
+                if (!recv_msg(sockfd, input)) {
+                    return;
+                }
+                rpc_msg_graph_compute_delta_rsp response;
+                uint64_t graph_id;
+                if (!server.graph_compute_delta(input, response, graph_id)) {
+                    return;
+                }
+                if (!send_msg(sockfd, &response, sizeof(response))) {
+                    return;
+                }
+                if (response.found) {
+                    rpc_msg_graph_compute_rsp compute_response;
+                    if (!server.graph_compute_stored(graph_id, compute_response)) {
+                        return;
+                    }
+                    if (!send_msg(sockfd, &compute_response, sizeof(compute_response))) {
+                        return;
+                    }
+                }
+                break;
+            }
+            case RPC_CMD_SHM_ATTACH: {
+                rpc_msg_shm_attach_req request;
+                if (!recv_msg(sockfd, &request, sizeof(request))) {
+                    return;
+                }
+                rpc_msg_shm_attach_rsp response;
+                if (!server.shm_attach(request, response)) {
+                    return;
+                }
+                if (!send_msg(sockfd, &response, sizeof(response))) {
+                    return;
+                }
+                break;
+            }
+            case RPC_CMD_SET_TENSOR_SHM: {
+                rpc_msg_set_tensor_shm_req request;
+                if (!recv_msg(sockfd, &request, sizeof(request))) {
+                    return;
+                }
+                if (!server.set_tensor_shm(request)) {
+                    return;
+                }
+                if (!send_msg(sockfd, nullptr, 0)) {
+                    return;
+                }
+                break;
+            }
+            case RPC_CMD_GET_TENSOR_SHM: {
+                rpc_msg_get_tensor_req request;
+                if (!recv_msg(sockfd, &request, sizeof(request))) {
+                    return;
+                }
+                if (!server.get_tensor_shm(request)) {
+                    return;
+                }
+                if (!send_msg(sockfd, nullptr, 0)) {
+                    return;
+                }
+                break;
+            }
             case RPC_CMD_GET_DEVICE_MEMORY: {
                 rpc_msg_get_device_memory_req request;
                 if (!recv_msg(sockfd, &request, sizeof(request))) {
@@ -1757,11 +2603,17 @@ void ggml_backend_rpc_start_server(const char * endpoint, const char * cache_dir
     }
 
     std::string host;
-    int port;
-    if (!parse_endpoint(endpoint, host, port)) {
+    int port = 0;
+    std::string unix_path;
+    bool is_unix = parse_unix_endpoint(endpoint, unix_path);
+    if (!is_unix && !parse_endpoint(endpoint, host, port)) {
         return;
     }
 #ifdef _WIN32
+    if (is_unix) {
+        fprintf(stderr, "Unix domain socket endpoints are not supported on Windows\n");
+        return;
+    }
     {
         WSADATA wsaData;
         int res = WSAStartup(MAKEWORD(2, 2), &wsaData);
@@ -1771,22 +2623,59 @@ void ggml_backend_rpc_start_server(const char * endpoint, const char * cache_dir
         }
     }
 #endif
+#ifdef _WIN32
     auto server_socket = create_server_socket(host.c_str(), port);
+#else
+    auto server_socket = is_unix ? create_server_socket_unix(unix_path.c_str()) : create_server_socket(host.c_str(), port);
+#endif
     if (server_socket == nullptr) {
         fprintf(stderr, "Failed to create server socket\n");
         return;
     }
+    // each client is served on its own thread and owns the buffers it allocates,
+    // graph computations on the shared backends are scheduled by rpc_compute_sched
+    // the client threads are joined before the backends they use are freed
+    struct client_thread {
+        std::shared_ptr<socket_t>          sock;
+        std::shared_ptr<std::atomic<bool>> done;
+        std::thread                        thread;
+    };
+    auto sched = std::make_shared<rpc_compute_sched>(backends.size());
+    auto n_clients = std::make_shared<std::atomic<int>>(0);
+    std::vector<client_thread> clients;
     while (true) {
-        auto client_socket = socket_accept(server_socket->fd);
+        auto client_socket = socket_accept(server_socket->fd, !is_unix);
         if (client_socket == nullptr) {
             fprintf(stderr, "Failed to accept client connection\n");
-            return;
+            break;
         }
-        printf("Accepted client connection\n");
-        fflush(stdout);
-        rpc_serve_client(backends, cache_dir, client_socket->fd);
-        printf("Client connection closed\n");
+        for (auto it = clients.begin(); it != clients.end();) {
+            if (it->done->load()) {
+                it->thread.join();
+                it = clients.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        printf("Accepted client connection (%d active)\n", ++*n_clients);
         fflush(stdout);
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        std::thread thread([backends, sched, cache_dir, client_socket, n_clients, is_unix, done]() {
+            rpc_serve_client(backends, sched, cache_dir, client_socket->fd, is_unix);
+            printf("Client connection closed (%d active)\n", --*n_clients);
+            fflush(stdout);
+            done->store(true);
+        });
+        clients.push_back({ client_socket, done, std::move(thread) });
+    }
+    // unblock the clients waiting for commands, their threads then return
+    for (auto & client : clients) {
+#ifdef _WIN32
+        shutdown(client.sock->fd, SD_BOTH);
+#else
+        shutdown(client.sock->fd, SHUT_RDWR);
+#endif
+        client.thread.join();
     }
 #ifdef _WIN32
     WSACleanup();
@@ -1836,10 +2725,10 @@ static void ggml_backend_rpc_device_get_props(ggml_backend_dev_t dev, struct ggm
     props->type        = ggml_backend_rpc_device_get_type(dev);
     ggml_backend_rpc_device_get_memory(dev, &props->memory_free, &props->memory_total);
     props->caps = {
-        /* .async                 = */ false,
+        /* .async                 = */ true,
         /* .host_buffer           = */ false,
         /* .buffer_from_host_ptr  = */ false,
-        /* .events                = */ false,
+        /* .events                = */ true,
     };
 }
 
@@ -1866,6 +2755,30 @@ static bool ggml_backend_rpc_device_supports_op(ggml_backend_dev_t dev, const st
     return true;
 }
 
+static ggml_backend_event_t ggml_backend_rpc_device_event_new(ggml_backend_dev_t dev) {
+    return new ggml_backend_event {
+        /* .device  = */ dev,
+        /* .context = */ new ggml_backend_rpc_event_context { nullptr, 0 },
+    };
+}
+
+static void ggml_backend_rpc_device_event_free(ggml_backend_dev_t dev, ggml_backend_event_t event) {
+    delete (ggml_backend_rpc_event_context *)event->context;
+    delete event;
+
+    GGML_UNUSED(dev);
+}
+
+static void ggml_backend_rpc_device_event_synchronize(ggml_backend_dev_t dev, ggml_backend_event_t event) {
+    ggml_backend_rpc_event_context * event_ctx = (ggml_backend_rpc_event_context *)event->context;
+    if (event_ctx->sock != nullptr) {
+        bool status = recv_async_rsp(event_ctx->sock, event_ctx->n_async);
+        RPC_STATUS_ASSERT(status);
+    }
+
+    GGML_UNUSED(dev);
+}
+
 static bool ggml_backend_rpc_device_supports_buft(ggml_backend_dev_t dev, ggml_backend_buffer_type_t buft) {
     if (!buft || buft->iface.get_name != ggml_backend_rpc_buffer_type_name) {
         return false;
@@ -1888,9 +2801,9 @@ static const struct ggml_backend_device_i ggml_backend_rpc_device_i = {
     /* .supports_op          = */ ggml_backend_rpc_device_supports_op,
     /* .supports_buft        = */ ggml_backend_rpc_device_supports_buft,
     /* .offload_op           = */ NULL,
-    /* .event_new            = */ NULL,
-    /* .event_free           = */ NULL,
-    /* .event_synchronize    = */ NULL,
+    /* .event_new            = */ ggml_backend_rpc_device_event_new,
+    /* .event_free           = */ ggml_backend_rpc_device_event_free,
+    /* .event_synchronize    = */ ggml_backend_rpc_device_event_synchronize,
 };
 
 // backend reg interface
@@ -1814,10 +1814,75 @@ struct ggml_tensor * ggml_set_name(struct ggml_tensor * tensor, const char * nam
     return tensor;
 }
 
+// tensor names are formatted for almost every node while building a graph and vsnprintf dominates the build time,
+// so the formats used by ggml and llama.cpp ("%s-%d", "%s (view)", "node_%d", ...) are handled without it
+static bool ggml_format_name_is_simple(const char * fmt) {
+    for (const char * p = fmt; *p; p++) {
+        if (*p == '%') {
+            p++;
+            if (*p != 's' && *p != 'd' && *p != 'i' && *p != '%') {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void ggml_format_name_simple(char * buf, size_t size, const char * fmt, va_list args) {
+    char * out = buf;
+    char * const end = buf + size - 1;
+
+    for (const char * p = fmt; *p && out < end; p++) {
+        if (*p != '%') {
+            *out++ = *p;
+            continue;
+        }
+
+        p++;
+
+        if (*p == '%') {
+            *out++ = '%';
+        } else if (*p == 's') {
+            const char * str = va_arg(args, const char *);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            while (*str && out < end) {
+                *out++ = *str++;
+            }
+        } else {
+            const int val = va_arg(args, int);
+
+            char tmp[16];
+            int  len = 0;
+
+            unsigned int u = val < 0 ? 0u - (unsigned int) val : (unsigned int) val;
+            do {
+                tmp[len++] = (char) ('0' + u % 10);
+                u /= 10;
+            } while (u > 0);
+
+            if (val < 0) {
+                tmp[len++] = '-';
+            }
+
+            while (len > 0 && out < end) {
+                *out++ = tmp[--len];
+            }
+        }
+    }
+
+    *out = '\0';
+}
+
 struct ggml_tensor * ggml_format_name(struct ggml_tensor * tensor, const char * fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    vsnprintf(tensor->name, sizeof(tensor->name), fmt, args);
+    if (ggml_format_name_is_simple(fmt)) {
+        ggml_format_name_simple(tensor->name, sizeof(tensor->name), fmt, args);
+    } else {
+        vsnprintf(tensor->name, sizeof(tensor->name), fmt, args);
+    }
     va_end(args);
     return tensor;
 }
@@ -6530,7 +6595,7 @@ static size_t ggml_visit_parents(struct ggml_cgraph * cgraph, struct ggml_tensor
         // reached a leaf node, not part of the gradient graph (e.g. a constant)
         GGML_ASSERT(cgraph->n_leafs < cgraph->size);
 
-        if (strlen(node->name) == 0) {
+        if (node->name[0] == '\0') {
             ggml_format_name(node, "leaf_%d", cgraph->n_leafs);
         }
 
@@ -6539,7 +6604,7 @@ static size_t ggml_visit_parents(struct ggml_cgraph * cgraph, struct ggml_tensor
     } else {
         GGML_ASSERT(cgraph->n_nodes < cgraph->size);
 
-        if (strlen(node->name) == 0) {
+        if (node->name[0] == '\0') {
             ggml_format_name(node, "node_%d", cgraph->n_nodes);
         }
 
@@ -6630,6 +6695,14 @@ void ggml_build_backward_expand(
                 ignore_src[1] = true;
                 break;
 
+            // like CPY the result of SET_ROWS is only used to store values (e.g. in the KV cache),
+            // the values are read back through separate views of the target, so no gradient reaches
+            // what produced them (llama_adapter_lora_init_empty does not adapt the K and V projections)
+            case GGML_OP_SET_ROWS:
+                ignore_src[0] = true;
+                ignore_src[1] = true;
+                break;
+
             default:
                 break;
         }
@@ -7230,6 +7303,10 @@ void ggml_set_loss(struct ggml_tensor * tensor) {
     tensor->flags |= GGML_TENSOR_FLAG_LOSS;
 }
 
+void ggml_set_checkpoint(struct ggml_tensor * tensor) {
+    tensor->flags |= GGML_TENSOR_FLAG_CHECKPOINT;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void ggml_quantize_init(enum ggml_type type) {
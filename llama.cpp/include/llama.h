@@ -565,6 +565,20 @@ extern "C" {
             struct llama_model * model,
             const char * path_lora);
 
+    // Create a LoRA adapter for training with rank x n matrices for the 2D weights of the repeating layers
+    // The self-attention K and V projections are not adapted, no gradient reaches them through the KV cache
+    // lora_a is initialized randomly and lora_b with zeros, so the new adapter does not change the model output
+    LLAMA_API struct llama_adapter_lora * llama_adapter_lora_init_empty(
+            struct llama_model * model,
+            int32_t rank,
+            float alpha);
+
+    // Save a LoRA adapter (e.g. after training it) to a file that can be loaded with llama_adapter_lora_init
+    // Returns false on failure
+    LLAMA_API bool llama_adapter_lora_save(
+            const struct llama_adapter_lora * adapter,
+            const char * path_lora);
+
     // Functions to access the adapter's GGUF metadata scalar values
     // - The functions return the length of the string on success, or -1 on failure
     // - The output string is always null-terminated and cleared on failure
@@ -1352,6 +1366,13 @@ extern "C" {
         int32_t n_reused;   // number of times a ggml compute graph had been reused
     };
 
+    // returned by a separate call, so that the size of llama_perf_context_data stays the same
+    struct llama_perf_graph_data {
+        double t_graph_ms;  // time needed for building compute graphs (included in the eval times)
+
+        int32_t n_graph;    // number of times a ggml compute graph had been built
+    };
+
     struct llama_perf_sampler_data {
         double t_sample_ms; // time needed for sampling in ms
 
@@ -1359,6 +1380,7 @@ extern "C" {
     };
 
     LLAMA_API struct llama_perf_context_data llama_perf_context      (const struct llama_context * ctx);
+    LLAMA_API struct llama_perf_graph_data   llama_perf_graph        (const struct llama_context * ctx);
     LLAMA_API void                           llama_perf_context_print(const struct llama_context * ctx);
     LLAMA_API void                           llama_perf_context_reset(      struct llama_context * ctx);
 
@@ -1370,6 +1392,42 @@ extern "C" {
     // print a breakdown of per-device memory use via LLAMA_LOG:
     LLAMA_API void llama_memory_breakdown_print(const struct llama_context * ctx);
 
+    // memory used by a buffer type, in bytes
+    struct llama_memory_breakdown_entry {
+        ggml_backend_buffer_type_t buft;
+
+        size_t model;   // model weights, including repacked weights
+        size_t context; // KV cache, recurrent states and output buffer
+        size_t compute; // temporary compute buffers
+    };
+
+    // plan the memory that a context created with the given params would use, without allocating its buffers
+    // the model weights are reported as currently loaded
+    // writes up to n_entries entries, returns the number of buffer types or -1 if the context cannot be created
+    LLAMA_API int32_t llama_memory_plan(
+            const struct llama_model * model,
+            struct llama_context_params params,
+            struct llama_memory_breakdown_entry * entries,
+            int32_t n_entries);
+
+    // memory currently used by the context and its model, same format as llama_memory_plan
+    LLAMA_API int32_t llama_memory_breakdown(
+            const struct llama_context * ctx,
+            struct llama_memory_breakdown_entry * entries,
+            int32_t n_entries);
+
+    struct llama_memory_counters {
+        size_t host;          // bytes of buffers in system memory (model, context and compute)
+        size_t device;        // bytes of buffers in device memory
+        size_t repack;        // bytes of model weights repacked into extra buffer types
+        size_t mmap;          // bytes of model files mapped into memory
+        size_t mmap_resident; // bytes of the mapped model files resident in RAM (mincore), 0 if not supported
+        size_t rss_peak;      // peak resident set size of the process, 0 if not supported
+    };
+
+    // live memory counters of a running context
+    LLAMA_API struct llama_memory_counters llama_memory_get_counters(const struct llama_context * ctx);
+
     //
     // training
     //
@@ -1384,12 +1442,17 @@ extern "C" {
         uint32_t n_ctx_train; // assumed context size post training, use context size specified in llama_context if 0
 
         llama_opt_param_filter param_filter; // callback for determining which tensors contain trainable parameters
+                                             // the self-attention K and V projections are never trained, no gradient reaches them through the KV cache
         void * param_filter_ud;              // userdata for determining which tensors contain trainable parameters
 
         ggml_opt_get_optimizer_params get_opt_pars; // callback for calculating optimizer parameters
         void * get_opt_pars_ud;                     // userdata for calculating optimizer parameters
 
         enum ggml_opt_optimizer_type optimizer_type;
+
+        struct llama_adapter_lora * adapter; // if not NULL only the tensors of this adapter are trained and the model weights stay frozen
+                                             // the adapter must be set on the context with llama_set_adapter_lora
+        bool checkpointing;                  // only keep the layer outputs for the backward pass and recompute the other activations
     };
 
     LLAMA_API void llama_opt_init(struct llama_context * lctx, struct llama_model * model, struct llama_opt_params lopt_params);
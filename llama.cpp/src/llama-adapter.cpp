@@ -6,6 +6,8 @@
 
 #include <map>
 #include <cassert>
+#include <cmath>
+#include <random>
 #include <sstream>
 #include <stdexcept>
 
@@ -146,6 +148,37 @@ llama_adapter_lora_weight * llama_adapter_lora::get_weight(ggml_tensor * w) {
     return nullptr;
 }
 
+// buffer type for the LoRA tensors of a model weight
+static ggml_backend_buffer_type_t llama_adapter_lora_buft(const ggml_tensor * model_tensor) {
+    auto * buft = ggml_backend_buffer_get_type(model_tensor->buffer);
+
+    // get extra buffer types of the CPU
+    // TODO: a more general solution for non-CPU extra buft should be imlpemented in the future
+    //       ref: https://github.com/ggml-org/llama.cpp/pull/12593#pullrequestreview-2718659948
+    auto * cpu_dev = ggml_backend_dev_by_type(GGML_BACKEND_DEVICE_TYPE_CPU);
+    if (!cpu_dev) {
+        throw std::runtime_error(format("%s: no CPU backend found", __func__));
+    }
+    auto * cpu_reg = ggml_backend_dev_backend_reg(cpu_dev);
+
+    auto ggml_backend_dev_get_extra_bufts_fn = (ggml_backend_dev_get_extra_bufts_t)
+        ggml_backend_reg_get_proc_address(cpu_reg, "ggml_backend_dev_get_extra_bufts");
+
+    if (ggml_backend_dev_get_extra_bufts_fn) {
+        ggml_backend_buffer_type_t * extra_bufts = ggml_backend_dev_get_extra_bufts_fn(cpu_dev);
+        while (extra_bufts && *extra_bufts) {
+            // do not load loras to extra buffer types (i.e. bufts for repacking) -> use the CPU in that case
+            if (*extra_bufts == buft) {
+                LLAMA_LOG_WARN("%s: lora for '%s' cannot use buft '%s', fallback to CPU\n", __func__, model_tensor->name, ggml_backend_buft_name(buft));
+                return ggml_backend_dev_buffer_type(cpu_dev);
+            }
+            ++extra_bufts;
+        }
+    }
+
+    return buft;
+}
+
 static void llama_adapter_lora_init_impl(llama_model & model, const char * path_lora, llama_adapter_lora & adapter) {
     LLAMA_LOG_INFO("%s: loading lora adapter from '%s' ...\n", __func__, path_lora);
 
@@ -293,29 +326,6 @@ static void llama_adapter_lora_init_impl(llama_model & model, const char * path_
         }
     }
 
-    // get extra buffer types of the CPU
-    // TODO: a more general solution for non-CPU extra buft should be imlpemented in the future
-    //       ref: https://github.com/ggml-org/llama.cpp/pull/12593#pullrequestreview-2718659948
-    std::vector<ggml_backend_buffer_type_t> buft_extra;
-    {
-        auto * cpu_dev = ggml_backend_dev_by_type(GGML_BACKEND_DEVICE_TYPE_CPU);
-        if (!cpu_dev) {
-            throw std::runtime_error(format("%s: no CPU backend found", __func__));
-        }
-        auto * cpu_reg = ggml_backend_dev_backend_reg(cpu_dev);
-
-        auto ggml_backend_dev_get_extra_bufts_fn = (ggml_backend_dev_get_extra_bufts_t)
-            ggml_backend_reg_get_proc_address(cpu_reg, "ggml_backend_dev_get_extra_bufts");
-
-        if (ggml_backend_dev_get_extra_bufts_fn) {
-            ggml_backend_buffer_type_t * extra_bufts = ggml_backend_dev_get_extra_bufts_fn(cpu_dev);
-            while (extra_bufts && *extra_bufts) {
-                buft_extra.emplace_back(*extra_bufts);
-                ++extra_bufts;
-            }
-        }
-    }
-
     // add tensors
     for (auto & it : ab_map) {
         const std::string & name = it.first;
@@ -332,22 +342,7 @@ static void llama_adapter_lora_init_impl(llama_model & model, const char * path_
             throw std::runtime_error("LoRA tensor '" + name + "' does not exist in base model (hint: maybe wrong base model?)");
         }
 
-        auto * buft = ggml_backend_buffer_get_type(model_tensor->buffer);
-
-        // do not load loras to extra buffer types (i.e. bufts for repacking) -> use the CPU in that case
-        for (auto & ex : buft_extra) {
-            if (ex == buft) {
-                LLAMA_LOG_WARN("%s: lora for '%s' cannot use buft '%s', fallback to CPU\n", __func__, model_tensor->name, ggml_backend_buft_name(buft));
-
-                auto * cpu_dev = ggml_backend_dev_by_type(GGML_BACKEND_DEVICE_TYPE_CPU);
-                if (!cpu_dev) {
-                    throw std::runtime_error(format("%s: no CPU backend found", __func__));
-                }
-                buft = ggml_backend_dev_buffer_type(cpu_dev);
-
-                break;
-            }
-        }
+        auto * buft = llama_adapter_lora_buft(model_tensor);
 
         LLAMA_LOG_DEBUG("%s: lora for '%s' -> '%s'\n", __func__, model_tensor->name, ggml_backend_buft_name(buft));
 
@@ -429,6 +424,185 @@ llama_adapter_lora * llama_adapter_lora_init(llama_model * model, const char * p
     return nullptr;
 }
 
+static void llama_adapter_lora_init_empty_impl(llama_model & model, int32_t rank, float alpha, llama_adapter_lora & adapter) {
+    if (rank <= 0) {
+        throw std::runtime_error(format("invalid LoRA rank %d", rank));
+    }
+
+    // dense projections of the repeating layers that the graphs multiply through build_lora_mm,
+    // other weights (norms, convolutions, ssm state, experts) never see the adapter
+    // wk and wv are left out: training runs through the KV cache, attention reads K and V back from the cache
+    // and ggml_build_backward_expand does not propagate gradients through the SET_ROWS that stores them,
+    // so their adapters would never train (wqkv is kept, its Q rows still get gradients)
+    std::vector<const ggml_tensor *> targets;
+    for (const llama_layer & layer : model.layers) {
+        const ggml_tensor * projections[] = {
+            // attention
+            layer.wq, layer.wo, layer.wqkv,
+            layer.wq_cross, layer.wk_cross, layer.wv_cross, layer.wo_cross,
+            layer.wq_enc, layer.wk_enc, layer.wv_enc, layer.wo_enc,
+            // ff
+            layer.ffn_gate, layer.ffn_down, layer.ffn_up,
+            layer.ffn_gate_enc, layer.ffn_down_enc, layer.ffn_up_enc,
+            layer.ffn_gate_inp, layer.ffn_gate_inp_shexp,
+            layer.ffn_gate_shexp, layer.ffn_down_shexp, layer.ffn_up_shexp,
+            // mamba
+            layer.ssm_in, layer.ssm_x, layer.ssm_dt, layer.ssm_out,
+            // rwkv
+            layer.time_mix_key, layer.time_mix_value, layer.time_mix_receptance,
+            layer.time_mix_gate, layer.time_mix_output,
+            layer.channel_mix_key, layer.channel_mix_receptance, layer.channel_mix_value,
+            // lfm2
+            layer.shortconv.in_proj, layer.shortconv.out_proj,
+            // gemma3n
+            layer.per_layer_inp_gate, layer.per_layer_proj,
+            layer.altup_correct_coef, layer.altup_predict_coef,
+            layer.laurel_l, layer.laurel_r,
+        };
+        for (const ggml_tensor * tensor : projections) {
+            if (tensor && ggml_n_dims(tensor) == 2) {
+                targets.push_back(tensor);
+            }
+        }
+    }
+
+    std::map<ggml_backend_buffer_type_t, ggml_context *> ctx_map;
+    auto ctx_for_buft = [&](ggml_backend_buffer_type_t buft) -> ggml_context * {
+        auto it = ctx_map.find(buft);
+        if (it == ctx_map.end()) {
+            ggml_init_params params = {
+                /*.mem_size   =*/ 2*targets.size()*ggml_tensor_overhead(),
+                /*.mem_buffer =*/ NULL,
+                /*.no_alloc   =*/ true,
+            };
+            ggml_context * buft_ctx = ggml_init(params);
+            if (!buft_ctx) {
+                throw std::runtime_error("failed to create ggml context for lora adapter");
+            }
+            ctx_map[buft] = buft_ctx;
+            adapter.ctxs.emplace_back(buft_ctx);
+            return buft_ctx;
+        }
+        return it->second;
+    };
+
+    for (const ggml_tensor * model_tensor : targets) {
+        ggml_context * dev_ctx = ctx_for_buft(llama_adapter_lora_buft(model_tensor));
+
+        ggml_tensor * tensor_a = ggml_new_tensor_2d(dev_ctx, GGML_TYPE_F32, model_tensor->ne[0], rank);
+        ggml_tensor * tensor_b = ggml_new_tensor_2d(dev_ctx, GGML_TYPE_F32, rank, model_tensor->ne[1]);
+        ggml_format_name(tensor_a, "%s.lora_a", model_tensor->name);
+        ggml_format_name(tensor_b, "%s.lora_b", model_tensor->name);
+        adapter.ab_map[model_tensor->name] = llama_adapter_lora_weight(tensor_a, tensor_b);
+    }
+
+    for (auto & it : ctx_map) {
+        ggml_backend_buffer_ptr buf { ggml_backend_alloc_ctx_tensors_from_buft(it.second, it.first) };
+        if (!buf) {
+            throw std::runtime_error("failed to allocate buffer for lora adapter\n");
+        }
+        ggml_backend_buffer_clear(buf.get(), 0);
+        LLAMA_LOG_INFO("%s: %10s LoRA buffer size = %8.2f MiB\n", __func__, ggml_backend_buffer_name(buf.get()), ggml_backend_buffer_get_size(buf.get())/1024.0/1024.0);
+        adapter.bufs.emplace_back(std::move(buf));
+    }
+
+    // lora_b stays zero, lora_a ~ U(-1/sqrt(n_in), 1/sqrt(n_in))
+    std::mt19937 rng(42);
+    std::vector<float> data;
+    for (auto & it : adapter.ab_map) {
+        ggml_tensor * a = it.second.a;
+        const float bound = 1.0f/sqrtf((float) a->ne[0]);
+        std::uniform_real_distribution<float> dist(-bound, bound);
+        data.resize(ggml_nelements(a));
+        for (float & x : data) {
+            x = dist(rng);
+        }
+        ggml_backend_tensor_set(a, data.data(), 0, ggml_nbytes(a));
+    }
+
+    adapter.alpha = alpha;
+
+    LLM_KV llm_kv = LLM_KV(LLM_ARCH_UNKNOWN);
+    adapter.gguf_kv[llm_kv(LLM_KV_GENERAL_TYPE)]         = "adapter";
+    adapter.gguf_kv[llm_kv(LLM_KV_GENERAL_ARCHITECTURE)] = llm_arch_name(model.arch);
+    adapter.gguf_kv[llm_kv(LLM_KV_ADAPTER_TYPE)]         = "lora";
+    adapter.gguf_kv[llm_kv(LLM_KV_ADAPTER_LORA_ALPHA)]   = std::to_string(alpha);
+
+    LLAMA_LOG_INFO("%s: created %zu rank %d lora tensor pairs\n", __func__, adapter.ab_map.size(), rank);
+}
+
+llama_adapter_lora * llama_adapter_lora_init_empty(llama_model * model, int32_t rank, float alpha) {
+    llama_adapter_lora * adapter = new llama_adapter_lora();
+
+    try {
+        llama_adapter_lora_init_empty_impl(*model, rank, alpha, *adapter);
+        return adapter;
+    } catch (const std::exception & err) {
+        LLAMA_LOG_ERROR("%s: failed to create lora adapter: %s\n", __func__, err.what());
+
+        delete adapter;
+    }
+
+    return nullptr;
+}
+
+bool llama_adapter_lora_save(const llama_adapter_lora * adapter, const char * path_lora) {
+    LLM_KV llm_kv = LLM_KV(LLM_ARCH_UNKNOWN);
+
+    const auto arch = adapter->gguf_kv.find(llm_kv(LLM_KV_GENERAL_ARCHITECTURE));
+    if (arch == adapter->gguf_kv.end()) {
+        LLAMA_LOG_ERROR("%s: adapter has no architecture\n", __func__);
+        return false;
+    }
+
+    gguf_context_ptr ctx_gguf { gguf_init_empty() };
+    gguf_set_val_str(ctx_gguf.get(), llm_kv(LLM_KV_GENERAL_TYPE).c_str(),         "adapter");
+    gguf_set_val_str(ctx_gguf.get(), llm_kv(LLM_KV_GENERAL_ARCHITECTURE).c_str(), arch->second.c_str());
+    gguf_set_val_str(ctx_gguf.get(), llm_kv(LLM_KV_ADAPTER_TYPE).c_str(),         "lora");
+    gguf_set_val_f32(ctx_gguf.get(), llm_kv(LLM_KV_ADAPTER_LORA_ALPHA).c_str(),   adapter->alpha);
+    if (!adapter->alora_invocation_tokens.empty()) {
+        gguf_set_arr_data(ctx_gguf.get(), llm_kv(LLM_KV_ADAPTER_ALORA_INVOCATION_TOKENS).c_str(), GGUF_TYPE_UINT32,
+            adapter->alora_invocation_tokens.data(), adapter->alora_invocation_tokens.size());
+    }
+
+    // write the tensors sorted by name so that the files are reproducible
+    std::map<std::string, llama_adapter_lora_weight> ab_map(adapter->ab_map.begin(), adapter->ab_map.end());
+
+    size_t size_data = 0;
+    for (const auto & it : ab_map) {
+        size_data += ggml_nbytes(it.second.a) + ggml_nbytes(it.second.b) + 2*GGML_MEM_ALIGN;
+    }
+
+    ggml_init_params params = {
+        /*.mem_size   =*/ 2*ab_map.size()*ggml_tensor_overhead() + size_data,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+    ggml_context_ptr ctx { ggml_init(params) };
+    if (!ctx) {
+        LLAMA_LOG_ERROR("%s: failed to create ggml context\n", __func__);
+        return false;
+    }
+
+    for (const auto & it : ab_map) {
+        for (const ggml_tensor * src : { it.second.a, it.second.b }) {
+            ggml_tensor * dst = ggml_dup_tensor(ctx.get(), src);
+            ggml_set_name(dst, src->name);
+            ggml_backend_tensor_get(src, dst->data, 0, ggml_nbytes(src));
+            gguf_add_tensor(ctx_gguf.get(), dst);
+        }
+    }
+
+    if (!gguf_write_to_file(ctx_gguf.get(), path_lora, /*only_meta =*/ false)) {
+        LLAMA_LOG_ERROR("%s: failed to write lora adapter to '%s'\n", __func__, path_lora);
+        return false;
+    }
+
+    LLAMA_LOG_INFO("%s: saved %zu tensors to '%s'\n", __func__, ab_map.size()*2, path_lora);
+
+    return true;
+}
+
 int32_t llama_adapter_meta_val_str(const llama_adapter_lora * adapter, const char * key, char * buf, size_t buf_size) {
     const auto & it = adapter->gguf_kv.find(key);
     if (it == adapter->gguf_kv.end()) {
@@ -7,6 +7,7 @@
 #include "llama-mmap.h"
 #include "llama-model.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstring>
 #include <limits>
@@ -18,7 +19,8 @@
 
 llama_context::llama_context(
         const llama_model & model,
-              llama_context_params params) :
+              llama_context_params params,
+              bool no_alloc) :
     model(model),
     balloc(std::make_unique<llama_batch_allocr>(model.hparams.n_pos_per_embd())) {
     LLAMA_LOG_INFO("%s: constructing llama_context\n", __func__);
@@ -33,6 +35,7 @@ llama_context::llama_context(
         throw std::runtime_error("n_seq_max must be <= " + std::to_string(LLAMA_MAX_SEQ));
     }
 
+    cparams.no_alloc         = no_alloc;
     cparams.n_threads        = params.n_threads;
     cparams.n_threads_batch  = params.n_threads_batch;
     cparams.yarn_ext_factor  = params.yarn_ext_factor  >= 0.0f ? params.yarn_ext_factor  : hparams.yarn_ext_factor;
@@ -376,7 +379,7 @@ llama_context::llama_context(
         for (size_t i = 0; i < backend_ptrs.size(); ++i) {
             ggml_backend_t             backend = backend_ptrs[i];
             ggml_backend_buffer_type_t buft    = backend_buft[i];
-            size_t size = ggml_backend_sched_get_buffer_size(sched.get(), backend);
+            size_t size = cparams.no_alloc ? compute_sizes[i] : ggml_backend_sched_get_buffer_size(sched.get(), backend);
             if (size > 1) {
                 LLAMA_LOG_INFO("%s: %10s compute buffer size = %8.2f MiB\n", __func__,
                         ggml_backend_buft_name(buft),
@@ -753,11 +756,12 @@ llm_graph_result * llama_context::process_ubatch(const llama_ubatch & ubatch, ll
         ggml_backend_sched_reset(sched.get());
         ggml_backend_sched_set_eval_callback(sched.get(), cparams.cb_eval, cparams.cb_eval_user_data);
 
-        //const auto t_start_us = ggml_time_us();
+        const auto t_start_us = ggml_time_us();
 
         gf = model.build_graph(gparams);
 
-        //LLAMA_LOG_INFO("graph build time: %.3f ms\n", (ggml_time_us() - t_start_us)/1000.0);
+        t_graph_us += ggml_time_us() - t_start_us;
+        n_graph++;
 
         if (!gf) {
             LLAMA_LOG_ERROR("%s: failed to initialize graph\n", __func__);
@@ -1313,7 +1317,7 @@ uint32_t llama_context::output_reserve(int32_t n_outputs) {
         if (output_dev_host_buft) {
             buft = output_dev_host_buft;
         }
-        buf_output.reset(ggml_backend_buft_alloc_buffer(buft, new_size));
+        buf_output.reset(cparams.no_alloc ? ggml_backend_buft_alloc_dummy_buffer(buft, new_size) : ggml_backend_buft_alloc_buffer(buft, new_size));
         if (buf_output == nullptr) {
             LLAMA_LOG_ERROR("%s: failed to allocate output buffer of size %.2f MiB\n", __func__, new_size / (1024.0 * 1024.0));
             return 0;
@@ -1407,6 +1411,14 @@ ggml_cgraph * llama_context::graph_reserve(uint32_t n_tokens, uint32_t n_seqs, u
     // initialize scheduler with the specified graph
     if (split_only) {
         ggml_backend_sched_split_graph(sched.get(), gf);
+    } else if (cparams.no_alloc) {
+        // the buffers only grow when reserving, keep the largest size seen for each backend
+        std::vector<size_t> sizes(backend_ptrs.size());
+        ggml_backend_sched_reserve_size(sched.get(), gf, sizes.data());
+        compute_sizes.resize(sizes.size(), 0);
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            compute_sizes[i] = std::max(compute_sizes[i], sizes[i]);
+        }
     } else if (!ggml_backend_sched_reserve(sched.get(), gf)) {
         LLAMA_LOG_ERROR("%s: failed to allocate compute buffers\n", __func__);
         return nullptr;
@@ -1475,6 +1487,11 @@ llm_graph_cb llama_context::graph_get_cb() const {
             ggml_set_name(cur, name);
         }
 
+        if (opt_checkpointing && strcmp(name, "l_out") == 0) {
+            // only the layer outputs are kept for the backward pass, ggml-opt recomputes the rest
+            ggml_set_checkpoint(cur);
+        }
+
         if (!cparams.offload_kqv) {
             if (strcmp(name, "kqv_merged_cont") == 0) {
                 // all nodes between the KV store and the attention output are run on the CPU
@@ -2020,10 +2037,20 @@ llama_perf_context_data llama_context::perf_get_data() const {
     return data;
 }
 
+llama_perf_graph_data llama_context::perf_get_graph_data() const {
+    llama_perf_graph_data data = {};
+
+    data.t_graph_ms = 1e-3 * t_graph_us;
+    data.n_graph    = std::max(0, n_graph);
+
+    return data;
+}
+
 void llama_context::perf_reset() {
     t_start_us  = ggml_time_us();
     t_eval_us   = n_eval = 0;
     t_p_eval_us = n_p_eval = 0;
+    t_graph_us  = n_graph = 0;
     n_reused    = 0;
 }
 
@@ -2032,12 +2059,18 @@ std::map<ggml_backend_buffer_type_t, llama_memory_breakdown_data> llama_context:
     for (const auto & buft_size : model.memory_breakdown()) {
         ret[buft_size.first].model += buft_size.second;
     }
-    for (const auto & buft_size : memory->memory_breakdown()) {
-        ret[buft_size.first].context += buft_size.second;
+    if (memory) {
+        for (const auto & buft_size : memory->memory_breakdown()) {
+            ret[buft_size.first].context += buft_size.second;
+        }
     }
-    for (const auto & backend_ptr : backends) {
-        ggml_backend_t backend = backend_ptr.get();
-        ret[ggml_backend_sched_get_buffer_type(sched.get(), backend)].compute += ggml_backend_sched_get_buffer_size(sched.get(), backend);
+    if (buf_output) {
+        ret[ggml_backend_buffer_get_type(buf_output.get())].context += ggml_backend_buffer_get_size(buf_output.get());
+    }
+    for (size_t i = 0; i < backend_ptrs.size(); ++i) {
+        ggml_backend_t backend = backend_ptrs[i];
+        ret[ggml_backend_sched_get_buffer_type(sched.get(), backend)].compute +=
+            cparams.no_alloc ? compute_sizes[i] : ggml_backend_sched_get_buffer_size(sched.get(), backend);
     }
     return ret;
 }
@@ -2080,6 +2113,18 @@ void llama_context::opt_init(struct llama_model * model, struct llama_opt_params
     llama_opt_param_filter param_filter = lopt_params.param_filter;
     void * param_filter_ud              = lopt_params.param_filter_ud;
 
+    opt_checkpointing = lopt_params.checkpointing;
+
+    if (lopt_params.adapter) {
+        // LoRA fine-tuning: the model weights are frozen, only the adapter is trained
+        GGML_ASSERT(loras.find(lopt_params.adapter) != loras.end() && "the adapter to train must be set on the context");
+        for (auto & it : lopt_params.adapter->ab_map) {
+            llama_set_param(it.second.a, param_filter, param_filter_ud);
+            llama_set_param(it.second.b, param_filter, param_filter_ud);
+        }
+        return;
+    }
+
   //llama_set_param(model->tok_embd,        param_filter, param_filter_ud); // FIXME
     llama_set_param(model->type_embd,       param_filter, param_filter_ud);
     llama_set_param(model->pos_embd,        param_filter, param_filter_ud);
@@ -2095,11 +2140,27 @@ void llama_context::opt_init(struct llama_model * model, struct llama_opt_params
     llama_set_param(model->cls_out,         param_filter, param_filter_ud);
     llama_set_param(model->cls_out_b,       param_filter, param_filter_ud);
 
+    // K and V only reach the attention through the KV cache, which SET_ROWS writes without a gradient,
+    // so the tensors that produce them get none and would only be shrunk by the weight decay
+    int n_frozen = 0;
     for (struct llama_layer & layer : model->layers) {
+        const struct ggml_tensor * frozen[] = {
+            layer.wk, layer.bk, layer.wv, layer.bv, layer.wqkv, layer.bqkv,
+            layer.attn_k_norm, layer.attn_k_norm_b, layer.wkv_a_mqa, layer.attn_kv_a_norm,
+        };
         for (size_t i = 0; i < sizeof(layer)/sizeof(struct ggml_tensor *); ++i) {
-            llama_set_param(reinterpret_cast<struct ggml_tensor **>(&layer)[i], param_filter, param_filter_ud);
+            struct ggml_tensor * tensor = reinterpret_cast<struct ggml_tensor **>(&layer)[i];
+            if (tensor && std::find(std::begin(frozen), std::end(frozen), tensor) != std::end(frozen)) {
+                n_frozen++;
+                continue;
+            }
+            llama_set_param(tensor, param_filter, param_filter_ud);
         }
     }
+    if (n_frozen > 0) {
+        LLAMA_LOG_WARN("%s: WARNING: %d K/V projection tensors are NOT trained, "
+                       "no gradient reaches them through the KV cache\n", __func__, n_frozen);
+    }
 }
 
 void llama_context::opt_epoch_iter(
@@ -2177,7 +2238,11 @@ void llama_context::opt_epoch_iter(
             struct ggml_context * ctx_compute_opt;
             {
                 const size_t size_gf = ggml_graph_size(gf);
-                const size_t size_meta = 4*size_gf*ggml_tensor_overhead() + 2*ggml_graph_overhead_custom(size_gf, /*grads = */ true);
+                size_t size_meta = 4*size_gf*ggml_tensor_overhead() + 2*ggml_graph_overhead_custom(size_gf, /*grads = */ true);
+                if (opt_checkpointing) {
+                    // recomputed activations + the backward graphs that include them
+                    size_meta += size_gf*ggml_tensor_overhead() + 2*ggml_graph_overhead_custom(2*size_gf, /*grads = */ true);
+                }
                 struct ggml_init_params params = {
                     /*.mem_size   =*/ size_meta,
                     /*.mem_buffer =*/ nullptr,
@@ -2300,9 +2365,10 @@ llama_context_params llama_context_default_params() {
     return result;
 }
 
-llama_context * llama_init_from_model(
-                 llama_model * model,
-        llama_context_params   params) {
+static llama_context * llama_init_from_model_impl(
+           const llama_model * model,
+        llama_context_params   params,
+                        bool   no_alloc) {
     if (!model) {
         LLAMA_LOG_ERROR("%s: model cannot be NULL\n", __func__);
         return nullptr;
@@ -2354,7 +2420,7 @@ llama_context * llama_init_from_model(
     }
 
     try {
-        auto * ctx = new llama_context(*model, params);
+        auto * ctx = new llama_context(*model, params, no_alloc);
         return ctx;
     } catch (const std::exception & err) {
         LLAMA_LOG_ERROR("%s: failed to initialize the context: %s\n", __func__, err.what());
@@ -2363,6 +2429,12 @@ llama_context * llama_init_from_model(
     return nullptr;
 }
 
+llama_context * llama_init_from_model(
+                 llama_model * model,
+        llama_context_params   params) {
+    return llama_init_from_model_impl(model, params, false);
+}
+
 // deprecated
 llama_context * llama_new_context_with_model(
                  llama_model * model,
@@ -2769,8 +2841,21 @@ llama_perf_context_data llama_perf_context(const llama_context * ctx) {
     return data;
 }
 
+llama_perf_graph_data llama_perf_graph(const llama_context * ctx) {
+    llama_perf_graph_data data = {};
+
+    if (ctx == nullptr) {
+        return data;
+    }
+
+    data = ctx->perf_get_graph_data();
+
+    return data;
+}
+
 void llama_perf_context_print(const llama_context * ctx) {
-    const auto data = llama_perf_context(ctx);
+    const auto data  = llama_perf_context(ctx);
+    const auto graph = llama_perf_graph(ctx);
 
     const double t_end_ms = 1e-3 * ggml_time_us();
 
@@ -2781,6 +2866,8 @@ void llama_perf_context_print(const llama_context * ctx) {
             __func__, data.t_eval_ms, data.n_eval, data.t_eval_ms / data.n_eval, 1e3 / data.t_eval_ms * data.n_eval);
     LLAMA_LOG_INFO("%s:       total time = %10.2f ms / %5d tokens\n", __func__, (t_end_ms - data.t_start_ms), (data.n_p_eval + data.n_eval));
     LLAMA_LOG_INFO("%s:    graphs reused = %10d\n", __func__, data.n_reused);
+    LLAMA_LOG_INFO("%s: graph build time = %10.2f ms / %5d graphs (%8.3f ms per graph)\n",
+            __func__, graph.t_graph_ms, graph.n_graph, graph.t_graph_ms / std::max(1, graph.n_graph));
 }
 
 void llama_perf_context_reset(llama_context * ctx) {
@@ -2923,6 +3010,95 @@ void llama_memory_breakdown_print(const struct llama_context * ctx) {
     }
 }
 
+static int32_t llama_memory_breakdown_copy(
+        const std::map<ggml_backend_buffer_type_t, llama_memory_breakdown_data> & memory_breakdown,
+        llama_memory_breakdown_entry * entries,
+        int32_t n_entries) {
+    int32_t n = 0;
+    for (const auto & buft_mb : memory_breakdown) {
+        if (n < n_entries) {
+            entries[n] = { buft_mb.first, buft_mb.second.model, buft_mb.second.context, buft_mb.second.compute };
+        }
+        n++;
+    }
+    return n;
+}
+
+int32_t llama_memory_plan(
+        const llama_model * model,
+        llama_context_params params,
+        llama_memory_breakdown_entry * entries,
+        int32_t n_entries) {
+    llama_context * ctx = llama_init_from_model_impl(model, params, true);
+    if (!ctx) {
+        return -1;
+    }
+
+    const int32_t n = llama_memory_breakdown_copy(ctx->memory_breakdown(), entries, n_entries);
+
+    delete ctx;
+
+    return n;
+}
+
+int32_t llama_memory_breakdown(
+        const llama_context * ctx,
+        llama_memory_breakdown_entry * entries,
+        int32_t n_entries) {
+    return llama_memory_breakdown_copy(ctx->memory_breakdown(), entries, n_entries);
+}
+
+// extra buffer types hold weights repacked into a backend-specific layout
+static bool llama_buft_is_extra(ggml_backend_buffer_type_t buft) {
+    ggml_backend_dev_t dev = ggml_backend_buft_get_device(buft);
+    if (!dev) {
+        return false;
+    }
+
+    ggml_backend_reg_t reg = ggml_backend_dev_backend_reg(dev);
+    auto ggml_backend_dev_get_extra_bufts_fn = (ggml_backend_dev_get_extra_bufts_t)
+        ggml_backend_reg_get_proc_address(reg, "ggml_backend_dev_get_extra_bufts");
+    if (!ggml_backend_dev_get_extra_bufts_fn) {
+        return false;
+    }
+
+    for (ggml_backend_buffer_type_t * extra = ggml_backend_dev_get_extra_bufts_fn(dev); extra && *extra; ++extra) {
+        if (*extra == buft) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+llama_memory_counters llama_memory_get_counters(const llama_context * ctx) {
+    llama_memory_counters res = {};
+
+    for (const auto & buft_mb : ctx->memory_breakdown()) {
+        ggml_backend_buffer_type_t          buft = buft_mb.first;
+        const llama_memory_breakdown_data & mb   = buft_mb.second;
+
+        const size_t self = mb.model + mb.context + mb.compute;
+
+        ggml_backend_dev_t dev = ggml_backend_buft_get_device(buft);
+        if (ggml_backend_buft_is_host(buft) || (dev && ggml_backend_dev_type(dev) == GGML_BACKEND_DEVICE_TYPE_CPU)) {
+            res.host += self;
+        } else {
+            res.device += self;
+        }
+
+        if (llama_buft_is_extra(buft)) {
+            res.repack += mb.model;
+        }
+    }
+
+    ctx->get_model().mmap_usage(res.mmap, res.mmap_resident);
+
+    res.rss_peak = llama_rss_peak();
+
+    return res;
+}
+
 //
 // training
 //
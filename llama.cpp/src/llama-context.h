@@ -30,9 +30,11 @@ struct llama_memory_breakdown_data {
 
 struct llama_context {
     // init scheduler and compute buffers, reserve worst-case graphs
+    // no_alloc: dry run, the buffers are planned but not allocated and the context cannot be used for inference
     llama_context(
             const llama_model & model,
-                  llama_context_params params);
+                  llama_context_params params,
+                  bool no_alloc = false);
 
     ~llama_context();
 
@@ -150,6 +152,7 @@ struct llama_context {
     //
 
     llama_perf_context_data perf_get_data() const;
+    llama_perf_graph_data   perf_get_graph_data() const;
     void perf_reset();
 
     std::map<ggml_backend_buffer_type_t, llama_memory_breakdown_data> memory_breakdown() const;
@@ -272,6 +275,7 @@ private:
 
     // training
     ggml_opt_context_t opt_ctx = nullptr;
+    bool opt_checkpointing     = false; // mark the layer outputs as gradient checkpoints
 
     ggml_threadpool_t threadpool       = nullptr;
     ggml_threadpool_t threadpool_batch = nullptr;
@@ -291,6 +295,9 @@ private:
     // host buffer for the model output (logits and embeddings)
     ggml_backend_buffer_ptr buf_output;
 
+    // size of the compute buffer of each backend, when the buffers are only planned (no_alloc)
+    std::vector<size_t> compute_sizes;
+
     bool has_evaluated_once = false;
 
     // env: LLAMA_GRAPH_REUSE_DISABLE
@@ -301,6 +308,7 @@ private:
     mutable int64_t t_load_us   = 0;
     mutable int64_t t_p_eval_us = 0;
     mutable int64_t t_eval_us   = 0;
+    mutable int64_t t_graph_us  = 0;
 
     mutable int64_t t_compute_start_us = 0;
     mutable int64_t n_queued_tokens    = 0;
@@ -309,4 +317,5 @@ private:
     mutable int32_t n_eval   = 0; // number of eval calls
 
     mutable int32_t n_reused = 0; // number of times the previous graph was reused
+    mutable int32_t n_graph  = 0; // number of times a new graph was built
 };
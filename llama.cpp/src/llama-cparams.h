@@ -33,6 +33,7 @@ struct llama_cparams {
     bool warmup;
     bool op_offload;
     bool kv_unified;
+    bool no_alloc; // dry run: plan the buffers without allocating them
 
     enum llama_pooling_type pooling_type;
 
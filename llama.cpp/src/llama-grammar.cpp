@@ -6,6 +6,10 @@
 
 #include <cmath>
 #include <algorithm>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 
 //
@@ -973,15 +977,8 @@ struct llama_grammar * llama_grammar_init_impl(
     };
 }
 
-struct llama_grammar * llama_grammar_init_impl(
-        const struct llama_vocab * vocab,
-                      const char * grammar_str,
-                      const char * grammar_root,
-                              bool lazy,
-                     const char ** trigger_patterns,
-                            size_t num_trigger_patterns,
-               const llama_token * trigger_tokens,
-                            size_t num_trigger_tokens) {
+// parses the grammar and builds its initial stacks, the result has no vocab and no triggers
+static struct llama_grammar * llama_grammar_parse_impl(const char * grammar_str, const char * grammar_root) {
     llama_grammar_parser parser;
 
     // if there is a grammar, parse it
@@ -1049,6 +1046,84 @@ struct llama_grammar * llama_grammar_init_impl(
         }
     } while (true);
 
+    // Important: vec_rules has to be moved here, not copied, because stacks contains
+    // pointers to elements of vec_rules. If vec_rules were copied into llama_grammar
+    // then the pointers would be invalidated when the local vec_rules goes out of scope.
+    return new llama_grammar {
+        /* .vocab = */            nullptr,
+        std::move(vec_rules),
+        std::move(stacks),
+        /* .partial_utf8 = */     {},
+        /* .lazy = */             false,
+        /* .awaiting_trigger = */ false,
+        /* .trigger_buffer = */   "",
+        /* .trigger_tokens   = */ {},
+        /* .trigger_patterns = */ {},
+    };
+}
+
+// The parsed grammars are kept by root and text: constrained requests usually reuse the same few grammars, and
+// cloning the parsed grammar is much cheaper than parsing it and building its initial stacks again.
+struct llama_grammar_cache {
+    static constexpr size_t n_max = 32;
+
+    struct entry {
+        std::string key;
+        std::unique_ptr<llama_grammar, decltype(&llama_grammar_free_impl)> grammar;
+    };
+
+    std::mutex       mtx;
+    std::list<entry> entries; // most recently used first
+
+    // returns a clone of the cached grammar, or nullptr
+    llama_grammar * get(const std::string & key) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->key == key) {
+                entries.splice(entries.begin(), entries, it);
+                return llama_grammar_clone_impl(*it->grammar);
+            }
+        }
+        return nullptr;
+    }
+
+    void add(const std::string & key, llama_grammar * grammar) {
+        std::lock_guard<std::mutex> lock(mtx);
+        entries.push_front({ key, { grammar, llama_grammar_free_impl } });
+        if (entries.size() > n_max) {
+            entries.pop_back();
+        }
+    }
+};
+
+static llama_grammar_cache & llama_grammar_get_cache() {
+    static llama_grammar_cache cache;
+    return cache;
+}
+
+struct llama_grammar * llama_grammar_init_impl(
+        const struct llama_vocab * vocab,
+                      const char * grammar_str,
+                      const char * grammar_root,
+                              bool lazy,
+                     const char ** trigger_patterns,
+                            size_t num_trigger_patterns,
+               const llama_token * trigger_tokens,
+                            size_t num_trigger_tokens) {
+    auto & cache = llama_grammar_get_cache();
+
+    const std::string key = std::string(grammar_root) + '\0' + grammar_str;
+
+    llama_grammar * result = cache.get(key);
+    if (!result) {
+        llama_grammar * parsed = llama_grammar_parse_impl(grammar_str, grammar_root);
+        if (!parsed) {
+            return nullptr;
+        }
+        result = llama_grammar_clone_impl(*parsed);
+        cache.add(key, parsed);
+    }
+
     std::vector<llama_token>    vec_trigger_tokens;
     std::vector<llama_grammar_trigger_pattern> vec_trigger_patterns;
     for (size_t i = 0; i < num_trigger_tokens; i++) {
@@ -1062,20 +1137,13 @@ struct llama_grammar * llama_grammar_init_impl(
         trigger.regex = std::regex(trigger.pattern);
     }
 
-    // Important: vec_rules has to be moved here, not copied, because stacks contains
-    // pointers to elements of vec_rules. If vec_rules were copied into llama_grammar
-    // then the pointers would be invalidated when the local vec_rules goes out of scope.
-    return new llama_grammar {
-        vocab,
-        std::move(vec_rules),
-        std::move(stacks),
-        /* .partial_utf8 = */     {},
-        /* .lazy = */             lazy,
-        /* .awaiting_trigger = */ lazy,
-        /* .trigger_buffer = */   "",
-        std::move(vec_trigger_tokens),
-        std::move(vec_trigger_patterns),
-    };
+    result->vocab            = vocab;
+    result->lazy             = lazy;
+    result->awaiting_trigger = lazy;
+    result->trigger_tokens   = std::move(vec_trigger_tokens);
+    result->trigger_patterns = std::move(vec_trigger_patterns);
+
+    return result;
 }
 
 void llama_grammar_free_impl(struct llama_grammar * grammar) {
@@ -1100,14 +1168,31 @@ struct llama_grammar * llama_grammar_clone_impl(const struct llama_grammar & gra
     };
 
     // redirect elements in stacks to point to new rules
-    for (size_t is = 0; is < result->stacks.size(); is++) {
-        for (size_t ie = 0; ie < result->stacks[is].size(); ie++) {
-            for (size_t ir0 = 0; ir0 < grammar.rules.size(); ir0++) {
-                for (size_t ir1 = 0; ir1 < grammar.rules[ir0].size(); ir1++) {
-                    if (grammar.stacks[is][ie] == &grammar.rules[ir0][ir1]) {
-                        result->stacks[is][ie] =  &result->rules[ir0][ir1];
-                    }
-                }
+    // the rules are sorted by address so that the rule of each element is found with a binary search
+    std::vector<std::pair<uintptr_t, size_t>> rule_addrs;
+    rule_addrs.reserve(grammar.rules.size());
+    for (size_t ir = 0; ir < grammar.rules.size(); ir++) {
+        if (!grammar.rules[ir].empty()) {
+            rule_addrs.emplace_back((uintptr_t) grammar.rules[ir].data(), ir);
+        }
+    }
+    std::sort(rule_addrs.begin(), rule_addrs.end());
+
+    for (auto & stack : result->stacks) {
+        for (auto & elem : stack) {
+            const uintptr_t addr = (uintptr_t) elem;
+
+            auto it = std::upper_bound(rule_addrs.begin(), rule_addrs.end(), std::make_pair(addr, SIZE_MAX));
+            if (it == rule_addrs.begin()) {
+                continue;
+            }
+            --it;
+
+            const auto & rule = grammar.rules[it->second];
+
+            const size_t offset = (addr - it->first) / sizeof(llama_grammar_element);
+            if (addr < (uintptr_t) (rule.data() + rule.size())) {
+                elem = &result->rules[it->second][offset];
             }
         }
     }
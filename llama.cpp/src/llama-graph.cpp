@@ -487,15 +487,22 @@ void llm_graph_result::reset() {
 
     inputs.clear();
 
-    buf_compute_meta.resize(ggml_tensor_overhead()*max_nodes + ggml_graph_overhead_custom(max_nodes, false));
+    const size_t size_meta = ggml_tensor_overhead()*max_nodes + ggml_graph_overhead_custom(max_nodes, false);
 
-    ggml_init_params params = {
-        /*.mem_size   =*/ buf_compute_meta.size(),
-        /*.mem_buffer =*/ buf_compute_meta.data(),
-        /*.no_alloc   =*/ true,
-    };
+    if (ctx_compute && buf_compute_meta.size() == size_meta) {
+        // the meta buffer does not change, so the context is rewound instead of being re-created for every graph
+        ggml_reset(ctx_compute.get());
+    } else {
+        buf_compute_meta.resize(size_meta);
 
-    ctx_compute.reset(ggml_init(params));
+        ggml_init_params params = {
+            /*.mem_size   =*/ buf_compute_meta.size(),
+            /*.mem_buffer =*/ buf_compute_meta.data(),
+            /*.no_alloc   =*/ true,
+        };
+
+        ctx_compute.reset(ggml_init(params));
+    }
 
     gf = ggml_new_graph_custom(ctx_compute.get(), max_nodes, false);
 }
@@ -23,6 +23,7 @@ llama_kv_cache::llama_kv_cache(
                      bool   v_trans,
                      bool   offload,
                      bool   unified,
+                     bool   no_alloc,
                  uint32_t   kv_size,
                  uint32_t   n_seq_max,
                  uint32_t   n_pad,
@@ -171,7 +172,7 @@ llama_kv_cache::llama_kv_cache(
         auto * buft = it.first;
         auto * ctx  = it.second;
 
-        ggml_backend_buffer_t buf = ggml_backend_alloc_ctx_tensors_from_buft(ctx, buft);
+        ggml_backend_buffer_t buf = no_alloc ? ggml_backend_alloc_ctx_tensors_from_buft_dummy(ctx, buft) : ggml_backend_alloc_ctx_tensors_from_buft(ctx, buft);
         if (!buf) {
             throw std::runtime_error("failed to allocate buffer for kv cache");
         }
@@ -26,6 +26,7 @@ llama_memory_hybrid::llama_memory_hybrid(
                  uint32_t   n_seq_max,
                      bool   offload,
                      bool   unified,
+                     bool   no_alloc,
                             /* layer filters */
     const layer_filter_cb & filter_attn,
     const layer_filter_cb & filter_recr) :
@@ -37,6 +38,7 @@ llama_memory_hybrid::llama_memory_hybrid(
         v_trans,
         offload,
         unified,
+        no_alloc,
         kv_size,
         n_seq_max,
         n_pad,
@@ -52,6 +54,7 @@ llama_memory_hybrid::llama_memory_hybrid(
         type_r,
         type_s,
         offload,
+        no_alloc,
         rs_size,
         n_seq_max,
         filter_recr == nullptr ?
@@ -36,6 +36,7 @@ public:
                  uint32_t   n_seq_max,
                      bool   offload,
                      bool   unified,
+                     bool   no_alloc,
                             /* layer filters */
     const layer_filter_cb & filter_attn = nullptr,
     const layer_filter_cb & filter_recr = nullptr);
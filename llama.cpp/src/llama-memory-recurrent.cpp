@@ -20,6 +20,7 @@ llama_memory_recurrent::llama_memory_recurrent(
                 ggml_type   type_r,
                 ggml_type   type_s,
                      bool   offload,
+                     bool   no_alloc,
                  uint32_t   mem_size,
                  uint32_t   n_seq_max,
     const layer_filter_cb & filter) : hparams(model.hparams), n_seq_max(n_seq_max) {
@@ -97,7 +98,7 @@ llama_memory_recurrent::llama_memory_recurrent(
         auto * buft = it.first;
         auto * ctx  = it.second;
 
-        ggml_backend_buffer_t buf = ggml_backend_alloc_ctx_tensors_from_buft(ctx, buft);
+        ggml_backend_buffer_t buf = no_alloc ? ggml_backend_alloc_ctx_tensors_from_buft_dummy(ctx, buft) : ggml_backend_alloc_ctx_tensors_from_buft(ctx, buft);
         if (!buf) {
             throw std::runtime_error("failed to allocate buffer for rs cache");
         }
@@ -17,7 +17,7 @@
             #include <sys/mman.h>
             #include <fcntl.h>
         #endif
-        #if defined(_POSIX_MEMLOCK_RANGE)
+        #if defined(_POSIX_MEMLOCK_RANGE) || __has_include(<sys/resource.h>)
             #include <sys/resource.h>
         #endif
     #endif
@@ -33,6 +33,7 @@
         #define PATH_MAX MAX_PATH
     #endif
     #include <io.h>
+    #include <psapi.h>
 #endif
 
 #if defined(__APPLE__)
@@ -354,6 +355,44 @@ struct llama_mmap::impl {
         mapped_fragments = std::move(new_mapped_fragments);
     }
 
+    size_t n_mapped() const {
+        size_t n = 0;
+        for (const auto & frag : mapped_fragments) {
+            n += frag.second - frag.first;
+        }
+        return n;
+    }
+
+    size_t n_resident() const {
+        const size_t page_size = sysconf(_SC_PAGESIZE);
+        // query the residency in blocks to bound the size of the page vector
+        const size_t block_size = 65536*page_size;
+
+#if defined(__linux__)
+        std::vector<unsigned char> pages;
+#else
+        std::vector<char> pages;
+#endif
+
+        size_t n = 0;
+        for (const auto & frag : mapped_fragments) {
+            for (size_t offs = frag.first; offs < frag.second; offs += block_size) {
+                const size_t len = std::min(block_size, frag.second - offs);
+                pages.resize((len + page_size - 1)/page_size);
+                if (mincore((char *) addr + offs, len, pages.data())) {
+                    LLAMA_LOG_WARN("warning: mincore failed: %s\n", strerror(errno));
+                    return 0;
+                }
+                for (auto p : pages) {
+                    if (p & 1) {
+                        n += page_size;
+                    }
+                }
+            }
+        }
+        return std::min(n, n_mapped());
+    }
+
     ~impl() {
         for (const auto & frag : mapped_fragments) {
             if (munmap((char *) addr + frag.first, frag.second - frag.first)) {
@@ -411,6 +450,14 @@ struct llama_mmap::impl {
         GGML_UNUSED(last);
     }
 
+    size_t n_mapped() const {
+        return size;
+    }
+
+    size_t n_resident() const {
+        return 0;
+    }
+
     ~impl() {
         if (!UnmapViewOfFile(addr)) {
             LLAMA_LOG_WARN("warning: UnmapViewOfFile failed: %s\n",
@@ -432,6 +479,14 @@ struct llama_mmap::impl {
 
         throw std::runtime_error("mmap not supported");
     }
+
+    size_t n_mapped() const {
+        return 0;
+    }
+
+    size_t n_resident() const {
+        return 0;
+    }
 #endif
 
     void * addr;
@@ -446,6 +501,9 @@ void * llama_mmap::addr() const { return pimpl->addr; }
 
 void llama_mmap::unmap_fragment(size_t first, size_t last) { pimpl->unmap_fragment(first, last); }
 
+size_t llama_mmap::n_mapped()   const { return pimpl->n_mapped(); }
+size_t llama_mmap::n_resident() const { return pimpl->n_resident(); }
+
 #if defined(_POSIX_MEMLOCK_RANGE) || defined(_WIN32)
 const bool llama_mmap::SUPPORTED  = true;
 #else
@@ -598,3 +656,25 @@ const bool llama_mlock::SUPPORTED = false;
 size_t llama_path_max() {
     return PATH_MAX;
 }
+
+size_t llama_rss_peak() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return pmc.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined(RUSAGE_SELF)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return usage.ru_maxrss; // bytes
+#else
+    return usage.ru_maxrss * 1024; // kilobytes
+#endif
+#else
+    return 0;
+#endif
+}
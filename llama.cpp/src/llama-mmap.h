@@ -44,6 +44,9 @@ struct llama_mmap {
 
     void unmap_fragment(size_t first, size_t last);
 
+    size_t n_mapped()   const; // bytes still mapped after unmap_fragment
+    size_t n_resident() const; // bytes resident in RAM, 0 if not supported
+
     static const bool SUPPORTED;
 
 private:
@@ -66,3 +69,6 @@ private:
 };
 
 size_t llama_path_max();
+
+// peak resident set size of the process in bytes, 0 if not supported
+size_t llama_rss_peak();
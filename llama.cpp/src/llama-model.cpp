@@ -6306,6 +6306,15 @@ std::map<ggml_backend_buffer_type_t, size_t> llama_model::memory_breakdown() con
     return ret;
 }
 
+void llama_model::mmap_usage(size_t & size, size_t & resident) const {
+    size     = 0;
+    resident = 0;
+    for (const auto & mapping : pimpl->mappings) {
+        size     += mapping->n_mapped();
+        resident += mapping->n_resident();
+    }
+}
+
 uint64_t llama_model::n_elements() const {
     return pimpl->n_elements;
 }
@@ -19664,6 +19673,7 @@ llama_memory_i * llama_model::create_memory(const llama_memory_params & params,
                             GGML_TYPE_F32,
                             GGML_TYPE_F32,
                             cparams.offload_kqv,
+                            cparams.no_alloc,
                             std::max((uint32_t) 1, cparams.n_seq_max),
                             cparams.n_seq_max,
                             nullptr);
@@ -19704,6 +19714,7 @@ llama_memory_i * llama_model::create_memory(const llama_memory_params & params,
                         /* n_seq_max         */ cparams.n_seq_max,
                         /* offload           */ cparams.offload_kqv,
                         /* unified           */ cparams.kv_unified,
+                        /* no_alloc          */ cparams.no_alloc,
                         /* filter_attn       */ std::move(filter_attn),
                         /* filter_recr       */ std::move(filter_recr));
                 } else {
@@ -19747,6 +19758,7 @@ llama_memory_i * llama_model::create_memory(const llama_memory_params & params,
                                 cparams.offload_kqv,
                                 params.swa_full,
                                 cparams.kv_unified,
+                                cparams.no_alloc,
                                 n_ctx_per_stream,
                                 cparams.n_seq_max,
                                 cparams.n_ubatch,
@@ -19763,6 +19775,7 @@ llama_memory_i * llama_model::create_memory(const llama_memory_params & params,
                                 !cparams.flash_attn,
                                 cparams.offload_kqv,
                                 cparams.kv_unified,
+                                cparams.no_alloc,
                                 n_ctx_per_stream,
                                 cparams.n_seq_max,
                                 padding,
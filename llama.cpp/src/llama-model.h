@@ -481,6 +481,9 @@ struct llama_model {
 
     std::map<ggml_backend_buffer_type_t, size_t> memory_breakdown() const;
 
+    // bytes of the model files mapped into memory, and how many of them are resident in RAM
+    void mmap_usage(size_t & size, size_t & resident) const;
+
     // total number of parameters in the model
     uint64_t n_elements() const;
 
@@ -6,12 +6,18 @@
 #include "unicode-data.h"
 
 #include <algorithm>
+#include <bitset>
 #include <cassert>
+#include <cctype>
 #include <codecvt>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <limits>
 #include <locale>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <stdexcept>
 #include <string>
@@ -557,6 +563,766 @@ static std::vector<size_t> unicode_regex_split_stl(const std::string & text, con
     return bpe_offsets;
 }
 
+//
+// compiled regex
+//
+
+// std::regex is slow and allocates on every match, so the pre-tokenizer regexes without a custom implementation are
+// compiled once into a small backtracking program. The program follows the ECMAScript rules of std::regex (the first
+// alternative that matches wins, greedy quantifiers, atomic lookaheads, the iteration over empty matches) and runs on
+// the same collapsed/wide input as the std::regex path, so the splits are identical. Regexes with syntax that is not
+// supported here are still handled by std::regex.
+
+struct unicode_regex_class {
+    bool negate = false;
+
+    std::bitset<256> low; // membership of the symbols < 256, before negation
+
+    // symbols >= 256 (wide regexes only)
+    std::vector<std::pair<uint32_t, uint32_t>>               ranges;
+    std::vector<std::regex_traits<wchar_t>::char_class_type> classes;
+    std::vector<std::regex_traits<wchar_t>::char_class_type> neg_classes;
+};
+
+enum unicode_regex_op : uint8_t {
+    UNICODE_REGEX_OP_CLASS, // x: class
+    UNICODE_REGEX_OP_SPLIT, // try x first, then y
+    UNICODE_REGEX_OP_JMP,   // x: target
+    UNICODE_REGEX_OP_BOL,
+    UNICODE_REGEX_OP_EOL,
+    UNICODE_REGEX_OP_LOOK,  // x: sub-program, neg: negative lookahead
+    UNICODE_REGEX_OP_MATCH,
+};
+
+struct unicode_regex_inst {
+    unicode_regex_op op;
+    bool neg;
+    int  x;
+    int  y;
+};
+
+struct unicode_regex_program {
+    bool wide = false;
+
+    std::vector<unicode_regex_inst>  code;
+    std::vector<unicode_regex_class> classes;
+
+    std::regex_traits<wchar_t> wtraits;
+
+    using stack_t = std::vector<std::pair<int, size_t>>;
+
+    bool match_class(const unicode_regex_class & cls, uint32_t c) const {
+        bool res;
+        if (c < 256) {
+            res = cls.low[c];
+        } else {
+            res = false;
+            for (const auto & r : cls.ranges) {
+                if (r.first <= c && c <= r.second) {
+                    res = true;
+                    break;
+                }
+            }
+            if (!res) {
+                for (const auto & m : cls.classes) {
+                    if (wtraits.isctype((wchar_t) c, m)) {
+                        res = true;
+                        break;
+                    }
+                }
+            }
+            if (!res) {
+                for (const auto & m : cls.neg_classes) {
+                    if (!wtraits.isctype((wchar_t) c, m)) {
+                        res = true;
+                        break;
+                    }
+                }
+            }
+        }
+        return res != cls.negate;
+    }
+
+    // match anchored at pos, the flags have the meaning of match_prev_avail and match_not_null of std::regex
+    bool run(stack_t & stack, const uint32_t * s, size_t end, int pc, size_t pos, bool prev_avail, bool not_null, size_t & out) const {
+        const size_t begin = pos;
+        const size_t base  = stack.size();
+
+        while (true) {
+            const auto & inst = code[pc];
+
+            bool ok = true;
+
+            switch (inst.op) {
+                case UNICODE_REGEX_OP_CLASS:
+                    if (pos < end && match_class(classes[inst.x], s[pos])) {
+                        pos++;
+                        pc++;
+                    } else {
+                        ok = false;
+                    }
+                    break;
+                case UNICODE_REGEX_OP_SPLIT:
+                    stack.emplace_back(inst.y, pos);
+                    pc = inst.x;
+                    break;
+                case UNICODE_REGEX_OP_JMP:
+                    pc = inst.x;
+                    break;
+                case UNICODE_REGEX_OP_BOL:
+                    ok = pos == begin && !prev_avail;
+                    pc++;
+                    break;
+                case UNICODE_REGEX_OP_EOL:
+                    ok = pos == end;
+                    pc++;
+                    break;
+                case UNICODE_REGEX_OP_LOOK:
+                    {
+                        // std::regex runs the lookahead as a separate search starting at the current position
+                        size_t tmp;
+                        ok = run(stack, s, end, inst.x, pos, prev_avail, not_null, tmp) != inst.neg;
+                        pc++;
+                    } break;
+                case UNICODE_REGEX_OP_MATCH:
+                    if (!not_null || pos != begin) {
+                        stack.resize(base);
+                        out = pos;
+                        return true;
+                    }
+                    ok = false;
+                    break;
+            }
+
+            if (!ok) {
+                if (stack.size() == base) {
+                    return false;
+                }
+                pc  = stack.back().first;
+                pos = stack.back().second;
+                stack.pop_back();
+            }
+        }
+    }
+
+    // equivalent of std::regex_search on [from, end)
+    bool search(stack_t & stack, const uint32_t * s, size_t from, size_t end, bool prev_avail, bool not_null, bool continuous, size_t & m_start, size_t & m_end) const {
+        for (size_t pos = from; ; ++pos) {
+            if (run(stack, s, end, 0, pos, prev_avail, not_null, m_end)) {
+                m_start = pos;
+                return true;
+            }
+            if (continuous || pos == end) {
+                return false;
+            }
+            prev_avail = true;
+        }
+    }
+};
+
+struct unicode_regex_node {
+    enum kind_t {
+        CLASS,
+        BOL,
+        EOL,
+        CONCAT,
+        ALT,
+        REPEAT,
+        LOOK,
+    };
+
+    kind_t kind;
+
+    int  cls    = -1;
+    int  min    = 0;
+    int  max    = 0;    // -1: unbounded
+    bool greedy = true;
+    bool neg    = false;
+
+    std::vector<unicode_regex_node> children;
+
+    bool nullable() const {
+        switch (kind) {
+            case CLASS:  return false;
+            case BOL:
+            case EOL:
+            case LOOK:   return true;
+            case CONCAT: return std::all_of(children.begin(), children.end(), [](const unicode_regex_node & c) { return c.nullable(); });
+            case ALT:    return std::any_of(children.begin(), children.end(), [](const unicode_regex_node & c) { return c.nullable(); });
+            case REPEAT: return min == 0 || children[0].nullable();
+        }
+        return true;
+    }
+};
+
+// recursive-descent parser for the ECMAScript subset used by the pre-tokenizers
+// anything else (backreferences, word boundaries, POSIX classes, ...) is reported as unsupported
+struct unicode_regex_parser {
+    unicode_regex_parser(const std::vector<uint32_t> & pat, unicode_regex_program & prog) : pat(pat), prog(prog) {}
+
+    const std::vector<uint32_t> & pat;
+
+    unicode_regex_program & prog;
+
+    size_t i = 0;
+
+    bool at(uint32_t c) const {
+        return i < pat.size() && pat[i] == c;
+    }
+
+    int new_class() {
+        prog.classes.emplace_back();
+        return (int) prog.classes.size() - 1;
+    }
+
+    void class_add_range(unicode_regex_class & cls, uint32_t a, uint32_t b) {
+        for (uint32_t c = a; c <= b && c < 256; ++c) {
+            cls.low[c] = true;
+        }
+        if (b >= 256) {
+            cls.ranges.emplace_back(std::max<uint32_t>(a, 256), b);
+        }
+    }
+
+    // \s, \d, \w and their negations, through the same regex traits as std::regex
+    void class_add_named(unicode_regex_class & cls, char name, bool negated) {
+        const char lname[2] = { (char) tolower(name), 0 };
+        if (prog.wide) {
+            const wchar_t wname[2] = { (wchar_t) lname[0], 0 };
+            const auto m = prog.wtraits.lookup_classname(wname, wname + 1);
+            for (uint32_t c = 0; c < 256; ++c) {
+                if (prog.wtraits.isctype((wchar_t) c, m) != negated) {
+                    cls.low[c] = true;
+                }
+            }
+            (negated ? cls.neg_classes : cls.classes).push_back(m);
+        } else {
+            const std::regex_traits<char> traits;
+            const auto m = traits.lookup_classname(lname, lname + 1);
+            for (uint32_t c = 0; c < 256; ++c) {
+                if (traits.isctype((char) c, m) != negated) {
+                    cls.low[c] = true;
+                }
+            }
+        }
+    }
+
+    bool parse_hex(int n, uint32_t & out) {
+        out = 0;
+        for (int k = 0; k < n; ++k) {
+            if (i >= pat.size() || pat[i] > 127 || !isxdigit((int) pat[i])) {
+                return false;
+            }
+            const uint32_t c = pat[i++];
+            out = out*16 + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+        return true;
+    }
+
+    // parses the escape after '\', either a character (named = 0) or a named class
+    bool parse_escape(bool in_class, uint32_t & c, char & named) {
+        if (i >= pat.size()) {
+            return false;
+        }
+
+        named = 0;
+        c = pat[i++];
+
+        switch (c) {
+            case 'd': case 'D': case 's': case 'S': case 'w': case 'W':
+                named = (char) c;
+                return true;
+            case 'f': c = '\f'; return true;
+            case 'n': c = '\n'; return true;
+            case 'r': c = '\r'; return true;
+            case 't': c = '\t'; return true;
+            case 'v': c = '\v'; return true;
+            case 'x': return parse_hex(2, c);
+            case 'u': return parse_hex(4, c);
+            case 'b':
+                if (in_class) {
+                    c = '\b';
+                    return true;
+                }
+                return false;
+            case '0':
+                if (i < pat.size() && pat[i] >= '0' && pat[i] <= '9') {
+                    return false;
+                }
+                c = 0;
+                return true;
+            default:
+                break;
+        }
+
+        // identity escapes of punctuation only, letters and digits have special meanings
+        return c > 127 || !isalnum((int) c);
+    }
+
+    bool parse_class(unicode_regex_node & node) {
+        node.kind = unicode_regex_node::CLASS;
+        node.cls  = new_class();
+
+        unicode_regex_class cls;
+
+        if (at('^')) {
+            cls.negate = true;
+            i++;
+        }
+
+        if (at(']')) {
+            return false;
+        }
+
+        while (true) {
+            if (i >= pat.size()) {
+                return false;
+            }
+            if (at(']')) {
+                i++;
+                break;
+            }
+            if (at('[') && i + 1 < pat.size() && (pat[i + 1] == ':' || pat[i + 1] == '=' || pat[i + 1] == '.')) {
+                return false;
+            }
+
+            uint32_t a = pat[i++];
+            char named = 0;
+            if (a == '\\' && !parse_escape(true, a, named)) {
+                return false;
+            }
+            if (named) {
+                class_add_named(cls, named, isupper((int) named) != 0);
+                continue;
+            }
+
+            if (at('-') && i + 1 < pat.size() && pat[i + 1] != ']') {
+                i++;
+                uint32_t b = pat[i++];
+                if (b == '\\' && !parse_escape(true, b, named)) {
+                    return false;
+                }
+                if (named || b < a) {
+                    return false;
+                }
+                class_add_range(cls, a, b);
+            } else {
+                class_add_range(cls, a, a);
+            }
+        }
+
+        prog.classes[node.cls] = std::move(cls);
+
+        return true;
+    }
+
+    bool parse_atom(unicode_regex_node & node) {
+        const uint32_t c = pat[i++];
+
+        switch (c) {
+            case '(':
+                {
+                    if (at('?')) {
+                        if (i + 1 >= pat.size()) {
+                            return false;
+                        }
+                        const uint32_t t = pat[i + 1];
+                        if (t != ':') {
+                            return false;
+                        }
+                        i += 2;
+                    }
+                    if (!parse_disjunction(node) || !at(')')) {
+                        return false;
+                    }
+                    i++;
+                    return true;
+                }
+            case '[':
+                return parse_class(node);
+            case '.':
+                {
+                    node.kind = unicode_regex_node::CLASS;
+                    node.cls  = new_class();
+                    auto & cls = prog.classes[node.cls];
+                    cls.negate = true;
+                    class_add_range(cls, '\n', '\n');
+                    class_add_range(cls, '\r', '\r');
+                    return true;
+                }
+            case '\\':
+                {
+                    uint32_t e;
+                    char named;
+                    if (!parse_escape(false, e, named)) {
+                        return false;
+                    }
+                    node.kind = unicode_regex_node::CLASS;
+                    node.cls  = new_class();
+                    auto & cls = prog.classes[node.cls];
+                    if (named) {
+                        class_add_named(cls, named, false);
+                        cls.negate = isupper((int) named) != 0;
+                    } else {
+                        class_add_range(cls, e, e);
+                    }
+                    return true;
+                }
+            case ')': case '*': case '+': case '?': case '{': case '}': case ']': case '|':
+                return false;
+            default:
+                {
+                    node.kind = unicode_regex_node::CLASS;
+                    node.cls  = new_class();
+                    class_add_range(prog.classes[node.cls], c, c);
+                    return true;
+                }
+        }
+    }
+
+    bool parse_number(int & out) {
+        if (i >= pat.size() || pat[i] < '0' || pat[i] > '9') {
+            return false;
+        }
+        out = 0;
+        while (i < pat.size() && pat[i] >= '0' && pat[i] <= '9') {
+            out = out*10 + (int) (pat[i++] - '0');
+            if (out > 1000) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parse_quantifier(unicode_regex_node & node) {
+        int min;
+        int max;
+
+        switch (pat[i]) {
+            case '*': min = 0; max = -1; i++; break;
+            case '+': min = 1; max = -1; i++; break;
+            case '?': min = 0; max =  1; i++; break;
+            case '{':
+                {
+                    i++;
+                    if (!parse_number(min)) {
+                        return false;
+                    }
+                    max = min;
+                    if (at(',')) {
+                        i++;
+                        max = -1;
+                        if (!at('}') && !parse_number(max)) {
+                            return false;
+                        }
+                    }
+                    if (!at('}') || (max >= 0 && max < min)) {
+                        return false;
+                    }
+                    i++;
+                } break;
+            default:
+                return true;
+        }
+
+        bool greedy = true;
+        if (at('?')) {
+            greedy = false;
+            i++;
+        }
+
+        // stacked quantifiers (possessive syntax) are not supported
+        if (at('*') || at('+') || at('?') || at('{')) {
+            return false;
+        }
+
+        // loops over a body that can match empty need the special handling of std::regex
+        if (max != min && node.nullable()) {
+            return false;
+        }
+
+        unicode_regex_node rep;
+        rep.kind   = unicode_regex_node::REPEAT;
+        rep.min    = min;
+        rep.max    = max;
+        rep.greedy = greedy;
+        rep.children.push_back(std::move(node));
+
+        node = std::move(rep);
+
+        return true;
+    }
+
+    bool parse_term(unicode_regex_node & node) {
+        if (at('^')) {
+            i++;
+            node.kind = unicode_regex_node::BOL;
+            return true;
+        }
+        if (at('$')) {
+            i++;
+            node.kind = unicode_regex_node::EOL;
+            return true;
+        }
+        if (at('(') && i + 2 < pat.size() && pat[i + 1] == '?' && (pat[i + 2] == '=' || pat[i + 2] == '!')) {
+            node.kind = unicode_regex_node::LOOK;
+            node.neg  = pat[i + 2] == '!';
+            i += 3;
+
+            unicode_regex_node sub;
+            if (!parse_disjunction(sub) || !at(')')) {
+                return false;
+            }
+            i++;
+
+            node.children.push_back(std::move(sub));
+
+            // quantified assertions are not supported
+            return !(at('*') || at('+') || at('?') || at('{'));
+        }
+
+        if (!parse_atom(node)) {
+            return false;
+        }
+
+        return i >= pat.size() || parse_quantifier(node);
+    }
+
+    bool parse_alternative(unicode_regex_node & node) {
+        node.kind = unicode_regex_node::CONCAT;
+        while (i < pat.size() && !at('|') && !at(')')) {
+            unicode_regex_node term;
+            if (!parse_term(term)) {
+                return false;
+            }
+            node.children.push_back(std::move(term));
+        }
+        return true;
+    }
+
+    bool parse_disjunction(unicode_regex_node & node) {
+        node.kind = unicode_regex_node::ALT;
+        while (true) {
+            unicode_regex_node alt;
+            if (!parse_alternative(alt)) {
+                return false;
+            }
+            node.children.push_back(std::move(alt));
+            if (!at('|')) {
+                break;
+            }
+            i++;
+        }
+        return true;
+    }
+};
+
+struct unicode_regex_codegen {
+    unicode_regex_program & prog;
+
+    std::vector<std::pair<int, const unicode_regex_node *>> lookaheads;
+
+    int here() const {
+        return (int) prog.code.size();
+    }
+
+    int push(unicode_regex_op op, int x = 0, int y = 0, bool neg = false) {
+        prog.code.push_back({ op, neg, x, y });
+        return here() - 1;
+    }
+
+    void emit(const unicode_regex_node & node) {
+        switch (node.kind) {
+            case unicode_regex_node::CLASS:
+                push(UNICODE_REGEX_OP_CLASS, node.cls);
+                break;
+            case unicode_regex_node::BOL:
+                push(UNICODE_REGEX_OP_BOL);
+                break;
+            case unicode_regex_node::EOL:
+                push(UNICODE_REGEX_OP_EOL);
+                break;
+            case unicode_regex_node::CONCAT:
+                for (const auto & child : node.children) {
+                    emit(child);
+                }
+                break;
+            case unicode_regex_node::ALT:
+                {
+                    std::vector<int> jmps;
+                    for (size_t k = 0; k + 1 < node.children.size(); ++k) {
+                        const int split = push(UNICODE_REGEX_OP_SPLIT, here() + 1);
+                        emit(node.children[k]);
+                        jmps.push_back(push(UNICODE_REGEX_OP_JMP));
+                        prog.code[split].y = here();
+                    }
+                    emit(node.children.back());
+                    for (int j : jmps) {
+                        prog.code[j].x = here();
+                    }
+                } break;
+            case unicode_regex_node::REPEAT:
+                {
+                    const auto & child = node.children[0];
+                    for (int k = 0; k < node.min; ++k) {
+                        emit(child);
+                    }
+                    if (node.max < 0) {
+                        const int split = push(UNICODE_REGEX_OP_SPLIT);
+                        emit(child);
+                        push(UNICODE_REGEX_OP_JMP, split);
+                        set_split(split, split + 1, here(), node.greedy);
+                    } else {
+                        // x{0,n} is nested as (x(x(...)?)?)?, so all optional copies exit at the same place
+                        std::vector<int> splits;
+                        for (int k = node.min; k < node.max; ++k) {
+                            splits.push_back(push(UNICODE_REGEX_OP_SPLIT));
+                            emit(child);
+                        }
+                        for (int split : splits) {
+                            set_split(split, split + 1, here(), node.greedy);
+                        }
+                    }
+                } break;
+            case unicode_regex_node::LOOK:
+                {
+                    const int look = push(UNICODE_REGEX_OP_LOOK, 0, 0, node.neg);
+                    lookaheads.emplace_back(look, &node.children[0]);
+                } break;
+        }
+    }
+
+    void set_split(int split, int body, int exit, bool greedy) {
+        prog.code[split].x = greedy ? body : exit;
+        prog.code[split].y = greedy ? exit : body;
+    }
+
+    void emit_program(const unicode_regex_node & root) {
+        emit(root);
+        push(UNICODE_REGEX_OP_MATCH);
+
+        // the lookaheads are separate programs placed after the main one
+        for (size_t k = 0; k < lookaheads.size(); ++k) {
+            prog.code[lookaheads[k].first].x = here();
+            emit(*lookaheads[k].second);
+            push(UNICODE_REGEX_OP_MATCH);
+        }
+    }
+};
+
+// returns nullptr if the regex uses syntax that is not supported by the compiled matcher
+static std::shared_ptr<const unicode_regex_program> unicode_regex_compile(const std::string & regex_expr, bool wide) {
+    std::vector<uint32_t> pat;
+    if (wide) {
+        pat = unicode_cpts_from_utf8(regex_expr);
+        for (uint32_t c : pat) {
+            // invalid UTF-8 or codepoints that do not fit in wchar_t
+            if (c == 0xFFFD || c > (uint32_t) std::numeric_limits<wchar_t>::max()) {
+                return nullptr;
+            }
+        }
+    } else {
+        pat.assign((const uint8_t *) regex_expr.data(), (const uint8_t *) regex_expr.data() + regex_expr.size());
+    }
+
+    auto prog = std::make_shared<unicode_regex_program>();
+    prog->wide = wide;
+
+    unicode_regex_parser parser(pat, *prog);
+
+    unicode_regex_node root;
+    if (!parser.parse_disjunction(root) || parser.i != pat.size()) {
+        return nullptr;
+    }
+
+    unicode_regex_codegen codegen { *prog, {} };
+    codegen.emit_program(root);
+
+    return prog;
+}
+
+static std::shared_ptr<const unicode_regex_program> unicode_regex_get_program(const std::string & regex_expr, bool wide) {
+    static std::mutex mtx;
+    static std::unordered_map<std::string, std::shared_ptr<const unicode_regex_program>> cache[2];
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    auto & c = cache[wide];
+
+    auto it = c.find(regex_expr);
+    if (it == c.end()) {
+        it = c.emplace(regex_expr, unicode_regex_compile(regex_expr, wide)).first;
+    }
+
+    return it->second;
+}
+
+// LLAMA_REGEX_VERIFY=1 also splits with std::regex wherever a compiled regex is used and fails on any difference
+static bool unicode_regex_verify() {
+    static const bool verify = [] {
+        const char * LLAMA_REGEX_VERIFY = getenv("LLAMA_REGEX_VERIFY");
+        return LLAMA_REGEX_VERIFY ? atoi(LLAMA_REGEX_VERIFY) != 0 : false;
+    }();
+    return verify;
+}
+
+static void unicode_regex_verify_split(const std::string & regex_expr, const std::vector<size_t> & compiled, const std::vector<size_t> & stl) {
+    if (compiled != stl) {
+        fprintf(stderr, "Compiled regex splits differ from std::regex: '%s'\n", regex_expr.c_str());
+        throw std::runtime_error("Compiled regex splits differ from std::regex");
+    }
+}
+
+// same splits as unicode_regex_split_stl, including the handling of empty matches by std::regex_iterator
+static std::vector<size_t> unicode_regex_split_compiled(const std::vector<uint32_t> & syms, const unicode_regex_program & prog, const std::vector<size_t> & offsets) {
+    std::vector<size_t> bpe_offsets; // store the offset of each word
+    bpe_offsets.reserve(offsets.size()); // Reserve memory for the approximate size
+
+    unicode_regex_program::stack_t stack;
+
+    size_t start = 0;
+    for (auto offset : offsets) {
+        const size_t end = start + offset;
+
+        size_t m_start = 0;
+        size_t m_end   = 0;
+
+        size_t start_idx  = start;
+        bool   prev_avail = false;
+
+        bool found = prog.search(stack, syms.data(), start, end, prev_avail, false, false, m_start, m_end);
+        while (found) {
+            if (m_start > start_idx) {
+                bpe_offsets.emplace_back(m_start - start_idx);
+            }
+            bpe_offsets.emplace_back(m_end - m_start);
+            start_idx = m_end;
+
+            size_t from = m_end;
+            if (m_start == m_end) {
+                if (m_end == end) {
+                    break;
+                }
+                // after an empty match, first look for a non-empty match at the same position
+                if (prog.search(stack, syms.data(), from, end, prev_avail, true, true, m_start, m_end)) {
+                    continue;
+                }
+                from++;
+            }
+
+            prev_avail = true;
+            found = prog.search(stack, syms.data(), from, end, prev_avail, false, false, m_start, m_end);
+        }
+
+        if (start_idx < end) {
+            bpe_offsets.emplace_back(end - start_idx);
+        }
+        start = end;
+    }
+
+    return bpe_offsets;
+}
+
 // K2 system regex patterns (from tokenization_kimi.py):
 // [\p{Han}]+|[^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}&&[^\p{Han}]]*[\p{Ll}\p{Lm}\p{Lo}\p{M}&&[^\p{Han}]]+(?i:'s|'t|'re|'ve|'m|'ll|'d)?|[^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}&&[^\p{Han}]]+[\p{Ll}\p{Lm}\p{Lo}\p{M}&&[^\p{Han}]]*(?i:'s|'t|'re|'ve|'m|'ll|'d)?|\p{N}{1,3}| ?[^\s\p{L}\p{N}]+[\r\n]*|\s*[\r\n]+|\s+(?!\S)|\s+
 static std::vector<size_t> unicode_regex_split_custom_kimi_k2(const std::string & text, const std::vector<size_t> & offsets) {
@@ -949,6 +1715,10 @@ std::vector<std::string> unicode_regex_split(const std::string & text, const std
 
     std::vector<size_t> bpe_offsets = { cpts.size() };
 
+    // input of the compiled regexes, built on first use
+    std::vector<uint32_t> syms_collapsed;
+    std::vector<uint32_t> syms_wide;
+
     for (const auto & regex_expr : regex_exprs) {
         // first, see if we have an efficient custom regex implementation
         auto tmp = unicode_regex_split_custom(text, regex_expr, bpe_offsets);
@@ -1021,12 +1791,40 @@ std::vector<std::string> unicode_regex_split(const std::string & text, const std
 
                 //printf("text_collapsed: %s\n", text_collapsed.c_str());
                 //printf("regex_expr_collapsed: %s\n", regex_expr_collapsed.c_str());
-                bpe_offsets = unicode_regex_split_stl(text_collapsed, regex_expr_collapsed, bpe_offsets);
+                if (auto prog = unicode_regex_get_program(regex_expr_collapsed, false)) {
+                    if (syms_collapsed.empty()) {
+                        syms_collapsed.assign((const uint8_t *) text_collapsed.data(), (const uint8_t *) text_collapsed.data() + text_collapsed.size());
+                    }
+                    auto offsets = unicode_regex_split_compiled(syms_collapsed, *prog, bpe_offsets);
+                    if (unicode_regex_verify()) {
+                        unicode_regex_verify_split(regex_expr, offsets, unicode_regex_split_stl(text_collapsed, regex_expr_collapsed, bpe_offsets));
+                    }
+                    bpe_offsets = std::move(offsets);
+                } else {
+                    bpe_offsets = unicode_regex_split_stl(text_collapsed, regex_expr_collapsed, bpe_offsets);
+                }
             } else {
                 // no unicode category used, we can use std::wregex directly
+                // std::wregex \s does not mach non-ASCII whitespaces, using 0x0B as fallback
+                if (auto prog = unicode_regex_get_program(regex_expr, true)) {
+                    if (syms_wide.empty()) {
+                        syms_wide.resize(cpts.size());
+                        for (size_t i = 0; i < cpts.size(); ++i) {
+                            const wchar_t wc = (wchar_t) cpts[i];
+                            syms_wide[i] = (uint32_t) wc > 0x7F && unicode_cpt_flags_from_cpt((uint32_t) wc).is_whitespace ? 0x0B : (uint32_t) wc;
+                        }
+                    }
+                    auto offsets = unicode_regex_split_compiled(syms_wide, *prog, bpe_offsets);
+                    if (unicode_regex_verify()) {
+                        const std::wstring wtext(syms_wide.begin(), syms_wide.end());
+                        unicode_regex_verify_split(regex_expr, offsets, unicode_regex_split_stl(wtext, unicode_wstring_from_utf8(regex_expr), bpe_offsets));
+                    }
+                    bpe_offsets = std::move(offsets);
+                    continue;
+                }
+
                 const std::wstring wregex_expr = unicode_wstring_from_utf8(regex_expr);
 
-                // std::wregex \s does not mach non-ASCII whitespaces, using 0x0B as fallback
                 std::wstring wtext(cpts.begin(), cpts.end());
                 for (size_t i = 0; i < wtext.size(); ++i) {
                     if (wtext[i] > 0x7F && unicode_cpt_flags_from_cpt(wtext[i]).is_whitespace) {
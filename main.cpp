@@ -1,16 +1,110 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <chrono>
 #include <cstring>
 #include <cstdio>
 #include <climits>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <semaphore.h>
 #include <signal.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <ctime>
 #include "llama.h"
+#include "common.h"
+#include "log.h"
+
+// Request queue of the shared memory mode: concurrent clients each claim a slot instead of taking turns on the
+// single request area, and the scheduler serves the slots by priority and deadline
+static const int QUEUE_SLOTS = 8;
+
+// Context size of one request: the scheduler sizes the KV cache so every sequence it runs at once can reach it
+static const uint32_t SEQ_CTX = 2048;
+
+enum RequestSlotState {
+    SLOT_FREE = 0,                 // Available, claimed by a producer while holding sem_queue_lock
+    SLOT_CLAIMED,                  // A producer is writing the request
+    SLOT_QUEUED,                   // Ready to be scheduled
+    SLOT_RUNNING,                  // Picked up by the scheduler
+    SLOT_DONE,                     // Response and status are final, the producer frees the slot
+    SLOT_ASSIGNED,                 // Handed to the worker in RequestSlot::worker by the supervisor (--workers)
+};
+
+enum RequestPriority {
+    PRIORITY_BACKGROUND = 0,       // Batch work (e.g. summarisation), preempted by interactive requests
+    PRIORITY_INTERACTIVE = 1,      // A user is waiting for the response
+};
+
+enum RequestStatus {
+    STATUS_OK = 0,
+    STATUS_EXPIRED,                // The deadline passed before generation started
+    STATUS_FAILED,                 // Tokenization or decoding failed (e.g. the KV cache is full)
+};
+
+struct RequestSlot {
+    int state;                     // RequestSlotState
+    int request_id;                // Assigned by the producer from next_request_id
+    int priority;                  // RequestPriority, higher is served first
+    int status;                    // RequestStatus, valid once the slot is SLOT_DONE
+    long long deadline_ms;         // Unix time in ms by which generation must have started, 0 = none
+    int max_tokens;                // Maximum tokens to generate, 0 = until end of generation
+    bool stream_mode;              // If true, send partial responses
+    bool generation_complete;      // True when generation is finished
+
+    // Same streaming protocol as the single request area, with lazy wakeups always on
+    int update_counter;
+    int tokens_generated;
+    int response_length;
+    int reader_waiting;
+    int update_ack;
+
+    // The request and response live in the slot's data segment (/llama_cpp_slot_data_<i>): the request record
+    // [int32 length][system prompt][int32 length][user prompt] at offset 0, the response bytes at response_offset.
+    // Whoever needs more room (the producer for a large prompt, C++ for a long response) grows the segment and
+    // then publishes the new size, the other side remaps when it sees a larger data_size.
+    int request_size;              // Bytes of the request record
+    int response_offset;           // Offset of the response, after the request record
+    int worker;                    // Worker pool process serving the request, set by the supervisor
+    long long data_size;           // Current size of the data segment, never shrinks
+};
+
+enum TokenizerOp {
+    TOKENIZER_TOKENIZE = 0,        // Items [int32 length][UTF-8 text], response items [int32 n_tokens][int32 tokens...]
+    TOKENIZER_DETOKENIZE,          // Items [int32 n_tokens][int32 tokens...], response items [int32 length][UTF-8 text]
+    TOKENIZER_COUNT,               // Items as for TOKENIZER_TOKENIZE, response int32 n_tokens per item
+    TOKENIZER_COUNT_PROMPT,        // Items are system prompt, user prompt pairs, response int32 n_tokens per pair of the
+                                   // full prompt a generation request evaluates
+};
+
+enum TokenizerFlags {
+    TOKENIZER_ADD_SPECIAL = 1,     // Add BOS/EOS as the model expects
+    TOKENIZER_PARSE_SPECIAL = 2,   // Parse special tokens in the text, or render them when detokenizing
+};
+
+// Tokenizer requests bypass the request queue and are served by their own thread. The request record is at offset 0
+// of the data segment /llama_cpp_tokenizer_data, C++ writes the response record after it. The segment grows the same
+// way as the slot data segments. Callers hold sem_tokenizer_lock, post sem_tokenizer_request and wait on
+// sem_tokenizer_response.
+struct TokenizerChannel {
+    int op;                        // TokenizerOp
+    int n_items;                   // Number of items (pairs for TOKENIZER_COUNT_PROMPT)
+    int flags;                     // TokenizerFlags
+    int status;                    // 0 = ok, 1 = malformed request
+    int request_size;              // Bytes of the request record
+    int response_offset;           // Offset of the response record, set by C++
+    int response_size;             // Bytes of the response record, set by C++
+    long long data_size;           // Current size of the data segment, never shrinks
+};
 
 // Shared memory structure
 struct SharedMemoryData {
@@ -24,6 +118,66 @@ struct SharedMemoryData {
     int update_counter;            // Increments with each partial update
     bool generation_complete;      // True when generation is finished
     int tokens_generated;          // Number of tokens generated so far
+    int response_length;           // Bytes of response published so far, new deltas are appended at this offset
+
+    // Wakeup protocol
+    int reader_waiting;            // Set by a reader before it blocks on sem_chunk_ready, cleared by the writer when it posts
+    int update_ack;                // Last update_counter the reader has processed
+    bool lazy_wakeup;              // Set by C#: only post sem_chunk_ready when reader_waiting is set
+
+    // Request queue
+    int queue_slots;               // Number of slots, 0 when the server only has the single request area
+    int next_request_id;           // Last request id handed out, protected by sem_queue_lock
+    RequestSlot slots[QUEUE_SLOTS];
+
+    TokenizerChannel tokenizer;
+};
+
+// The C# side addresses the fields by byte offset, keep these in sync with LocalLLMService.cs
+static_assert(offsetof(SharedMemoryData, response)            == 8192,  "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, update_counter)      == 40964, "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, generation_complete) == 40968, "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, tokens_generated)    == 40972, "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, response_length)     == 40976, "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, reader_waiting)      == 40980, "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, update_ack)          == 40984, "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, lazy_wakeup)         == 40988, "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, queue_slots)         == 40992, "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, next_request_id)     == 40996, "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, slots)               == 41000, "unexpected shared memory layout");
+static_assert(offsetof(RequestSlot, deadline_ms)              == 16,    "unexpected shared memory layout");
+static_assert(offsetof(RequestSlot, update_counter)           == 32,    "unexpected shared memory layout");
+static_assert(offsetof(RequestSlot, update_ack)               == 48,    "unexpected shared memory layout");
+static_assert(offsetof(RequestSlot, request_size)             == 52,    "unexpected shared memory layout");
+static_assert(offsetof(RequestSlot, data_size)                == 64,    "unexpected shared memory layout");
+static_assert(sizeof(RequestSlot)                             == 72,    "unexpected shared memory layout");
+static_assert(offsetof(SharedMemoryData, tokenizer)           == 41576, "unexpected shared memory layout");
+static_assert(offsetof(TokenizerChannel, data_size)           == 32,    "unexpected shared memory layout");
+
+// Initial size of the slot and tokenizer data segments, grown on demand
+static const size_t SLOT_DATA_INITIAL_SIZE = 64 * 1024;
+
+// A shared memory segment either side can grow: the grower resizes it, then publishes the new size in the header,
+// and the other side remaps when it sees a size larger than its mapping
+struct DataSegment {
+    std::string name;
+    int fd = -1;
+    char* data = nullptr;          // Current mapping
+    size_t mapped = 0;             // Size of the current mapping
+    long long* size = nullptr;     // Published size, in SharedMemoryData
+};
+
+// Coalescing of the streaming notifications (shared memory mode)
+struct StreamNotifyParams {
+    int interval_ms = 16;          // Minimum time between two notifications, 0 notifies every token
+    int max_interval_ms = 128;     // Upper bound of the interval while the reader falls behind
+    int chunk_bytes = 256;         // Notify early once this many bytes are pending, 0 disables
+};
+
+// Per-request statistics for the structured request log
+struct RequestStats {
+    int n_prompt = 0;              // Number of prompt tokens
+    int n_gen = 0;                 // Number of generated tokens
 };
 
 // Global variables for cleanup
@@ -33,6 +187,16 @@ static sem_t* sem_ready = nullptr;
 static sem_t* sem_prompts_written = nullptr;
 static sem_t* sem_response_written = nullptr;
 static sem_t* sem_chunk_ready = nullptr;  // For streaming updates
+static sem_t* sem_queue = nullptr;        // Rung when there is work for the scheduler
+static sem_t* sem_queue_lock = nullptr;   // Serializes slot claims between producers
+static sem_t* sem_queue_free = nullptr;   // Counts free slots
+static sem_t* sem_slot[QUEUE_SLOTS] = {}; // Per slot updates
+static sem_t* sem_worker[QUEUE_SLOTS] = {}; // Rung by the supervisor when it assigns a slot to a pool worker
+static sem_t* sem_tokenizer_lock = nullptr;     // Serializes tokenizer callers
+static sem_t* sem_tokenizer_request = nullptr;  // Rung by the caller once the request is written
+static sem_t* sem_tokenizer_response = nullptr; // Rung by C++ once the response is written
+static DataSegment slot_segment[QUEUE_SLOTS];
+static DataSegment tokenizer_segment;
 static pthread_mutex_t* shared_mutex = nullptr;
 
 void print_usage(const char* program_name) {
@@ -52,6 +216,10 @@ void print_usage(const char* program_name) {
     std::cout << "  " << program_name << " --test --max-tokens 0     # Unlimited (until model stops naturally)\n";
     std::cout << "  " << program_name << " --test --system \"You are a coding expert\"  # Interactive with custom system\n";
     std::cout << "  " << program_name << " --test --user \"What is C++?\"              # One-shot mode\n";
+    std::cout << "\nShared Memory Mode Options:\n";
+    std::cout << "  --stream-interval-ms <n>  Minimum time between streaming updates (default: 16, 0 = every token)\n";
+    std::cout << "  --stream-chunk-bytes <n>  Send an update early once n bytes are pending (default: 256, 0 = disabled)\n";
+    std::cout << "  --workers <n>             Serve the request queue with n processes sharing the model (default: 1, max: 8)\n";
     std::cout << "\nShared Memory Mode:\n";
     std::cout << "  " << program_name << "                          # Background process for C# integration\n";
 }
@@ -74,6 +242,64 @@ bool has_flag(int argc, char** argv, const std::string& flag) {
     return false;
 }
 
+// Create a data segment of initial_size bytes and publish its size, pages are only backed once they are written
+static bool create_segment(DataSegment& segment, const std::string& name, long long* size, size_t initial_size) {
+    segment.name = name;
+    segment.size = size;
+    shm_unlink(name.c_str());
+    segment.fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0666);
+    if (segment.fd == -1 || ftruncate(segment.fd, initial_size) == -1) {
+        return false;
+    }
+    *size = (long long) initial_size;
+    return true;
+}
+
+static void destroy_segment(DataSegment& segment) {
+    if (segment.data != nullptr) {
+        munmap(segment.data, segment.mapped);
+        segment.data = nullptr;
+        segment.mapped = 0;
+    }
+    
+    if (segment.fd != -1) {
+        close(segment.fd);
+        shm_unlink(segment.name.c_str());
+        segment.fd = -1;
+    }
+}
+
+// Map the current size of a data segment, after the other side or grow_segment changed it
+static bool map_segment(DataSegment& segment) {
+    const size_t size = (size_t) __atomic_load_n(segment.size, __ATOMIC_ACQUIRE);
+    if (segment.data != nullptr && segment.mapped == size) {
+        return true;
+    }
+    
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (data == MAP_FAILED) {
+        LOG_ERR("Error: Failed to map %s (%zu bytes)\n", segment.name.c_str(), size);
+        return false;
+    }
+    if (segment.data != nullptr) {
+        munmap(segment.data, segment.mapped);
+    }
+    segment.data = (char*) data;
+    segment.mapped = size;
+    return true;
+}
+
+// Grow a data segment to at least min_size bytes and publish the new size
+static bool grow_segment(DataSegment& segment, size_t min_size) {
+    const size_t size = std::max(min_size, 2 * (size_t) *segment.size);
+    if (size > (size_t) INT_MAX || ftruncate(segment.fd, size) == -1) {
+        LOG_ERR("Error: Failed to grow %s to %zu bytes\n", segment.name.c_str(), size);
+        return false;
+    }
+    __atomic_store_n(segment.size, (long long) size, __ATOMIC_RELEASE);
+    return map_segment(segment);
+}
+
 // Cleanup function
 void cleanup_shared_resources() {
     if (shared_mem != nullptr) {
@@ -110,6 +336,52 @@ void cleanup_shared_resources() {
         sem_unlink("/llama_cpp_sem_chunk_ready");
         sem_chunk_ready = nullptr;
     }
+    
+    if (sem_queue != nullptr) {
+        sem_close(sem_queue);
+        sem_unlink("/llama_cpp_sem_queue");
+        sem_queue = nullptr;
+    }
+    
+    if (sem_queue_lock != nullptr) {
+        sem_close(sem_queue_lock);
+        sem_unlink("/llama_cpp_sem_queue_lock");
+        sem_queue_lock = nullptr;
+    }
+    
+    if (sem_queue_free != nullptr) {
+        sem_close(sem_queue_free);
+        sem_unlink("/llama_cpp_sem_queue_free");
+        sem_queue_free = nullptr;
+    }
+    
+    for (int i = 0; i < QUEUE_SLOTS; i++) {
+        if (sem_slot[i] != nullptr) {
+            sem_close(sem_slot[i]);
+            sem_unlink(("/llama_cpp_sem_slot_" + std::to_string(i)).c_str());
+            sem_slot[i] = nullptr;
+        }
+        
+        destroy_segment(slot_segment[i]);
+        
+        if (sem_worker[i] != nullptr) {
+            sem_close(sem_worker[i]);
+            sem_unlink(("/llama_cpp_sem_worker_" + std::to_string(i)).c_str());
+            sem_worker[i] = nullptr;
+        }
+    }
+    
+    destroy_segment(tokenizer_segment);
+    
+    for (auto [sem, name] : { std::make_pair(&sem_tokenizer_lock, "/llama_cpp_sem_tokenizer_lock"),
+                              std::make_pair(&sem_tokenizer_request, "/llama_cpp_sem_tokenizer_request"),
+                              std::make_pair(&sem_tokenizer_response, "/llama_cpp_sem_tokenizer_response") }) {
+        if (*sem != nullptr) {
+            sem_close(*sem);
+            sem_unlink(name);
+            *sem = nullptr;
+        }
+    }
 }
 
 // Signal handler for graceful shutdown
@@ -124,13 +396,13 @@ bool init_shared_memory() {
     // Create shared memory
     shm_fd = shm_open("/llama_cpp_shared_mem", O_CREAT | O_RDWR, 0666);
     if (shm_fd == -1) {
-        std::cerr << "Error: Failed to create shared memory" << std::endl;
+        LOG_ERR("Error: Failed to create shared memory\n");
         return false;
     }
     
     // Set the size of shared memory
     if (ftruncate(shm_fd, sizeof(SharedMemoryData)) == -1) {
-        std::cerr << "Error: Failed to set shared memory size" << std::endl;
+        LOG_ERR("Error: Failed to set shared memory size\n");
         close(shm_fd);
         shm_unlink("/llama_cpp_shared_mem");
         return false;
@@ -140,7 +412,7 @@ bool init_shared_memory() {
     shared_mem = (SharedMemoryData*)mmap(NULL, sizeof(SharedMemoryData), 
                                           PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
     if (shared_mem == MAP_FAILED) {
-        std::cerr << "Error: Failed to map shared memory" << std::endl;
+        LOG_ERR("Error: Failed to map shared memory\n");
         close(shm_fd);
         shm_unlink("/llama_cpp_shared_mem");
         return false;
@@ -149,53 +421,150 @@ bool init_shared_memory() {
     // Initialize shared memory
     memset(shared_mem, 0, sizeof(SharedMemoryData));
     shared_mem->shutdown_requested = false;
+    shared_mem->queue_slots = QUEUE_SLOTS;
     
     // Create semaphores
     sem_unlink("/llama_cpp_sem_ready");
     sem_ready = sem_open("/llama_cpp_sem_ready", O_CREAT, 0666, 0);
     if (sem_ready == SEM_FAILED) {
-        std::cerr << "Error: Failed to create ready semaphore" << std::endl;
+        LOG_ERR("Error: Failed to create ready semaphore\n");
         return false;
     }
     
     sem_unlink("/llama_cpp_sem_prompts_written");
     sem_prompts_written = sem_open("/llama_cpp_sem_prompts_written", O_CREAT, 0666, 0);
     if (sem_prompts_written == SEM_FAILED) {
-        std::cerr << "Error: Failed to create prompts_written semaphore" << std::endl;
+        LOG_ERR("Error: Failed to create prompts_written semaphore\n");
         return false;
     }
     
     sem_unlink("/llama_cpp_sem_response_written");
     sem_response_written = sem_open("/llama_cpp_sem_response_written", O_CREAT, 0666, 0);
     if (sem_response_written == SEM_FAILED) {
-        std::cerr << "Error: Failed to create response_written semaphore" << std::endl;
+        LOG_ERR("Error: Failed to create response_written semaphore\n");
         return false;
     }
     
     sem_unlink("/llama_cpp_sem_chunk_ready");
     sem_chunk_ready = sem_open("/llama_cpp_sem_chunk_ready", O_CREAT, 0666, 0);
     if (sem_chunk_ready == SEM_FAILED) {
-        std::cerr << "Error: Failed to create chunk_ready semaphore" << std::endl;
+        LOG_ERR("Error: Failed to create chunk_ready semaphore\n");
+        return false;
+    }
+    
+    sem_unlink("/llama_cpp_sem_queue");
+    sem_queue = sem_open("/llama_cpp_sem_queue", O_CREAT, 0666, 0);
+    if (sem_queue == SEM_FAILED) {
+        LOG_ERR("Error: Failed to create queue semaphore\n");
+        return false;
+    }
+    
+    sem_unlink("/llama_cpp_sem_queue_lock");
+    sem_queue_lock = sem_open("/llama_cpp_sem_queue_lock", O_CREAT, 0666, 1);
+    if (sem_queue_lock == SEM_FAILED) {
+        LOG_ERR("Error: Failed to create queue_lock semaphore\n");
+        return false;
+    }
+    
+    sem_unlink("/llama_cpp_sem_queue_free");
+    sem_queue_free = sem_open("/llama_cpp_sem_queue_free", O_CREAT, 0666, QUEUE_SLOTS);
+    if (sem_queue_free == SEM_FAILED) {
+        LOG_ERR("Error: Failed to create queue_free semaphore\n");
+        return false;
+    }
+    
+    for (int i = 0; i < QUEUE_SLOTS; i++) {
+        const std::string name = "/llama_cpp_sem_slot_" + std::to_string(i);
+        sem_unlink(name.c_str());
+        sem_slot[i] = sem_open(name.c_str(), O_CREAT, 0666, 0);
+        if (sem_slot[i] == SEM_FAILED) {
+            LOG_ERR("Error: Failed to create slot semaphore %d\n", i);
+            return false;
+        }
+        
+        // Create the data segment of the slot
+        if (!create_segment(slot_segment[i], "/llama_cpp_slot_data_" + std::to_string(i),
+                            &shared_mem->slots[i].data_size, SLOT_DATA_INITIAL_SIZE)) {
+            LOG_ERR("Error: Failed to create slot data segment %d\n", i);
+            return false;
+        }
+    }
+    
+    // Tokenizer channel
+    sem_unlink("/llama_cpp_sem_tokenizer_lock");
+    sem_unlink("/llama_cpp_sem_tokenizer_request");
+    sem_unlink("/llama_cpp_sem_tokenizer_response");
+    sem_tokenizer_lock = sem_open("/llama_cpp_sem_tokenizer_lock", O_CREAT, 0666, 1);
+    sem_tokenizer_request = sem_open("/llama_cpp_sem_tokenizer_request", O_CREAT, 0666, 0);
+    sem_tokenizer_response = sem_open("/llama_cpp_sem_tokenizer_response", O_CREAT, 0666, 0);
+    if (sem_tokenizer_lock == SEM_FAILED || sem_tokenizer_request == SEM_FAILED || sem_tokenizer_response == SEM_FAILED) {
+        LOG_ERR("Error: Failed to create tokenizer semaphores\n");
+        return false;
+    }
+    if (!create_segment(tokenizer_segment, "/llama_cpp_tokenizer_data", &shared_mem->tokenizer.data_size,
+                        SLOT_DATA_INITIAL_SIZE)) {
+        LOG_ERR("Error: Failed to create tokenizer data segment\n");
         return false;
     }
     
     return true;
 }
 
+// Create the doorbells of the worker pool
+static bool init_worker_pool(int n_workers) {
+    for (int w = 0; w < n_workers; w++) {
+        const std::string name = "/llama_cpp_sem_worker_" + std::to_string(w);
+        sem_unlink(name.c_str());
+        sem_worker[w] = sem_open(name.c_str(), O_CREAT, 0666, 0);
+        if (sem_worker[w] == SEM_FAILED) {
+            sem_worker[w] = nullptr;
+            LOG_ERR("Error: Failed to create worker semaphore %d\n", w);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Read the system and user prompts from the request record of a slot
+static bool read_slot_request(int i, std::string& system_prompt, std::string& user_prompt) {
+    const RequestSlot& slot = shared_mem->slots[i];
+    const DataSegment& segment = slot_segment[i];
+    const size_t size = std::min((size_t) std::max(slot.request_size, 0), segment.mapped);
+    size_t pos = 0;
+    for (std::string* field : { &system_prompt, &user_prompt }) {
+        int32_t len = 0;
+        if (pos + sizeof(len) > size) {
+            return false;
+        }
+        memcpy(&len, segment.data + pos, sizeof(len));
+        pos += sizeof(len);
+        if (len < 0 || pos + (size_t) len > size) {
+            return false;
+        }
+        field->assign(segment.data + pos, len);
+        pos += len;
+    }
+    return slot.response_offset >= (int) pos && (size_t) slot.response_offset <= segment.mapped;
+}
+
+// Chat prompt of a request, in the format of the model
+static std::string format_prompt(const std::string& system_prompt, const std::string& user_prompt) {
+    if (!system_prompt.empty()) {
+        return "<|system|>\n" + system_prompt + "<|end|>\n<|user|>\n" + user_prompt + "<|end|>\n<|assistant|>\n";
+    }
+    return "<|user|>\n" + user_prompt + "<|end|>\n<|assistant|>\n";
+}
+
 // Process inference request
 std::string process_llm_request(llama_model* model, llama_context* ctx, 
                                 const llama_vocab* vocab, llama_sampler* smpl,
                                 const std::string& system_prompt, 
                                 const std::string& user_prompt,
                                 bool print_output = true,
-                                int max_tokens = 4096) {
+                                int max_tokens = 4096,
+                                RequestStats* stats = nullptr) {
     // Build the prompt
-    std::string full_prompt;
-    if (!system_prompt.empty()) {
-        full_prompt = "<|system|>\n" + system_prompt + "<|end|>\n<|user|>\n" + user_prompt + "<|end|>\n<|assistant|>\n";
-    } else {
-        full_prompt = "<|user|>\n" + user_prompt + "<|end|>\n<|assistant|>\n";
-    }
+    const std::string full_prompt = format_prompt(system_prompt, user_prompt);
 
     if (print_output) {
         std::cout << "\n--- Prompt ---\n" << full_prompt << std::endl;
@@ -207,7 +576,7 @@ std::string process_llm_request(llama_model* model, llama_context* ctx,
     std::vector<llama_token> tokens_list(n_prompt_tokens);
     
     if (llama_tokenize(vocab, full_prompt.c_str(), full_prompt.length(), tokens_list.data(), tokens_list.size(), true, true) < 0) {
-        std::cerr << "Error: Failed to tokenize prompt" << std::endl;
+        LOG_ERR("Error: Failed to tokenize prompt\n");
         return "";
     }
 
@@ -216,7 +585,7 @@ std::string process_llm_request(llama_model* model, llama_context* ctx,
 
     // Evaluate the prompt
     if (llama_decode(ctx, batch) != 0) {
-        std::cerr << "Error: Failed to decode prompt" << std::endl;
+        LOG_ERR("Error: Failed to decode prompt\n");
         return "";
     }
 
@@ -237,7 +606,7 @@ std::string process_llm_request(llama_model* model, llama_context* ctx,
         char buf[256];
         int n = llama_token_to_piece(vocab, new_token_id, buf, sizeof(buf), 0, true);
         if (n < 0) {
-            std::cerr << "\nError: Failed to convert token to piece" << std::endl;
+            LOG_ERR("Error: Failed to convert token to piece\n");
             break;
         }
         std::string piece(buf, n);
@@ -254,7 +623,7 @@ std::string process_llm_request(llama_model* model, llama_context* ctx,
 
         // Evaluate
         if (llama_decode(ctx, batch) != 0) {
-            std::cerr << "\nError: Failed to decode" << std::endl;
+            LOG_ERR("Error: Failed to decode\n");
             break;
         }
     }
@@ -264,6 +633,11 @@ std::string process_llm_request(llama_model* model, llama_context* ctx,
         std::cout << "Tokens generated: " << n_decode << std::endl;
     }
     
+    if (stats != nullptr) {
+        stats->n_prompt = n_prompt_tokens;
+        stats->n_gen = n_decode;
+    }
+
     // Reset the sampler state
     llama_sampler_reset(smpl);
     
@@ -274,101 +648,741 @@ std::string process_llm_request(llama_model* model, llama_context* ctx,
     return response;
 }
 
-// Process inference request with streaming support for shared memory
-std::string process_llm_request_streaming(llama_model* model, llama_context* ctx, 
-                                          const llama_vocab* vocab, llama_sampler* smpl,
-                                          const std::string& system_prompt, 
-                                          const std::string& user_prompt,
-                                          int max_tokens = 4096) {
+// Where a generation publishes its response: the single request area or a queue slot
+struct ResponseChannel {
+    int slot;                      // Queue slot whose data segment holds the response, -1 for the single request area
+    char* response;
+    size_t capacity;
+    int* response_length;
+    int* update_counter;
+    int* tokens_generated;
+    int* reader_waiting;
+    int* update_ack;
+    bool* generation_complete;
+    sem_t* sem;                    // Posted on updates
+};
+
+static ResponseChannel legacy_channel() {
+    // Keep the last byte for the '\0' that readers of the single request area rely on
+    return { -1, shared_mem->response, sizeof(shared_mem->response) - 1, &shared_mem->response_length,
+             &shared_mem->update_counter, &shared_mem->tokens_generated, &shared_mem->reader_waiting,
+             &shared_mem->update_ack, &shared_mem->generation_complete, sem_chunk_ready };
+}
+
+static ResponseChannel slot_channel(int i) {
+    RequestSlot& slot = shared_mem->slots[i];
+    const size_t offset = (size_t) slot.response_offset;
+    const DataSegment& segment = slot_segment[i];
+    return { i, segment.data != nullptr ? segment.data + offset : nullptr,
+             segment.data != nullptr ? segment.mapped - offset : 0, &slot.response_length, &slot.update_counter,
+             &slot.tokens_generated, &slot.reader_waiting, &slot.update_ack, &slot.generation_complete, sem_slot[i] };
+}
+
+// Make room for size bytes of response, growing the data segment of a slot. Returns the available capacity.
+static size_t channel_reserve(ResponseChannel& channel, size_t size) {
+    if (channel.slot >= 0 && channel.response != nullptr && size > channel.capacity) {
+        const size_t offset = (size_t) shared_mem->slots[channel.slot].response_offset;
+        DataSegment& segment = slot_segment[channel.slot];
+        if (grow_segment(segment, offset + size)) {
+            channel.response = segment.data + offset;
+            channel.capacity = segment.mapped - offset;
+        }
+    }
+    return channel.capacity;
+}
+
+// Tell the reader that update_counter moved. With lazy wakeups the reader polls update_counter and
+// announces itself in reader_waiting before blocking, so the semaphore is only posted when someone sleeps on it.
+static bool notify_stream_update(const ResponseChannel& channel, bool lazy_wakeup) {
+    __atomic_add_fetch(channel.update_counter, 1, __ATOMIC_SEQ_CST);
+    if (lazy_wakeup && __atomic_exchange_n(channel.reader_waiting, 0, __ATOMIC_SEQ_CST) == 0) {
+        return false;
+    }
+    sem_post(channel.sem);
+    return true;
+}
+
+// Publish the final update of a queue slot. The slot belongs to its producer again as soon as SLOT_DONE is
+// visible, so the last update_counter bump and the reader_waiting handshake happen before the state store, and
+// only the semaphore, which lives outside the slot, is posted after it. Returns true if the semaphore was posted.
+static bool complete_slot(const ResponseChannel& channel, int status, bool lazy_wakeup) {
+    RequestSlot& slot = shared_mem->slots[channel.slot];
+    *channel.generation_complete = true;
+    slot.status = status;
+    __atomic_add_fetch(channel.update_counter, 1, __ATOMIC_SEQ_CST);
+    const bool post = !lazy_wakeup || __atomic_exchange_n(channel.reader_waiting, 0, __ATOMIC_SEQ_CST) != 0;
+    __atomic_store_n(&slot.state, (int) SLOT_DONE, __ATOMIC_RELEASE);
+    if (post) {
+        sem_post(channel.sem);
+    }
+    return post;
+}
+
+static long long unix_time_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// A request served in shared memory mode. Generation advances one token per step, so the scheduler can switch
+// to a more urgent request at any token boundary; each job keeps its tokens in its own KV sequence.
+struct GenerationJob {
+    int id = 0;                    // Sequence number for the log
+    int request_id = -1;           // Producer's id, -1 for the single request area
+    int slot = -1;                 // Queue slot, -1 for the single request area
+    int priority = PRIORITY_INTERACTIVE;
+    long long deadline_ms = 0;
+    int max_tokens = 4096;         // Single request area has no field for it, keep the pre-queue default
+    bool stream = false;
+    bool lazy_wakeup = false;
+    int status = STATUS_OK;
+    ResponseChannel channel;
+    llama_seq_id seq_id = 0;
+    llama_sampler* smpl = nullptr;
+
+    std::vector<llama_token> prompt;
+    bool started = false;
+    llama_token last_token = LLAMA_TOKEN_NULL;
+    llama_pos n_past = 0;
+    int n_decode = 0;
+
+    // Streaming notifications, see job_step
+    size_t n_published = 0;
+    size_t n_notified = 0;
+    int n_notify = 0;
+    int n_wakeup = 0;
+    int interval_ms = 0;
+    std::chrono::steady_clock::time_point t_notify;
+    std::chrono::steady_clock::time_point t_start;
+};
+
+// Tokenize the prompt and reset the response channel of a new job
+static bool job_init(llama_context* ctx, const llama_vocab* vocab, GenerationJob& job,
+                     const std::string& system_prompt, const std::string& user_prompt,
+                     const StreamNotifyParams& notify_params) {
     // Build the prompt
-    std::string full_prompt;
-    if (!system_prompt.empty()) {
-        full_prompt = "<|system|>\n" + system_prompt + "<|end|>\n<|user|>\n" + user_prompt + "<|end|>\n<|assistant|>\n";
-    } else {
-        full_prompt = "<|user|>\n" + user_prompt + "<|end|>\n<|assistant|>\n";
+    const std::string full_prompt = format_prompt(system_prompt, user_prompt);
+
+    // Initialize streaming state in shared memory
+    *job.channel.generation_complete = false;
+    *job.channel.update_counter = 0;
+    *job.channel.tokens_generated = 0;
+    *job.channel.response_length = 0;
+    if (job.channel.slot < 0) {
+        memset(job.channel.response, 0, job.channel.capacity + 1);
     }
 
+    job.interval_ms = notify_params.interval_ms;
+    job.t_start = std::chrono::steady_clock::now();
+
     // Tokenize the prompt
     const int n_prompt_tokens = -llama_tokenize(vocab, full_prompt.c_str(), full_prompt.length(), NULL, 0, true, true);
-    std::vector<llama_token> tokens_list(n_prompt_tokens);
+    job.prompt.resize(n_prompt_tokens);
     
-    if (llama_tokenize(vocab, full_prompt.c_str(), full_prompt.length(), tokens_list.data(), tokens_list.size(), true, true) < 0) {
-        std::cerr << "Error: Failed to tokenize prompt" << std::endl;
-        return "";
+    if (llama_tokenize(vocab, full_prompt.c_str(), full_prompt.length(), job.prompt.data(), job.prompt.size(), true, true) < 0) {
+        LOG_ERR("Error: Failed to tokenize prompt\n");
+        return false;
+    }
+    if (job.prompt.empty() || job.prompt.size() >= std::min(SEQ_CTX, llama_n_ctx(ctx))) {
+        LOG_ERR("Error: Prompt of %zu tokens does not fit in the context\n", job.prompt.size());
+        return false;
+    }
+    return true;
+}
+
+// Send a stream update for everything published so far
+static void job_notify(GenerationJob& job, std::chrono::steady_clock::time_point t_now) {
+    job.n_wakeup += notify_stream_update(job.channel, job.lazy_wakeup);
+    job.n_notify++;
+    job.n_notified = job.n_published;
+    job.t_notify = t_now;
+}
+
+// Decode the pending tokens of a job, then sample and publish the next one. Sampling right after the job's own
+// decode keeps the logits valid when other jobs ran in between. Long prompts are evaluated n_ubatch tokens per
+// step, so they can be preempted too. Returns false once the job is finished.
+static bool job_step(llama_context* ctx, const llama_vocab* vocab, llama_batch& batch, GenerationJob& job,
+                     const StreamNotifyParams& notify_params) {
+    // A job stops at SEQ_CTX instead of taking the cells of the other sequences
+    if (job.n_decode >= job.max_tokens || job.n_past >= (llama_pos) SEQ_CTX) {
+        return false;
     }
 
-    // Prepare batch
-    llama_batch batch = llama_batch_get_one(tokens_list.data(), tokens_list.size());
+    const llama_pos n_prompt = (llama_pos) job.prompt.size();
+    common_batch_clear(batch);
+    if (job.n_past < n_prompt) {
+        const llama_pos n_chunk = std::min(n_prompt - job.n_past, (llama_pos) llama_n_ubatch(ctx));
+        for (llama_pos pos = job.n_past; pos < job.n_past + n_chunk; pos++) {
+            common_batch_add(batch, job.prompt[pos], pos, { job.seq_id }, pos == n_prompt - 1);
+        }
+        job.n_past += n_chunk;
+    } else {
+        common_batch_add(batch, job.last_token, job.n_past++, { job.seq_id }, true);
+    }
+    job.started = true;
 
-    // Evaluate the prompt
+    // Evaluate
     if (llama_decode(ctx, batch) != 0) {
-        std::cerr << "Error: Failed to decode prompt" << std::endl;
-        return "";
+        LOG_ERR("Error: Failed to decode\n");
+        job.status = STATUS_FAILED;
+        return false;
+    }
+    if (job.n_past < n_prompt) {
+        return true;
     }
 
-    // Initialize streaming state in shared memory
-    shared_mem->generation_complete = false;
-    shared_mem->update_counter = 0;
-    shared_mem->tokens_generated = 0;
-    memset(shared_mem->response, 0, sizeof(shared_mem->response));
+    // Sample the next token
+    const llama_token new_token_id = llama_sampler_sample(job.smpl, ctx, -1);
+
+    // Check for end of generation
+    if (llama_vocab_is_eog(vocab, new_token_id)) {
+        return false;
+    }
+
+    // Convert token to piece
+    char buf[256];
+    int n = llama_token_to_piece(vocab, new_token_id, buf, sizeof(buf), 0, true);
+    if (n < 0) {
+        LOG_ERR("Error: Failed to convert token to piece\n");
+        return false;
+    }
+
+    // Append the new bytes to shared memory, then publish the new length so the reader only copies the delta
+    ResponseChannel& channel = job.channel;
+    const size_t n_append = std::min((size_t) n, channel_reserve(channel, job.n_published + n) - job.n_published);
+    memcpy(channel.response + job.n_published, buf, n_append);
+    job.n_published += n_append;
+    __atomic_store_n(channel.response_length, (int) job.n_published, __ATOMIC_RELEASE);
+    *channel.tokens_generated = ++job.n_decode;
+    job.last_token = new_token_id;
+
+    // Signal C# that a chunk is ready. Notifications are coalesced: the first token is sent right away, then at
+    // most one update per interval unless chunk_bytes are pending. The interval doubles while the reader hasn't
+    // processed the previous update (only known with lazy wakeups) and shrinks back once it keeps up.
+    if (job.stream) {
+        const auto t_now = std::chrono::steady_clock::now();
+        const bool due = job.n_notify == 0 ||
+            t_now - job.t_notify >= std::chrono::milliseconds(job.interval_ms) ||
+            (notify_params.chunk_bytes > 0 && job.n_published - job.n_notified >= (size_t) notify_params.chunk_bytes);
+        if (due) {
+            if (job.lazy_wakeup && job.n_notify > 0) {
+                const bool behind = __atomic_load_n(channel.update_ack, __ATOMIC_ACQUIRE) != *channel.update_counter;
+                job.interval_ms = behind ? std::min(std::max(2 * job.interval_ms, 1), std::max(notify_params.max_interval_ms, notify_params.interval_ms))
+                                         : std::max(job.interval_ms / 2, notify_params.interval_ms);
+            }
+            job_notify(job, t_now);
+        }
+    }
+
+    return true;
+}
+
+// Announce the bytes a streaming job published since its last update. The scheduler calls this before it
+// switches to another job, so a preempted job's coalesced tail doesn't wait until the job runs again.
+static void job_flush(GenerationJob& job) {
+    if (job.stream && job.n_published > job.n_notified) {
+        job_notify(job, std::chrono::steady_clock::now());
+    }
+}
+
+// Release the KV sequence and sampler of a job and hand the final response to the reader
+static void job_finish(llama_context* ctx, GenerationJob& job) {
+    // Clear KV cache for next request
+    if (job.started) {
+        llama_memory_seq_rm(llama_get_memory(ctx), job.seq_id, -1, -1);
+    }
+    llama_sampler_free(job.smpl);
+    job.smpl = nullptr;
+
+    // Mark generation as complete
+    if (job.slot >= 0) {
+        job.n_wakeup += complete_slot(job.channel, job.status, job.lazy_wakeup);
+        job.n_notify++;
+        return;
+    }
+    *job.channel.generation_complete = true;
+    if (job.stream) {
+        job.n_wakeup += notify_stream_update(job.channel, job.lazy_wakeup);
+        job.n_notify++;
+    }
+
+    // Signal that response is ready (final), then accept the next request in the single request area
+    sem_post(sem_response_written);
+    sem_post(sem_ready);
+}
+
+// Serve the tokenizer request in the tokenizer data segment. Returns false if the request is malformed.
+static bool serve_tokenizer_request(const llama_vocab* vocab) {
+    TokenizerChannel& tok = shared_mem->tokenizer;
+    DataSegment& segment = tokenizer_segment;
+    if (!map_segment(segment)) {
+        return false;
+    }
+    const bool add_special = tok.flags & TOKENIZER_ADD_SPECIAL;
+    const bool parse_special = tok.flags & TOKENIZER_PARSE_SPECIAL;
+
+    // Split the request record into its items: [int32 n][n elements of elem_size bytes]
+    const size_t request_size = std::min((size_t) std::max(tok.request_size, 0), segment.mapped);
+    const size_t elem_size = tok.op == TOKENIZER_DETOKENIZE ? sizeof(llama_token) : 1;
+    const int n_items = tok.op == TOKENIZER_COUNT_PROMPT ? 2 * tok.n_items : tok.n_items;
+    std::vector<std::pair<size_t, int32_t>> items; // offset and number of elements
+    size_t pos = 0;
+    for (int i = 0; i < n_items; i++) {
+        int32_t n = 0;
+        if (pos + sizeof(n) > request_size) {
+            return false;
+        }
+        memcpy(&n, segment.data + pos, sizeof(n));
+        pos += sizeof(n);
+        if (n < 0 || (size_t) n > (request_size - pos) / elem_size) {
+            return false;
+        }
+        items.emplace_back(pos, n);
+        pos += n * elem_size;
+    }
 
-    // Generate response
-    int n_decode = 0;
     std::string response;
+    auto append_i32 = [&](int32_t value) {
+        response.append((const char*) &value, sizeof(value));
+    };
+    auto item_text = [&](int i) {
+        return std::string(segment.data + items[i].first, items[i].second);
+    };
 
-    while (n_decode < max_tokens) {
-        // Sample the next token
-        llama_token new_token_id = llama_sampler_sample(smpl, ctx, -1);
+    switch (tok.op) {
+        case TOKENIZER_TOKENIZE: {
+            std::vector<llama_token> tokens;
+            for (int i = 0; i < n_items; i++) {
+                const char* text = segment.data + items[i].first;
+                tokens.resize(items[i].second + 2);
+                int n = llama_tokenize(vocab, text, items[i].second, tokens.data(), tokens.size(), add_special, parse_special);
+                if (n < 0) {
+                    tokens.resize(-n);
+                    n = llama_tokenize(vocab, text, items[i].second, tokens.data(), tokens.size(), add_special, parse_special);
+                }
+                append_i32(n);
+                response.append((const char*) tokens.data(), n * sizeof(llama_token));
+            }
+            break;
+        }
+        case TOKENIZER_DETOKENIZE: {
+            const int n_vocab = llama_vocab_n_tokens(vocab);
+            std::vector<llama_token> tokens;
+            std::string text;
+            for (int i = 0; i < n_items; i++) {
+                tokens.resize(items[i].second);
+                memcpy(tokens.data(), segment.data + items[i].first, tokens.size() * sizeof(llama_token));
+                for (llama_token t : tokens) {
+                    if (t < 0 || t >= n_vocab) {
+                        return false;
+                    }
+                }
+                text.resize(tokens.size() * 8 + 16);
+                int n = llama_detokenize(vocab, tokens.data(), tokens.size(), &text[0], text.size(), false, parse_special);
+                if (n < 0) {
+                    text.resize(-n);
+                    n = llama_detokenize(vocab, tokens.data(), tokens.size(), &text[0], text.size(), false, parse_special);
+                }
+                append_i32(n);
+                response.append(text.data(), n);
+            }
+            break;
+        }
+        case TOKENIZER_COUNT: {
+            // Only the count is needed, llama_tokenize reports it without writing any token
+            for (int i = 0; i < n_items; i++) {
+                append_i32(-llama_tokenize(vocab, segment.data + items[i].first, items[i].second, NULL, 0,
+                                           add_special, parse_special));
+            }
+            break;
+        }
+        case TOKENIZER_COUNT_PROMPT: {
+            // Same tokenization as job_init
+            for (int i = 0; i < n_items; i += 2) {
+                const std::string prompt = format_prompt(item_text(i), item_text(i + 1));
+                append_i32(-llama_tokenize(vocab, prompt.c_str(), prompt.length(), NULL, 0, true, true));
+            }
+            break;
+        }
+        default:
+            return false;
+    }
 
-        // Check for end of generation
-        if (llama_vocab_is_eog(vocab, new_token_id)) {
+    // The response follows the request record, the segment grows when it doesn't fit
+    const size_t response_offset = (request_size + 63) & ~(size_t) 63;
+    if (response_offset + response.size() > segment.mapped && !grow_segment(segment, response_offset + response.size())) {
+        return false;
+    }
+    memcpy(segment.data + response_offset, response.data(), response.size());
+    tok.response_offset = (int) response_offset;
+    tok.response_size = (int) response.size();
+    return true;
+}
+
+// Tokenizer service, on its own thread so token counts never wait behind a generation. Stops on shutdown.
+static void run_tokenizer(const llama_vocab* vocab) {
+    while (true) {
+        sem_wait(sem_tokenizer_request);
+        if (shared_mem->shutdown_requested) {
+            return;
+        }
+
+        TokenizerChannel& tok = shared_mem->tokenizer;
+        tok.response_size = 0;
+        tok.status = serve_tokenizer_request(vocab) ? 0 : 1;
+        LOG_DBG_KV("Tokenizer request.", { "op", tok.op }, { "n_items", tok.n_items }, { "status", tok.status },
+                   { "response_size", tok.response_size });
+        sem_post(sem_tokenizer_response);
+    }
+}
+
+// CPUs of worker w when the CPUs this process may run on are split between n workers. Workers share CPUs when
+// there are fewer CPUs than workers.
+static std::vector<int> worker_cpus(int w, int n) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    std::vector<int> cpus;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &allowed)) {
+                cpus.push_back(c);
+            }
+        }
+    }
+    if ((int) cpus.size() < n) {
+        return cpus.empty() ? cpus : std::vector<int>{ cpus[w % cpus.size()] };
+    }
+    const size_t begin = cpus.size() * w / n;
+    const size_t end = cpus.size() * (w + 1) / n;
+    return std::vector<int>(cpus.begin() + begin, cpus.begin() + end);
+}
+
+// Finish a queue slot with STATUS_FAILED without serving it, when its worker is gone or on shutdown
+static void fail_slot(int i) {
+    complete_slot(slot_channel(i), STATUS_FAILED, true);
+}
+
+// Supervisor of the worker pool: hand each queued slot to the live worker serving the fewest requests (taking
+// turns on ties), and fail the requests of a worker that exited. Interactive requests preempt background ones
+// inside a worker, so they go to the worker with the fewest interactive requests first. Returns on shutdown, once
+// the workers are gone.
+static void run_dispatcher(std::vector<pid_t>& workers) {
+    const int n_workers = (int) workers.size();
+    int next = 0;
+
+    while (!shared_mem->shutdown_requested) {
+        // Wake up now and then to notice workers that died while the queue is quiet
+        timespec timeout;
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_sec += 1;
+        sem_timedwait(sem_queue, &timeout);
+        if (shared_mem->shutdown_requested) {
             break;
         }
 
-        // Convert token to piece
-        char buf[256];
-        int n = llama_token_to_piece(vocab, new_token_id, buf, sizeof(buf), 0, true);
-        if (n < 0) {
-            std::cerr << "\nError: Failed to convert token to piece" << std::endl;
+        pid_t pid;
+        int wstatus;
+        while ((pid = waitpid(-1, &wstatus, WNOHANG)) > 0) {
+            for (int w = 0; w < n_workers; w++) {
+                if (workers[w] != pid) {
+                    continue;
+                }
+                LOG_ERR("Error: Worker %d exited unexpectedly (status %d)\n", w, wstatus);
+                workers[w] = -1;
+                for (int i = 0; i < QUEUE_SLOTS; i++) {
+                    const int state = __atomic_load_n(&shared_mem->slots[i].state, __ATOMIC_ACQUIRE);
+                    if ((state == SLOT_ASSIGNED || state == SLOT_RUNNING) && shared_mem->slots[i].worker == w) {
+                        fail_slot(i);
+                    }
+                }
+            }
+        }
+        if (std::all_of(workers.begin(), workers.end(), [](pid_t p) { return p < 0; })) {
+            LOG_ERR("Error: No worker left\n");
             break;
         }
-        std::string piece(buf, n);
-        response += piece;
+
+        int load[QUEUE_SLOTS] = {};
+        int load_interactive[QUEUE_SLOTS] = {};
+        for (int i = 0; i < QUEUE_SLOTS; i++) {
+            const RequestSlot& slot = shared_mem->slots[i];
+            const int state = __atomic_load_n(&slot.state, __ATOMIC_ACQUIRE);
+            if (state == SLOT_ASSIGNED || state == SLOT_RUNNING) {
+                load[slot.worker]++;
+                load_interactive[slot.worker] += slot.priority == PRIORITY_INTERACTIVE;
+            }
+        }
+
+        for (int i = 0; i < QUEUE_SLOTS; i++) {
+            RequestSlot& slot = shared_mem->slots[i];
+            if (__atomic_load_n(&slot.state, __ATOMIC_ACQUIRE) != SLOT_QUEUED) {
+                continue;
+            }
+            const bool interactive = slot.priority == PRIORITY_INTERACTIVE;
+            auto busier = [&](int a, int b) {
+                if (interactive && load_interactive[a] != load_interactive[b]) {
+                    return load_interactive[a] > load_interactive[b];
+                }
+                return load[a] > load[b];
+            };
+            int best = -1;
+            for (int k = 0; k < n_workers; k++) {
+                const int w = (next + k) % n_workers;
+                if (workers[w] >= 0 && (best < 0 || busier(best, w))) {
+                    best = w;
+                }
+            }
+            next = (best + 1) % n_workers;
+            load[best]++;
+            load_interactive[best] += interactive;
+
+            slot.worker = best;
+            __atomic_store_n(&slot.state, (int) SLOT_ASSIGNED, __ATOMIC_RELEASE);
+            sem_post(sem_worker[best]);
+        }
+    }
+
+    for (int w = 0; w < n_workers; w++) {
+        if (workers[w] >= 0) {
+            sem_post(sem_worker[w]);
+            waitpid(workers[w], nullptr, 0);
+        }
+    }
+
+    // The workers failed their own requests on the way out, what is left was never dispatched or belonged to a
+    // worker that died
+    for (int i = 0; i < QUEUE_SLOTS; i++) {
+        const int state = __atomic_load_n(&shared_mem->slots[i].state, __ATOMIC_ACQUIRE);
+        if (state == SLOT_QUEUED || state == SLOT_ASSIGNED || state == SLOT_RUNNING) {
+            fail_slot(i);
+        }
+    }
+}
+
+// Serve the shared memory requests with one context until the C# application asks for shutdown. worker is the
+// index of this process in the worker pool, or -1 when it serves the whole queue by itself. n_threads = 0 keeps
+// the default number of threads.
+static int run_scheduler(llama_model* model, int worker, int n_threads, const StreamNotifyParams& notify_params) {
+    // Get vocab
+    const llama_vocab* vocab = llama_model_get_vocab(model);
+
+    // Context parameters
+    llama_context_params ctx_params = llama_context_default_params();
+    ctx_params.n_seq_max = QUEUE_SLOTS + 1; // One sequence per queue slot, plus the single request area
+    ctx_params.n_ctx = SEQ_CTX * ctx_params.n_seq_max; // Context size, SEQ_CTX cells for every sequence
+    ctx_params.n_batch = 2048; // Batch size for prompt processing
+    ctx_params.kv_unified = true; // The sequences share the n_ctx cells
+    if (n_threads > 0) {
+        ctx_params.n_threads = n_threads;
+        ctx_params.n_threads_batch = n_threads;
+    }
+
+    // Create context
+    llama_context* ctx = llama_init_from_model(model, ctx_params);
+    if (ctx == nullptr) {
+        LOG_ERR("Error: Failed to create context\n");
+        return 1;
+    }
+
+    // Initialize the sampler, each request works on a clone of it
+    llama_sampler* smpl = llama_sampler_chain_init(llama_sampler_chain_default_params());
+    llama_sampler_chain_add(smpl, llama_sampler_init_min_p(0.05f, 1));
+    llama_sampler_chain_add(smpl, llama_sampler_init_temp(0.7f));
+    llama_sampler_chain_add(smpl, llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
+
+    if (worker > 0) {
+        LOG_INF("Worker %d ready (%d threads).\n", worker, llama_n_threads(ctx));
+    } else {
+        LOG_INF("Model loaded. Ready to process requests from C#.\n");
+        LOG_INF("Signal ready to C# application...\n");
+    }
+
+    // A pool worker is only rung for the slots the supervisor assigned to it
+    sem_t* doorbell = worker < 0 ? sem_queue : sem_worker[worker];
+    const int admit_state = worker < 0 ? SLOT_QUEUED : SLOT_ASSIGNED;
+    
+    // Requests in the single request area are announced on sem_prompts_written, forward them to the scheduler.
+    // In a worker pool the first worker serves them.
+    std::atomic<bool> legacy_pending(false);
+    std::atomic<bool> shutdown_pending(false);
+    std::thread legacy_thread;
+    if (worker <= 0) {
+        legacy_thread = std::thread([&]() {
+            while (true) {
+                // Wait for C# to write prompts
+                sem_wait(sem_prompts_written);
+                
+                // Check for shutdown request
+                if (shared_mem->shutdown_requested) {
+                    shutdown_pending = true;
+                    sem_post(doorbell);
+                    return;
+                }
+                legacy_pending = true;
+                sem_post(doorbell);
+            }
+        });
+    }
+
+    // Scheduler: admit new requests, then advance the most urgent one by one token. Interactive requests go
+    // before background ones, then the earliest deadline, then arrival order, so a background generation is
+    // preempted at the next token boundary and resumes once no interactive request is left.
+    llama_batch batch = llama_batch_init(ctx_params.n_batch, 0, 1);
+    std::vector<GenerationJob> jobs;
+    int request_id = 0;
+    int last_job = -1;
+
+    // Signal that we're ready
+    if (worker <= 0) {
+        sem_post(sem_ready);
+        LOG_INF("Waiting for prompts from C#...\n");
+    }
+
+    // The other pool workers stop when the supervisor rings them after the shutdown request
+    while (!shutdown_pending && !(worker > 0 && shared_mem->shutdown_requested)) {
+        while (sem_trywait(doorbell) == 0) {
+        }
+
+        auto admit = [&](GenerationJob& job, const std::string& system_prompt, const std::string& user_prompt) {
+            job.id = request_id++;
+            job.smpl = llama_sampler_clone(smpl);
+            llama_sampler_reset(job.smpl);
+
+            LOG_INF_KV("Received prompts from C#.",
+                       { "id", job.id }, { "request", job.request_id }, { "slot", job.slot }, { "worker", std::max(worker, 0) },
+                       { "priority", job.priority == PRIORITY_INTERACTIVE ? "interactive" : "background" },
+                       { "stream", job.stream ? "enabled" : "disabled" },
+                       { "system", system_prompt.empty() ? "(empty)" : system_prompt.c_str() }, { "user", user_prompt });
+
+            if (!job_init(ctx, vocab, job, system_prompt, user_prompt, notify_params) || job.channel.response == nullptr) {
+                job.status = STATUS_FAILED;
+            }
+            jobs.push_back(std::move(job));
+        };
+
+        if (legacy_pending.exchange(false)) {
+            GenerationJob job;
+            job.channel = legacy_channel();
+            job.stream = shared_mem->stream_mode;
+            job.lazy_wakeup = shared_mem->lazy_wakeup;
+            shared_mem->lazy_wakeup = false; // opted into per request, readers that don't know the flag get every post
+            // Read prompts from shared memory
+            admit(job, std::string(shared_mem->system_prompt), std::string(shared_mem->user_prompt));
+        }
+
+        for (int i = 0; i < QUEUE_SLOTS; i++) {
+            RequestSlot& slot = shared_mem->slots[i];
+            if (__atomic_load_n(&slot.state, __ATOMIC_ACQUIRE) != admit_state || (worker >= 0 && slot.worker != worker)) {
+                continue;
+            }
+            slot.state = SLOT_RUNNING;
+
+            GenerationJob job;
+            job.request_id = slot.request_id;
+            job.slot = i;
+            job.seq_id = i + 1;
+            job.priority = slot.priority;
+            job.deadline_ms = slot.deadline_ms;
+            // 0 has no limit, as with --max-tokens 0; the sequence context still caps it
+            job.max_tokens = slot.max_tokens > 0 ? slot.max_tokens : INT_MAX;
+            job.stream = slot.stream_mode;
+            job.lazy_wakeup = true;
+
+            // Read prompts from the slot data segment
+            std::string system_prompt;
+            std::string user_prompt;
+            if (!map_segment(slot_segment[i]) || !read_slot_request(i, system_prompt, user_prompt)) {
+                LOG_ERR("Error: Invalid request record in slot %d\n", i);
+                job.status = STATUS_FAILED;
+            }
+            job.channel = slot_channel(i);
+            admit(job, system_prompt, user_prompt);
+        }
+
+        if (jobs.empty()) {
+            sem_wait(doorbell);
+            continue;
+        }
+
+        // Requests still waiting at their deadline are dropped
+        const long long now_ms = unix_time_ms();
+        for (GenerationJob& job : jobs) {
+            if (job.status == STATUS_OK && !job.started && job.deadline_ms > 0 && now_ms > job.deadline_ms) {
+                job.status = STATUS_EXPIRED;
+            }
+        }
+
+        auto urgent = [](const GenerationJob& a, const GenerationJob& b) {
+            if ((a.status != STATUS_OK) != (b.status != STATUS_OK)) {
+                return a.status != STATUS_OK; // finish failed and expired requests first
+            }
+            if (a.priority != b.priority) {
+                return a.priority > b.priority;
+            }
+            const long long da = a.deadline_ms > 0 ? a.deadline_ms : LLONG_MAX;
+            const long long db = b.deadline_ms > 0 ? b.deadline_ms : LLONG_MAX;
+            if (da != db) {
+                return da < db;
+            }
+            return a.id < b.id;
+        };
+        auto it = std::min_element(jobs.begin(), jobs.end(), urgent);
+        GenerationJob& job = *it;
+
+        if (job.id != last_job && last_job >= 0) {
+            for (GenerationJob& other : jobs) {
+                if (other.id == last_job) {
+                    job_flush(other);
+                    if (job.status == STATUS_OK) {
+                        LOG_DBG_KV("Preempting request.", { "id", other.id }, { "n_gen", other.n_decode }, { "by", job.id });
+                    }
+                }
+            }
+        }
+        last_job = job.id;
+
+        if (job.status == STATUS_OK && job_step(ctx, vocab, batch, job, notify_params)) {
+            continue;
+        }
+
+        job_finish(ctx, job);
         
-        // Write partial response to shared memory
-        strncpy(shared_mem->response, response.c_str(), sizeof(shared_mem->response) - 1);
-        shared_mem->response[sizeof(shared_mem->response) - 1] = '\0';
-        shared_mem->tokens_generated = n_decode + 1;
-        shared_mem->update_counter++;
+        const double t_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.t_start).count();
         
-        // Signal C# that a chunk is ready
-        sem_post(sem_chunk_ready);
-
-        // Prepare the next batch with the new token
-        batch = llama_batch_get_one(&new_token_id, 1);
+        LOG_INF_KV("Response generation complete.",
+                   { "id", job.id }, { "request", job.request_id }, { "slot", job.slot }, { "worker", std::max(worker, 0) },
+                   { "status", job.status == STATUS_OK ? "ok" : job.status == STATUS_EXPIRED ? "expired" : "failed" },
+                   { "n_prompt", (int) job.prompt.size() }, { "n_gen", job.n_decode },
+                   { "n_notify", job.n_notify }, { "n_wakeup", job.n_wakeup },
+                   { "t_ms", t_ms }, { "tok_per_s", t_ms > 0.0 ? 1e3 * job.n_decode / t_ms : 0.0 });
         
-        n_decode++;
+        jobs.erase(it);
+    }
+    LOG_INF("Shutdown requested by C# application.\n");
+    if (legacy_thread.joinable()) {
+        legacy_thread.join();
+    }
+    if (worker == 0) {
+        sem_post(sem_queue); // let the supervisor stop the other workers
+    }
 
-        // Evaluate
-        if (llama_decode(ctx, batch) != 0) {
-            std::cerr << "\nError: Failed to decode" << std::endl;
-            break;
+    // Fail the requests still in flight or waiting to be admitted, their producers are blocked until the slot is done
+    for (GenerationJob& job : jobs) {
+        job.status = STATUS_FAILED;
+        job_finish(ctx, job);
+    }
+    jobs.clear();
+    for (int i = 0; i < QUEUE_SLOTS; i++) {
+        const RequestSlot& slot = shared_mem->slots[i];
+        if (__atomic_load_n(&slot.state, __ATOMIC_ACQUIRE) == admit_state && (worker < 0 || slot.worker == worker)) {
+            fail_slot(i);
         }
     }
 
-    // Mark generation as complete
-    shared_mem->generation_complete = true;
-    shared_mem->update_counter++;
-    sem_post(sem_chunk_ready);
-    
-    // Reset the sampler state
-    llama_sampler_reset(smpl);
-    
-    // Clear KV cache for next request (remove all tokens from sequence 0)
-    llama_memory_t mem = llama_get_memory(ctx);
-    llama_memory_seq_rm(mem, 0, -1, -1);
-    
-    return response;
+    // Cleanup
+    LOG_INF("Cleaning up...\n");
+    llama_batch_free(batch);
+    llama_sampler_free(smpl);
+    llama_free(ctx);
+    return 0;
 }
 
 int main(int argc, char** argv) {
@@ -442,7 +1456,7 @@ int main(int argc, char** argv) {
 
         // Context parameters
         llama_context_params ctx_params = llama_context_default_params();
-        ctx_params.n_ctx = 2048;  // Context size
+        ctx_params.n_ctx = SEQ_CTX;  // Context size
         ctx_params.n_batch = 2048; // Batch size for prompt processing
 
         // Create context
@@ -538,28 +1552,53 @@ int main(int argc, char** argv) {
         return 0;
     } else {
         // Shared memory mode - continuous operation
-        std::cout << "Starting in shared memory mode for C# integration..." << std::endl;
+        // Log through the asynchronous logger, the serving loop below does no synchronous I/O
+        common_log_set_prefix(common_log_main(), true);
+        common_log_set_timestamps(common_log_main(), true);
+
+        LOG_INF("Starting in shared memory mode for C# integration...\n");
+
+        StreamNotifyParams notify_params;
+        int n_workers = 1;
+        try {
+            const std::string interval_str = get_arg_value(argc, argv, "--stream-interval-ms");
+            const std::string chunk_str = get_arg_value(argc, argv, "--stream-chunk-bytes");
+            const std::string workers_str = get_arg_value(argc, argv, "--workers");
+            if (!interval_str.empty()) {
+                notify_params.interval_ms = std::max(std::stoi(interval_str), 0);
+            }
+            if (!chunk_str.empty()) {
+                notify_params.chunk_bytes = std::max(std::stoi(chunk_str), 0);
+            }
+            if (!workers_str.empty()) {
+                n_workers = std::min(std::max(std::stoi(workers_str), 1), QUEUE_SLOTS);
+            }
+        } catch (...) {
+            LOG_ERR("Error: Invalid --stream-interval-ms, --stream-chunk-bytes or --workers value\n");
+            return 1;
+        }
         
         // Setup signal handlers
         signal(SIGINT, signal_handler);
         signal(SIGTERM, signal_handler);
         
         // Initialize shared memory
-        if (!init_shared_memory()) {
-            std::cerr << "Error: Failed to initialize shared memory" << std::endl;
+        if (!init_shared_memory() || (n_workers > 1 && !init_worker_pool(n_workers))) {
+            LOG_ERR("Error: Failed to initialize shared memory\n");
+            cleanup_shared_resources();
             return 1;
         }
         
-        std::cout << "Shared memory initialized successfully." << std::endl;
+        LOG_INF("Shared memory initialized successfully.\n");
         
         // Model path
         const std::string model_path = "models/Phi-3-mini-4k-instruct-q4.gguf";
-        std::cout << "Loading model: " << model_path << std::endl;
+        LOG_INF("Loading model: %s\n", model_path.c_str());
 
         // Set logging to errors only
         llama_log_set([](enum ggml_log_level level, const char * text, void *) {
             if (level >= GGML_LOG_LEVEL_ERROR) {
-                fprintf(stderr, "%s", text);
+                common_log_add(common_log_main(), level, "%s", text);
             }
         }, nullptr);
 
@@ -573,98 +1612,76 @@ int main(int argc, char** argv) {
         // Load the model
         llama_model* model = llama_model_load_from_file(model_path.c_str(), model_params);
         if (model == nullptr) {
-            std::cerr << "Error: Failed to load model from " << model_path << std::endl;
+            LOG_ERR("Error: Failed to load model from %s\n", model_path.c_str());
             cleanup_shared_resources();
             return 1;
         }
 
-        // Get vocab
         const llama_vocab* vocab = llama_model_get_vocab(model);
 
-        // Context parameters
-        llama_context_params ctx_params = llama_context_default_params();
-        ctx_params.n_ctx = 2048;  // Context size
-        ctx_params.n_batch = 2048; // Batch size for prompt processing
-
-        // Create context
-        llama_context* ctx = llama_init_from_model(model, ctx_params);
-        if (ctx == nullptr) {
-            std::cerr << "Error: Failed to create context" << std::endl;
+        if (n_workers == 1) {
+            std::thread tokenizer_thread(run_tokenizer, vocab);
+            const int ret = run_scheduler(model, -1, 0, notify_params);
+            shared_mem->shutdown_requested = true;
+            sem_post(sem_tokenizer_request);
+            tokenizer_thread.join();
             llama_model_free(model);
             cleanup_shared_resources();
-            return 1;
+            LOG_INF("Shutdown complete.\n");
+            return ret;
         }
 
-        // Initialize the sampler
-        llama_sampler* smpl = llama_sampler_chain_init(llama_sampler_chain_default_params());
-        llama_sampler_chain_add(smpl, llama_sampler_init_min_p(0.05f, 1));
-        llama_sampler_chain_add(smpl, llama_sampler_init_temp(0.7f));
-        llama_sampler_chain_add(smpl, llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
+        // Worker pool: the model is loaded (and its weights repacked) once, the forked workers share these pages
+        // copy-on-write and only create their own context. The log thread doesn't survive fork, pause it meanwhile.
+        LOG_INF("Starting %d workers...\n", n_workers);
+        std::vector<pid_t> workers;
+        const pid_t supervisor = getpid();
+        common_log_pause(common_log_main());
+        for (int w = 0; w < n_workers; w++) {
+            const pid_t pid = fork();
+            if (pid == 0) {
+                common_log_resume(common_log_main());
+                signal(SIGINT, SIG_DFL);
+                signal(SIGTERM, SIG_DFL);
+                prctl(PR_SET_PDEATHSIG, SIGTERM);
+                if (getppid() != supervisor) {
+                    _exit(1);
+                }
 
-        std::cout << "Model loaded. Ready to process requests from C#." << std::endl;
-        std::cout << "Signal ready to C# application..." << std::endl;
-        
-        // Main loop
-        while (true) {
-            // Signal that we're ready
-            sem_post(sem_ready);
-            
-            std::cout << "Waiting for prompts from C#..." << std::endl;
-            
-            // Wait for C# to write prompts
-            sem_wait(sem_prompts_written);
-            
-            // Check for shutdown request
-            if (shared_mem->shutdown_requested) {
-                std::cout << "Shutdown requested by C# application." << std::endl;
-                break;
+                const std::vector<int> cpus = worker_cpus(w, n_workers);
+                cpu_set_t cpu_set;
+                CPU_ZERO(&cpu_set);
+                for (int c : cpus) {
+                    CPU_SET(c, &cpu_set);
+                }
+                if (!cpus.empty() && sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+                    LOG_WRN("Warning: Failed to set the CPUs of worker %d\n", w);
+                }
+
+                const int ret = run_scheduler(model, w, std::max((int) cpus.size(), 1), notify_params);
+                common_log_pause(common_log_main());
+                _exit(ret);
             }
-            
-            std::cout << "Received prompts from C#. Processing..." << std::endl;
-            
-            // Read prompts from shared memory
-            std::string system_prompt(shared_mem->system_prompt);
-            std::string user_prompt(shared_mem->user_prompt);
-            
-            std::cout << "System Prompt: " << (system_prompt.empty() ? "(empty)" : system_prompt) << std::endl;
-            std::cout << "User Prompt: " << user_prompt << std::endl;
-            
-            // Check if C# wants streaming
-            bool stream_requested = shared_mem->stream_mode;
-            std::cout << "Stream Mode: " << (stream_requested ? "Enabled" : "Disabled") << std::endl;
-            
-            std::string response;
-            if (stream_requested) {
-                // Streaming mode - send partial responses
-                std::cout << "Processing with streaming..." << std::endl;
-                response = process_llm_request_streaming(model, ctx, vocab, smpl, 
-                                                        system_prompt, user_prompt, 0);
-            } else {
-                // Normal mode - send complete response
-                std::cout << "Processing normally..." << std::endl;
-                response = process_llm_request(model, ctx, vocab, smpl, 
-                                               system_prompt, user_prompt, false, 0);
-                
-                // Write response to shared memory
-                strncpy(shared_mem->response, response.c_str(), sizeof(shared_mem->response) - 1);
-                shared_mem->response[sizeof(shared_mem->response) - 1] = '\0';
+            if (pid < 0) {
+                LOG_ERR("Error: Failed to start worker %d\n", w);
+                break;
             }
-            
-            std::cout << "Response generation complete. Signaling C#..." << std::endl;
-            
-            // Signal that response is ready (final)
-            sem_post(sem_response_written);
+            workers.push_back(pid);
         }
+        common_log_resume(common_log_main());
 
-        // Cleanup
-        std::cout << "Cleaning up..." << std::endl;
-        llama_sampler_free(smpl);
-        llama_free(ctx);
+        // The supervisor has no decode loop, it serves the tokenizer requests
+        std::thread tokenizer_thread(run_tokenizer, vocab);
+        if (!workers.empty()) {
+            run_dispatcher(workers);
+        }
+        shared_mem->shutdown_requested = true;
+        sem_post(sem_tokenizer_request);
+        tokenizer_thread.join();
         llama_model_free(model);
         cleanup_shared_resources();
-        
-        std::cout << "Shutdown complete." << std::endl;
-        return 0;
+        LOG_INF("Shutdown complete.\n");
+        return workers.empty() ? 1 : 0;
     }
 }
 